@@ -1757,7 +1757,7 @@ static int subvert_sendmsg_child (broker_ctx_t *ctx, const flux_msg_t *msg,
     snprintf (uuid, sizeof (uuid), "%"PRIu32, nodeid);
     if (flux_msg_push_route (cpy, uuid) < 0)
         goto done;
-    if (overlay_sendmsg_child (ctx->overlay, cpy) < 0)
+    if (overlay_sendmsg_child (ctx->overlay, cpy, uuid) < 0)
         goto done;
     rc = 0;
 done:
@@ -1865,7 +1865,7 @@ static int broker_response_sendmsg (broker_ctx_t *ctx, const flux_msg_t *msg)
      */
     rc = module_response_sendmsg (ctx->modhash, msg);
     if (rc < 0 && errno == ENOSYS)
-        rc = overlay_sendmsg_child (ctx->overlay, msg);
+        rc = overlay_sendmsg_child (ctx->overlay, msg, uuid);
 done:
     if (uuid)
         free (uuid);
@@ -18,8 +18,10 @@
 #include <flux/core.h>
 #include "src/common/libutil/xzmalloc.h"
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/blobvec.h"
 #include "src/common/libutil/iterators.h"
 #include "src/common/libutil/log.h"
+#include "src/common/libutil/monotime.h"
 
 #include "attr.h"
 #include "content-cache.h"
@@ -43,22 +45,32 @@ static const uint32_t default_flush_batch_limit = 256;
 struct cache_entry {
     void *data;
     int len;
-    char *blobref;
+    struct blobkey key;             /* hash type and digest */
     uint8_t valid:1;                /* entry contains valid data */
     uint8_t dirty:1;                /* entry needs to be stored upstream */
                                     /*   or to backing store (rank 0) */
     uint8_t load_pending:1;
     uint8_t store_pending:1;
+    uint8_t on_lru:1;               /* entry is linked on the lru list */
+    uint8_t on_lru_large:1;         /* ...and on the large entry lru list */
     zlist_t *load_requests;
     zlist_t *store_requests;
+    zlist_t *load_batches;          /* batch slots awaiting load */
+    zlist_t *store_batches;         /* batch slots awaiting store */
+    int holds;                      /* batch slots referring to entry data */
     int lastused;
+
+    struct cache_entry *lru_prev;
+    struct cache_entry *lru_next;
+    struct cache_entry *lru_large_prev;
+    struct cache_entry *lru_large_next;
 };
 
 struct content_cache {
     flux_t *h;
     flux_msg_handler_t **handlers;
     uint32_t rank;
-    zhash_t *entries;
+    zhashx_t *entries;
     uint8_t backing:1;              /* 'content.backing' service available */
     char *backing_name;
     char hash_name[BLOBREF_MAX_STRING_SIZE];
@@ -77,10 +89,48 @@ struct content_cache {
     uint32_t acct_size;             /* total size of all cache entries */
     uint32_t acct_valid;            /* count of valid cache entries */
     uint32_t acct_dirty;            /* count of dirty cache entries */
+
+    /* Valid, clean entries are kept on a list ordered by recency of use,
+     * most recently used first.  Purge takes entries from the tail.
+     * Those of at least purge_large_entry bytes when last used are also
+     * kept on a second list in the same order, for purging by size.
+     */
+    struct cache_entry *lru_first;
+    struct cache_entry *lru_last;
+    struct cache_entry *lru_large_first;
+    struct cache_entry *lru_large_last;
+
+    uint32_t purge_count;           /* count of entries purged */
+    uint32_t purge_size;            /* total size of entries purged */
+    double purge_time;              /* time spent purging (ms) */
+};
+
+/* A load-batch or store-batch request is tracked by a batch with one
+ * slot per blob.  The batch is responded to once all slots are complete.
+ * A load slot holds its cache entry so that the data remains in cache
+ * until the response is sent.
+ */
+struct batch;
+
+struct batch_slot {
+    struct batch *batch;
+    struct cache_entry *e;          /* load: entry holding data (held) */
+    struct blobkey key;             /* store: key for response */
+    int errnum;
+};
+
+struct batch {
+    content_cache_t *cache;
+    flux_msg_t *msg;
+    bool store;
+    int pending;                    /* incomplete slots, plus one for setup */
+    int count;
+    struct batch_slot slots[];
 };
 
 static void flush_respond (content_cache_t *cache);
 static int cache_flush (content_cache_t *cache);
+static void batch_slots_complete (zlist_t **l, int errnum);
 
 static void message_list_destroy (zlist_t **l)
 {
@@ -156,21 +206,29 @@ static void cache_entry_destroy (void *arg)
     if (e) {
         if (e->data)
             free (e->data);
-        if (e->blobref)
-            free (e->blobref);
         assert (!e->load_requests || zlist_size (e->load_requests) == 0);
         assert (!e->store_requests || zlist_size (e->store_requests) == 0);
         message_list_destroy (&e->load_requests);
         message_list_destroy (&e->store_requests);
+        zlist_destroy (&e->load_batches);
+        zlist_destroy (&e->store_batches);
         free (e);
     }
 }
 
+static void cache_entry_destructor (void **item)
+{
+    if (item) {
+        cache_entry_destroy (*item);
+        *item = NULL;
+    }
+}
+
 /* Create a cache entry.
  * Initially only the digest is filled in;  defaults for the rest (zeroed).
  * Returns entry on success, NULL with errno set on failure.
  */
-static struct cache_entry *cache_entry_create (const char *blobref)
+static struct cache_entry *cache_entry_create (const struct blobkey *key)
 {
     struct cache_entry *e = malloc (sizeof (*e));
     if (!e) {
@@ -178,11 +236,7 @@ static struct cache_entry *cache_entry_create (const char *blobref)
         return NULL;
     }
     memset (e, 0, sizeof (*e));
-    if (!(e->blobref = strdup (blobref))) {
-        free (e);
-        errno = ENOMEM;
-        return NULL;
-    }
+    e->key = *key;
     return e;
 }
 
@@ -208,18 +262,77 @@ done:
     return rc;
 }
 
-/* Insert a cache entry, by blobref.
+/* Unlink a cache entry from the lru lists, if linked.
+ */
+static void lru_remove (content_cache_t *cache, struct cache_entry *e)
+{
+    if (e->on_lru_large) {
+        if (e->lru_large_prev)
+            e->lru_large_prev->lru_large_next = e->lru_large_next;
+        else
+            cache->lru_large_first = e->lru_large_next;
+        if (e->lru_large_next)
+            e->lru_large_next->lru_large_prev = e->lru_large_prev;
+        else
+            cache->lru_large_last = e->lru_large_prev;
+        e->lru_large_prev = e->lru_large_next = NULL;
+        e->on_lru_large = 0;
+    }
+    if (!e->on_lru)
+        return;
+    if (e->lru_prev)
+        e->lru_prev->lru_next = e->lru_next;
+    else
+        cache->lru_first = e->lru_next;
+    if (e->lru_next)
+        e->lru_next->lru_prev = e->lru_prev;
+    else
+        cache->lru_last = e->lru_prev;
+    e->lru_prev = e->lru_next = NULL;
+    e->on_lru = 0;
+}
+
+/* Mark a cache entry used in the current epoch.  If it is valid and clean,
+ * (re-)link it at the head of the lru list, making it the last candidate
+ * for purge.  Entries that are invalid, dirty, or held by a batch request
+ * are not purgeable, so they are kept off the list.  Because the epoch never
+ * decreases, the list stays ordered by 'lastused'.
+ */
+static void lru_touch (content_cache_t *cache, struct cache_entry *e)
+{
+    lru_remove (cache, e);
+    e->lastused = cache->epoch;
+    if (!e->valid || e->dirty || e->holds > 0)
+        return;
+    e->lru_next = cache->lru_first;
+    if (cache->lru_first)
+        cache->lru_first->lru_prev = e;
+    else
+        cache->lru_last = e;
+    cache->lru_first = e;
+    e->on_lru = 1;
+    if (e->len < cache->purge_large_entry)
+        return;
+    e->lru_large_next = cache->lru_large_first;
+    if (cache->lru_large_first)
+        cache->lru_large_first->lru_large_prev = e;
+    else
+        cache->lru_large_last = e;
+    cache->lru_large_first = e;
+    e->on_lru_large = 1;
+}
+
+/* Insert a cache entry, by digest.
  * Returns 0 on success, -1 on failure with errno set.
  * Side effect: destroys entry on failure.
  */
 static int insert_entry (content_cache_t *cache, struct cache_entry *e)
 {
-    if (zhash_insert (cache->entries, e->blobref, e) < 0) {
+    if (zhashx_insert (cache->entries, &e->key, e) < 0) {
         cache_entry_destroy (e);
-        errno = ENOMEM;
+        errno = EEXIST;
         return -1;
     }
-    zhash_freefn (cache->entries, e->blobref, cache_entry_destroy);
     if (e->valid) {
         cache->acct_size += e->len;
         cache->acct_valid++;
@@ -229,27 +342,28 @@ static int insert_entry (content_cache_t *cache, struct cache_entry *e)
     return 0;
 }
 
-/* Look up a cache entry, by blobref.
+/* Look up a cache entry, by digest.
  * Returns entry on success, NULL on failure.
  * N.B. errno is not set
  */
 static struct cache_entry *lookup_entry (content_cache_t *cache,
-                                         const char *blobref)
+                                         const struct blobkey *key)
 {
-    return zhash_lookup (cache->entries, blobref);
+    return zhashx_lookup (cache->entries, key);
 }
 
 /* Remove a cache entry.
  */
 static void remove_entry (content_cache_t *cache, struct cache_entry *e)
 {
+    lru_remove (cache, e);
     if (e->valid) {
         cache->acct_size -= e->len;
         cache->acct_valid--;
     }
     if (e->dirty)
         cache->acct_dirty--;
-    zhash_delete (cache->entries, e->blobref);
+    zhashx_delete (cache->entries, &e->key);
 }
 
 /* Load operation
@@ -263,50 +377,58 @@ static void remove_entry (content_cache_t *cache, struct cache_entry *e)
  * an error such as ENOENT.
  */
 
+/* Complete a load operation on cache entry 'e', successful if errnum == 0.
+ * Respond to all parked requests and remove the entry on failure.
+ */
+static void cache_load_complete (content_cache_t *cache, struct cache_entry *e,
+                                 int errnum, const void *data, int len)
+{
+    e->load_pending = 0;
+    if (errnum != 0 && e->valid)
+        errnum = 0; /* entry was filled by a store in the mean time */
+    if (errnum == 0 && cache_entry_fill (e, data, len) < 0) {
+        errnum = errno;
+        flux_log_error (cache->h, "content load");
+    }
+    if (errnum == 0 && !e->valid) {
+        e->valid = 1;
+        cache->acct_valid++;
+        cache->acct_size += len;
+    }
+    if (respond_requests_raw (&e->load_requests, cache->h, errnum,
+                                                    e->data, e->len) < 0)
+        flux_log_error (cache->h, "%s: error responding to load requests",
+                        __FUNCTION__);
+    batch_slots_complete (&e->load_batches, errnum);
+    if (errnum != 0)
+        remove_entry (cache, e);
+    else
+        lru_touch (cache, e);
+}
+
 static void cache_load_continuation (flux_future_t *f, void *arg)
 {
     content_cache_t *cache = arg;
     struct cache_entry *e = flux_future_aux_get (f, "entry");
     const void *data = NULL;
     int len = 0;
-    int saved_errno;
-    int rc = -1;
+    int errnum = 0;
 
-    e->load_pending = 0;
     if (flux_content_load_get (f, &data, &len) < 0) {
         if (errno == ENOSYS && cache->rank == 0)
             errno = ENOENT;
-        saved_errno = errno;
+        errnum = errno;
         if (errno != ENOENT)
             flux_log_error (cache->h, "content load");
-        goto done;
-    }
-    if (cache_entry_fill (e, data, len) < 0) {
-        saved_errno = errno;
-        flux_log_error (cache->h, "content load");
-        goto done;
-    }
-    if (!e->valid) {
-        e->valid = 1;
-        cache->acct_valid++;
-        cache->acct_size += len;
     }
-    e->lastused = cache->epoch;
-    rc = 0;
-done:
-    if (respond_requests_raw (&e->load_requests, cache->h,
-                                                    rc < 0 ? saved_errno : 0,
-                                                    e->data, e->len) < 0)
-        flux_log_error (cache->h, "%s: error responding to load requests",
-                        __FUNCTION__);
-    if (rc < 0)
-        remove_entry (cache, e);
+    cache_load_complete (cache, e, errnum, data, len);
     flux_future_destroy (f);
 }
 
 static int cache_load (content_cache_t *cache, struct cache_entry *e)
 {
     flux_future_t *f;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
     int saved_errno = 0;
     int flags = CONTENT_FLAG_UPSTREAM;
     int rc = -1;
@@ -315,7 +437,11 @@ static int cache_load (content_cache_t *cache, struct cache_entry *e)
         return 0;
     if (cache->rank == 0)
         flags = CONTENT_FLAG_CACHE_BYPASS;
-    if (!(f = flux_content_load (cache->h, e->blobref, flags))) {
+    if (blobkey_tostr (&e->key, blobref, sizeof (blobref)) < 0) {
+        saved_errno = errno;
+        goto done;
+    }
+    if (!(f = flux_content_load (cache->h, blobref, flags))) {
         if (errno == ENOSYS && cache->rank == 0)
             errno = ENOENT;
         saved_errno = errno;
@@ -347,6 +473,7 @@ void content_load_request (flux_t *h, flux_msg_handler_t *mh,
     content_cache_t *cache = arg;
     const char *blobref;
     int blobref_size;
+    struct blobkey key;
     void *data = NULL;
     int len = 0;
     struct cache_entry *e;
@@ -362,12 +489,22 @@ void content_load_request (flux_t *h, flux_msg_handler_t *mh,
         saved_errno = errno = EPROTO;
         goto done;
     }
-    if (!(e = lookup_entry (cache, blobref))) {
+    if (blobkey_fromstr (&key, blobref) < 0) {
+        saved_errno = errno;
+        goto done;
+    }
+    /* Only blobs of the configured hash type can have been stored.
+     */
+    if (!blobkey_match_hashtype (&key, cache->hash_name)) {
+        saved_errno = errno = ENOENT;
+        goto done;
+    }
+    if (!(e = lookup_entry (cache, &key))) {
         if (cache->rank == 0 && !cache->backing) {
             saved_errno = errno = ENOENT;
             goto done;
         }
-        if (!(e = cache_entry_create (blobref))
+        if (!(e = cache_entry_create (&key))
                                             || insert_entry (cache, e) < 0) {
             saved_errno = errno;
             flux_log_error (h, "content load");
@@ -386,7 +523,7 @@ void content_load_request (flux_t *h, flux_msg_handler_t *mh,
         }
         return; /* RPC continuation will respond to msg */
     }
-    e->lastused = cache->epoch;
+    lru_touch (cache, e);
     data = e->data;
     len = e->len;
     rc = 0;
@@ -421,51 +558,41 @@ done:
  * offload rank 0 hash entries at a slower pace.
  */
 
-static void cache_store_continuation (flux_future_t *f, void *arg)
+/* Complete a store operation on cache entry 'e', successful if errnum == 0.
+ * Respond to all parked requests.
+ */
+static void cache_store_complete (content_cache_t *cache,
+                                  struct cache_entry *e, int errnum)
 {
-    content_cache_t *cache = arg;
-    struct cache_entry *e = flux_future_aux_get (f, "entry");
-    const char *blobref;
-    int saved_errno = 0;
-    int rc = -1;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
 
     e->store_pending = 0;
     assert (cache->flush_batch_count > 0);
     cache->flush_batch_count--;
-    if (flux_content_store_get (f, &blobref) < 0) {
-        saved_errno = errno;
-        if (cache->rank == 0 && errno == ENOSYS)
-            flux_log (cache->h, LOG_DEBUG, "content store: %s",
-                      "backing store service unavailable");
-        else
-            flux_log_error (cache->h, "content store");
-        goto done;
-    }
-    if (strcmp (blobref, e->blobref)) {
-        saved_errno = errno = EIO;
-        flux_log (cache->h, LOG_ERR, "content store: wrong blobref");
-        goto done;
-    }
-    if (e->dirty) {
+    if (errnum == 0 && e->dirty) {
         cache->acct_dirty--;
         e->dirty = 0;
+        lru_touch (cache, e);
     }
-    rc = 0;
-done:
-    if (respond_requests_raw (&e->store_requests, cache->h,
-                                        rc < 0 ? saved_errno : 0,
-                                        e->blobref, strlen (e->blobref) + 1) < 0)
+    if (errnum == 0 && blobkey_tostr (&e->key, blobref, sizeof (blobref)) < 0)
+        errnum = errno;
+    if (respond_requests_raw (&e->store_requests, cache->h, errnum,
+                              errnum != 0 ? NULL : blobref,
+                              errnum != 0 ? 0 : strlen (blobref) + 1) < 0)
         flux_log_error (cache->h, "%s: error responding to store requests",
                         __FUNCTION__);
-    flux_future_destroy (f);
+    batch_slots_complete (&e->store_batches, errnum);
+}
 
-    /* If cache has been flushed, respond to flush requests, if any.
-     * If there are still dirty entries and the number of outstanding
-     * store requests would not exceed the limit, flush more entries.
-     * Optimization: since scanning for dirty entries is a linear search,
-     * only do it when the number of outstanding store requests falls to
-     * a low water mark, here hardwired to be half of the limit.
-     */
+/* If cache has been flushed, respond to flush requests, if any.
+ * If there are still dirty entries and the number of outstanding
+ * store requests would not exceed the limit, flush more entries.
+ * Optimization: since scanning for dirty entries is a linear search,
+ * only do it when the number of outstanding store requests falls to
+ * a low water mark, here hardwired to be half of the limit.
+ */
+static void cache_store_resume (content_cache_t *cache)
+{
     if (cache->acct_dirty == 0 || (cache->rank == 0 && !cache->backing))
         flush_respond (cache);
     else if (cache->acct_dirty - cache->flush_batch_count > 0
@@ -473,6 +600,32 @@ done:
         (void)cache_flush (cache); /* resume flushing */
 }
 
+static void cache_store_continuation (flux_future_t *f, void *arg)
+{
+    content_cache_t *cache = arg;
+    struct cache_entry *e = flux_future_aux_get (f, "entry");
+    const char *blobref;
+    struct blobkey key;
+    int errnum = 0;
+
+    if (flux_content_store_get (f, &blobref) < 0) {
+        errnum = errno;
+        if (cache->rank == 0 && errno == ENOSYS)
+            flux_log (cache->h, LOG_DEBUG, "content store: %s",
+                      "backing store service unavailable");
+        else
+            flux_log_error (cache->h, "content store");
+    }
+    else if (blobkey_fromstr (&key, blobref) < 0
+                            || blobkey_cmp (&key, &e->key) != 0) {
+        errnum = EIO;
+        flux_log (cache->h, LOG_ERR, "content store: wrong blobref");
+    }
+    cache_store_complete (cache, e, errnum);
+    flux_future_destroy (f);
+    cache_store_resume (cache);
+}
+
 static int cache_store (content_cache_t *cache, struct cache_entry *e)
 {
     flux_future_t *f;
@@ -513,6 +666,51 @@ done:
     return rc;
 }
 
+/* Place blob in cache under 'key', creating the cache entry if needed.
+ * If the entry was invalid, it is made valid (responding to any queued
+ * load requests), and then dirty.
+ * Returns entry on success, NULL on failure with errno set.
+ */
+static struct cache_entry *cache_store_entry (content_cache_t *cache,
+                                              const struct blobkey *key,
+                                              const void *data, int len)
+{
+    struct cache_entry *e;
+
+    if (!(e = lookup_entry (cache, key))) {
+        if (!(e = cache_entry_create (key)))
+            return NULL;
+        if (insert_entry (cache, e) < 0)
+            return NULL; /* insert destroys 'e' on failure */
+    }
+    if (!e->valid) {
+        if (cache_entry_fill (e, data, len) < 0)
+            return NULL;
+        e->valid = 1;
+        cache->acct_valid++;
+        cache->acct_size += len;
+        if (respond_requests_raw (&e->load_requests, cache->h, 0,
+                                                        e->data, e->len) < 0)
+            flux_log_error (cache->h, "%s: error responding to load requests",
+                            __FUNCTION__);
+        batch_slots_complete (&e->load_batches, 0);
+        if (!e->dirty) {
+            e->dirty = 1;
+            cache->acct_dirty++;
+        }
+    }
+    /* When a backing store module is unloaded, it will clear
+     * cache->backing then attempt to store all its blobs.  Any of
+     * those still in cache need to be marked dirty.
+     */
+    else if (!e->dirty && cache->rank == 0 && !cache->backing) {
+        e->dirty = 1;
+        cache->acct_dirty++;
+    }
+    lru_touch (cache, e);
+    return e;
+}
+
 static void content_store_request (flux_t *h, flux_msg_handler_t *mh,
                                    const flux_msg_t *msg, void *arg)
 {
@@ -520,6 +718,7 @@ static void content_store_request (flux_t *h, flux_msg_handler_t *mh,
     const void *data;
     int len;
     struct cache_entry *e = NULL;
+    struct blobkey key;
     char blobref[BLOBREF_MAX_STRING_SIZE];
     int rc = -1;
 
@@ -529,52 +728,19 @@ static void content_store_request (flux_t *h, flux_msg_handler_t *mh,
         errno = EFBIG;
         goto done;
     }
-    if (blobref_hash (cache->hash_name, (uint8_t *)data, len, blobref,
-                      sizeof (blobref)) < 0)
+    if (blobkey_hash (cache->hash_name, data, len, &key) < 0)
         goto done;
-
-    if (!(e = lookup_entry (cache, blobref))) {
-        if (!(e = cache_entry_create (blobref)))
-            goto done;
-        if (insert_entry (cache, e) < 0)
-            goto done; /* insert destroys 'e' on failure */
-    }
-    if (!e->valid) {
-        if (cache_entry_fill (e, data, len) < 0)
+    if (blobkey_tostr (&key, blobref, sizeof (blobref)) < 0)
+        goto done;
+    if (!(e = cache_store_entry (cache, &key, data, len)))
+        goto done;
+    if (e->dirty && (cache->rank > 0 || cache->backing)) {
+        if (cache_store (cache, e) < 0)
             goto done;
-        if (!e->valid) {
-            e->valid = 1;
-            cache->acct_valid++;
-            cache->acct_size += len;
-        }
-        if (respond_requests_raw (&e->load_requests, cache->h, 0,
-                                                        e->data, e->len) < 0)
-            flux_log_error (cache->h, "%s: error responding to load requests",
-                            __FUNCTION__);
-        if (!e->dirty) {
-            e->dirty = 1;
-            cache->acct_dirty++;
-        }
-    }
-    e->lastused = cache->epoch;
-    if (e->dirty) {
-        if (cache->rank > 0 || cache->backing) {
-            if (cache_store (cache, e) < 0)
+        if (cache->rank > 0) {  /* write-through */
+            if (defer_request (&e->store_requests, msg) < 0)
                 goto done;
-            if (cache->rank > 0) {  /* write-through */
-                if (defer_request (&e->store_requests, msg) < 0)
-                    goto done;
-                return;
-            }
-        }
-    } else {
-        /* When a backing store module is unloaded, it will clear
-         * cache->backing then attempt to store all its blobs.  Any of
-         * those still in cache need to be marked dirty.
-         */
-        if (cache->rank == 0 && !cache->backing) {
-            e->dirty = 1;
-            cache->acct_dirty++;
+            return;
         }
     }
     rc = 0;
@@ -590,6 +756,468 @@ done:
     }
 }
 
+/* Batch load and store operations
+ *
+ * A content.load-batch or content.store-batch request carries many blobs,
+ * encoded as a blobvec.  Each blob is handled as in the single blob case,
+ * except that on ranks > 0, cache misses (load) and dirty entries (store)
+ * are coalesced into a single batch request to the next level of TBON.
+ * On rank 0, the backing store is accessed one blob at a time as before.
+ * One response is sent when all blobs of the batch are complete, carrying
+ * a result for each blob in request order.
+ */
+
+static void batch_destroy (struct batch *b)
+{
+    if (b) {
+        int saved_errno = errno;
+        int i;
+        for (i = 0; i < b->count; i++) {
+            struct cache_entry *e = b->slots[i].e;
+            if (e) {
+                assert (e->holds > 0);
+                e->holds--;
+                lru_touch (b->cache, e);
+            }
+        }
+        flux_msg_destroy (b->msg);
+        free (b);
+        errno = saved_errno;
+    }
+}
+
+static struct batch *batch_create (content_cache_t *cache,
+                                   const flux_msg_t *msg,
+                                   int count, bool store)
+{
+    struct batch *b;
+
+    if (!(b = calloc (1, sizeof (*b) + count * sizeof (b->slots[0])))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (!(b->msg = flux_msg_copy (msg, false))) {
+        free (b);
+        return NULL;
+    }
+    b->cache = cache;
+    b->store = store;
+    b->count = count;
+    b->pending = 1;
+    return b;
+}
+
+static void batch_respond (struct batch *b)
+{
+    flux_t *h = b->cache->h;
+    blobvec_t *bv;
+    const void *buf;
+    int len;
+    int i;
+
+    if (!(bv = blobvec_create ()))
+        goto error;
+    for (i = 0; i < b->count; i++) {
+        struct batch_slot *slot = &b->slots[i];
+        char blobref[BLOBREF_MAX_STRING_SIZE];
+        int rc;
+
+        if (slot->errnum != 0)
+            rc = blobvec_append (bv, slot->errnum, NULL, 0);
+        else if (!b->store)
+            rc = blobvec_append (bv, 0, slot->e->data, slot->e->len);
+        else if (blobkey_tostr (&slot->key, blobref, sizeof (blobref)) < 0)
+            rc = blobvec_append (bv, errno, NULL, 0);
+        else
+            rc = blobvec_append (bv, 0, blobref, strlen (blobref) + 1);
+        if (rc < 0)
+            goto error;
+    }
+    if (blobvec_encode (bv, &buf, &len) < 0)
+        goto error;
+    if (flux_respond_raw (h, b->msg, buf, len) < 0)
+        flux_log_error (h, "content batch: flux_respond_raw");
+    blobvec_destroy (bv);
+    return;
+error:
+    if (flux_respond_error (h, b->msg, errno, NULL) < 0)
+        flux_log_error (h, "content batch: flux_respond_error");
+    blobvec_destroy (bv);
+}
+
+/* Drop a reference on the batch, responding to the batch request and
+ * destroying the batch once the last reference is dropped.
+ */
+static void batch_unref (struct batch *b)
+{
+    if (--b->pending == 0) {
+        batch_respond (b);
+        batch_destroy (b);
+    }
+}
+
+/* Park batch slot on a cache entry list, to be completed by
+ * batch_slots_complete().
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int batch_slot_wait (zlist_t **l, struct batch_slot *slot)
+{
+    if (!*l) {
+        if (!(*l = zlist_new ()))
+            goto nomem;
+    }
+    if (zlist_append (*l, slot) < 0)
+        goto nomem;
+    slot->batch->pending++;
+    return 0;
+nomem:
+    errno = ENOMEM;
+    return -1;
+}
+
+/* Complete a list of batch slots identically.
+ * A failed load slot releases its hold on the cache entry.
+ * The list is always run to completion, then destroyed.
+ */
+static void batch_slots_complete (zlist_t **l, int errnum)
+{
+    struct batch_slot *slot;
+
+    if (*l) {
+        while ((slot = zlist_pop (*l))) {
+            slot->errnum = errnum;
+            if (errnum != 0 && slot->e) {
+                slot->e->holds--;
+                slot->e = NULL;
+            }
+            batch_unref (slot->batch);
+        }
+        zlist_destroy (l);
+    }
+}
+
+/* Send one load-batch request upstream for a NULL-terminated array of
+ * cache entries, which is freed when the RPC completes.  Results are fed back
+ * through cache_load_complete().
+ */
+static void cache_load_batch_continuation (flux_future_t *f, void *arg)
+{
+    content_cache_t *cache = arg;
+    struct cache_entry **entries = flux_future_aux_get (f, "entries");
+    const void *data;
+    int len;
+    int i;
+
+    for (i = 0; entries[i] != NULL; i++) {
+        int errnum = 0;
+
+        data = NULL;
+        len = 0;
+        if (flux_content_load_batch_get (f, i, &data, &len) < 0) {
+            errnum = errno;
+            if (errno != ENOENT)
+                flux_log_error (cache->h, "content load-batch");
+        }
+        cache_load_complete (cache, entries[i], errnum, data, len);
+    }
+    flux_future_destroy (f);
+    free (entries);
+}
+
+static void cache_load_batch (content_cache_t *cache,
+                              struct cache_entry **entries, int count)
+{
+    char (*refs)[BLOBREF_MAX_STRING_SIZE] = NULL;
+    const char **refv = NULL;
+    flux_future_t *f = NULL;
+    int errnum;
+    int i;
+
+    if (!(refs = calloc (count, sizeof (refs[0])))
+                            || !(refv = calloc (count, sizeof (refv[0])))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    for (i = 0; i < count; i++) {
+        if (blobkey_tostr (&entries[i]->key, refs[i], sizeof (refs[i])) < 0)
+            goto error;
+        refv[i] = refs[i];
+    }
+    if (!(f = flux_content_load_batch (cache->h, refv, count,
+                                       CONTENT_FLAG_UPSTREAM)))
+        goto error;
+    if (flux_future_aux_set (f, "entries", entries, NULL) < 0)
+        goto error;
+    if (flux_future_then (f, -1., cache_load_batch_continuation, cache) < 0)
+        goto error;
+    free (refs);
+    free (refv);
+    return;
+error:
+    errnum = errno;
+    flux_log_error (cache->h, "content load-batch");
+    flux_future_destroy (f);
+    for (i = 0; i < count; i++)
+        cache_load_complete (cache, entries[i], errnum, NULL, 0);
+    free (entries);
+    free (refs);
+    free (refv);
+}
+
+static void content_load_batch_request (flux_t *h, flux_msg_handler_t *mh,
+                                        const flux_msg_t *msg, void *arg)
+{
+    content_cache_t *cache = arg;
+    const void *buf;
+    int len;
+    blobvec_t *bv = NULL;
+    struct batch *b = NULL;
+    struct cache_entry **misses = NULL;
+    int nmisses = 0;
+    int count;
+    int i;
+
+    if (flux_request_decode_raw (msg, NULL, &buf, &len) < 0)
+        goto error;
+    if (!(bv = blobvec_decode (buf, len)))
+        goto error;
+    if ((count = blobvec_count (bv)) == 0) {
+        errno = EPROTO;
+        goto error;
+    }
+    if (!(b = batch_create (cache, msg, count, false)))
+        goto error;
+    if (!(misses = calloc (count + 1, sizeof (misses[0])))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    for (i = 0; i < count; i++) {
+        struct batch_slot *slot = &b->slots[i];
+        struct cache_entry *e;
+        struct blobkey key;
+        const char *blobref;
+        int blobref_size;
+        int errnum;
+
+        slot->batch = b;
+        if (blobvec_get (bv, i, &errnum, (const void **)&blobref,
+                                                    &blobref_size) < 0
+                || errnum != 0 || blobref_size < 1
+                || blobref[blobref_size - 1] != '\0') {
+            slot->errnum = EPROTO;
+            continue;
+        }
+        if (blobkey_fromstr (&key, blobref) < 0) {
+            slot->errnum = errno;
+            continue;
+        }
+        if (!blobkey_match_hashtype (&key, cache->hash_name)) {
+            slot->errnum = ENOENT;
+            continue;
+        }
+        if (!(e = lookup_entry (cache, &key))) {
+            if (cache->rank == 0 && !cache->backing) {
+                slot->errnum = ENOENT;
+                continue;
+            }
+            if (!(e = cache_entry_create (&key))
+                                            || insert_entry (cache, e) < 0) {
+                slot->errnum = errno;
+                flux_log_error (h, "content load-batch");
+                continue; /* insert destroys 'e' on failure */
+            }
+        }
+        slot->e = e;
+        e->holds++;
+        if (e->valid) {
+            lru_touch (cache, e);
+            continue;
+        }
+        if (batch_slot_wait (&e->load_batches, slot) < 0) {
+            slot->errnum = errno;
+            slot->e = NULL;
+            e->holds--;
+            continue;
+        }
+        if (!e->load_pending) {
+            if (cache->rank > 0) {
+                e->load_pending = 1;
+                misses[nmisses++] = e;
+            }
+            else if (cache_load (cache, e) < 0)
+                cache_load_complete (cache, e, errno, NULL, 0);
+        }
+    }
+    blobvec_destroy (bv);
+    if (nmisses > 0)
+        cache_load_batch (cache, misses, nmisses);
+    else
+        free (misses);
+    batch_unref (b);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "content load-batch: flux_respond_error");
+    free (misses);
+    batch_destroy (b);
+    blobvec_destroy (bv);
+}
+
+/* Send one store-batch request upstream for a NULL-terminated array of
+ * dirty cache entries, which is freed when the RPC completes.  Results are fed
+ * back through cache_store_complete().
+ */
+static void cache_store_batch_continuation (flux_future_t *f, void *arg)
+{
+    content_cache_t *cache = arg;
+    struct cache_entry **entries = flux_future_aux_get (f, "entries");
+    int i;
+
+    for (i = 0; entries[i] != NULL; i++) {
+        const char *blobref;
+        struct blobkey key;
+        int errnum = 0;
+
+        if (flux_content_store_batch_get (f, i, &blobref) < 0) {
+            errnum = errno;
+            flux_log_error (cache->h, "content store-batch");
+        }
+        else if (blobkey_fromstr (&key, blobref) < 0
+                            || blobkey_cmp (&key, &entries[i]->key) != 0) {
+            errnum = EIO;
+            flux_log (cache->h, LOG_ERR, "content store-batch: wrong blobref");
+        }
+        cache_store_complete (cache, entries[i], errnum);
+    }
+    flux_future_destroy (f);
+    free (entries);
+    cache_store_resume (cache);
+}
+
+static void cache_store_batch (content_cache_t *cache,
+                               struct cache_entry **entries, int count)
+{
+    const void **bufs = NULL;
+    int *lens = NULL;
+    flux_future_t *f = NULL;
+    int errnum;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        entries[i]->store_pending = 1;
+        cache->flush_batch_count++;
+    }
+    if (!(bufs = calloc (count, sizeof (bufs[0])))
+                            || !(lens = calloc (count, sizeof (lens[0])))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    for (i = 0; i < count; i++) {
+        bufs[i] = entries[i]->data;
+        lens[i] = entries[i]->len;
+    }
+    if (!(f = flux_content_store_batch (cache->h, bufs, lens, count,
+                                        CONTENT_FLAG_UPSTREAM)))
+        goto error;
+    if (flux_future_aux_set (f, "entries", entries, NULL) < 0)
+        goto error;
+    if (flux_future_then (f, -1., cache_store_batch_continuation, cache) < 0)
+        goto error;
+    free (bufs);
+    free (lens);
+    return;
+error:
+    errnum = errno;
+    flux_log_error (cache->h, "content store-batch");
+    flux_future_destroy (f);
+    for (i = 0; i < count; i++)
+        cache_store_complete (cache, entries[i], errnum);
+    free (entries);
+    free (bufs);
+    free (lens);
+}
+
+static void content_store_batch_request (flux_t *h, flux_msg_handler_t *mh,
+                                         const flux_msg_t *msg, void *arg)
+{
+    content_cache_t *cache = arg;
+    const void *buf;
+    int len;
+    blobvec_t *bv = NULL;
+    struct batch *b = NULL;
+    struct cache_entry **dirty = NULL;
+    int ndirty = 0;
+    int count;
+    int i;
+
+    if (flux_request_decode_raw (msg, NULL, &buf, &len) < 0)
+        goto error;
+    if (!(bv = blobvec_decode (buf, len)))
+        goto error;
+    if ((count = blobvec_count (bv)) == 0) {
+        errno = EPROTO;
+        goto error;
+    }
+    if (!(b = batch_create (cache, msg, count, true)))
+        goto error;
+    if (!(dirty = calloc (count + 1, sizeof (dirty[0])))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    for (i = 0; i < count; i++) {
+        struct batch_slot *slot = &b->slots[i];
+        struct cache_entry *e;
+        const void *data;
+        int data_size;
+        int errnum;
+
+        slot->batch = b;
+        if (blobvec_get (bv, i, &errnum, &data, &data_size) < 0
+                                                            || errnum != 0) {
+            slot->errnum = EPROTO;
+            continue;
+        }
+        if (data_size > cache->blob_size_limit) {
+            slot->errnum = EFBIG;
+            continue;
+        }
+        if (blobkey_hash (cache->hash_name, data, data_size, &slot->key) < 0
+            || !(e = cache_store_entry (cache, &slot->key, data, data_size))) {
+            slot->errnum = errno;
+            continue;
+        }
+        if (!e->dirty)
+            continue;
+        if (cache->rank > 0) {  /* write-through */
+            if (batch_slot_wait (&e->store_batches, slot) < 0) {
+                slot->errnum = errno;
+                continue;
+            }
+            if (!e->store_pending) {
+                e->store_pending = 1; /* claim entry for this batch */
+                dirty[ndirty++] = e;
+            }
+        }
+        else if (cache->backing) {
+            if (cache_store (cache, e) < 0)
+                slot->errnum = errno;
+        }
+    }
+    blobvec_destroy (bv);
+    if (ndirty > 0)
+        cache_store_batch (cache, dirty, ndirty);
+    else
+        free (dirty);
+    batch_unref (b);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "content store-batch: flux_respond_error");
+    free (dirty);
+    batch_destroy (b);
+    blobvec_destroy (bv);
+}
+
 /* Backing store is enabled/disabled by modules that provide the
  * 'content.backing' service.  At module load time, the backing module
  * informs the content service of its availability, and entries are
@@ -609,7 +1237,7 @@ done:
 static int cache_flush (content_cache_t *cache)
 {
     struct cache_entry *e;
-    const char *key;
+    const struct blobkey *key;
     int saved_errno = 0;
     int count = 0;
     int rc = 0;
@@ -619,7 +1247,7 @@ static int cache_flush (content_cache_t *cache)
         return 0;
 
     flux_log (cache->h, LOG_DEBUG, "content flush begin");
-    FOREACH_ZHASH (cache->entries, key, e) {
+    FOREACH_ZHASHX (cache->entries, key, e) {
         if (!e->dirty || e->store_pending)
             continue;
         if (cache_store (cache, e) < 0) {
@@ -673,16 +1301,13 @@ done:
 };
 
 /* Forcibly drop all entries from the cache that can be dropped
- * without data loss.
- * N.B. this walks the entire cache in one go.
+ * without data loss.  Those are exactly the entries on the lru list.
  */
 
 static void content_dropcache_request (flux_t *h, flux_msg_handler_t *mh,
                                        const flux_msg_t *msg, void *arg)
 {
     content_cache_t *cache = arg;
-    zlist_t *keys = NULL;
-    char *key;
     struct cache_entry *e;
     int orig_size;
     int saved_errno;
@@ -690,17 +1315,10 @@ static void content_dropcache_request (flux_t *h, flux_msg_handler_t *mh,
 
     if (flux_request_decode (msg, NULL, NULL) < 0)
         goto done;
-    orig_size = zhash_size (cache->entries);
-    if (!(keys = zhash_keys (cache->entries))) {
-        errno = ENOMEM;
-        goto done;
-    }
-    while ((key = zlist_pop (keys))) {
-        e = zhash_lookup (cache->entries, key);
-        assert (e != NULL);
-        if (e->valid && !e->dirty)
-            remove_entry (cache, e);
-        free (key);
+    orig_size = zhashx_size (cache->entries);
+    while ((e = cache->lru_last)) {
+        assert (e->valid && !e->dirty);
+        remove_entry (cache, e);
     }
     rc = 0;
 done:
@@ -710,11 +1328,10 @@ done:
                   flux_strerror (saved_errno));
     else
         flux_log (h, LOG_DEBUG, "content dropcache %d/%d",
-                  orig_size - (int)zhash_size (cache->entries), orig_size);
+                  orig_size - (int)zhashx_size (cache->entries), orig_size);
     errno = saved_errno;
     if (flux_respond (h, msg, rc < 0 ? errno : 0, NULL) < 0)
         flux_log_error (h, "content dropcache");
-    zlist_destroy (&keys);
 }
 
 /* Return stats about the cache.
@@ -727,11 +1344,14 @@ static void content_stats_request (flux_t *h, flux_msg_handler_t *mh,
 
     if (flux_request_decode (msg, NULL, NULL) < 0)
         goto error;
-    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i}",
-                           "count", zhash_size (cache->entries),
+    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i s:i s:i s:f }",
+                           "count", zhashx_size (cache->entries),
                            "valid", cache->acct_valid,
                            "dirty", cache->acct_dirty,
-                           "size", cache->acct_size) < 0)
+                           "size", cache->acct_size,
+                           "purge-count", cache->purge_count,
+                           "purge-size", cache->purge_size,
+                           "purge-time", cache->purge_time) < 0)
         flux_log_error (h, "content stats");
     return;
 error:
@@ -800,50 +1420,45 @@ done:
         flux_log_error (h, "content flush");
 }
 
-/* Heartbeat drives periodic cache purge
+/* Heartbeat drives periodic cache purge.
+ * Candidates are taken from the cold end of an lru list, so the cost is
+ * proportional to the number of entries purged, not the size of the cache.
+ * Since the lists are ordered by 'lastused', each walk stops at the first
+ * entry that is too young to be purged.  While the entry target is
+ * exceeded, any entry may go.  After that, while only the size target is
+ * exceeded, entries come from the large entry list, so small entries are
+ * never visited.
  */
 
-static int cache_purge (content_cache_t *cache)
+static void cache_purge (content_cache_t *cache)
 {
-    int after_entries = zhash_size (cache->entries);
-    int after_size = cache->acct_size;
     struct cache_entry *e;
-    zlist_t *purge = NULL;
-    int rc = -1;
-    const char *key;
-
-    if (cache->acct_dirty == zhash_size (cache->entries))
-        return 0;
+    struct timespec t0;
+    int count = 0;
+    uint32_t size = 0;
 
-    FOREACH_ZHASH (cache->entries, key, e) {
-        if (after_size <= cache->purge_target_size
-                        && after_entries <= cache->purge_target_entries)
-            break;
-        if (!e->valid || e->dirty)
-            continue;
+    monotime (&t0);
+    while ((e = cache->lru_last)
+            && zhashx_size (cache->entries) > cache->purge_target_entries) {
         if (cache->epoch - e->lastused < cache->purge_old_entry)
-            continue;
-        if (after_entries <= cache->purge_target_entries
-                    && e->len < cache->purge_large_entry)
-            continue;
-        if ((!purge && !(purge = zlist_new ()))
-                    || zlist_append (purge, e) < 0) {
-            errno = ENOMEM;
-            goto done;
-        }
-        after_size -= e->len;
-        after_entries--;
+            break;
+        size += e->len;
+        count++;
+        remove_entry (cache, e);
     }
-    if (purge) {
-        flux_log (cache->h, LOG_DEBUG, "content purge: %d entries",
-                  (int)zlist_size (purge));
-        while ((e = zlist_pop (purge)))
-            remove_entry (cache, e);
+    while ((e = cache->lru_large_last)
+            && cache->acct_size > cache->purge_target_size) {
+        if (cache->epoch - e->lastused < cache->purge_old_entry)
+            break;
+        size += e->len;
+        count++;
+        remove_entry (cache, e);
     }
-    rc = 0;
-done:
-    zlist_destroy (&purge);
-    return rc;
+    cache->purge_count += count;
+    cache->purge_size += size;
+    cache->purge_time += monotime_since (t0);
+    if (count > 0)
+        flux_log (cache->h, LOG_DEBUG, "content purge: %d entries", count);
 }
 
 static void heartbeat_event (flux_t *h, flux_msg_handler_t *mh,
@@ -864,6 +1479,10 @@ static const struct flux_msg_handler_spec htab[] = {
       FLUX_ROLE_USER },
     { FLUX_MSGTYPE_REQUEST, "content.store",     content_store_request,
       FLUX_ROLE_USER },
+    { FLUX_MSGTYPE_REQUEST, "content.load-batch",
+      content_load_batch_request, FLUX_ROLE_USER },
+    { FLUX_MSGTYPE_REQUEST, "content.store-batch",
+      content_store_batch_request, FLUX_ROLE_USER },
     { FLUX_MSGTYPE_REQUEST, "content.backing",   content_backing_request, 0 },
     { FLUX_MSGTYPE_REQUEST, "content.dropcache", content_dropcache_request, 0 },
     { FLUX_MSGTYPE_REQUEST, "content.stats.get", content_stats_request, 0 },
@@ -911,7 +1530,7 @@ static int content_cache_getattr (const char *name, const char **val, void *arg)
     else if (!strcmp (name, "content.backing"))
         *val = cache->backing_name;
     else if (!strcmp (name, "content.acct-entries")) {
-        snprintf (s, sizeof (s), "%zd", zhash_size (cache->entries));
+        snprintf (s, sizeof (s), "%zd", zhashx_size (cache->entries));
         *val = s;
     } else
         return -1;
@@ -981,7 +1600,7 @@ void content_cache_destroy (content_cache_t *cache)
         }
         if (cache->backing_name)
             free (cache->backing_name);
-        zhash_destroy (&cache->entries);
+        zhashx_destroy (&cache->entries);
         message_list_destroy (&cache->flush_requests);
         free (cache);
     }
@@ -994,11 +1613,19 @@ content_cache_t *content_cache_create (void)
         errno = ENOMEM;
         return NULL;
     }
-    if (!(cache->entries = zhash_new ())) {
+    if (!(cache->entries = zhashx_new ())) {
         content_cache_destroy (cache);
         errno = ENOMEM;
         return NULL;
     }
+    /* Entries are keyed by binary digest.  Keys are not duplicated,
+     * the hash refers to the key stored in each cache entry.
+     */
+    zhashx_set_key_hasher (cache->entries, blobkey_hasher);
+    zhashx_set_key_comparator (cache->entries, blobkey_cmp);
+    zhashx_set_key_duplicator (cache->entries, NULL);
+    zhashx_set_key_destructor (cache->entries, NULL);
+    zhashx_set_destructor (cache->entries, cache_entry_destructor);
     cache->rank = FLUX_NODEID_ANY;
     cache->blob_size_limit = default_blob_size_limit;
     cache->flush_batch_limit = default_flush_batch_limit;
@@ -26,6 +26,7 @@
 #include <stdarg.h>
 #include <argz.h>
 #include <czmq.h>
+#include <jansson.h>
 #include <flux/core.h>
 
 #include "src/common/libutil/log.h"
@@ -76,10 +77,13 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
                           const flux_msg_t *msg, void *arg)
 {
     flux_msgcounters_t mcs;
+    uint64_t copied, shared;
 
     flux_get_msgcounters (h, &mcs);
+    flux_msg_payload_stats (&copied, &shared);
 
-    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i s:i s:i s:i s:i }",
+    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i s:i s:i s:i s:i"
+                                   " s:I s:I }",
                            "#request (tx)", mcs.request_tx,
                            "#request (rx)", mcs.request_rx,
                            "#response (tx)", mcs.response_tx,
@@ -87,7 +91,9 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
                            "#event (tx)", mcs.event_tx,
                            "#event (rx)", mcs.event_rx,
                            "#keepalive (tx)", mcs.keepalive_tx,
-                           "#keepalive (rx)", mcs.keepalive_rx) < 0)
+                           "#keepalive (rx)", mcs.keepalive_rx,
+                           "payload bytes (copied)", (json_int_t)copied,
+                           "payload bytes (shared)", (json_int_t)shared) < 0)
       FLUX_LOG_ERROR (h);
 }
 
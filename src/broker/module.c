@@ -38,6 +38,7 @@
 #include "src/common/libutil/xzmalloc.h"
 #include "src/common/libutil/oom.h"
 #include "src/common/libutil/iterators.h"
+#include "src/common/libutil/subtrie.h"
 
 #include "heartbeat.h"
 #include "module.h"
@@ -80,12 +81,11 @@ struct module_struct {
     flux_msg_t *insmod;
 
     flux_t *h;               /* module's handle */
-
-    zlist_t *subs;          /* subscription strings */
 };
 
 struct modhash_struct {
     zhash_t *zh_byuuid;
+    subtrie_t *subs;        /* event subscriptions of all modules */
     uint32_t rank;
     flux_t *broker_h;
     heartbeat_t *heartbeat;
@@ -338,12 +338,6 @@ static void module_destroy (module_t *p)
             flux_msg_destroy (msg);
     }
     flux_msg_destroy (p->insmod);
-    if (p->subs) {
-        char *s;
-        while ((s = zlist_pop (p->subs)))
-            free (s);
-        zlist_destroy (&p->subs);
-    }
     zlist_destroy (&p->rmmod);
     p->magic = ~MODULE_MAGIC;
     free (p);
@@ -534,8 +528,6 @@ module_t *module_add (modhash_t *mh, const char *path)
         oom ();
     if (!(p->rmmod = zlist_new ()))
         oom ();
-    if (!(p->subs = zlist_new ()))
-        oom ();
 
     p->rank = mh->rank;
     p->broker_h = mh->broker_h;
@@ -570,6 +562,7 @@ module_t *module_add (modhash_t *mh, const char *path)
 void module_remove (modhash_t *mh, module_t *p)
 {
     assert (p->magic == MODULE_MAGIC);
+    subtrie_unsubscribe_all (mh->subs, p);
     zhash_delete (mh->zh_byuuid, module_get_uuid (p));
 }
 
@@ -578,6 +571,8 @@ modhash_t *modhash_create (void)
     modhash_t *mh = xzmalloc (sizeof (*mh));
     if (!(mh->zh_byuuid = zhash_new ()))
         oom ();
+    if (!(mh->subs = subtrie_create ()))
+        oom ();
     return mh;
 }
 
@@ -595,6 +590,7 @@ void modhash_destroy (modhash_t *mh)
             }
         }
         zhash_destroy (&mh->zh_byuuid);
+        subtrie_destroy (mh->subs);
         free (mh);
     }
 }
@@ -696,8 +692,8 @@ int module_subscribe (modhash_t *mh, const char *uuid, const char *topic)
         errno = ENOENT;
         goto done;
     }
-    if (zlist_push (p->subs, xstrdup (topic)) < 0)
-        oom ();
+    if (subtrie_subscribe (mh->subs, topic, p) < 0)
+        goto done;
     rc = 0;
 done:
     return rc;
@@ -706,54 +702,46 @@ done:
 int module_unsubscribe (modhash_t *mh, const char *uuid, const char *topic)
 {
     module_t *p = zhash_lookup (mh->zh_byuuid, uuid);
-    char *s;
     int rc = -1;
 
     if (!p) {
         errno = ENOENT;
         goto done;
     }
-    s = zlist_first (p->subs);
-    while (s) {
-        if (!strcmp (topic, s)) {
-            zlist_remove (p->subs, s);
-            free (s);
-            break;
-        }
-        s = zlist_next (p->subs);
-    }
+    if (subtrie_unsubscribe (mh->subs, topic, p) < 0 && errno != ENOENT)
+        goto done;
     rc = 0;
 done:
     return rc;
 }
 
-static bool match_sub (module_t *p, const char *topic)
+struct mcast {
+    const flux_msg_t *msg;
+    int errnum;
+};
+
+static void mcast_cb (void *subscriber, void *arg)
 {
-    char *s = zlist_first (p->subs);
+    module_t *p = subscriber;
+    struct mcast *mc = arg;
 
-    while (s) {
-        if (!strncmp (topic, s, strlen (s)))
-            return true;
-        s = zlist_next (p->subs);
-    }
-    return false;
+    if (module_sendmsg (p, mc->msg) < 0 && mc->errnum == 0)
+        mc->errnum = errno;
 }
 
 int module_event_mcast (modhash_t *mh, const flux_msg_t *msg)
 {
+    struct mcast mc = { .msg = msg, .errnum = 0 };
     const char *topic;
-    module_t *p;
     int rc = -1;
 
     if (flux_msg_get_topic (msg, &topic) < 0)
         goto done;
-    p = zhash_first (mh->zh_byuuid);
-    while (p) {
-        if (match_sub (p, topic)) {
-            if (module_sendmsg (p, msg) < 0)
-                goto done;
-        }
-        p = zhash_next (mh->zh_byuuid);
+    if (subtrie_match (mh->subs, topic, mcast_cb, &mc) < 0)
+        goto done;
+    if (mc.errnum != 0) {
+        errno = mc.errnum;
+        goto done;
     }
     rc = 0;
 done:
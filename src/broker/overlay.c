@@ -67,6 +67,8 @@ struct overlay_struct {
 
 typedef struct {
     int lastseen;
+    uint64_t tx_msgs;           /* messages sent to child */
+    uint64_t tx_bytes;          /* payload bytes sent to child */
 } child_t;
 
 static void heartbeat_handler (flux_t *h, flux_msg_handler_t *mh,
@@ -180,8 +182,10 @@ char *overlay_lspeer_encode (overlay_t *ov)
     if (!(o = json_object ()))
         goto nomem;
     FOREACH_ZHASH (ov->children, uuid, child) {
-        if (!(child_o = json_pack ("{s:i}", "idle",
-                                   ov->epoch - child->lastseen)))
+        if (!(child_o = json_pack ("{s:i s:I s:I}",
+                                   "idle", ov->epoch - child->lastseen,
+                                   "tx-msgs", (json_int_t)child->tx_msgs,
+                                   "tx-bytes", (json_int_t)child->tx_bytes)))
             goto nomem;
         if (json_object_set_new (o, uuid, child_o) < 0) {
             json_decref (child_o);
@@ -314,43 +318,62 @@ void overlay_set_child_cb (overlay_t *ov, overlay_cb_f cb, void *arg)
     ov->child_arg = arg;
 }
 
-int overlay_sendmsg_child (overlay_t *ov, const flux_msg_t *msg)
+/* Only payload bytes are counted, so a message costs the same whether
+ * it is routed to one child or multicast to all of them.
+ */
+static size_t payload_size (const flux_msg_t *msg)
 {
-    int rc = -1;
+    const void *buf;
+    int size;
+
+    if (flux_msg_get_payload (msg, &buf, &size) < 0)
+        return 0;
+    return size;
+}
+
+static void child_account (child_t *child, size_t size)
+{
+    child->tx_msgs++;
+    child->tx_bytes += size;
+}
+
+int overlay_sendmsg_child (overlay_t *ov, const flux_msg_t *msg,
+                           const char *uuid)
+{
+    child_t *child;
 
     if (!ov->child || !ov->child->zs) {
         errno = EINVAL;
-        goto done;
+        return -1;
     }
-    rc = flux_msg_sendzsock (ov->child->zs, msg);
-done:
-    return rc;
+    if (flux_msg_sendzsock (ov->child->zs, msg) < 0)
+        return -1;
+    if (uuid && (child = zhash_lookup (ov->children, uuid)))
+        child_account (child, payload_size (msg));
+    return 0;
 }
 
+/* The message is encoded once: each child is sent its own route frame
+ * followed by the same topic, payload, and PROTO frames, with the payload
+ * handed to zeromq by reference rather than copied per child.
+ */
 int overlay_mcast_child (overlay_t *ov, const flux_msg_t *msg)
 {
-    flux_msg_t *cpy = NULL;
     const char *uuid;
     child_t *child;
+    size_t size;
     int rc = -1;
 
     if (!ov->child || !ov->child->zs || !ov->children)
         return 0;
+    size = payload_size (msg);
     FOREACH_ZHASH (ov->children, uuid, child) {
-        if (!(cpy = flux_msg_copy (msg, true)))
-            oom ();
-        if (flux_msg_enable_route (cpy) < 0)
-            goto done;
-        if (flux_msg_push_route (cpy, uuid) < 0)
-            goto done;
-        if (flux_msg_sendzsock (ov->child->zs, cpy) < 0)
+        if (flux_msg_sendzsock_route (ov->child->zs, msg, uuid) < 0)
             goto done;
-        flux_msg_destroy (cpy);
-        cpy = NULL;
+        child_account (child, size);
     }
     rc = 0;
 done:
-    flux_msg_destroy (cpy);
     return rc;
 }
 
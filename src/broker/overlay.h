@@ -51,9 +51,15 @@ int overlay_sendmsg_parent (overlay_t *ov, const flux_msg_t *msg);
 void overlay_set_child (overlay_t *ov, const char *fmt, ...);
 const char *overlay_get_child (overlay_t *ov);
 void overlay_set_child_cb (overlay_t *ov, overlay_cb_f cb, void *arg);
-int overlay_sendmsg_child (overlay_t *ov, const flux_msg_t *msg);
+/* The message is routed by its last route frame.  'uuid' is that
+ * frame's value, passed in by the caller (who already has it) so the
+ * send can be accounted to the child without decoding the route stack.
+ */
+int overlay_sendmsg_child (overlay_t *ov, const flux_msg_t *msg,
+                           const char *uuid);
 /* We can "multicast" events to all child peers using mcast_child().
- * It walks the 'children' hash, finding peers and routeing them a copy of msg.
+ * It walks the 'children' hash, finding peers and routing msg to each.
+ * The message is not copied per peer.
  */
 int overlay_mcast_child (overlay_t *ov, const flux_msg_t *msg);
 
@@ -62,6 +68,8 @@ int overlay_mcast_child (overlay_t *ov, const flux_msg_t *msg);
 void overlay_checkin_child (overlay_t *ov, const char *uuid);
 
 /* Encode cmb.lspeer response payload.
+ * Each child entry reports heartbeats since last seen ("idle") and
+ * messages and payload bytes sent to it ("tx-msgs", "tx-bytes").
  */
 char *overlay_lspeer_encode (overlay_t *ov);
 
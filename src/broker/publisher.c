@@ -14,6 +14,9 @@
 #include "config.h"
 #endif
 #include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <arpa/inet.h>
 #include <flux/core.h>
 #include <czmq.h>
 #include <sodium.h>
@@ -66,10 +69,9 @@ struct publisher *publisher_create (void)
 
 static flux_msg_t *encode_event (const char *topic, int flags,
                                  uint32_t rolemask, uint32_t userid,
-                                 uint32_t seq, const char *src)
+                                 uint32_t seq, const void *data, int len)
 {
     flux_msg_t *msg;
-    void *dst = NULL;
     int saved_errno;
 
     if (!(msg = flux_msg_create (FLUX_MSGTYPE_EVENT)))
@@ -86,34 +88,42 @@ static flux_msg_t *encode_event (const char *topic, int flags,
         if (flux_msg_set_private (msg) < 0)
             goto error;
     }
-    if (src) { // optional payload
-        int srclen = strlen (src);
-        size_t dstlen = BASE64_DECODE_SIZE (srclen);
-
-        if (!(dst = malloc (dstlen)))
-            goto error;
-        if (sodium_base642bin ((unsigned char *)dst, dstlen, src, srclen,
-                               NULL, &dstlen, NULL,
-                               sodium_base64_VARIANT_ORIGINAL) < 0) {
-            errno = EPROTO;
-            goto error;
-        }
-        if (flux_msg_set_payload (msg, dst, dstlen) < 0) {
+    if (data) { // optional payload
+        if (flux_msg_set_payload (msg, data, len) < 0) {
             if (errno == EINVAL)
                 errno = EPROTO;
             goto error;
         }
     }
-    free (dst);
     return msg;
 error:
     saved_errno = errno;
-    free (dst);
     flux_msg_destroy (msg);
     errno = saved_errno;
     return NULL;
 }
 
+/* Decode base64 payload 'src' from an event.pub request.
+ */
+static void *decode_payload (const char *src, size_t *lenp)
+{
+    int srclen = strlen (src);
+    size_t dstlen = BASE64_DECODE_SIZE (srclen);
+    void *dst;
+
+    if (!(dst = malloc (dstlen)))
+        return NULL;
+    if (sodium_base642bin ((unsigned char *)dst, dstlen, src, srclen,
+                           NULL, &dstlen, NULL,
+                           sodium_base64_VARIANT_ORIGINAL) < 0) {
+        free (dst);
+        errno = EPROTO;
+        return NULL;
+    }
+    *lenp = dstlen;
+    return dst;
+}
+
 /* Broadcast event using all senders.
  * Log failure, but don't abort the event at this point.
  */
@@ -139,6 +149,8 @@ void pub_cb (flux_t *h, flux_msg_handler_t *mh,
     int flags;
     uint32_t rolemask, userid;
     flux_msg_t *event = NULL;
+    void *data = NULL;
+    size_t len = 0;
 
     if (flux_request_unpack (msg, NULL, "{s:s s:i s?:s}",
                                         "topic", &topic,
@@ -153,13 +165,16 @@ void pub_cb (flux_t *h, flux_msg_handler_t *mh,
         goto error;
     if (flux_msg_get_userid (msg, &userid) < 0)
         goto error;
+    if (payload && !(data = decode_payload (payload, &len)))
+        goto error;
     if (!(event = encode_event (topic, flags, rolemask, userid,
-                                ++pub->seq, payload)))
+                                ++pub->seq, data, len)))
         goto error_restore_seq;
     send_event (pub, event);
     if (flux_respond_pack (h, msg, "{s:i}", "seq", pub->seq) < 0)
         flux_log_error (h, "%s: flux_respond", __FUNCTION__);
     flux_msg_destroy (event);
+    free (data);
     return;
 error_restore_seq:
     pub->seq--;
@@ -167,6 +182,123 @@ error:
     if (flux_respond (h, msg, errno, NULL) < 0)
         flux_log_error (h, "%s: flux_respond", __FUNCTION__);
     flux_msg_destroy (event);
+    free (data);
+}
+
+/* Header of each record in an event.pub-raw request:
+ * flags, topic length, payload length (network byte order),
+ * followed by the topic and payload bytes.
+ */
+#define RAW_HDRSIZE     (3 * sizeof (uint32_t))
+
+/* Decode the records in an event.pub-raw request payload into a list of
+ * events, with sequence numbers starting at 'seq'.  Nothing is published
+ * unless every record is valid.  A topic is not NUL terminated in the
+ * record, and must not contain a NUL.
+ */
+static zlist_t *decode_raw_batch (const uint8_t *buf, int size,
+                                  uint32_t rolemask, uint32_t userid,
+                                  uint32_t seq)
+{
+    zlist_t *events;
+    flux_msg_t *event;
+    char *topic = NULL;
+    int offset = 0;
+    int saved_errno;
+
+    if (!(events = zlist_new ())) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    while (offset < size) {
+        uint32_t hdr[3];
+        size_t topiclen, len;
+
+        if (size - offset < (int)RAW_HDRSIZE)
+            goto error_proto;
+        memcpy (hdr, buf + offset, RAW_HDRSIZE);
+        offset += RAW_HDRSIZE;
+        topiclen = ntohl (hdr[1]);
+        len = ntohl (hdr[2]);
+        if ((ntohl (hdr[0]) & ~(FLUX_MSGFLAG_PRIVATE)) != 0
+                || topiclen == 0 || topiclen > size - offset
+                || len > size - offset - topiclen)
+            goto error_proto;
+        /* strndup() would silently truncate at an embedded NUL.
+         */
+        if (memchr (buf + offset, '\0', topiclen))
+            goto error_proto;
+        if (!(topic = strndup ((char *)buf + offset, topiclen)))
+            goto error;
+        offset += topiclen;
+        if (!(event = encode_event (topic, ntohl (hdr[0]), rolemask, userid,
+                                    seq++, len > 0 ? buf + offset : NULL,
+                                    len)))
+            goto error;
+        offset += len;
+        free (topic);
+        topic = NULL;
+        if (zlist_append (events, event) < 0) {
+            flux_msg_destroy (event);
+            errno = ENOMEM;
+            goto error;
+        }
+    }
+    if (zlist_size (events) == 0)
+        goto error_proto;
+    return events;
+error_proto:
+    errno = EPROTO;
+error:
+    saved_errno = errno;
+    free (topic);
+    while ((event = zlist_pop (events)))
+        flux_msg_destroy (event);
+    zlist_destroy (&events);
+    errno = saved_errno;
+    return NULL;
+}
+
+/* Publish one or more events with raw payloads carried directly in the
+ * request, avoiding the base64 encoding of event.pub.
+ */
+static void pub_raw_cb (flux_t *h, flux_msg_handler_t *mh,
+                        const flux_msg_t *msg, void *arg)
+{
+    struct publisher *pub = arg;
+    const void *buf;
+    int size;
+    uint32_t rolemask, userid;
+    zlist_t *events;
+    flux_msg_t *event;
+    int first = pub->seq + 1;
+
+    if (flux_request_decode_raw (msg, NULL, &buf, &size) < 0)
+        goto error;
+    if (!buf) {
+        errno = EPROTO;
+        goto error;
+    }
+    if (flux_msg_get_rolemask (msg, &rolemask) < 0)
+        goto error;
+    if (flux_msg_get_userid (msg, &userid) < 0)
+        goto error;
+    if (!(events = decode_raw_batch (buf, size, rolemask, userid, first)))
+        goto error;
+    while ((event = zlist_pop (events))) {
+        pub->seq++;
+        send_event (pub, event);
+        flux_msg_destroy (event);
+    }
+    zlist_destroy (&events);
+    if (flux_respond_pack (h, msg, "{s:i s:i}",
+                           "seq", first,
+                           "count", pub->seq - first + 1) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+    return;
+error:
+    if (flux_respond (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
 }
 
 int publisher_send (struct publisher *pub, const flux_msg_t *msg)
@@ -191,6 +323,7 @@ error:
 
 static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST, "event.pub",  pub_cb, FLUX_ROLE_USER },
+    { FLUX_MSGTYPE_REQUEST, "event.pub-raw",  pub_raw_cb, FLUX_ROLE_USER },
     FLUX_MSGHANDLER_TABLE_END,
 };
 
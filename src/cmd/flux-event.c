@@ -149,6 +149,37 @@ done:
     return rc;
 }
 
+/* Publish 'count' copies of the event in one batch request.
+ * The events are assigned consecutive sequence numbers.
+ */
+static int publish_batch (flux_t *h, const char *topic, int flags,
+                          char *payload, int payloadsz, int count)
+{
+    flux_event_batch_t *batch;
+    flux_future_t *f = NULL;
+    int seq;
+    int i;
+    int rc = -1;
+
+    if (!(batch = flux_event_batch_create ()))
+        goto done;
+    for (i = 0; i < count; i++) {
+        if (flux_event_batch_append (batch, topic, flags,
+                                     payload, payloadsz) < 0)
+            goto done;
+    }
+    if (!(f = flux_event_batch_publish (h, batch)))
+        goto done;
+    if (flux_event_publish_get_seq (f, &seq) < 0)
+        goto done;
+    printf ("seq=%d-%d\n", seq, seq + count - 1);
+    rc = 0;
+done:
+    flux_future_destroy (f);
+    flux_event_batch_destroy (batch);
+    return rc;
+}
+
 static struct optparse_option pub_opts[] = {
     { .name = "raw", .key = 'r', .has_arg = 0,
       .usage = "Interpret event payload as raw.",
@@ -162,6 +193,9 @@ static struct optparse_option pub_opts[] = {
     { .name = "private", .key = 'p', .has_arg = 0,
       .usage = "Set privacy flag on published event.",
     },
+    { .name = "count", .key = 'c', .has_arg = 1, .arginfo = "N",
+      .usage = "Publish N copies of the event in one request.",
+    },
     OPTPARSE_TABLE_END
 };
 
@@ -181,9 +215,10 @@ static int event_pub (optparse_t *p, int argc, char **argv)
     char *payload = NULL;
     int payloadsz = 0;
     int flags = 0;
+    int count = optparse_get_int (p, "count", 1);
     int rc;
 
-    if (optindex == argc) {
+    if (optindex == argc || count < 1) {
         optparse_print_usage (p);
         exit (1);
     }
@@ -199,6 +234,8 @@ static int event_pub (optparse_t *p, int argc, char **argv)
         argz_stringify (payload, len, ' ');
         if (optparse_hasopt (p, "raw"))
             payloadsz = strlen (payload);
+        else
+            payloadsz = strlen (payload) + 1;
     }
 
     if (optparse_hasopt (p, "private"))
@@ -209,7 +246,9 @@ static int event_pub (optparse_t *p, int argc, char **argv)
             log_err_exit ("flux_event_subscribe");
     }
 
-    if (optparse_hasopt (p, "raw")) {
+    if (optparse_hasopt (p, "count"))
+        rc = publish_batch (h, topic, flags, payload, payloadsz, count);
+    else if (optparse_hasopt (p, "raw")) {
         if (optparse_hasopt (p, "synchronous"))
             rc = publish_raw_sync (h, topic, flags, payload, payloadsz);
         else
@@ -227,10 +266,10 @@ static int event_pub (optparse_t *p, int argc, char **argv)
     if (optparse_hasopt (p, "loopback")) {
         flux_msg_t *msg;
         struct flux_match match = FLUX_MATCH_EVENT;
-        bool received = false;
+        int received = 0;
         match.topic_glob = topic;
 
-        while (!received) {
+        while (received < count) {
             if (!(msg = flux_recv (h, match, 0)))
                 log_err_exit ("flux_recv error");
             if (optparse_hasopt (p, "raw")) {
@@ -238,13 +277,13 @@ static int event_pub (optparse_t *p, int argc, char **argv)
                 int len;
                 if ((flux_event_decode_raw (msg, NULL, &data, &len) == 0
                         && match_payload_raw (payload, payloadsz, data, len)))
-                    received = true;
+                    received++;
             }
             else {
                 const char *json_str;
                 if ((flux_event_decode (msg, NULL, &json_str) == 0
                         && match_payload (payload, json_str)))
-                    received = true;
+                    received++;
             }
             flux_msg_destroy (msg);
         }
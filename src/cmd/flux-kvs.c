@@ -99,6 +99,9 @@ static struct optparse_option get_opts[] =  {
     { .name = "full", .key = 'f', .has_arg = 0,
       .usage = "Monitor key changes with more complete accuracy",
     },
+    { .name = "append", .key = 'A', .has_arg = 0,
+      .usage = "Display only data appended to key on each change",
+    },
     { .name = "count", .key = 'c', .has_arg = 1, .arginfo = "COUNT",
       .usage = "Display at most COUNT changes",
     },
@@ -674,6 +677,8 @@ void cmd_get_one (flux_t *h, const char *key, struct lookup_ctx *ctx)
         if (optparse_hasopt (ctx->p, "uniq"))
             flags |= FLUX_KVS_WATCH_UNIQ;
     }
+    if (optparse_hasopt (ctx->p, "append"))
+        flags |= FLUX_KVS_WATCH_APPEND;
     if (optparse_hasopt (ctx->p, "waitcreate"))
         flags |= FLUX_KVS_WAITCREATE;
     if (optparse_hasopt (ctx->p, "at")) {
@@ -1847,15 +1852,21 @@ void eventlog_get_continuation (flux_future_t *f, void *arg)
         return;
     }
 
-    /* Each KVS get response returns a new snapshot of the eventlog.
-     * Pass it to eventlog_update() which ensures the shapshot is consistent
-     * with any existing events in the log, and makes new events available to
-     * the iterator.
+    /* When watching, each KVS get response returns the events appended
+     * since the last one (FLUX_KVS_WATCH_APPEND).  Otherwise the response
+     * is a snapshot of the eventlog.  Either way, pass it to the eventlog,
+     * which validates it and makes new events available to the iterator.
      */
     if (flux_kvs_lookup_get (f, &s) < 0)
         log_err_exit ("flux_kvs_lookup_get");
-    if (flux_kvs_eventlog_update (ctx->log, s) < 0)
-        log_err_exit ("flux_kvs_eventlog_update");
+    if (optparse_hasopt (ctx->p, "watch")) {
+        if (flux_kvs_eventlog_append_encoded (ctx->log, s) < 0)
+            log_err_exit ("flux_kvs_eventlog_append_encoded");
+    }
+    else {
+        if (flux_kvs_eventlog_update (ctx->log, s) < 0)
+            log_err_exit ("flux_kvs_eventlog_update");
+    }
 
     /* Display any new events.
      */
@@ -1899,7 +1910,7 @@ int cmd_eventlog_get (optparse_t *p, int argc, char **argv)
     }
     key = argv[optindex++];
     if (optparse_hasopt (p, "watch"))
-        flags |= FLUX_KVS_WATCH;
+        flags |= FLUX_KVS_WATCH | FLUX_KVS_WATCH_APPEND;
 
     if (!(ctx.log = flux_kvs_eventlog_create()))
         log_err_exit ("flux_kvs_eventlog_create");
@@ -19,6 +19,7 @@
 #include "content.h"
 
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/blobvec.h"
 
 flux_future_t *flux_content_load (flux_t *h, const char *blobref, int flags)
 {
@@ -73,6 +74,156 @@ int flux_content_store_get (flux_future_t *f, const char **blobref)
     return 0;
 }
 
+/* Batch requests and responses are encoded as a blobvec (see
+ * libutil/blobvec.h), with one record per blob, in request order.
+ * Blobrefs are sent with their NUL terminator.
+ * Backing store modules only handle single blobs, so batches cannot
+ * bypass the cache.
+ */
+
+static flux_future_t *batch_rpc (flux_t *h, const char *topic,
+                                 uint32_t rank, blobvec_t *bv)
+{
+    const void *buf;
+    int len;
+
+    if (blobvec_encode (bv, &buf, &len) < 0)
+        return NULL;
+    return flux_rpc_raw (h, topic, buf, len, rank, 0);
+}
+
+flux_future_t *flux_content_load_batch (flux_t *h,
+                                        const char **blobrefs, int count,
+                                        int flags)
+{
+    const char *topic = "content.load-batch";
+    uint32_t rank = FLUX_NODEID_ANY;
+    blobvec_t *bv;
+    flux_future_t *f = NULL;
+    int i;
+
+    if (!h || !blobrefs || count <= 0
+           || (flags & CONTENT_FLAG_CACHE_BYPASS)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if ((flags & CONTENT_FLAG_UPSTREAM))
+        rank = FLUX_NODEID_UPSTREAM;
+    if (!(bv = blobvec_create ()))
+        return NULL;
+    for (i = 0; i < count; i++) {
+        if (!blobrefs[i] || blobref_validate (blobrefs[i]) < 0) {
+            errno = EINVAL;
+            goto done;
+        }
+        if (blobvec_append (bv, 0, blobrefs[i], strlen (blobrefs[i]) + 1) < 0)
+            goto done;
+    }
+    f = batch_rpc (h, topic, rank, bv);
+done:
+    blobvec_destroy (bv);
+    return f;
+}
+
+/* Decode batch response payload once and cache it in the future.
+ */
+static blobvec_t *batch_get (flux_future_t *f)
+{
+    const char *auxkey = "flux::content_batch";
+    blobvec_t *bv;
+    const void *buf;
+    int len;
+
+    if (!(bv = flux_future_aux_get (f, auxkey))) {
+        if (flux_rpc_get_raw (f, &buf, &len) < 0)
+            return NULL;
+        if (!(bv = blobvec_decode (buf, len)))
+            return NULL;
+        if (flux_future_aux_set (f, auxkey, bv,
+                                 (flux_free_f)blobvec_destroy) < 0) {
+            blobvec_destroy (bv);
+            return NULL;
+        }
+    }
+    return bv;
+}
+
+int flux_content_load_batch_get (flux_future_t *f, int index,
+                                 const void **buf, int *len)
+{
+    blobvec_t *bv;
+    int errnum;
+
+    if (!(bv = batch_get (f)))
+        return -1;
+    if (blobvec_get (bv, index, &errnum, buf, len) < 0) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (errnum != 0) {
+        errno = errnum;
+        return -1;
+    }
+    return 0;
+}
+
+flux_future_t *flux_content_store_batch (flux_t *h,
+                                         const void **bufs, const int *lens,
+                                         int count, int flags)
+{
+    const char *topic = "content.store-batch";
+    uint32_t rank = FLUX_NODEID_ANY;
+    blobvec_t *bv;
+    flux_future_t *f = NULL;
+    int i;
+
+    if (!h || !bufs || !lens || count <= 0
+           || (flags & CONTENT_FLAG_CACHE_BYPASS)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if ((flags & CONTENT_FLAG_UPSTREAM))
+        rank = FLUX_NODEID_UPSTREAM;
+    if (!(bv = blobvec_create ()))
+        return NULL;
+    for (i = 0; i < count; i++) {
+        if (blobvec_append (bv, 0, bufs[i], lens[i]) < 0)
+            goto done;
+    }
+    f = batch_rpc (h, topic, rank, bv);
+done:
+    blobvec_destroy (bv);
+    return f;
+}
+
+int flux_content_store_batch_get (flux_future_t *f, int index,
+                                  const char **blobref)
+{
+    blobvec_t *bv;
+    const char *ref;
+    int ref_size;
+    int errnum;
+
+    if (!(bv = batch_get (f)))
+        return -1;
+    if (blobvec_get (bv, index, &errnum, (const void **)&ref, &ref_size) < 0) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (errnum != 0) {
+        errno = errnum;
+        return -1;
+    }
+    if (!ref || ref_size < 1 || ref[ref_size - 1] != '\0'
+             || blobref_validate (ref) < 0) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (blobref)
+        *blobref = ref;
+    return 0;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
@@ -46,6 +46,35 @@ flux_future_t *flux_content_store (flux_t *h,
  */
 int flux_content_store_get (flux_future_t *f, const char **blobref);
 
+/* Send request to load 'count' blobs by blobref in one message.
+ * Missing blobs are coalesced into a single request upstream.
+ */
+flux_future_t *flux_content_load_batch (flux_t *h,
+                                        const char **blobrefs, int count,
+                                        int flags);
+
+/* Get result of batch load request for the blob at 'index'.
+ * This blocks until response is received.
+ * Storage for 'buf' belongs to 'f' and is valid until 'f' is destroyed.
+ * Returns 0 on success, -1 on failure with errno set.  Failure may be
+ * specific to one blob (e.g. ENOENT) or apply to the whole batch.
+ */
+int flux_content_load_batch_get (flux_future_t *f, int index,
+                                 const void **buf, int *len);
+
+/* Send request to store 'count' blobs in one message.
+ */
+flux_future_t *flux_content_store_batch (flux_t *h,
+                                         const void **bufs, const int *lens,
+                                         int count, int flags);
+
+/* Get result of batch store request (blobref) for the blob at 'index'.
+ * Storage for 'blobref' belongs to 'f' and is valid until 'f' is destroyed.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int flux_content_store_batch_get (flux_future_t *f, int index,
+                                  const char **blobref);
+
 #ifdef __cplusplus
 }
 #endif
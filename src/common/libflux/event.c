@@ -14,8 +14,10 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+#include <arpa/inet.h>
 #include <jansson.h>
-#include <sodium.h>
 
 #include "event.h"
 #include "rpc.h"
@@ -195,38 +197,113 @@ flux_msg_t *flux_event_pack (const char *topic, const char *fmt, ...)
     return msg;
 }
 
+/* A batch is the payload of an "event.pub-raw" request: one or more
+ * records, each consisting of a header of three 32-bit integers in
+ * network byte order (flags, topic length, payload length) followed by
+ * the topic (without NUL terminator), then the payload.  The broker
+ * assigns the events consecutive sequence numbers in record order.
+ */
+#define EVENT_BATCH_HDRSIZE     (3 * sizeof (uint32_t))
+
+struct flux_event_batch {
+    uint8_t *buf;
+    size_t size;
+    size_t alloc;
+    int count;
+};
+
+void flux_event_batch_destroy (flux_event_batch_t *batch)
+{
+    if (batch) {
+        int saved_errno = errno;
+        free (batch->buf);
+        free (batch);
+        errno = saved_errno;
+    }
+}
+
+flux_event_batch_t *flux_event_batch_create (void)
+{
+    flux_event_batch_t *batch;
+
+    if (!(batch = calloc (1, sizeof (*batch))))
+        return NULL;
+    return batch;
+}
+
+int flux_event_batch_append (flux_event_batch_t *batch,
+                             const char *topic, int flags,
+                             const void *data, int len)
+{
+    size_t topiclen;
+    size_t need;
+    uint32_t hdr[3];
+
+    if (!batch || !topic || (flags & ~(FLUX_MSGFLAG_PRIVATE)) != 0
+               || len < 0 || (len > 0 && !data)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!data)
+        len = 0;
+    topiclen = strlen (topic);
+    need = batch->size + EVENT_BATCH_HDRSIZE + topiclen + len;
+    if (need > batch->alloc) {
+        size_t alloc = batch->alloc > 0 ? batch->alloc : 256;
+        uint8_t *buf;
+
+        while (alloc < need)
+            alloc *= 2;
+        if (!(buf = realloc (batch->buf, alloc)))
+            return -1;
+        batch->buf = buf;
+        batch->alloc = alloc;
+    }
+    hdr[0] = htonl (flags);
+    hdr[1] = htonl (topiclen);
+    hdr[2] = htonl (len);
+    memcpy (batch->buf + batch->size, hdr, EVENT_BATCH_HDRSIZE);
+    batch->size += EVENT_BATCH_HDRSIZE;
+    memcpy (batch->buf + batch->size, topic, topiclen);
+    batch->size += topiclen;
+    if (len > 0) {
+        memcpy (batch->buf + batch->size, data, len);
+        batch->size += len;
+    }
+    batch->count++;
+    return 0;
+}
+
+int flux_event_batch_count (flux_event_batch_t *batch)
+{
+    return batch ? batch->count : 0;
+}
+
+flux_future_t *flux_event_batch_publish (flux_t *h,
+                                         flux_event_batch_t *batch)
+{
+    if (!h || !batch || batch->count == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return flux_rpc_raw (h, "event.pub-raw", batch->buf, batch->size,
+                         FLUX_NODEID_ANY, 0);
+}
+
 static flux_future_t *wrap_event_rpc (flux_t *h,
                                       const char *topic, int flags,
                                       const void *src, int srclen)
 {
-    flux_future_t *f;
+    flux_event_batch_t *batch;
+    flux_future_t *f = NULL;
 
-    if (src) {
-        size_t dstlen = sodium_base64_encoded_len (srclen,
-                                            sodium_base64_VARIANT_ORIGINAL);
-        void *dst;
-        if (!(dst = malloc (dstlen)))
-            return NULL;
-        sodium_bin2base64 (dst, dstlen, (unsigned char *)src, srclen,
-                           sodium_base64_VARIANT_ORIGINAL);
-        if (!(f = flux_rpc_pack (h, "event.pub", FLUX_NODEID_ANY, 0,
-                                 "{s:s s:i s:s}", "topic", topic,
-                                                  "flags", flags,
-                                                  "payload", dst))) {
-            int saved_errno = errno;
-            free (dst);
-            errno = saved_errno;
-            return NULL;
-        }
-        free (dst);
-    }
-    else {
-        if (!(f = flux_rpc_pack (h, "event.pub", FLUX_NODEID_ANY, 0,
-                                    "{s:s s:i}", "topic", topic,
-                                                 "flags", flags))) {
-            return NULL;
-        }
-    }
+    if (!(batch = flux_event_batch_create ()))
+        return NULL;
+    if (flux_event_batch_append (batch, topic, flags, src, srclen) < 0)
+        goto done;
+    f = flux_event_batch_publish (h, batch);
+done:
+    flux_event_batch_destroy (batch);
     return f;
 }
 
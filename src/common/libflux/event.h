@@ -84,10 +84,29 @@ flux_future_t *flux_event_publish_raw (flux_t *h,
                                        const void *data, int len);
 
 /* Obtain the event sequence number from the fulfilled
- * flux_event_publish() future.
+ * flux_event_publish() future.  For flux_event_batch_publish(), this is
+ * the sequence number of the first event in the batch; the rest follow
+ * consecutively.
  */
 int flux_event_publish_get_seq (flux_future_t *f, int *seq);
 
+/* Publish many events in one request.
+ * Append events with optional raw payloads to a batch, then publish the
+ * batch.  The events are published in the order they were appended and
+ * receive consecutive sequence numbers.  A batch may be published more
+ * than once.  Payloads are sent as is, without intermediate encoding.
+ */
+typedef struct flux_event_batch flux_event_batch_t;
+
+flux_event_batch_t *flux_event_batch_create (void);
+void flux_event_batch_destroy (flux_event_batch_t *batch);
+int flux_event_batch_append (flux_event_batch_t *batch,
+                             const char *topic, int flags,
+                             const void *data, int len);
+int flux_event_batch_count (flux_event_batch_t *batch);
+flux_future_t *flux_event_batch_publish (flux_t *h,
+                                         flux_event_batch_t *batch);
+
 #ifdef __cplusplus
 }
 #endif
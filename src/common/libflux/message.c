@@ -20,6 +20,14 @@
  * [payload frame]
  * PROTO frame
  *
+ * Only the route frames are kept in the zmsg.  The PROTO frame is decoded
+ * once into native fields and re-encoded only when the message is encoded
+ * or sent.  The topic frame is held directly so it can be found without
+ * walking the route stack.  The payload is held in a reference counted,
+ * immutable buffer so that message copies, and messages passed between
+ * threads over zeromq inproc sockets, can share it rather than
+ * duplicating it.
+ *
  * See also: RFC 3
  */
 
@@ -34,6 +42,7 @@
 #include <fnmatch.h>
 #include <inttypes.h>
 #include <czmq.h>
+#include <zmq.h>
 #include <jansson.h>
 
 #include "src/common/libutil/aux.h"
@@ -54,186 +63,230 @@
 #define PROTO_OFF_BIGINT    12 /* 4 bytes */
 #define PROTO_OFF_BIGINT2   16 /* 4 bytes */
 
-#define FLUX_MSG_MAGIC 0x33321eee
-struct flux_msg {
-    int magic;
-    zmsg_t *zmsg;
-    json_t *json;
-    struct aux_item *aux;
+
+struct proto {
+    uint8_t type;
+    uint8_t flags;
+    uint32_t userid;
+    uint32_t rolemask;
+    uint32_t bigint;        /* nodeid, errnum, or seq depending on type */
+    uint32_t bigint2;       /* matchtag or status depending on type */
 };
 
-static int proto_set_bigint (uint8_t *data, int len, uint32_t bigint);
-static int proto_set_bigint2 (uint8_t *data, int len, uint32_t bigint);
+static void proto_encode (const struct proto *proto, uint8_t *data)
+{
+    uint32_t x;
 
-static int proto_set_type (uint8_t *data, int len, int type)
+    data[PROTO_OFF_MAGIC] = PROTO_MAGIC;
+    data[PROTO_OFF_VERSION] = PROTO_VERSION;
+    data[PROTO_OFF_TYPE] = proto->type;
+    data[PROTO_OFF_FLAGS] = proto->flags;
+    x = htonl (proto->userid);
+    memcpy (&data[PROTO_OFF_USERID], &x, sizeof (x));
+    x = htonl (proto->rolemask);
+    memcpy (&data[PROTO_OFF_ROLEMASK], &x, sizeof (x));
+    x = htonl (proto->bigint);
+    memcpy (&data[PROTO_OFF_BIGINT], &x, sizeof (x));
+    x = htonl (proto->bigint2);
+    memcpy (&data[PROTO_OFF_BIGINT2], &x, sizeof (x));
+}
+
+static int proto_decode (struct proto *proto, const uint8_t *data, size_t len)
 {
+    uint32_t x;
+
     if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
+                         || data[PROTO_OFF_VERSION] != PROTO_VERSION) {
+        errno = EPROTO;
         return -1;
+    }
+    proto->type = data[PROTO_OFF_TYPE];
+    proto->flags = data[PROTO_OFF_FLAGS];
+    memcpy (&x, &data[PROTO_OFF_USERID], sizeof (x));
+    proto->userid = ntohl (x);
+    memcpy (&x, &data[PROTO_OFF_ROLEMASK], sizeof (x));
+    proto->rolemask = ntohl (x);
+    memcpy (&x, &data[PROTO_OFF_BIGINT], sizeof (x));
+    proto->bigint = ntohl (x);
+    memcpy (&x, &data[PROTO_OFF_BIGINT2], sizeof (x));
+    proto->bigint2 = ntohl (x);
+    return 0;
+}
+
+static int proto_set_type (struct proto *proto, int type)
+{
     switch (type) {
         case FLUX_MSGTYPE_REQUEST:
-            if (proto_set_bigint (data, len, FLUX_NODEID_ANY) < 0)
-                return -1;
-            if (proto_set_bigint2 (data, len, FLUX_MATCHTAG_NONE) < 0)
-                return -1;
+            proto->bigint = FLUX_NODEID_ANY;
+            proto->bigint2 = FLUX_MATCHTAG_NONE;
             break;
         case FLUX_MSGTYPE_RESPONSE:
-            if (proto_set_bigint (data, len, 0) < 0)
-                return -1;
+            proto->bigint = 0;
             break;
         case FLUX_MSGTYPE_EVENT:
-            if (proto_set_bigint (data, len, 0) < 0)
-                return -1;
-            if (proto_set_bigint2 (data, len, 0) < 0)
-                return -1;
-            break;
         case FLUX_MSGTYPE_KEEPALIVE:
-            if (proto_set_bigint (data, len, 0) < 0)
-                return -1;
-            if (proto_set_bigint2 (data, len, 0) < 0)
-                return -1;
+            proto->bigint = 0;
+            proto->bigint2 = 0;
             break;
         default:
             return -1;
     }
-    data[PROTO_OFF_TYPE] = type;
+    proto->type = type;
     return 0;
 }
-static int proto_get_type (uint8_t *data, int len, int *type)
-{
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    *type = data[PROTO_OFF_TYPE];
-    return 0;
-}
-static int proto_set_flags (uint8_t *data, int len, uint8_t flags)
+
+static void proto_init (struct proto *proto)
 {
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    data[PROTO_OFF_FLAGS] = flags;
-    return 0;
+    memset (proto, 0, sizeof (*proto));
+    proto->userid = FLUX_USERID_UNKNOWN;
+    proto->rolemask = FLUX_ROLE_NONE;
 }
-static int proto_get_flags (uint8_t *data, int len, uint8_t *val)
+/* End manual codec
+ */
+
+#define FLUX_MSG_MAGIC 0x33321eee
+struct payload {
+    int refcount;
+    void *data;
+    size_t size;
+    zframe_t *zf;           /* if non-NULL, 'data' belongs to this frame */
+};
+
+struct flux_msg {
+    int magic;
+    zmsg_t *zmsg;           /* route frames, if any */
+    zframe_t *topic;
+    struct payload *payload;
+    struct proto proto;
+    json_t *json;
+    struct aux_item *aux;
+};
+
+/* Payload bytes duplicated vs shared by reference, for all messages
+ * in this process.  Updated atomically since messages cross threads.
+ */
+static uint64_t payload_bytes_copied;
+static uint64_t payload_bytes_shared;
+
+static struct payload *payload_incref (struct payload *p)
 {
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    *val = data[PROTO_OFF_FLAGS];
-    return 0;
+    if (p)
+        __sync_add_and_fetch (&p->refcount, 1);
+    return p;
 }
-static int proto_mod_flags (uint8_t *data, int len, uint8_t val, bool clear)
+
+static void payload_decref (struct payload *p)
 {
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    if (clear)
-        data[PROTO_OFF_FLAGS] &= ~val;
-    else
-        data[PROTO_OFF_FLAGS] |= val;
-    return 0;
+    if (p && __sync_sub_and_fetch (&p->refcount, 1) == 0) {
+        if (p->zf)
+            zframe_destroy (&p->zf);
+        else
+            free (p->data);
+        free (p);
+    }
 }
-static int proto_set_bigint (uint8_t *data, int len, uint32_t bigint)
-{
-    uint32_t x = htonl (bigint);
 
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    memcpy (&data[PROTO_OFF_BIGINT], &x, sizeof (x));
-    return 0;
-}
-static int proto_get_bigint (uint8_t *data, int len, uint32_t *bigint)
+/* Create payload containing a copy of 'buf'.
+ */
+static struct payload *payload_create (const void *buf, size_t size)
 {
-    uint32_t x;
+    struct payload *p;
 
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    memcpy (&x, &data[PROTO_OFF_BIGINT], sizeof (x));
-    *bigint = ntohl (x);
-    return 0;
+    if (!(p = calloc (1, sizeof (*p))) || !(p->data = malloc (size))) {
+        free (p);
+        errno = ENOMEM;
+        return NULL;
+    }
+    memcpy (p->data, buf, size);
+    p->size = size;
+    p->refcount = 1;
+    __sync_add_and_fetch (&payload_bytes_copied, size);
+    return p;
 }
-static int proto_set_bigint2 (uint8_t *data, int len, uint32_t bigint)
-{
-    uint32_t x = htonl (bigint);
 
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    memcpy (&data[PROTO_OFF_BIGINT2], &x, sizeof (x));
-    return 0;
-}
-static int proto_get_bigint2 (uint8_t *data, int len, uint32_t *bigint)
+/* Create payload that takes ownership of 'zf' without copying its data.
+ */
+static struct payload *payload_create_frame (zframe_t *zf)
 {
-    uint32_t x;
+    struct payload *p;
 
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    memcpy (&x, &data[PROTO_OFF_BIGINT2], sizeof (x));
-    *bigint = ntohl (x);
-    return 0;
+    if (!(p = calloc (1, sizeof (*p)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    p->zf = zf;
+    p->data = zframe_data (zf);
+    p->size = zframe_size (zf);
+    p->refcount = 1;
+    return p;
 }
-static int proto_set_userid (uint8_t *data, int len, uint32_t userid)
-{
-    uint32_t x = htonl (userid);
 
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    memcpy (&data[PROTO_OFF_USERID], &x, sizeof (x));
-    return 0;
-}
-static int proto_get_userid (uint8_t *data, int len, uint32_t *userid)
+/* zeromq calls this when it is finished with a zero-copy message part.
+ */
+static void payload_zmq_free (void *data, void *hint)
 {
-    uint32_t x;
-
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    memcpy (&x, &data[PROTO_OFF_USERID], sizeof (x));
-    *userid = ntohl (x);
-    return 0;
+    payload_decref (hint);
 }
-static int proto_set_rolemask (uint8_t *data, int len, uint32_t rolemask)
+
+/* Send payload as a (non-final) message part, passing a reference to
+ * zeromq rather than copying the buffer.
+ */
+static int payload_send (struct payload *p, void *handle)
 {
-    uint32_t x = htonl (rolemask);
+    zmq_msg_t part;
 
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
+    payload_incref (p);
+    if (zmq_msg_init_data (&part, p->data, p->size,
+                           payload_zmq_free, p) < 0) {
+        payload_decref (p);
         return -1;
-    memcpy (&data[PROTO_OFF_ROLEMASK], &x, sizeof (x));
+    }
+    if (zmq_msg_send (&part, handle, ZMQ_SNDMORE) < 0) {
+        int saved_errno = errno;
+        zmq_msg_close (&part);
+        errno = saved_errno;
+        return -1;
+    }
+    __sync_add_and_fetch (&payload_bytes_shared, p->size);
     return 0;
 }
-static int proto_get_rolemask (uint8_t *data, int len, uint32_t *rolemask)
+
+/* Take apart the frames of a message received off the wire:  decode the
+ * PROTO frame (last), then move the payload and topic frames (if any)
+ * out of the zmsg, leaving only the route frames.  Nothing is copied.
+ */
+static int unpack_frames (flux_msg_t *msg)
 {
-    uint32_t x;
+    zframe_t *zf;
 
-    if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
-                         || data[PROTO_OFF_VERSION] != PROTO_VERSION)
-        return -1;
-    memcpy (&x, &data[PROTO_OFF_ROLEMASK], sizeof (x));
-    *rolemask = ntohl (x);
+    if (!(zf = zmsg_last (msg->zmsg))
+            || proto_decode (&msg->proto, zframe_data (zf),
+                                          zframe_size (zf)) < 0)
+        goto error;
+    zmsg_remove (msg->zmsg, zf);
+    zframe_destroy (&zf);
+    if ((msg->proto.flags & FLUX_MSGFLAG_PAYLOAD)) {
+        if (!(zf = zmsg_last (msg->zmsg)))
+            goto error;
+        zmsg_remove (msg->zmsg, zf);
+        if (!(msg->payload = payload_create_frame (zf))) {
+            zframe_destroy (&zf);
+            return -1;
+        }
+    }
+    if ((msg->proto.flags & FLUX_MSGFLAG_TOPIC)) {
+        if (!(msg->topic = zmsg_last (msg->zmsg)))
+            goto error;
+        zmsg_remove (msg->zmsg, msg->topic);
+    }
     return 0;
+error:
+    errno = EPROTO;
+    return -1;
 }
-static void proto_init (uint8_t *data, int len, uint8_t flags)
-{
-    assert (len >= PROTO_SIZE);
-    memset (data, 0, len);
-    data[PROTO_OFF_MAGIC] = PROTO_MAGIC;
-    data[PROTO_OFF_VERSION] = PROTO_VERSION;
-    data[PROTO_OFF_FLAGS] = flags;
-    proto_set_userid (data, len, FLUX_USERID_UNKNOWN);
-    proto_set_rolemask (data, len, FLUX_ROLE_NONE);
-}
-/* End manual codec
- */
 
 flux_msg_t *flux_msg_create (int type)
 {
-    uint8_t proto[PROTO_SIZE];
     flux_msg_t *msg = calloc (1, sizeof (*msg));
 
     if (!msg) {
@@ -241,8 +294,8 @@ flux_msg_t *flux_msg_create (int type)
         goto error;
     }
     msg->magic = FLUX_MSG_MAGIC;
-    proto_init (proto, PROTO_SIZE, 0);
-    if (proto_set_type (proto, PROTO_SIZE, type) < 0) {
+    proto_init (&msg->proto);
+    if (proto_set_type (&msg->proto, type) < 0) {
         errno = EINVAL;
         goto error;
     }
@@ -250,8 +303,6 @@ flux_msg_t *flux_msg_create (int type)
         errno = ENOMEM;
         goto error;
     }
-    if (zmsg_addmem (msg->zmsg, proto, PROTO_SIZE) < 0)
-        goto error;
     return msg;
 error:
     flux_msg_destroy (msg);
@@ -265,6 +316,8 @@ void flux_msg_destroy (flux_msg_t *msg)
         int saved_errno = errno;
         json_decref (msg->json);
         zmsg_destroy (&msg->zmsg);
+        zframe_destroy (&msg->topic);
+        payload_decref (msg->payload);
         msg->magic =~ FLUX_MSG_MAGIC;
         aux_destroy (&msg->aux);
         free (msg);
@@ -296,6 +349,11 @@ void *flux_msg_aux_get (const flux_msg_t *msg, const char *name)
     return aux_get (msg->aux, name);
 }
 
+static size_t encode_frame_size (size_t n)
+{
+    return n < 0xff ? 1 + n : 1 + 4 + n;
+}
+
 size_t flux_msg_encode_size (const flux_msg_t *msg)
 {
     zframe_t *zf;
@@ -303,45 +361,65 @@ size_t flux_msg_encode_size (const flux_msg_t *msg)
 
     zf = zmsg_first (msg->zmsg);
     while (zf) {
-        size_t n = zframe_size (zf);
-        if (n < 255)
-            size += 1;
-        else
-            size += 1 + 4;
-        size += n;
+        size += encode_frame_size (zframe_size (zf));
         zf = zmsg_next (msg->zmsg);
     }
+    if (msg->topic)
+        size += encode_frame_size (zframe_size (msg->topic));
+    if (msg->payload)
+        size += encode_frame_size (msg->payload->size);
+    size += encode_frame_size (PROTO_SIZE);
     return size;
 }
 
+static int encode_frame (uint8_t **pp, const uint8_t *end,
+                         const void *data, size_t n)
+{
+    uint8_t *p = *pp;
+
+    if ((size_t)(end - p) < encode_frame_size (n)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (n < 0xff)
+        *p++ = (uint8_t)n;
+    else {
+        *p++ = 0xff;
+        *(uint32_t *)p = htonl (n);
+        p += 4;
+    }
+    memcpy (p, data, n);
+    *pp = p + n;
+    return 0;
+}
 
 int flux_msg_encode (const flux_msg_t *msg, void *buf, size_t size)
 {
     uint8_t *p = buf;
+    const uint8_t *end = p + size;
+    uint8_t proto[PROTO_SIZE];
     zframe_t *zf;
 
     zf = zmsg_first (msg->zmsg);
     while (zf) {
-        size_t n = zframe_size (zf);
-        if (n < 0xff) {
-            if (size - (p - (uint8_t *)buf) < n + 1)
-                goto nospace;
-            *p++ = (uint8_t)n;
-        } else {
-            if (size - (p - (uint8_t *)buf) < n + 1 + 4)
-                goto nospace;
-            *p++ = 0xff;
-            *(uint32_t *)p = htonl (n);
-            p += 4;
-        }
-        memcpy (p, zframe_data (zf), n);
-        p += n;
+        if (encode_frame (&p, end, zframe_data (zf), zframe_size (zf)) < 0)
+            return -1;
         zf = zmsg_next (msg->zmsg);
     }
+    if (msg->topic) {
+        if (encode_frame (&p, end, zframe_data (msg->topic),
+                                   zframe_size (msg->topic)) < 0)
+            return -1;
+    }
+    if (msg->payload) {
+        if (encode_frame (&p, end, msg->payload->data,
+                                   msg->payload->size) < 0)
+            return -1;
+    }
+    proto_encode (&msg->proto, proto);
+    if (encode_frame (&p, end, proto, PROTO_SIZE) < 0)
+        return -1;
     return 0;
-nospace:
-    errno = EINVAL;
-    return -1;
 }
 
 flux_msg_t *flux_msg_decode (const void *buf, size_t size)
@@ -376,6 +454,12 @@ flux_msg_t *flux_msg_decode (const void *buf, size_t size)
             goto nomem;
         p += n;
     }
+    if (unpack_frames (msg) < 0) {
+        saved_errno = errno;
+        goto error;
+    }
+    if (msg->payload)
+        __sync_add_and_fetch (&payload_bytes_copied, msg->payload->size);
     return msg;
 nomem:
     saved_errno = EINVAL;
@@ -387,8 +471,7 @@ error:
 
 int flux_msg_set_type (flux_msg_t *msg, int type)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_set_type (zframe_data (zf), zframe_size (zf), type) < 0) {
+    if (proto_set_type (&msg->proto, type) < 0) {
         errno = EINVAL;
         return -1;
     }
@@ -397,118 +480,69 @@ int flux_msg_set_type (flux_msg_t *msg, int type)
 
 int flux_msg_get_type (const flux_msg_t *msg, int *type)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), type) < 0) {
-        errno = EPROTO;
-        return -1;
-    }
+    *type = msg->proto.type;
     return 0;
 }
 
 int flux_msg_set_flags (flux_msg_t *msg, uint8_t fl)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_set_flags (zframe_data (zf), zframe_size (zf), fl) < 0) {
-        errno = EINVAL;
-        return -1;
-    }
+    msg->proto.flags = fl;
     return 0;
 }
 
 int flux_msg_get_flags (const flux_msg_t *msg, uint8_t *fl)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_get_flags (zframe_data (zf), zframe_size (zf), fl) < 0) {
-        errno = EPROTO;
-        return -1;
-    }
+    *fl = msg->proto.flags;
     return 0;
 }
 
 int flux_msg_set_private (flux_msg_t *msg)
 {
-    uint8_t flags;
-    if (flux_msg_get_flags (msg, &flags) < 0)
-        return -1;
-    if (flux_msg_set_flags (msg, flags | FLUX_MSGFLAG_PRIVATE) < 0)
-        return -1;
+    msg->proto.flags |= FLUX_MSGFLAG_PRIVATE;
     return 0;
 }
 
 bool flux_msg_is_private (const flux_msg_t *msg)
 {
-    uint8_t flags;
-    if (flux_msg_get_flags (msg, &flags) < 0)
-        return true;
-    return (flags & FLUX_MSGFLAG_PRIVATE) ? true : false;
+    return (msg->proto.flags & FLUX_MSGFLAG_PRIVATE) ? true : false;
 }
 
-
 int flux_msg_set_userid (flux_msg_t *msg, uint32_t userid)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_set_userid (zframe_data (zf),
-                                 zframe_size (zf), userid) < 0) {
-        errno = EINVAL;
-        return -1;
-    }
+    msg->proto.userid = userid;
     return 0;
 }
 
 int flux_msg_get_userid (const flux_msg_t *msg, uint32_t *userid)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_get_userid (zframe_data (zf),
-                                 zframe_size (zf), userid) < 0) {
-        errno = EPROTO;
-        return -1;
-    }
+    *userid = msg->proto.userid;
     return 0;
 }
 
 int flux_msg_set_rolemask (flux_msg_t *msg, uint32_t rolemask)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_set_rolemask (zframe_data (zf),
-                                   zframe_size (zf), rolemask) < 0) {
-        errno = EINVAL;
-        return -1;
-    }
+    msg->proto.rolemask = rolemask;
     return 0;
 }
 
 int flux_msg_get_rolemask (const flux_msg_t *msg, uint32_t *rolemask)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_get_rolemask (zframe_data (zf),
-                                   zframe_size (zf), rolemask) < 0) {
-        errno = EPROTO;
-        return -1;
-    }
+    *rolemask = msg->proto.rolemask;
     return 0;
 }
 
 int flux_msg_set_nodeid (flux_msg_t *msg, uint32_t nodeid, int flags)
 {
-    zframe_t *zf;
-    int type;
-
     if (flags != 0 && flags != FLUX_MSGFLAG_UPSTREAM)
         goto error;
     if (nodeid == FLUX_NODEID_UPSTREAM) /* should have been resolved earlier */
         goto error;
     if (flags == FLUX_MSGFLAG_UPSTREAM && nodeid == FLUX_NODEID_ANY)
         goto error;
-    if (!(zf = zmsg_last (msg->zmsg)))
-        goto error;
-    if (proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0)
-        goto error;
-    if (type != FLUX_MSGTYPE_REQUEST)
-        goto error;
-    if (proto_set_bigint (zframe_data (zf), zframe_size (zf), nodeid) < 0)
-        goto error;
-    if (proto_mod_flags (zframe_data (zf), zframe_size (zf), flags, false) < 0)
+    if (msg->proto.type != FLUX_MSGTYPE_REQUEST)
         goto error;
+    msg->proto.bigint = nodeid;
+    msg->proto.flags |= flags;
     return 0;
 error:
     errno = EINVAL;
@@ -517,138 +551,101 @@ error:
 
 int flux_msg_get_nodeid (const flux_msg_t *msg, uint32_t *nodeid, int *flags)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    int type;
-    uint8_t fl;
-    uint32_t nid;
-
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
-            || type != FLUX_MSGTYPE_REQUEST
-            || proto_get_bigint (zframe_data (zf), zframe_size (zf), &nid) < 0
-            || proto_get_flags (zframe_data (zf), zframe_size (zf), &fl) < 0
-            || ((fl & FLUX_MSGFLAG_UPSTREAM) && nid == FLUX_NODEID_ANY)
-            || nid == FLUX_NODEID_UPSTREAM) {
+    const struct proto *proto = &msg->proto;
+
+    if (proto->type != FLUX_MSGTYPE_REQUEST
+            || ((proto->flags & FLUX_MSGFLAG_UPSTREAM)
+                                    && proto->bigint == FLUX_NODEID_ANY)
+            || proto->bigint == FLUX_NODEID_UPSTREAM) {
         errno = EPROTO;
         return -1;
     }
-    *nodeid = nid;
-    *flags = (fl & FLUX_MSGFLAG_UPSTREAM);
+    *nodeid = proto->bigint;
+    *flags = (proto->flags & FLUX_MSGFLAG_UPSTREAM);
     return 0;
 }
 
 int flux_msg_set_errnum (flux_msg_t *msg, int e)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    int type;
-
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
-            || (type != FLUX_MSGTYPE_RESPONSE && type != FLUX_MSGTYPE_KEEPALIVE)
-            || proto_set_bigint (zframe_data (zf), zframe_size (zf), e) < 0) {
+    if (msg->proto.type != FLUX_MSGTYPE_RESPONSE
+                            && msg->proto.type != FLUX_MSGTYPE_KEEPALIVE) {
         errno = EINVAL;
         return -1;
     }
+    msg->proto.bigint = e;
     return 0;
 }
 
 int flux_msg_get_errnum (const flux_msg_t *msg, int *e)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    int type;
-    uint32_t xe;
-
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
-            || (type != FLUX_MSGTYPE_RESPONSE && type != FLUX_MSGTYPE_KEEPALIVE)
-            || proto_get_bigint (zframe_data (zf), zframe_size (zf), &xe) < 0) {
+    if (msg->proto.type != FLUX_MSGTYPE_RESPONSE
+                            && msg->proto.type != FLUX_MSGTYPE_KEEPALIVE) {
         errno = EPROTO;
         return -1;
     }
-    *e = xe;
+    *e = msg->proto.bigint;
     return 0;
 }
 
 int flux_msg_set_seq (flux_msg_t *msg, uint32_t seq)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    int type;
-
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
-            || type != FLUX_MSGTYPE_EVENT
-            || proto_set_bigint (zframe_data (zf), zframe_size (zf), seq) < 0) {
+    if (msg->proto.type != FLUX_MSGTYPE_EVENT) {
         errno = EINVAL;
         return -1;
     }
+    msg->proto.bigint = seq;
     return 0;
 }
 
 int flux_msg_get_seq (const flux_msg_t *msg, uint32_t *seq)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    int type;
-
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
-            || type != FLUX_MSGTYPE_EVENT
-            || proto_get_bigint (zframe_data (zf), zframe_size (zf), seq) < 0) {
+    if (msg->proto.type != FLUX_MSGTYPE_EVENT) {
         errno = EPROTO;
         return -1;
     }
+    *seq = msg->proto.bigint;
     return 0;
 }
 
 int flux_msg_set_matchtag (flux_msg_t *msg, uint32_t t)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    int type;
-
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
-            || (type != FLUX_MSGTYPE_REQUEST && type != FLUX_MSGTYPE_RESPONSE)
-            || proto_set_bigint2 (zframe_data (zf), zframe_size (zf), t) < 0) {
+    if (msg->proto.type != FLUX_MSGTYPE_REQUEST
+                            && msg->proto.type != FLUX_MSGTYPE_RESPONSE) {
         errno = EINVAL;
         return -1;
     }
+    msg->proto.bigint2 = t;
     return 0;
 }
 
 int flux_msg_get_matchtag (const flux_msg_t *msg, uint32_t *t)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    int type;
-
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
-            || (type != FLUX_MSGTYPE_REQUEST && type != FLUX_MSGTYPE_RESPONSE)
-            || proto_get_bigint2 (zframe_data (zf), zframe_size (zf), t) < 0) {
+    if (msg->proto.type != FLUX_MSGTYPE_REQUEST
+                            && msg->proto.type != FLUX_MSGTYPE_RESPONSE) {
         errno = EPROTO;
         return -1;
     }
+    *t = msg->proto.bigint2;
     return 0;
 }
 
 int flux_msg_set_status (flux_msg_t *msg, int s)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    int type;
-
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
-            || type != FLUX_MSGTYPE_KEEPALIVE
-            || proto_set_bigint2 (zframe_data (zf), zframe_size (zf), s) < 0) {
+    if (msg->proto.type != FLUX_MSGTYPE_KEEPALIVE) {
         errno = EINVAL;
         return -1;
     }
+    msg->proto.bigint2 = s;
     return 0;
 }
 
 int flux_msg_get_status (const flux_msg_t *msg, int *s)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    int type;
-    uint32_t u;
-
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
-            || type != FLUX_MSGTYPE_KEEPALIVE
-            || proto_get_bigint2 (zframe_data (zf), zframe_size (zf), &u) < 0) {
+    if (msg->proto.type != FLUX_MSGTYPE_KEEPALIVE) {
         errno = EPROTO;
         return -1;
     }
-    *s = u;
+    *s = msg->proto.bigint2;
     return 0;
 }
 
@@ -941,15 +938,15 @@ char *flux_msg_get_route_string (const flux_msg_t *msg)
     return buf;
 }
 
-static bool payload_overlap (const void *b, zframe_t *zf)
+static bool payload_overlap (const void *b, struct payload *p)
 {
-    return ((char *)b >= (char *)zframe_data (zf)
-         && (char *)b <  (char *)zframe_data (zf) + zframe_size (zf));
+    return ((char *)b >= (char *)p->data
+         && (char *)b <  (char *)p->data + p->size);
 }
 
 int flux_msg_set_payload (flux_msg_t *msg, const void *buf, int size)
 {
-    zframe_t *zf;
+    struct payload *p = NULL;
     uint8_t flags;
     int rc = -1;
 
@@ -965,50 +962,34 @@ int flux_msg_set_payload (flux_msg_t *msg, const void *buf, int size)
         rc = 0;
         goto done;
     }
-    zf = zmsg_first (msg->zmsg);
-    if ((flags & FLUX_MSGFLAG_ROUTE)) {
-        while (zf && zframe_size (zf) > 0)
-            zf = zmsg_next (msg->zmsg);      /* skip route frame */
-        if (zf)
-            zf = zmsg_next (msg->zmsg);      /* skip route delim */
-    }
-    if ((flags & FLUX_MSGFLAG_TOPIC)) {
-        if (zf)
-            zf = zmsg_next (msg->zmsg);      /* skip topic frame */
-    }
-    if (!zf) {                          /* must at least have proto frame */
-        errno = EPROTO;
-        goto done;
-    }
-    /* Case #1: replace existing payload.
+    /* Add or replace payload.  The buffer is immutable once created,
+     * so a new one is always allocated (it may be shared by copies).
      */
-    if ((flags & FLUX_MSGFLAG_PAYLOAD) && (buf != NULL && size > 0)) {
-        if (zframe_data (zf) != buf || zframe_size (zf) != size) {
-            if (payload_overlap (buf, zf)) {
+    if (buf != NULL && size > 0) {
+        if (msg->payload) {
+            if (msg->payload->data == buf && msg->payload->size == size) {
+                rc = 0;
+                goto done;
+            }
+            if (payload_overlap (buf, msg->payload)) {
                 errno = EINVAL;
                 goto done;
             }
-            zframe_reset (zf, buf, size);
         }
-    /* Case #2: add payload.
-     */
-    } else if (!(flags & FLUX_MSGFLAG_PAYLOAD) && (buf != NULL && size > 0)) {
-        zmsg_remove (msg->zmsg, zf);
-        if (zmsg_addmem (msg->zmsg, buf, size) < 0
-                                        || zmsg_append (msg->zmsg, &zf) < 0) {
-            errno = ENOMEM;
+        if (!(p = payload_create (buf, size)))
             goto done;
-        }
         flags |= FLUX_MSGFLAG_PAYLOAD;
-    /* Case #3: remove payload.
+    }
+    /* Remove payload.
      */
-    } else if ((flags & FLUX_MSGFLAG_PAYLOAD) && (buf == NULL || size == 0)) {
-        zmsg_remove (msg->zmsg, zf);
-        zframe_destroy (&zf);
+    else
         flags &= ~(uint8_t)(FLUX_MSGFLAG_PAYLOAD);
-    }
-    if (flux_msg_set_flags (msg, flags) < 0)
+    if (flux_msg_set_flags (msg, flags) < 0) {
+        payload_decref (p);
         goto done;
+    }
+    payload_decref (msg->payload);
+    msg->payload = p;
     rc = 0;
 done:
     return rc;
@@ -1054,34 +1035,18 @@ int flux_msg_pack (flux_msg_t *msg, const char *fmt, ...)
 
 int flux_msg_get_payload (const flux_msg_t *msg, const void **buf, int *size)
 {
-    zframe_t *zf;
     uint8_t flags;
 
     if (flux_msg_get_flags (msg, &flags) < 0)
         return -1;
-    if (!(flags & FLUX_MSGFLAG_PAYLOAD)) {
-        errno = EPROTO;
-        return -1;
-    }
-    zf = zmsg_first (msg->zmsg);
-    if ((flags & FLUX_MSGFLAG_ROUTE)) {
-        while (zf && zframe_size (zf) > 0)
-            zf = zmsg_next (msg->zmsg);
-        if (zf)
-            zf = zmsg_next (msg->zmsg);
-    }
-    if ((flags & FLUX_MSGFLAG_TOPIC)) {
-        if (zf)
-            zf = zmsg_next (msg->zmsg);
-    }
-    if (!zf) {
+    if (!(flags & FLUX_MSGFLAG_PAYLOAD) || !msg->payload) {
         errno = EPROTO;
         return -1;
     }
     if (buf)
-        *buf = zframe_data (zf);
+        *buf = msg->payload->data;
     if (size)
-        *size = zframe_size (zf);
+        *size = msg->payload->size;
     return 0;
 }
 
@@ -1175,141 +1140,74 @@ int flux_msg_unpack (const flux_msg_t *msg, const char *fmt, ...)
 
 int flux_msg_set_topic (flux_msg_t *msg, const char *topic)
 {
-    zframe_t *zf, *zf2 = NULL;
-    uint8_t flags;
-    int rc = -1;
-
-    if (flux_msg_get_flags (msg, &flags) < 0)
-        goto done;
-    zf = zmsg_first (msg->zmsg);
-    if ((flags & FLUX_MSGFLAG_ROUTE)) {   /* skip over routing frames, if any */
-        while (zf && zframe_size (zf) > 0)
-            zf = zmsg_next (msg->zmsg);
-        if (zf)
-            zf = zmsg_next (msg->zmsg);
-    }
-    if (!zf) {                          /* must at least have proto frame */
-        errno = EPROTO;
-        goto done;
-    }
-    if ((flags & FLUX_MSGFLAG_TOPIC) && topic) {        /* case 1: repl topic */
-        zframe_reset (zf, topic, strlen (topic) + 1);
-    } else if (!(flags & FLUX_MSGFLAG_TOPIC) && topic) {/* case 2: add topic */
-        zmsg_remove (msg->zmsg, zf);
-        if ((flags & FLUX_MSGFLAG_PAYLOAD) && (zf2 = zmsg_next (msg->zmsg)))
-            zmsg_remove (msg->zmsg, zf2);
-        if (zmsg_addmem (msg->zmsg, topic, strlen (topic) + 1) < 0
-                                    || zmsg_append (msg->zmsg, &zf) < 0
-                                    || (zf2 && zmsg_append (msg->zmsg, &zf2) < 0)) {
+    if (topic) {
+        if (msg->topic) {
+            if (zframe_data (msg->topic) != (byte *)topic)
+                zframe_reset (msg->topic, topic, strlen (topic) + 1);
+        }
+        else if (!(msg->topic = zframe_new (topic, strlen (topic) + 1))) {
             errno = ENOMEM;
-            goto done;
+            return -1;
         }
-        flags |= FLUX_MSGFLAG_TOPIC;
-        if (flux_msg_set_flags (msg, flags) < 0)
-            goto done;
-    } else if ((flags & FLUX_MSGFLAG_TOPIC) && !topic) { /* case 3: del topic */
-        zmsg_remove (msg->zmsg, zf);
-        zframe_destroy (&zf);
-        flags &= ~(uint8_t)FLUX_MSGFLAG_TOPIC;
-        if (flux_msg_set_flags (msg, flags) < 0)
-            goto done;
+        msg->proto.flags |= FLUX_MSGFLAG_TOPIC;
     }
-    rc = 0;
-done:
-    return rc;
-}
-
-static int zf_topic (const flux_msg_t *msg, zframe_t **zfp)
-{
-    uint8_t flags;
-    zframe_t *zf = NULL;
-    int rc = -1;
-
-    if (flux_msg_get_flags (msg, &flags) < 0)
-        goto done;
-    if (!(flags & FLUX_MSGFLAG_TOPIC)) {
-        errno = EPROTO;
-        goto done;
-    }
-    zf = zmsg_first (msg->zmsg);
-    if ((flags & FLUX_MSGFLAG_ROUTE)) {
-        while (zf && zframe_size (zf) > 0)
-            zf = zmsg_next (msg->zmsg);
-        if (zf)
-            zf = zmsg_next (msg->zmsg);
+    else {
+        zframe_destroy (&msg->topic);
+        msg->proto.flags &= ~(uint8_t)FLUX_MSGFLAG_TOPIC;
     }
-    if (!zf) {
-        errno = EPROTO;
-        goto done;
-    }
-    *zfp = zf;
-    rc = 0;
-done:
-    return rc;
+    return 0;
 }
 
 int flux_msg_get_topic (const flux_msg_t *msg, const char **topic)
 {
-    zframe_t *zf;
     const char *s;
-    int rc = -1;
+    size_t size;
 
-    if (zf_topic (msg, &zf) < 0)
-        goto done;
-    s = (const char *)zframe_data (zf);
-    if (s[zframe_size (zf) - 1] != '\0') {
+    if (!(msg->proto.flags & FLUX_MSGFLAG_TOPIC) || !msg->topic) {
         errno = EPROTO;
-        goto done;
+        return -1;
+    }
+    s = (const char *)zframe_data (msg->topic);
+    size = zframe_size (msg->topic);
+    if (size == 0 || s[size - 1] != '\0') {
+        errno = EPROTO;
+        return -1;
     }
     *topic = s;
-    rc = 0;
-done:
-    return rc;
+    return 0;
 }
 
 flux_msg_t *flux_msg_copy (const flux_msg_t *msg, bool payload)
 {
     flux_msg_t *cpy = NULL;
     zframe_t *zf;
-    int count;
-    uint8_t flags;
-    bool skip_payload = false;
 
     if (msg->magic != FLUX_MSG_MAGIC) {
         errno = EINVAL;
         goto error;
     }
-    /* Set skip_payload = true if caller set 'payload' flag false
-     * AND message contains a payload frame.
-     */
-    if (flux_msg_get_flags (msg, &flags) < 0)
-        goto error;
-    if (!payload && (flags & FLUX_MSGFLAG_PAYLOAD)) {
-        flags &= ~(FLUX_MSGFLAG_PAYLOAD);
-        skip_payload = true;
-    }
     if (!(cpy = calloc (1, sizeof (*cpy))))
         goto nomem;
     cpy->magic = FLUX_MSG_MAGIC;
+    cpy->proto = msg->proto;
     if (!(cpy->zmsg = zmsg_new ()))
         goto nomem;
-
-    /* Copy frames from 'msg' to 'cpy'.
-     * 'count' indexes frames from 0 to zmsg_size (msg) - 1.
-     * The payload frame (if it exists) will be in the second to last position.
-     */
-    count = 0;
     zf = zmsg_first (msg->zmsg);
     while (zf) {
-        if (!skip_payload || count != zmsg_size (msg->zmsg) - 2) {
-            if (zmsg_addmem (cpy->zmsg, zframe_data (zf), zframe_size (zf)) < 0)
-                goto nomem;
-        }
+        if (zmsg_addmem (cpy->zmsg, zframe_data (zf), zframe_size (zf)) < 0)
+            goto nomem;
         zf = zmsg_next (msg->zmsg);
-        count++;
     }
-    if (flux_msg_set_flags (cpy, flags) < 0)
-        goto error;
+    if (msg->topic && !(cpy->topic = zframe_dup (msg->topic)))
+        goto nomem;
+    /* The copy shares the (immutable) payload buffer.
+     */
+    if (payload && msg->payload) {
+        cpy->payload = payload_incref (msg->payload);
+        __sync_add_and_fetch (&payload_bytes_shared, msg->payload->size);
+    }
+    if (!payload)
+        cpy->proto.flags &= ~(FLUX_MSGFLAG_PAYLOAD);
     return cpy;
 nomem:
     errno = ENOMEM;
@@ -1318,6 +1216,14 @@ error:
     return NULL;
 }
 
+void flux_msg_payload_stats (uint64_t *copied, uint64_t *shared)
+{
+    if (copied)
+        *copied = __sync_add_and_fetch (&payload_bytes_copied, 0);
+    if (shared)
+        *shared = __sync_add_and_fetch (&payload_bytes_shared, 0);
+}
+
 struct map_struct {
     const char *name;
     const char *sname;
@@ -1357,7 +1263,8 @@ void flux_msg_fprint (FILE *f, const flux_msg_t *msg)
 {
     int hops;
     int type = 0;
-    zframe_t *proto;
+    uint8_t proto[PROTO_SIZE];
+    zframe_t *zf;
     const char *prefix, *topic = NULL;
 
     fprintf (f, "--------------------------------------\n");
@@ -1365,8 +1272,7 @@ void flux_msg_fprint (FILE *f, const flux_msg_t *msg)
         fprintf (f, "NULL");
         return;
     }
-    if (flux_msg_get_type (msg, &type) < 0
-            || (!(proto = zmsg_last (msg->zmsg)))) {
+    if (flux_msg_get_type (msg, &type) < 0) {
         fprintf (f, "malformed message");
         return;
     }
@@ -1401,7 +1307,11 @@ void flux_msg_fprint (FILE *f, const flux_msg_t *msg)
     }
     /* Proto block
      */
-    zframe_fprint (proto, prefix, f);
+    proto_encode (&msg->proto, proto);
+    if ((zf = zframe_new (proto, PROTO_SIZE))) {
+        zframe_fprint (zf, prefix, f);
+        zframe_destroy (&zf);
+    }
 }
 
 #define IOBUF_MAGIC 0xffee0012
@@ -1531,32 +1441,67 @@ done:
     return msg;
 }
 
-int flux_msg_sendzsock (void *sock, const flux_msg_t *msg)
+/* Send 'msg' to 'sock'.  If 'id' is non-NULL, send it as though it had
+ * been pushed onto the route stack (enabling routing if necessary),
+ * without modifying or copying 'msg'.
+ */
+static int sendzsock (void *sock, const flux_msg_t *msg, const char *id)
 {
+    void *handle;
+    struct proto proto;
+    uint8_t buf[PROTO_SIZE];
+    int flags = ZFRAME_REUSE | ZFRAME_MORE;
+    zframe_t *zf;
     int rc = -1;
 
     if (!sock || !msg || !zmsg_is (msg->zmsg)) {
         errno = EINVAL;
         goto done;
     }
-
-    void *handle = zsock_resolve (sock);
-    int flags = ZFRAME_REUSE | ZFRAME_MORE;
-    zframe_t *zf = zmsg_first (msg->zmsg);
-    size_t count = 0;
-
+    handle = zsock_resolve (sock);
+    proto = msg->proto;
+    if (id) {
+        if (zmq_send (handle, id, strlen (id), ZMQ_SNDMORE) < 0)
+            goto done;
+        if (!(proto.flags & FLUX_MSGFLAG_ROUTE)) {
+            if (zmq_send (handle, NULL, 0, ZMQ_SNDMORE) < 0)
+                goto done;
+            proto.flags |= FLUX_MSGFLAG_ROUTE;
+        }
+    }
+    zf = zmsg_first (msg->zmsg);
     while (zf) {
-        if (++count == zmsg_size (msg->zmsg))
-            flags &= ~ZFRAME_MORE;
         if (zframe_send (&zf, handle, flags) < 0)
             goto done;
         zf = zmsg_next (msg->zmsg);
     }
+    if ((zf = msg->topic) && zframe_send (&zf, handle, flags) < 0)
+        goto done;
+    if (msg->payload && payload_send (msg->payload, handle) < 0)
+        goto done;
+    proto_encode (&proto, buf);
+    if (zmq_send (handle, buf, PROTO_SIZE, 0) < 0)
+        goto done;
     rc = 0;
 done:
     return rc;
 }
 
+int flux_msg_sendzsock (void *sock, const flux_msg_t *msg)
+{
+    return sendzsock (sock, msg, NULL);
+}
+
+int flux_msg_sendzsock_route (void *sock, const flux_msg_t *msg,
+                              const char *id)
+{
+    if (!id) {
+        errno = EINVAL;
+        return -1;
+    }
+    return sendzsock (sock, msg, id);
+}
+
 flux_msg_t *flux_msg_recvzsock (void *sock)
 {
     zmsg_t *zmsg;
@@ -1571,12 +1516,17 @@ flux_msg_t *flux_msg_recvzsock (void *sock)
     }
     msg->magic = FLUX_MSG_MAGIC;
     msg->zmsg = zmsg;
+    if (unpack_frames (msg) < 0) {
+        flux_msg_destroy (msg);
+        return NULL;
+    }
     return msg;
 }
 
 int flux_msg_frames (const flux_msg_t *msg)
 {
-    return zmsg_size (msg->zmsg);
+    return zmsg_size (msg->zmsg) + (msg->topic ? 1 : 0)
+                                 + (msg->payload ? 1 : 0) + 1;
 }
 
 /*
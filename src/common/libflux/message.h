@@ -90,9 +90,15 @@ int flux_msg_aux_set (const flux_msg_t *msg, const char *name,
 void *flux_msg_aux_get (const flux_msg_t *msg, const char *name);
 
 /* Duplicate msg, omitting payload if 'payload' is false.
+ * The copy shares the payload buffer with 'msg' rather than duplicating it.
  */
 flux_msg_t *flux_msg_copy (const flux_msg_t *msg, bool payload);
 
+/* Get the total number of payload bytes copied into messages, and shared
+ * between messages by reference (copies and zeromq sends), in this process.
+ */
+void flux_msg_payload_stats (uint64_t *copied, uint64_t *shared);
+
 /* Encode a flux_msg_t to buffer (pre-sized by calling flux_msg_encode_size()).
  * Returns 0 on success, -1 on failure with errno set.
  */
@@ -127,6 +133,15 @@ flux_msg_t *flux_msg_recvfd (int fd, struct flux_msg_iobuf *iobuf);
  */
 int flux_msg_sendzsock (void *dest, const flux_msg_t *msg);
 
+/* Send message to zeromq socket with 'id' pushed onto its route stack,
+ * as if by flux_msg_enable_route() and flux_msg_push_route() on a copy.
+ * The message is not modified and its payload is not copied, so this is
+ * cheap to call once per peer when multicasting.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int flux_msg_sendzsock_route (void *dest, const flux_msg_t *msg,
+                              const char *id);
+
 /* Receive a message from zeromq socket.
  * Returns message on success, NULL on failure with errno set.
  */
@@ -165,7 +180,8 @@ int flux_msg_get_topic (const flux_msg_t *msg, const char **topic);
  * Set function adds/deletes/replaces payload frame as needed.
  * The new payload will be copied (caller retains ownership).
  * Any old payload is deleted.
- * flux_msg_get_payload returns pointer to msg-owned buf.
+ * flux_msg_get_payload returns pointer to msg-owned buf, which may be
+ * shared with copies of the message and must not be modified.
  */
 int flux_msg_get_payload (const flux_msg_t *msg, const void **buf, int *size);
 int flux_msg_set_payload (flux_msg_t *msg, const void *buf, int size);
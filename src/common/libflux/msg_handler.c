@@ -26,11 +26,39 @@
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/iterators.h"
 
+/* Handlers other than rpc response handlers are indexed by message type
+ * and topic, so that dispatch tests only handlers that could match:
+ * - exact: topic_glob contains no wildcards, hashed by topic
+ * - prefix: topic_glob is a literal followed by one trailing '*',
+ *   stored in a character trie walked along the message topic
+ * - other: any other glob, or no topic (matches all), tested in turn
+ * Each handler list is kept newest first (descending 'seq').  For requests
+ * and responses, the newest matching handler wins, as it did when all
+ * handlers were kept on one list.  For events, all matching handlers are
+ * called, newest first.
+ */
+#define DISPATCH_NTYPES 4
+
+struct trie_node {
+    char c;
+    struct trie_node *child;    // first child
+    struct trie_node *next;     // next sibling
+    zlist_t *handlers;          // handlers whose prefix ends here
+};
+
+struct dispatch_index {
+    zhashx_t *exact;            // topic => zlist_t of handlers
+    struct trie_node prefix;    // root node (c unused)
+    zlist_t *other;
+};
+
 struct dispatch {
     flux_t *h;
     zlist_t *handlers;
     zlist_t *handlers_new;
     zhashx_t *handlers_rpc; // hashed by matchtag
+    struct dispatch_index index[DISPATCH_NTYPES];
+    uint64_t seq;
     flux_watcher_t *w;
     int running_count;
     int usecount;
@@ -51,6 +79,8 @@ struct flux_msg_handler {
     flux_msg_handler_f fn;
     void *arg;
     uint8_t running:1;
+    uint64_t seq;           // order in which handler was added to dispatch
+    int refcount;
 };
 
 static void handle_cb (flux_reactor_t *r, flux_watcher_t *w,
@@ -60,6 +90,225 @@ static void free_msg_handler (flux_msg_handler_t *mh);
 static size_t matchtag_hasher (const void *key);
 static int matchtag_cmp (const void *key1, const void *key2);
 
+enum {
+    INDEX_EXACT,
+    INDEX_PREFIX,
+    INDEX_OTHER,
+};
+
+/* Map message type to index slot, or -1 if type is invalid.
+ */
+static int type_slot (int type)
+{
+    switch (type) {
+        case FLUX_MSGTYPE_REQUEST:
+            return 0;
+        case FLUX_MSGTYPE_RESPONSE:
+            return 1;
+        case FLUX_MSGTYPE_EVENT:
+            return 2;
+        case FLUX_MSGTYPE_KEEPALIVE:
+            return 3;
+    }
+    return -1;
+}
+
+/* Classify topic_glob as described above.
+ * Wildcards are the ones recognized by flux_msg_cmp(), plus anything
+ * else fnmatch(3) would interpret in a prefix.
+ */
+static int index_class (const char *glob)
+{
+    size_t len;
+
+    if (!glob || strlen (glob) == 0 || !strcmp (glob, "*"))
+        return INDEX_OTHER;
+    if (!strchr (glob, '*') && !strchr (glob, '?'))
+        return INDEX_EXACT;
+    len = strlen (glob);
+    if (glob[len - 1] == '*' && strcspn (glob, "*?[\\") == len - 1)
+        return INDEX_PREFIX;
+    return INDEX_OTHER;
+}
+
+static void list_destructor (void **item)
+{
+    if (item) {
+        zlist_t *l = *item;
+        zlist_destroy (&l);
+        *item = NULL;
+    }
+}
+
+static void trie_destroy (struct trie_node *node)
+{
+    while (node) {
+        struct trie_node *next = node->next;
+        trie_destroy (node->child);
+        zlist_destroy (&node->handlers);
+        free (node);
+        node = next;
+    }
+}
+
+static struct trie_node *trie_child (struct trie_node *node, char c,
+                                     bool create)
+{
+    struct trie_node *child;
+
+    for (child = node->child; child != NULL; child = child->next) {
+        if (child->c == c)
+            return child;
+    }
+    if (!create)
+        return NULL;
+    if (!(child = calloc (1, sizeof (*child))))
+        return NULL;
+    child->c = c;
+    child->next = node->child;
+    node->child = child;
+    return child;
+}
+
+/* Remove 'mh' from the trie below 'node', following 'prefix'.
+ * Empty nodes are pruned on the way back up.
+ */
+static void trie_remove (struct trie_node *node, const char *prefix,
+                         flux_msg_handler_t *mh)
+{
+    struct trie_node *child, **prev;
+
+    if (*prefix == '\0') {
+        if (node->handlers)
+            zlist_remove (node->handlers, mh);
+        return;
+    }
+    for (prev = &node->child; (child = *prev) != NULL; prev = &child->next) {
+        if (child->c == *prefix)
+            break;
+    }
+    if (!child)
+        return;
+    trie_remove (child, prefix + 1, mh);
+    if (!child->child && (!child->handlers
+                          || zlist_size (child->handlers) == 0)) {
+        *prev = child->next;
+        zlist_destroy (&child->handlers);
+        free (child);
+    }
+}
+
+static void index_destroy (struct dispatch_index *idx)
+{
+    zhashx_destroy (&idx->exact);
+    trie_destroy (idx->prefix.child);
+    idx->prefix.child = NULL;
+    zlist_destroy (&idx->prefix.handlers);
+    zlist_destroy (&idx->other);
+}
+
+static int index_init (struct dispatch_index *idx)
+{
+    if (!(idx->exact = zhashx_new ()) || !(idx->other = zlist_new ())) {
+        errno = ENOMEM;
+        return -1;
+    }
+    zhashx_set_destructor (idx->exact, list_destructor);
+    return 0;
+}
+
+/* Add 'mh' to 'idx'.  Since 'mh' is the newest handler, push it on the
+ * front of its list.
+ */
+static int index_insert (struct dispatch_index *idx, flux_msg_handler_t *mh)
+{
+    const char *glob = mh->match.topic_glob;
+    zlist_t *l = NULL;
+
+    switch (index_class (glob)) {
+        case INDEX_EXACT:
+            if (!(l = zhashx_lookup (idx->exact, glob))) {
+                if (!(l = zlist_new ()))
+                    goto nomem;
+                (void)zhashx_insert (idx->exact, glob, l);
+            }
+            break;
+        case INDEX_PREFIX: {
+            struct trie_node *node = &idx->prefix;
+            size_t i, len = strlen (glob) - 1;
+            for (i = 0; i < len; i++) {
+                if (!(node = trie_child (node, glob[i], true)))
+                    goto nomem;
+            }
+            if (!node->handlers && !(node->handlers = zlist_new ()))
+                goto nomem;
+            l = node->handlers;
+            break;
+        }
+        case INDEX_OTHER:
+            l = idx->other;
+            break;
+    }
+    if (zlist_push (l, mh) < 0)
+        goto nomem;
+    return 0;
+nomem:
+    errno = ENOMEM;
+    return -1;
+}
+
+static void index_remove (struct dispatch_index *idx, flux_msg_handler_t *mh)
+{
+    const char *glob = mh->match.topic_glob;
+    zlist_t *l;
+
+    switch (index_class (glob)) {
+        case INDEX_EXACT:
+            if ((l = zhashx_lookup (idx->exact, glob))) {
+                zlist_remove (l, mh);
+                if (zlist_size (l) == 0)
+                    zhashx_delete (idx->exact, glob);
+            }
+            break;
+        case INDEX_PREFIX: {
+            char *prefix = strdup (glob);
+            if (prefix) {
+                prefix[strlen (prefix) - 1] = '\0';
+                trie_remove (&idx->prefix, prefix, mh);
+                free (prefix);
+            }
+            break;
+        }
+        case INDEX_OTHER:
+            zlist_remove (idx->other, mh);
+            break;
+    }
+}
+
+/* Call 'fun' on the index slot of each message type matched by 'mh'.
+ */
+static int foreach_slot (struct dispatch *d, flux_msg_handler_t *mh,
+                         int (*fun)(struct dispatch_index *idx,
+                                    flux_msg_handler_t *mh))
+{
+    int i;
+
+    for (i = 0; i < DISPATCH_NTYPES; i++) {
+        if (mh->match.typemask == 0 || (mh->match.typemask & (1 << i))) {
+            if (fun (&d->index[i], mh) < 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+static int index_remove_slot (struct dispatch_index *idx,
+                              flux_msg_handler_t *mh)
+{
+    index_remove (idx, mh);
+    return 0;
+}
+
 static void dispatch_requeue (struct dispatch *d)
 {
     if (d->unmatched) {
@@ -90,6 +339,8 @@ static void dispatch_usecount_decr (struct dispatch *d)
         }
         flux_watcher_destroy (d->w);
         zhashx_destroy (&d->handlers_rpc);
+        for (int i = 0; i < DISPATCH_NTYPES; i++)
+            index_destroy (&d->index[i]);
         free (d);
         errno = saved_errno;
     }
@@ -130,6 +381,10 @@ static struct dispatch *dispatch_get (flux_t *h)
         zhashx_set_key_comparator (d->handlers_rpc, matchtag_cmp);
         zhashx_set_key_destructor (d->handlers_rpc, NULL);
         zhashx_set_key_duplicator (d->handlers_rpc, NULL);
+        for (int i = 0; i < DISPATCH_NTYPES; i++) {
+            if (index_init (&d->index[i]) < 0)
+                goto error;
+        }
 #if HAVE_CALIPER
         d->prof_msg_type = cali_create_attribute ("flux.message.type",
                                                   CALI_TYPE_STRING,
@@ -215,12 +470,112 @@ static void call_handler (flux_msg_handler_t *mh, const flux_msg_t *msg)
     mh->fn (mh->d->h, mh, msg, mh->arg);
 }
 
-static bool dispatch_message (struct dispatch *d,
-                              const flux_msg_t *msg, int type)
+/* Find handlers in 'l' that match 'msg'.  If 'all' is false, only the
+ * newest match is of interest:  update '*best' if it is newer.  Otherwise
+ * append each match to 'matches'.
+ */
+static int match_list (zlist_t *l, const flux_msg_t *msg, bool all,
+                       flux_msg_handler_t **best, zlist_t *matches)
 {
     flux_msg_handler_t *mh;
-    bool match = false;
 
+    if (!l)
+        return 0;
+    FOREACH_ZLIST (l, mh) {
+        if (!mh->running || !flux_msg_cmp (msg, mh->match))
+            continue;
+        if (!all) {
+            if (!*best || mh->seq > (*best)->seq)
+                *best = mh;
+            break; // list is newest first
+        }
+        if (zlist_append (matches, mh) < 0) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int match_index (struct dispatch_index *idx, const flux_msg_t *msg,
+                        bool all, flux_msg_handler_t **best,
+                        zlist_t *matches)
+{
+    const char *topic;
+
+    if (flux_msg_get_topic (msg, &topic) == 0) {
+        struct trie_node *node = &idx->prefix;
+        const char *cp;
+
+        if (match_list (zhashx_lookup (idx->exact, topic),
+                        msg, all, best, matches) < 0)
+            return -1;
+        for (cp = topic; *cp != '\0'; cp++) {
+            if (!(node = trie_child (node, *cp, false)))
+                break;
+            if (match_list (node->handlers, msg, all, best, matches) < 0)
+                return -1;
+        }
+    }
+    return match_list (idx->other, msg, all, best, matches);
+}
+
+/* zlist_compare_fn to order handlers newest first.
+ */
+static int seq_cmp (void *item1, void *item2)
+{
+    flux_msg_handler_t *mh1 = item1;
+    flux_msg_handler_t *mh2 = item2;
+
+    if (mh1->seq < mh2->seq)
+        return 1;
+    if (mh1->seq > mh2->seq)
+        return -1;
+    return 0;
+}
+
+static void msg_handler_decref (flux_msg_handler_t *mh);
+
+/* Call all handlers matching event 'msg', newest first.
+ * Handlers hold a reference while queued, so that a handler may destroy
+ * other handlers (or itself) during the traversal.
+ * N.B. events are never "consumed" by a handler (see handle_cb).
+ */
+static int dispatch_event (struct dispatch_index *idx, const flux_msg_t *msg)
+{
+    zlist_t *matches;
+    flux_msg_handler_t *mh;
+    int rc = -1;
+
+    if (!(matches = zlist_new ())) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (match_index (idx, msg, true, NULL, matches) < 0)
+        goto done;
+    zlist_sort (matches, seq_cmp);
+    FOREACH_ZLIST (matches, mh)
+        mh->refcount++;
+    while ((mh = zlist_pop (matches))) {
+        if (mh->running)
+            call_handler (mh, msg);
+        msg_handler_decref (mh);
+    }
+    rc = 0;
+done:
+    while ((mh = zlist_pop (matches)))
+        msg_handler_decref (mh);
+    zlist_destroy (&matches);
+    return rc;
+}
+
+static int dispatch_message (struct dispatch *d,
+                             const flux_msg_t *msg, int type, bool *match)
+{
+    flux_msg_handler_t *mh;
+    int slot;
+
+    *match = false;
     /* rpc w/matchtag */
     if (type == FLUX_MSGTYPE_RESPONSE) {
         uint32_t matchtag;
@@ -230,40 +585,42 @@ static bool dispatch_message (struct dispatch *d,
                 && mh->running
                 && flux_msg_cmp (msg, mh->match)) {
             call_handler (mh, msg);
-            match = true;
+            *match = true;
+            return 0;
         }
     }
     /* other */
-    if (!match) {
-        FOREACH_ZLIST (d->handlers, mh) {
-            if (!mh->running)
-                continue;
-            if (flux_msg_cmp (msg, mh->match)) {
-                call_handler (mh, msg);
-                if (type != FLUX_MSGTYPE_EVENT) {
-                    match = true;
-                    break;
-                }
-            }
-        }
+    if ((slot = type_slot (type)) < 0)
+        return 0;
+    if (type == FLUX_MSGTYPE_EVENT)
+        return dispatch_event (&d->index[slot], msg);
+    mh = NULL;
+    if (match_index (&d->index[slot], msg, false, &mh, NULL) < 0)
+        return -1;
+    if (mh) {
+        call_handler (mh, msg);
+        *match = true;
     }
-    return match;
+    return 0;
 }
 
-static int transfer_items_zlist (zlist_t *from, zlist_t *to)
+/* Move handlers created since the last dispatch into the index,
+ * making handler creation safe to call during dispatch.
+ */
+static int transfer_new_handlers (struct dispatch *d)
 {
-    void *item;
-    int rc = -1;
+    flux_msg_handler_t *mh;
 
-    while ((item = zlist_pop (from))) {
-        if (zlist_push (to, item) < 0) {
+    while ((mh = zlist_pop (d->handlers_new))) {
+        mh->seq = ++d->seq;
+        if (zlist_push (d->handlers, mh) < 0) {
             errno = ENOMEM;
-            goto done;
+            return -1;
         }
+        if (foreach_slot (d, mh, index_insert) < 0)
+            return -1;
     }
-    rc = 0;
-done:
-    return rc;
+    return 0;
 }
 
 static void handle_cb (flux_reactor_t *r,
@@ -291,10 +648,7 @@ static void handle_cb (flux_reactor_t *r,
 
     const char *topic;
     flux_msg_get_topic (msg, &topic);
-    /* Add any new handlers here, making handler creation
-     * safe to call during handlers list traversal below.
-     */
-    if (transfer_items_zlist (d->handlers_new, d->handlers) < 0)
+    if (transfer_new_handlers (d) < 0)
         goto done;
 
 #if defined(HAVE_CALIPER)
@@ -305,7 +659,8 @@ static void handle_cb (flux_reactor_t *r,
     cali_end (d->prof_msg_type);
 #endif
 
-    match = dispatch_message (d, msg, type);
+    if (dispatch_message (d, msg, type, &match) < 0)
+        goto done;
 
 #if defined(HAVE_CALIPER)
     cali_begin_string (d->prof_msg_type, flux_msg_typestr (type));
@@ -416,6 +771,12 @@ static void free_msg_handler (flux_msg_handler_t *mh)
     }
 }
 
+static void msg_handler_decref (flux_msg_handler_t *mh)
+{
+    if (mh && --mh->refcount == 0)
+        free_msg_handler (mh);
+}
+
 void flux_msg_handler_destroy (flux_msg_handler_t *mh)
 {
     if (mh) {
@@ -426,11 +787,14 @@ void flux_msg_handler_destroy (flux_msg_handler_t *mh)
             zhashx_delete (mh->d->handlers_rpc, &mh->match.matchtag);
         } else {
             zlist_remove (mh->d->handlers_new, mh);
-            zlist_remove (mh->d->handlers, mh);
+            if (mh->seq > 0) {
+                zlist_remove (mh->d->handlers, mh);
+                (void)foreach_slot (mh->d, mh, index_remove_slot);
+            }
         }
         flux_msg_handler_stop (mh);
         dispatch_usecount_decr (mh->d);
-        free_msg_handler (mh);
+        msg_handler_decref (mh);
         errno = saved_errno;
     }
 }
@@ -451,6 +815,7 @@ flux_msg_handler_t *flux_msg_handler_create (flux_t *h,
     if (!(mh = calloc (1, sizeof (*mh))))
         return NULL;
     mh->magic = HANDLER_MAGIC;
+    mh->refcount = 1;
     if (copy_match (&mh->match, match) < 0)
         goto error;
     mh->rolemask = FLUX_ROLE_OWNER;
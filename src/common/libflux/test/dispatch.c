@@ -254,6 +254,134 @@ void test_cloned_dispatch (flux_t *orig)
     diag ("destroyed reactor, closed clone");
 }
 
+/* Record the order in which handlers are called, by 'arg' string.
+ */
+char order[64];
+void order_cb (flux_t *h, flux_msg_handler_t *mh,
+               const flux_msg_t *msg, void *arg)
+{
+    strcat (order, arg);
+}
+
+flux_msg_handler_t *order_create (flux_t *h, int typemask, const char *glob,
+                                  const char *name)
+{
+    struct flux_match match = FLUX_MATCH_ANY;
+    flux_msg_handler_t *mh;
+
+    match.typemask = typemask;
+    match.topic_glob = (char *)glob;
+    if (!(mh = flux_msg_handler_create (h, match, order_cb, (void *)name)))
+        BAIL_OUT ("flux_msg_handler_create failed");
+    flux_msg_handler_start (mh);
+    return mh;
+}
+
+void send_and_run (flux_t *h, int type, const char *topic)
+{
+    flux_msg_t *msg;
+
+    if (!(msg = flux_msg_create (type))
+            || flux_msg_set_topic (msg, topic) < 0
+            || flux_send (h, msg, 0) < 0)
+        BAIL_OUT ("failed to send test message");
+    flux_msg_destroy (msg);
+    order[0] = '\0';
+    if (flux_reactor_run (flux_get_reactor (h), FLUX_REACTOR_NOWAIT) < 0)
+        BAIL_OUT ("flux_reactor_run failed");
+}
+
+/* Newest matching handler wins for requests, whether it matched by
+ * exact topic, prefix glob, or catch-all.
+ */
+void test_dispatch_order (flux_t *h)
+{
+    flux_msg_handler_t *any, *prefix, *exact, *prefix2;
+
+    any = order_create (h, FLUX_MSGTYPE_REQUEST, NULL, "a");
+    prefix = order_create (h, FLUX_MSGTYPE_REQUEST, "foo.*", "p");
+    exact = order_create (h, FLUX_MSGTYPE_REQUEST, "foo.bar", "e");
+
+    send_and_run (h, FLUX_MSGTYPE_REQUEST, "foo.bar");
+    is (order, "e",
+        "request matched newest (exact) handler");
+    send_and_run (h, FLUX_MSGTYPE_REQUEST, "foo.baz");
+    is (order, "p",
+        "request matched prefix handler");
+    send_and_run (h, FLUX_MSGTYPE_REQUEST, "bar");
+    is (order, "a",
+        "request matched catch-all handler");
+    send_and_run (h, FLUX_MSGTYPE_EVENT, "foo.bar");
+    is (order, "",
+        "request handlers did not match event");
+
+    flux_msg_handler_destroy (exact);
+    send_and_run (h, FLUX_MSGTYPE_REQUEST, "foo.bar");
+    is (order, "p",
+        "after exact handler was destroyed, request matched prefix handler");
+
+    prefix2 = order_create (h, FLUX_MSGTYPE_REQUEST, "foo.b*", "q");
+    send_and_run (h, FLUX_MSGTYPE_REQUEST, "foo.bar");
+    is (order, "q",
+        "request matched newer, longer prefix handler");
+    flux_msg_handler_stop (prefix2);
+    send_and_run (h, FLUX_MSGTYPE_REQUEST, "foo.bar");
+    is (order, "p",
+        "stopped handler was skipped");
+
+    flux_msg_handler_destroy (prefix2);
+    flux_msg_handler_destroy (prefix);
+    flux_msg_handler_destroy (any);
+}
+
+/* All matching handlers are called for events, newest first.
+ * A handler may destroy or create handlers during the traversal.
+ */
+flux_msg_handler_t *victim;
+flux_msg_handler_t *added;
+void destroy_cb (flux_t *h, flux_msg_handler_t *mh,
+                 const flux_msg_t *msg, void *arg)
+{
+    strcat (order, arg);
+    flux_msg_handler_destroy (victim);
+    victim = NULL;
+    if (!added)
+        added = order_create (h, FLUX_MSGTYPE_EVENT, "ev.x", "n");
+}
+
+void test_dispatch_event_order (flux_t *h)
+{
+    flux_msg_handler_t *prefix, *exact, *any, *destroyer;
+
+    prefix = order_create (h, FLUX_MSGTYPE_EVENT, "ev.*", "p");
+    exact = order_create (h, FLUX_MSGTYPE_EVENT, "ev.x", "e");
+    any = order_create (h, FLUX_MSGTYPE_EVENT, NULL, "a");
+
+    send_and_run (h, FLUX_MSGTYPE_EVENT, "ev.x");
+    is (order, "aep",
+        "event called all matching handlers, newest first");
+    send_and_run (h, FLUX_MSGTYPE_EVENT, "ev.y");
+    is (order, "ap",
+        "event called only matching handlers");
+
+    destroyer = flux_msg_handler_create (h, FLUX_MATCH_EVENT, destroy_cb, "d");
+    if (!destroyer)
+        BAIL_OUT ("flux_msg_handler_create failed");
+    flux_msg_handler_start (destroyer);
+    victim = exact;
+    send_and_run (h, FLUX_MSGTYPE_EVENT, "ev.x");
+    is (order, "dap",
+        "handler destroyed during event dispatch was not called");
+    send_and_run (h, FLUX_MSGTYPE_EVENT, "ev.x");
+    is (order, "ndap",
+        "handler created during event dispatch was called for next event");
+
+    flux_msg_handler_destroy (added);
+    flux_msg_handler_destroy (destroyer);
+    flux_msg_handler_destroy (any);
+    flux_msg_handler_destroy (prefix);
+}
+
 int main (int argc, char *argv[])
 {
     flux_t *h;
@@ -269,6 +397,8 @@ int main (int argc, char *argv[])
     test_simple_msg_handler (h);
     test_fastpath (h);
     test_cloned_dispatch (h);
+    test_dispatch_order (h);
+    test_dispatch_event_order (h);
 
     flux_close (h);
     done_testing();
@@ -95,6 +95,36 @@ int main (int argc, char *argv[])
         "flux_event_decode_raw len=NULL fails with EINVAL");
     flux_msg_destroy (msg);
 
+    /* batch */
+    flux_event_batch_t *batch;
+    ok ((batch = flux_event_batch_create ()) != NULL
+        && flux_event_batch_count (batch) == 0,
+        "flux_event_batch_create works");
+    ok (flux_event_batch_append (batch, "foo.bar", 0, data, len) == 0
+        && flux_event_batch_append (batch, "foo.baz", FLUX_MSGFLAG_PRIVATE,
+                                    NULL, 0) == 0,
+        "flux_event_batch_append works");
+    ok (flux_event_batch_count (batch) == 2,
+        "flux_event_batch_count returns 2");
+    errno = 0;
+    ok (flux_event_batch_append (batch, NULL, 0, data, len) < 0
+        && errno == EINVAL,
+        "flux_event_batch_append topic=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_event_batch_append (batch, "foo", 0x80, NULL, 0) < 0
+        && errno == EINVAL,
+        "flux_event_batch_append with invalid flags fails with EINVAL");
+    errno = 0;
+    ok (flux_event_batch_append (batch, "foo", 0, NULL, 1) < 0
+        && errno == EINVAL,
+        "flux_event_batch_append data=NULL len=1 fails with EINVAL");
+    ok (flux_event_batch_count (batch) == 2,
+        "failed appends did not change batch");
+    errno = 0;
+    ok (flux_event_batch_publish (NULL, batch) == NULL && errno == EINVAL,
+        "flux_event_batch_publish h=NULL fails with EINVAL");
+    flux_event_batch_destroy (batch);
+
     done_testing();
     return (0);
 }
@@ -523,6 +523,56 @@ void check_encode (void)
     flux_msg_destroy (msg2);
 }
 
+void check_encode_header (void)
+{
+    flux_msg_t *msg, *msg2;
+    void *buf;
+    size_t size;
+    uint32_t nodeid, matchtag, userid, rolemask;
+    int flags;
+    const char *topic, *s;
+
+    ok ((msg = flux_msg_create (FLUX_MSGTYPE_REQUEST)) != NULL
+            && flux_msg_enable_route (msg) == 0
+            && flux_msg_push_route (msg, "id1") == 0
+            && flux_msg_set_topic (msg, "a.b") == 0
+            && flux_msg_set_string (msg, "payload") == 0
+            && flux_msg_set_nodeid (msg, 7, FLUX_MSGFLAG_UPSTREAM) == 0
+            && flux_msg_set_matchtag (msg, 42) == 0
+            && flux_msg_set_userid (msg, 100) == 0
+            && flux_msg_set_rolemask (msg, FLUX_ROLE_USER) == 0,
+        "created request with route, topic, payload, and header fields");
+    size = flux_msg_encode_size (msg);
+    buf = malloc (size);
+    assert (buf != NULL);
+    ok (flux_msg_encode (msg, buf, size) == 0
+            && (msg2 = flux_msg_decode (buf, size)) != NULL,
+        "encoded and decoded message");
+    ok (flux_msg_get_nodeid (msg2, &nodeid, &flags) == 0
+            && nodeid == 7 && flags == FLUX_MSGFLAG_UPSTREAM
+            && flux_msg_get_matchtag (msg2, &matchtag) == 0 && matchtag == 42
+            && flux_msg_get_userid (msg2, &userid) == 0 && userid == 100
+            && flux_msg_get_rolemask (msg2, &rolemask) == 0
+            && rolemask == FLUX_ROLE_USER,
+        "decoded header fields match");
+    ok (flux_msg_get_route_count (msg2) == 1
+            && flux_msg_get_topic (msg2, &topic) == 0 && !strcmp (topic, "a.b")
+            && flux_msg_get_string (msg2, &s) == 0 && !strcmp (s, "payload")
+            && flux_msg_frames (msg2) == 5,
+        "decoded route, topic, and payload match");
+    flux_msg_destroy (msg2);
+
+    errno = 0;
+    ok (flux_msg_decode (buf, size - 1) == NULL && errno == EINVAL,
+        "flux_msg_decode fails on truncated message with EINVAL");
+    ((uint8_t *)buf)[size - 20] = 0; /* corrupt PROTO magic */
+    errno = 0;
+    ok (flux_msg_decode (buf, size) == NULL && errno == EPROTO,
+        "flux_msg_decode fails on bad PROTO frame with EPROTO");
+    free (buf);
+    flux_msg_destroy (msg);
+}
+
 /* Send a small message over a blocking pipe.
  * We assume that there's enough buffer to do this in one go.
  */
@@ -561,6 +611,7 @@ void check_sendzsock (void)
     zsock_t *zsock[2] = { NULL, NULL };
     flux_msg_t *msg, *msg2;
     const char *topic;
+    const char *s;
     int type;
     const char *uri = "inproc://test";
 
@@ -596,6 +647,82 @@ void check_sendzsock (void)
             && flux_msg_has_payload (msg2) == false,
         "try2: decoded message looks like what was sent");
     flux_msg_destroy (msg2);
+
+    /* Send with payload, destroying the sent message before receipt.
+     */
+    ok (flux_msg_set_string (msg, "hello world") == 0,
+        "try3: added payload");
+    ok (flux_msg_sendzsock (zsock[1], msg) == 0,
+        "try3: flux_msg_sendzsock works");
+    flux_msg_destroy (msg);
+    ok ((msg2 = flux_msg_recvzsock (zsock[0])) != NULL,
+        "try3: flux_msg_recvzsock works");
+    ok (flux_msg_get_type (msg2, &type) == 0 && type == FLUX_MSGTYPE_REQUEST
+            && flux_msg_get_topic (msg2, &topic) == 0
+            && !strcmp (topic, "foo.bar")
+            && flux_msg_get_string (msg2, &s) == 0
+            && s != NULL && !strcmp (s, "hello world")
+            && flux_msg_frames (msg2) == 3,
+        "try3: decoded message looks like what was sent");
+    flux_msg_destroy (msg2);
+
+    zsock_destroy (&zsock[0]);
+    zsock_destroy (&zsock[1]);
+}
+
+void check_sendzsock_route (void)
+{
+    zsock_t *zsock[2] = { NULL, NULL };
+    flux_msg_t *msg, *msg2;
+    const char *s;
+    char *id;
+    const char *uri = "inproc://test_route";
+
+    ok ((zsock[0] = zsock_new_pair (NULL)) != NULL
+                    && zsock_bind (zsock[0], "%s", uri) == 0
+                    && (zsock[1] = zsock_new_pair (uri)) != NULL,
+        "route: got inproc socket pair");
+    ok ((msg = flux_msg_create (FLUX_MSGTYPE_EVENT)) != NULL
+            && flux_msg_set_topic (msg, "foo.bar") == 0
+            && flux_msg_set_string (msg, "hello world") == 0,
+        "route: created test event");
+    errno = 0;
+    ok (flux_msg_sendzsock_route (zsock[1], msg, NULL) < 0 && errno == EINVAL,
+        "flux_msg_sendzsock_route id=NULL fails with EINVAL");
+
+    ok (flux_msg_sendzsock_route (zsock[1], msg, "child1") == 0,
+        "flux_msg_sendzsock_route works on message without route stack");
+    ok (flux_msg_get_route_count (msg) < 0,
+        "original message still has no route stack");
+    ok ((msg2 = flux_msg_recvzsock (zsock[0])) != NULL,
+        "route: flux_msg_recvzsock works");
+    id = NULL;
+    ok (flux_msg_get_route_count (msg2) == 1
+            && flux_msg_get_route_last (msg2, &id) == 0
+            && id != NULL && !strcmp (id, "child1"),
+        "received message has route stack with id");
+    free (id);
+    ok (flux_msg_get_string (msg2, &s) == 0
+            && s != NULL && !strcmp (s, "hello world"),
+        "received message has payload");
+    flux_msg_destroy (msg2);
+
+    ok (flux_msg_enable_route (msg) == 0
+            && flux_msg_push_route (msg, "parent") == 0,
+        "route: pushed route onto test event");
+    ok (flux_msg_sendzsock_route (zsock[1], msg, "child2") == 0,
+        "flux_msg_sendzsock_route works on message with route stack");
+    ok (flux_msg_get_route_count (msg) == 1,
+        "original message route stack is unchanged");
+    ok ((msg2 = flux_msg_recvzsock (zsock[0])) != NULL,
+        "route: flux_msg_recvzsock works");
+    id = NULL;
+    ok (flux_msg_get_route_count (msg2) == 2
+            && flux_msg_get_route_last (msg2, &id) == 0
+            && id != NULL && !strcmp (id, "child2"),
+        "received message has id pushed onto route stack");
+    free (id);
+    flux_msg_destroy (msg2);
     flux_msg_destroy (msg);
 
     zsock_destroy (&zsock[0]);
@@ -686,6 +813,47 @@ void check_copy (void)
     flux_msg_destroy (msg);
 }
 
+void check_copy_shared (void)
+{
+    flux_msg_t *msg, *cpy;
+    const char buf[] = "shared payload";
+    const char buf2[] = "new payload";
+    const void *msgbuf, *cpybuf;
+    int len;
+    uint64_t copied, shared, copied2, shared2;
+
+    ok ((msg = flux_msg_create (FLUX_MSGTYPE_EVENT)) != NULL
+            && flux_msg_set_payload (msg, buf, sizeof (buf)) == 0,
+        "created event with payload");
+    flux_msg_payload_stats (&copied, &shared);
+    ok ((cpy = flux_msg_copy (msg, true)) != NULL,
+        "flux_msg_copy works");
+    flux_msg_payload_stats (&copied2, &shared2);
+    ok (copied2 == copied && shared2 == shared + sizeof (buf),
+        "flux_msg_copy counted payload as shared, not copied");
+    ok (flux_msg_get_payload (msg, &msgbuf, NULL) == 0
+            && flux_msg_get_payload (cpy, &cpybuf, NULL) == 0
+            && msgbuf == cpybuf,
+        "copy shares payload buffer with original");
+    flux_msg_destroy (msg);
+    ok (flux_msg_get_payload (cpy, &cpybuf, &len) == 0
+            && len == sizeof (buf) && memcmp (cpybuf, buf, len) == 0,
+        "copy payload is intact after original is destroyed");
+
+    ok ((msg = flux_msg_copy (cpy, true)) != NULL,
+        "copied the copy");
+    ok (flux_msg_set_payload (cpy, buf2, sizeof (buf2)) == 0,
+        "replaced payload in copy");
+    ok (flux_msg_get_payload (msg, &msgbuf, &len) == 0
+            && len == sizeof (buf) && memcmp (msgbuf, buf, len) == 0,
+        "other message sharing old payload is unaffected");
+    ok (flux_msg_get_payload (cpy, &cpybuf, &len) == 0
+            && len == sizeof (buf2) && memcmp (cpybuf, buf2, len) == 0,
+        "copy has new payload");
+    flux_msg_destroy (cpy);
+    flux_msg_destroy (msg);
+}
+
 void check_print (void)
 {
     flux_msg_t *msg;
@@ -760,12 +928,15 @@ int main (int argc, char *argv[])
     check_security ();
     check_aux ();
     check_copy ();
+    check_copy_shared ();
 
     check_cmp ();
 
     check_encode ();
+    check_encode_header ();
     check_sendfd ();
     check_sendzsock ();
+    check_sendzsock_route ();
 
     check_params ();
 
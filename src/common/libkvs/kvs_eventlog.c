@@ -18,12 +18,17 @@
 #include "kvs_eventlog.h"
 
 
-/* eventlog is a list of RFC 18 events.
- * Once appended to the list, pointers to the events can be accessed by users
+/* eventlog is an array of RFC 18 events.
+ * Once appended to the array, pointers to the events can be accessed by users
  * with the guarantee that they remain valid until the eventlog is destroyed.
+ * 'len' is the length of the encoded eventlog, so that updates from a newer
+ * snapshot only need to parse the events past it.
  */
 struct flux_kvs_eventlog {
-    zlist_t *events; // zlist cursor reserved for internal use
+    char **events;
+    int count;
+    int size;
+    size_t len;
     int cursor;
 };
 
@@ -32,12 +37,10 @@ void flux_kvs_eventlog_destroy (struct flux_kvs_eventlog *eventlog)
 {
     if (eventlog) {
         int saved_errno = errno;
-        if (eventlog->events) {
-            char *s;
-            while ((s = zlist_pop (eventlog->events)))
-                free (s);
-            zlist_destroy (&eventlog->events);
-        }
+        int i;
+        for (i = 0; i < eventlog->count; i++)
+            free (eventlog->events[i]);
+        free (eventlog->events);
         free (eventlog);
         errno = saved_errno;
     }
@@ -49,53 +52,48 @@ struct flux_kvs_eventlog *flux_kvs_eventlog_create (void)
 
     if (!(eventlog = calloc (1, sizeof (*eventlog))))
         return NULL;
-    if (!(eventlog->events = zlist_new ())) {
-        errno = ENOMEM;
-        goto error;
-    }
     return eventlog;
-error:
-    flux_kvs_eventlog_destroy (eventlog);
-    return NULL;
 }
 
-/* Determine the buffer size (including terminating \0) needed
- * to encode 'eventlog'.
+/* Append 'event' (of length 'len') to eventlog, taking ownership of it.
  */
-static size_t eventlog_encode_size (const struct flux_kvs_eventlog *eventlog)
+static int eventlog_push (struct flux_kvs_eventlog *eventlog, char *event,
+                          size_t len)
 {
-    char *event;
-    size_t size = 0;
-
-    event = zlist_first (eventlog->events);
-    while ((event)) {
-        size += strlen (event);
-        event = zlist_next (eventlog->events);
+    if (eventlog->count == eventlog->size) {
+        int new_size = eventlog->size ? eventlog->size * 2 : 16;
+        char **new_events;
+
+        if (!(new_events = realloc (eventlog->events,
+                                    new_size * sizeof (new_events[0])))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        eventlog->events = new_events;
+        eventlog->size = new_size;
     }
-    return size + 1; // plus \0 terminator
+    eventlog->events[eventlog->count++] = event;
+    eventlog->len += len;
+    return 0;
 }
 
 char *flux_kvs_eventlog_encode (const struct flux_kvs_eventlog *eventlog)
 {
     char *cpy;
-    char *event;
-    size_t size;
     size_t used = 0;
+    int i;
 
     if (!eventlog) {
         errno = EINVAL;
         return NULL;
     }
-    size = eventlog_encode_size (eventlog);
-    if (!(cpy = calloc (1, size)))
+    if (!(cpy = calloc (1, eventlog->len + 1)))
         return NULL;
-    event = zlist_first (eventlog->events);
-    while (event) {
-        int n;
-        n = snprintf (cpy + used, size - used, "%s", event);
-        assert (n < size - used);
+    for (i = 0; i < eventlog->count; i++) {
+        size_t n = strlen (eventlog->events[i]);
+        assert (used + n <= eventlog->len);
+        memcpy (cpy + used, eventlog->events[i], n);
         used += n;
-        event = zlist_next (eventlog->events);
     }
     return cpy;
 }
@@ -133,35 +131,25 @@ static bool event_validate (const char *tok, size_t toklen)
     return true;
 }
 
-int flux_kvs_eventlog_update (struct flux_kvs_eventlog *eventlog,
-                              const char *s)
+int flux_kvs_eventlog_append_encoded (struct flux_kvs_eventlog *eventlog,
+                                      const char *s)
 {
     const char *input;
     const char *tok;
     size_t toklen;
-    char *event;
 
     if (!eventlog || !s)
         goto error_inval;
     input = s;
-    event = zlist_first (eventlog->events);
     while (eventlog_parse_next (&input, &tok, &toklen)) {
-        if (event) {
-            if (toklen != strlen (event) || strncmp (event, tok, toklen) != 0)
-                goto error_inval;
-            event = zlist_next (eventlog->events);
-        }
-        else {
-            char *cpy;
-            if (!event_validate (tok, toklen))
-                goto error_inval;
-            if (!(cpy = strndup (tok, toklen)))
-                goto error;
-            if (zlist_append (eventlog->events, cpy) < 0) {
-                free (cpy);
-                errno = ENOMEM;
-                goto error;
-            }
+        char *cpy;
+        if (!event_validate (tok, toklen))
+            goto error_inval;
+        if (!(cpy = strndup (tok, toklen)))
+            goto error;
+        if (eventlog_push (eventlog, cpy, toklen) < 0) {
+            free (cpy);
+            goto error;
         }
     }
     if (*input != '\0')
@@ -173,6 +161,29 @@ error:
     return -1;
 }
 
+int flux_kvs_eventlog_update (struct flux_kvs_eventlog *eventlog,
+                              const char *s)
+{
+    if (!eventlog || !s)
+        goto error_inval;
+    /* The snapshot must extend the log.  Since eventlogs are append-only,
+     * check only that the last event already in the log is found at the
+     * same position in the snapshot, then parse the new events after it.
+     */
+    if (eventlog->count > 0) {
+        const char *last = eventlog->events[eventlog->count - 1];
+        size_t lastlen = strlen (last);
+
+        if (strnlen (s, eventlog->len) < eventlog->len
+            || strncmp (s + eventlog->len - lastlen, last, lastlen) != 0)
+            goto error_inval;
+    }
+    return flux_kvs_eventlog_append_encoded (eventlog, s + eventlog->len);
+error_inval:
+    errno = EINVAL;
+    return -1;
+}
+
 struct flux_kvs_eventlog *flux_kvs_eventlog_decode (const char *s)
 {
     struct flux_kvs_eventlog *eventlog;
@@ -186,29 +197,11 @@ struct flux_kvs_eventlog *flux_kvs_eventlog_decode (const char *s)
     return eventlog;
 }
 
-/* Return the nth (zero-origin) element of 'l', or NULL if it doesn't exist.
- */
-static void *get_zlist_nth (zlist_t *l, int n)
-{
-    void *item;
-    int count = 0;
-    if (!l)
-        return NULL;
-    item = zlist_first (l);
-    while (item && count++ < n)
-        item = zlist_next (l);
-    return item;
-}
-
 const char *flux_kvs_eventlog_next (struct flux_kvs_eventlog *eventlog)
 {
-    char *event;
-
-    if (!eventlog)
+    if (!eventlog || eventlog->cursor >= eventlog->count)
         return NULL;
-    if ((event = get_zlist_nth (eventlog->events, eventlog->cursor)))
-        eventlog->cursor++;
-    return event;
+    return eventlog->events[eventlog->cursor++];
 }
 
 const char *flux_kvs_eventlog_first (struct flux_kvs_eventlog *eventlog)
@@ -219,18 +212,28 @@ const char *flux_kvs_eventlog_first (struct flux_kvs_eventlog *eventlog)
     return flux_kvs_eventlog_next (eventlog);
 }
 
+int flux_kvs_eventlog_count (const struct flux_kvs_eventlog *eventlog)
+{
+    if (!eventlog) {
+        errno = EINVAL;
+        return -1;
+    }
+    return eventlog->count;
+}
+
 int flux_kvs_eventlog_append (struct flux_kvs_eventlog *eventlog,
                               const char *s)
 {
     char *cpy;
+    size_t len;
 
-    if (!eventlog || !s || !event_validate (s, strlen (s))) {
+    if (!eventlog || !s || !event_validate (s, (len = strlen (s)))) {
         errno = EINVAL;
         return -1;
     }
     if (!(cpy = strdup (s)))
         goto error_nomem;
-    if (zlist_append (eventlog->events, cpy) < 0)
+    if (eventlog_push (eventlog, cpy, len) < 0)
         goto error_nomem;
     return 0;
 error_nomem:
@@ -36,6 +36,9 @@ char *flux_kvs_eventlog_encode (const struct flux_kvs_eventlog *eventlog);
 struct flux_kvs_eventlog *flux_kvs_eventlog_decode (const char *s);
 
 /* Update an eventlog with new encoded snapshot 's'.
+ * 's' must extend the events already in the eventlog.  Only the events
+ * past them are parsed, so repeatedly updating a growing eventlog costs
+ * time proportional to the new events, not to the whole log.
  */
 int flux_kvs_eventlog_update (struct flux_kvs_eventlog *eventlog,
                               const char *s);
@@ -45,6 +48,17 @@ int flux_kvs_eventlog_update (struct flux_kvs_eventlog *eventlog,
 int flux_kvs_eventlog_append (struct flux_kvs_eventlog *eventlog,
                               const char *s);
 
+/* Append zero or more encoded events to eventlog, e.g. the new tail
+ * of an eventlog.  If any event is invalid, returns -1 with errno = EINVAL,
+ * and events preceding it remain appended.
+ */
+int flux_kvs_eventlog_append_encoded (struct flux_kvs_eventlog *eventlog,
+                                      const char *s);
+
+/* Return the number of events in eventlog.
+ */
+int flux_kvs_eventlog_count (const struct flux_kvs_eventlog *eventlog);
+
 /* Iterator for events.
  */
 const char *flux_kvs_eventlog_first (struct flux_kvs_eventlog *eventlog);
@@ -40,7 +40,8 @@ struct lookup_ctx {
 static const char *auxkey = "flux::lookup_ctx";
 
 #define FLUX_KVS_WATCH_FLAGS (FLUX_KVS_WATCH_FULL \
-                              | FLUX_KVS_WATCH_UNIQ)
+                              | FLUX_KVS_WATCH_UNIQ \
+                              | FLUX_KVS_WATCH_APPEND)
 
 static void free_ctx (struct lookup_ctx *ctx)
 {
@@ -80,6 +81,13 @@ static int validate_lookup_flags (int flags, bool watch_ok)
     if ((flags & FLUX_KVS_WATCH_FLAGS)
         && !(flags & FLUX_KVS_WATCH))
         return -1;
+    /* FLUX_KVS_WATCH_APPEND responses are values appended to the key,
+     * so comparing values or requesting other objects makes no sense.
+     */
+    if ((flags & FLUX_KVS_WATCH_APPEND)
+        && (flags & ~(FLUX_KVS_WATCH | FLUX_KVS_WATCH_APPEND
+                      | FLUX_KVS_WAITCREATE)))
+        return -1;
     /* FLUX_KVS_WAITCREATE does not require FLUX_KVS_WATCH to be set,
      * but it requires that we be able to communicate with the
      * kvs-watch module, so we use the watch_ok bool here.
@@ -149,6 +149,84 @@ void basic (void)
     flux_kvs_eventlog_destroy (log);
 }
 
+void incremental (void)
+{
+    struct flux_kvs_eventlog *log;
+    char buf[64];
+    char *snapshot;
+    size_t len = 0;
+    bool valid = true;
+    int i;
+    char *s;
+
+    if (!(log = flux_kvs_eventlog_create ()))
+        BAIL_OUT ("flux_kvs_eventlog_create failed");
+    ok (flux_kvs_eventlog_count (log) == 0,
+        "flux_kvs_eventlog_count returns 0 on new log");
+
+    /* grow a snapshot one event at a time, as a watcher would see it */
+    if (!(snapshot = calloc (1, 1000 * sizeof (buf))))
+        BAIL_OUT ("calloc failed");
+    for (i = 0; i < 1000; i++) {
+        len += snprintf (snapshot + len, sizeof (buf), "%d.0 e%d\n", i + 1, i);
+        if (flux_kvs_eventlog_update (log, snapshot) < 0
+            || flux_kvs_eventlog_count (log) != i + 1)
+            valid = false;
+    }
+    ok (valid,
+        "flux_kvs_eventlog_update works on 1000 growing snapshots");
+    s = flux_kvs_eventlog_encode (log);
+    ok (s != NULL && !strcmp (s, snapshot),
+        "flux_kvs_eventlog_encode output = last snapshot");
+    free (s);
+
+    basic_check (log, true, false, 1., "e0", "");
+    for (i = 1; i < 999; i++)
+        (void)flux_kvs_eventlog_next (log);
+    basic_check (log, false, false, 1000., "e999", "");
+    basic_check (log, false, true, 0, NULL, NULL);
+
+    /* snapshots that do not extend the log */
+    errno = 0;
+    ok (flux_kvs_eventlog_update (log, "1.0 e0\n") < 0 && errno == EINVAL,
+        "flux_kvs_eventlog_update on shorter snapshot fails with EINVAL");
+    snapshot[len - 2] = 'x';
+    errno = 0;
+    ok (flux_kvs_eventlog_update (log, snapshot) < 0 && errno == EINVAL,
+        "flux_kvs_eventlog_update on changed last event fails with EINVAL");
+    ok (flux_kvs_eventlog_count (log) == 1000,
+        "flux_kvs_eventlog_count is unchanged");
+    free (snapshot);
+
+    /* append a tail */
+    ok (flux_kvs_eventlog_append_encoded (log, "") == 0
+        && flux_kvs_eventlog_count (log) == 1000,
+        "flux_kvs_eventlog_append_encoded s=\"\" appends nothing");
+    ok (flux_kvs_eventlog_append_encoded (log, "1001 a\n1002 b ctx\n") == 0
+        && flux_kvs_eventlog_count (log) == 1002,
+        "flux_kvs_eventlog_append_encoded appends 2 events");
+    basic_check (log, false, false, 1001., "a", "");
+    basic_check (log, false, false, 1002., "b", "ctx");
+    basic_check (log, false, true, 0, NULL, NULL);
+
+    errno = 0;
+    ok (flux_kvs_eventlog_append_encoded (log, "1003 c\n1004") < 0
+        && errno == EINVAL,
+        "flux_kvs_eventlog_append_encoded with partial event fails with EINVAL");
+    errno = 0;
+    ok (flux_kvs_eventlog_append_encoded (NULL, "1 a\n") < 0
+        && errno == EINVAL,
+        "flux_kvs_eventlog_append_encoded log=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_kvs_eventlog_append_encoded (log, NULL) < 0 && errno == EINVAL,
+        "flux_kvs_eventlog_append_encoded s=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_kvs_eventlog_count (NULL) < 0 && errno == EINVAL,
+        "flux_kvs_eventlog_count log=NULL fails with EINVAL");
+
+    flux_kvs_eventlog_destroy (log);
+}
+
 void bad_input (void)
 {
     struct flux_kvs_eventlog *log;
@@ -282,6 +360,7 @@ int main (int argc, char *argv[])
     plan (NO_PLAN);
 
     basic ();
+    incremental ();
     bad_input ();
     event ();
 
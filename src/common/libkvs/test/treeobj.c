@@ -99,6 +99,101 @@ const char *blobrefs[] = {
     "sha1-da39a3ee5e6b4b0d3255bfef95601890afd80709",
 };
 
+void test_codec_binary (void)
+{
+    json_t *dir = create_large_dir ();
+    json_t *subdir, *o, *cpy;
+    const char bin[] = { 'a', '\0', 'b', (char)0xff, (char)0xfe };
+    void *data;
+    int datalen;
+    char *json_str;
+    void *buf;
+    size_t len;
+
+    if (!dir)
+        BAIL_OUT ("could not create %d-entry dir", large_dir_entries);
+    if (!(subdir = treeobj_create_dir ()))
+        BAIL_OUT ("treeobj_create_dir failed");
+    if (!(o = treeobj_create_val (bin, sizeof (bin)))
+            || treeobj_insert_entry (subdir, "binval", o) < 0)
+        BAIL_OUT ("could not insert binval");
+    json_decref (o);
+    if (!(o = treeobj_create_val (NULL, 0))
+            || treeobj_insert_entry (subdir, "emptyval", o) < 0)
+        BAIL_OUT ("could not insert emptyval");
+    json_decref (o);
+    if (!(o = treeobj_create_valref (blobrefs[0]))
+            || treeobj_append_blobref (o, blobrefs[1]) < 0
+            || treeobj_insert_entry (subdir, "valref", o) < 0)
+        BAIL_OUT ("could not insert valref");
+    json_decref (o);
+    if (!(o = treeobj_create_dirref (blobrefs[2]))
+            || treeobj_insert_entry (subdir, "dirref", o) < 0)
+        BAIL_OUT ("could not insert dirref");
+    json_decref (o);
+    if (treeobj_insert_entry (dir, "subdir", subdir) < 0)
+        BAIL_OUT ("could not insert subdir");
+    json_decref (subdir);
+
+    ok ((json_str = treeobj_encodeb (dir, TREEOBJ_FORMAT_JSON, &len)) != NULL
+        && len == strlen (json_str),
+        "treeobj_encodeb TREEOBJ_FORMAT_JSON works");
+    ok (!treeobj_is_binary (json_str, len),
+        "treeobj_is_binary returns false for JSON encoding");
+    ok ((buf = treeobj_encodeb (dir, TREEOBJ_FORMAT_BINARY, &len)) != NULL,
+        "treeobj_encodeb TREEOBJ_FORMAT_BINARY works");
+    ok (treeobj_is_binary (buf, len),
+        "treeobj_is_binary returns true for binary encoding");
+    ok (len < strlen (json_str),
+        "binary encoding is smaller than JSON (%zu < %zu)",
+        len, strlen (json_str));
+    ok ((cpy = treeobj_decodeb (buf, len)) != NULL,
+        "treeobj_decodeb decodes binary encoding");
+    ok (cpy != NULL && json_equal (cpy, dir) == 1,
+        "decoded object is identical to original");
+    ok (cpy != NULL
+        && (o = treeobj_get_entry (treeobj_get_entry (cpy, "subdir"),
+                                   "binval")) != NULL
+        && treeobj_decode_val (o, &data, &datalen) == 0
+        && datalen == sizeof (bin) && memcmp (data, bin, datalen) == 0,
+        "val with embedded NUL survived round trip");
+    free (data);
+    json_decref (cpy);
+
+    errno = 0;
+    ok (treeobj_decodeb (buf, len - 1) == NULL && errno == EPROTO,
+        "treeobj_decodeb fails with EPROTO on truncated binary encoding");
+    ((char *)buf)[2] = 99;
+    errno = 0;
+    ok (treeobj_decodeb (buf, len) == NULL && errno == EPROTO,
+        "treeobj_decodeb fails with EPROTO on unknown binary version");
+    free (buf);
+
+    if (!(o = treeobj_create_symlink ("a.b.c")))
+        BAIL_OUT ("treeobj_create_symlink failed");
+    ok ((buf = treeobj_encodeb (o, TREEOBJ_FORMAT_BINARY, &len)) != NULL,
+        "encoded symlink");
+    if (!(buf = realloc (buf, len + 1)))
+        BAIL_OUT ("realloc failed");
+    ((char *)buf)[len] = 0;
+    errno = 0;
+    ok (treeobj_decodeb (buf, len + 1) == NULL && errno == EPROTO,
+        "treeobj_decodeb fails with EPROTO on trailing garbage");
+    free (buf);
+
+    errno = 0;
+    ok (treeobj_encodeb (o, 42, &len) == NULL && errno == EINVAL,
+        "treeobj_encodeb fails with EINVAL on unknown format");
+    errno = 0;
+    ok (treeobj_encodeb (NULL, TREEOBJ_FORMAT_BINARY, &len) == NULL
+        && errno == EINVAL,
+        "treeobj_encodeb fails with EINVAL on NULL object");
+    json_decref (o);
+
+    free (json_str);
+    json_decref (dir);
+}
+
 void test_valref (void)
 {
     json_t *valref;
@@ -367,6 +462,111 @@ void test_dir (void)
     json_decref (dir);
 }
 
+void test_hdir (void)
+{
+    json_t *hdir, *child, *dir, *val, *o, *cpy;
+    int index, level;
+    bool inrange = true;
+    void *buf;
+    size_t len;
+
+    ok ((hdir = treeobj_create_hdir ()) != NULL,
+        "treeobj_create_hdir works");
+    ok (treeobj_validate (hdir) == 0,
+        "treeobj_validate likes empty hdir");
+    ok (treeobj_is_hdir (hdir) && !treeobj_is_dir (hdir),
+        "treeobj_is_hdir returns true, treeobj_is_dir returns false");
+    ok (treeobj_get_count (hdir) == 0,
+        "treeobj_get_count returns 0");
+
+    for (level = 0; level < TREEOBJ_HDIR_MAXLEVEL; level++) {
+        index = treeobj_hdir_slot ("foo", level);
+        if (index < 0 || index >= TREEOBJ_HDIR_FANOUT)
+            inrange = false;
+    }
+    ok (inrange,
+        "treeobj_hdir_slot returns a valid slot at every level");
+    ok (treeobj_hdir_slot ("foo", 2) == treeobj_hdir_slot ("foo", 2),
+        "treeobj_hdir_slot is deterministic");
+    errno = 0;
+    ok (treeobj_hdir_slot ("foo", TREEOBJ_HDIR_MAXLEVEL) < 0 && errno == EINVAL,
+        "treeobj_hdir_slot fails with EINVAL on level too deep");
+
+    if (!(dir = treeobj_create_dir ())
+        || !(val = treeobj_create_val ("foo", 4))
+        || treeobj_insert_entry (dir, "foo", val) < 0)
+        BAIL_OUT ("can't continue without test values");
+    index = treeobj_hdir_slot ("foo", 0);
+    ok (treeobj_insert_slot (hdir, index, dir) == 0
+            && treeobj_get_count (hdir) == 1
+            && treeobj_get_slot (hdir, index) == dir
+            && treeobj_peek_slot (hdir, index) == dir,
+        "treeobj_insert_slot works");
+    ok (treeobj_validate (hdir) == 0,
+        "treeobj_validate likes populated hdir");
+    errno = 0;
+    ok (treeobj_insert_slot (hdir, (index + 1) % TREEOBJ_HDIR_FANOUT, val) < 0
+            && errno == EINVAL,
+        "treeobj_insert_slot fails with EINVAL on val");
+    errno = 0;
+    ok (treeobj_insert_slot (hdir, TREEOBJ_HDIR_FANOUT, dir) < 0
+            && errno == EINVAL,
+        "treeobj_insert_slot fails with EINVAL on bad slot");
+    errno = 0;
+    ok (treeobj_get_slot (hdir, (index + 1) % TREEOBJ_HDIR_FANOUT) == NULL
+            && errno == ENOENT,
+        "treeobj_get_slot fails with ENOENT on empty slot");
+    errno = 0;
+    ok (treeobj_insert_slot (dir, 0, dir) < 0 && errno == EINVAL,
+        "treeobj_insert_slot fails with EINVAL on non-hdir treeobj");
+    errno = 0;
+    ok (treeobj_get_entry (hdir, "foo") == NULL && errno == EINVAL,
+        "treeobj_get_entry fails with EINVAL on hdir");
+
+    ok ((cpy = treeobj_copy (hdir)) != NULL
+            && treeobj_is_hdir (cpy)
+            && treeobj_get_slot (cpy, index) == dir,
+        "treeobj_copy of hdir shares slot contents");
+    json_decref (cpy);
+
+    ok ((buf = treeobj_encodeb (hdir, TREEOBJ_FORMAT_BINARY, &len)) != NULL,
+        "treeobj_encodeb binary works on hdir");
+    ok ((o = treeobj_decodeb (buf, len)) != NULL && json_equal (o, hdir),
+        "treeobj_decodeb of binary hdir round trips");
+    json_decref (o);
+    free (buf);
+
+    o = json_pack ("{s:i s:s s:{s:O}}", "ver", 1, "type", "hdir",
+                   "data", "x", dir);
+    ok (o != NULL && treeobj_validate (o) < 0,
+        "treeobj_validate rejects hdir with bad slot name");
+    json_decref (o);
+    o = json_pack ("{s:i s:s s:{s:O}}", "ver", 1, "type", "hdir",
+                   "data", "0", val);
+    ok (o != NULL && treeobj_validate (o) < 0,
+        "treeobj_validate rejects hdir with val in slot");
+    json_decref (o);
+
+    ok (treeobj_delete_slot (hdir, index) == 0
+            && treeobj_get_count (hdir) == 0,
+        "treeobj_delete_slot works");
+    errno = 0;
+    ok (treeobj_delete_slot (hdir, index) < 0 && errno == ENOENT,
+        "treeobj_delete_slot fails with ENOENT on empty slot");
+
+    ok ((child = treeobj_create_dirref (NULL)) != NULL
+            && treeobj_append_blobref (child,
+                    "sha1-508259c0f7fd50e47716b50ad1f0fc6ed46017f9") == 0
+            && treeobj_insert_slot (hdir, 0, child) == 0
+            && treeobj_validate (hdir) == 0,
+        "hdir with dirref in slot is valid");
+    json_decref (child);
+
+    json_decref (val);
+    json_decref (dir);
+    json_decref (hdir);
+}
+
 void test_dir_peek (void)
 {
     json_t *dir;
@@ -761,12 +961,14 @@ int main(int argc, char** argv)
     test_dirref ();
     test_dir ();
     test_dir_peek ();
+    test_hdir ();
     test_copy ();
     test_deep_copy ();
     test_symlink ();
     test_corner_cases ();
 
     test_codec ();
+    test_codec_binary ();
 
     done_testing();
 }
@@ -15,6 +15,8 @@
 #endif
 #include <errno.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #include <assert.h>
 #include <sodium.h>
 
@@ -24,6 +26,24 @@
 
 static const int treeobj_version = 1;
 
+/* hdir slots are named by a single lowercase hex digit.
+ */
+static const char *hdir_slot_names[TREEOBJ_HDIR_FANOUT] = {
+    "0", "1", "2", "3", "4", "5", "6", "7",
+    "8", "9", "a", "b", "c", "d", "e", "f",
+};
+
+static int hdir_slot_index (const char *name)
+{
+    if (name[0] != '\0' && name[1] == '\0') {
+        if (name[0] >= '0' && name[0] <= '9')
+            return name[0] - '0';
+        if (name[0] >= 'a' && name[0] <= 'f')
+            return name[0] - 'a' + 10;
+    }
+    return -1;
+}
+
 static int treeobj_unpack (json_t *obj, const char **typep, json_t **datap)
 {
     json_t *data;
@@ -101,6 +121,19 @@ int treeobj_validate (const json_t *obj)
                 goto inval;
         }
     }
+    else if (!strcmp (type, "hdir")) {
+        const char *key;
+        if (!json_is_object (data))
+            goto inval;
+        json_object_foreach ((json_t *)data, key, o) {
+            if (hdir_slot_index (key) < 0
+                || !(treeobj_is_dir (o)
+                     || treeobj_is_dirref (o)
+                     || treeobj_is_hdir (o))
+                || treeobj_validate (o) < 0)
+                goto inval;
+        }
+    }
     else if (!strcmp (type, "symlink")) {
         if (!json_is_string (data))
             goto inval;
@@ -156,6 +189,12 @@ bool treeobj_is_dirref (const json_t *obj)
     return type && !strcmp (type, "dirref");
 }
 
+bool treeobj_is_hdir (const json_t *obj)
+{
+    const char *type = treeobj_get_type (obj);
+    return type && !strcmp (type, "hdir");
+}
+
 json_t *treeobj_get_data (json_t *obj)
 {
     json_t *data;
@@ -233,7 +272,7 @@ int treeobj_get_count (const json_t *obj)
     if (!strcmp (type, "valref") || !strcmp (type, "dirref")) {
         count = json_array_size (data);
     }
-    else if (!strcmp (type, "dir")) {
+    else if (!strcmp (type, "dir") || !strcmp (type, "hdir")) {
         count = json_object_size (data);
     }
     else if (!strcmp (type, "symlink") || !strcmp (type, "val")) {
@@ -315,6 +354,98 @@ const json_t *treeobj_peek_entry (const json_t *obj, const char *name)
     return obj2;
 }
 
+/* 32-bit FNV-1a hash of the entry name.
+ */
+int treeobj_hdir_slot (const char *name, int level)
+{
+    uint32_t hash = 2166136261U;
+
+    if (!name || level < 0 || level >= TREEOBJ_HDIR_MAXLEVEL) {
+        errno = EINVAL;
+        return -1;
+    }
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619U;
+    }
+    return (hash >> (level * 4)) & (TREEOBJ_HDIR_FANOUT - 1);
+}
+
+json_t *treeobj_get_slot (json_t *obj, int index)
+{
+    const char *type;
+    json_t *data, *obj2;
+
+    if (treeobj_unpack (obj, &type, &data) < 0
+            || strcmp (type, "hdir") != 0
+            || index < 0 || index >= TREEOBJ_HDIR_FANOUT) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(obj2 = json_object_get (data, hdir_slot_names[index]))) {
+        errno = ENOENT;
+        return NULL;
+    }
+    return obj2;
+}
+
+const json_t *treeobj_peek_slot (const json_t *obj, int index)
+{
+    const char *type;
+    const json_t *data, *obj2;
+
+    if (treeobj_peek (obj, &type, &data) < 0
+            || strcmp (type, "hdir") != 0
+            || index < 0 || index >= TREEOBJ_HDIR_FANOUT) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(obj2 = json_object_get (data, hdir_slot_names[index]))) {
+        errno = ENOENT;
+        return NULL;
+    }
+    return obj2;
+}
+
+int treeobj_insert_slot (json_t *obj, int index, json_t *obj2)
+{
+    const char *type;
+    json_t *data;
+
+    if (!obj2 || treeobj_unpack (obj, &type, &data) < 0
+            || strcmp (type, "hdir") != 0
+            || index < 0 || index >= TREEOBJ_HDIR_FANOUT
+            || !(treeobj_is_dir (obj2)
+                 || treeobj_is_dirref (obj2)
+                 || treeobj_is_hdir (obj2))) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (json_object_set (data, hdir_slot_names[index], obj2) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+int treeobj_delete_slot (json_t *obj, int index)
+{
+    const char *type;
+    json_t *data;
+
+    if (treeobj_unpack (obj, &type, &data) < 0
+            || strcmp (type, "hdir") != 0
+            || index < 0 || index >= TREEOBJ_HDIR_FANOUT) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (json_object_del (data, hdir_slot_names[index]) < 0) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
 json_t *treeobj_copy (json_t *obj)
 {
     json_t *data;
@@ -327,10 +458,14 @@ json_t *treeobj_copy (json_t *obj)
         return NULL;
     }
     /* shallow copy of treeobj data and deep copy of treeobj is
-     * identical except for dir object.
+     * identical except for dir and hdir objects.
      */
-    if (treeobj_is_dir (obj)) {
-        if (!(cpy = treeobj_create_dir ()))
+    if (treeobj_is_dir (obj) || treeobj_is_hdir (obj)) {
+        if (treeobj_is_dir (obj))
+            cpy = treeobj_create_dir ();
+        else
+            cpy = treeobj_create_hdir ();
+        if (!cpy)
             return NULL;
 
         if (!(datacpy = json_copy (data))) {
@@ -420,6 +555,19 @@ json_t *treeobj_create_dir (void)
     return obj;
 }
 
+json_t *treeobj_create_hdir (void)
+{
+    json_t *obj;
+
+    if (!(obj = json_pack ("{s:i s:s s:{}}", "ver", treeobj_version,
+                                            "type", "hdir",
+                                            "data"))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return obj;
+}
+
 json_t *treeobj_create_symlink (const char *target)
 {
     json_t *obj;
@@ -539,9 +687,350 @@ json_t *treeobj_decode (const char *buf)
     return treeobj_decodeb (buf, strlen (buf));
 }
 
+/* Binary encoding:
+ *
+ * A three byte header (0xfe, 'T', version) followed by one encoded
+ * object.  An object is a type byte, then:
+ *   val:            length, raw data
+ *   symlink:        length, target
+ *   valref, dirref: count, then count x (length, blobref)
+ *   dir, hdir:      count, then count x (length, name, object),
+ *                   sorted by name
+ * Lengths and counts are unsigned LEB128 varints.  JSON text cannot begin
+ * with 0xfe, so treeobj_decodeb() tells the formats apart by first byte.
+ */
+#define BINARY_MAGIC0       0xfe
+#define BINARY_MAGIC1       'T'
+#define BINARY_VERSION      1
+#define BINARY_MAXDEPTH     2048    // same as jansson's parser limit
+
+enum {
+    BINARY_VAL = 1,
+    BINARY_VALREF = 2,
+    BINARY_DIR = 3,
+    BINARY_DIRREF = 4,
+    BINARY_SYMLINK = 5,
+    BINARY_HDIR = 6,
+};
+
+struct bbuf {
+    uint8_t *data;
+    size_t len;
+    size_t size;
+};
+
+static int bbuf_reserve (struct bbuf *b, size_t n)
+{
+    if (b->len + n > b->size) {
+        size_t size = b->size ? b->size : 256;
+        uint8_t *data;
+
+        while (size < b->len + n)
+            size *= 2;
+        if (!(data = realloc (b->data, size)))
+            return -1;
+        b->data = data;
+        b->size = size;
+    }
+    return 0;
+}
+
+static int bbuf_put (struct bbuf *b, const void *data, size_t n)
+{
+    if (bbuf_reserve (b, n) < 0)
+        return -1;
+    if (n > 0)
+        memcpy (b->data + b->len, data, n);
+    b->len += n;
+    return 0;
+}
+
+static int bbuf_put_varint (struct bbuf *b, size_t val)
+{
+    uint8_t tmp[10];
+    int n = 0;
+
+    do {
+        tmp[n] = val & 0x7f;
+        val >>= 7;
+        if (val)
+            tmp[n] |= 0x80;
+        n++;
+    } while (val);
+    return bbuf_put (b, tmp, n);
+}
+
+static int bbuf_put_string (struct bbuf *b, const char *s, size_t len)
+{
+    if (bbuf_put_varint (b, len) < 0 || bbuf_put (b, s, len) < 0)
+        return -1;
+    return 0;
+}
+
+static int keycmp (const void *a, const void *b)
+{
+    return strcmp (*(const char **)a, *(const char **)b);
+}
+
+static int encode_binary_obj (struct bbuf *b, const json_t *obj)
+{
+    const char *type;
+    const json_t *data;
+    uint8_t t;
+
+    if (treeobj_peek (obj, &type, &data) < 0)
+        return -1;
+    if (!strcmp (type, "val")) {
+        void *val;
+        int len, rc;
+
+        if (treeobj_decode_val (obj, &val, &len) < 0)
+            return -1;
+        t = BINARY_VAL;
+        rc = bbuf_put (b, &t, 1);
+        if (rc == 0)
+            rc = bbuf_put_string (b, val, len);
+        free (val);
+        return rc;
+    }
+    else if (!strcmp (type, "symlink")) {
+        const char *target = json_string_value (data);
+
+        t = BINARY_SYMLINK;
+        if (!target || bbuf_put (b, &t, 1) < 0
+                    || bbuf_put_string (b, target, strlen (target)) < 0)
+            return -1;
+    }
+    else if (!strcmp (type, "valref") || !strcmp (type, "dirref")) {
+        const json_t *o;
+        size_t index;
+
+        t = !strcmp (type, "valref") ? BINARY_VALREF : BINARY_DIRREF;
+        if (bbuf_put (b, &t, 1) < 0
+                || bbuf_put_varint (b, json_array_size (data)) < 0)
+            return -1;
+        json_array_foreach (data, index, o) {
+            const char *ref = json_string_value (o);
+            if (!ref || bbuf_put_string (b, ref, strlen (ref)) < 0)
+                return -1;
+        }
+    }
+    else if (!strcmp (type, "dir") || !strcmp (type, "hdir")) {
+        size_t count = json_object_size (data);
+        const char **keys;
+        const char *key;
+        const json_t *o;
+        size_t i = 0;
+        int rc = -1;
+
+        t = !strcmp (type, "dir") ? BINARY_DIR : BINARY_HDIR;
+        if (bbuf_put (b, &t, 1) < 0 || bbuf_put_varint (b, count) < 0)
+            return -1;
+        if (count == 0)
+            return 0;
+        if (!(keys = malloc (count * sizeof (keys[0]))))
+            return -1;
+        json_object_foreach ((json_t *)data, key, o)
+            keys[i++] = key;
+        qsort (keys, count, sizeof (keys[0]), keycmp);
+        for (i = 0; i < count; i++) {
+            if (bbuf_put_string (b, keys[i], strlen (keys[i])) < 0)
+                goto done;
+            if (encode_binary_obj (b, json_object_get (data, keys[i])) < 0)
+                goto done;
+        }
+        rc = 0;
+done:
+        free (keys);
+        return rc;
+    }
+    else {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+struct cursor {
+    const uint8_t *p;
+    size_t left;
+};
+
+static int get_byte (struct cursor *c, uint8_t *val)
+{
+    if (c->left < 1)
+        return -1;
+    *val = *c->p++;
+    c->left--;
+    return 0;
+}
+
+static int get_varint (struct cursor *c, size_t *val)
+{
+    size_t v = 0;
+    int shift = 0;
+    uint8_t byte;
+
+    do {
+        if (shift > 56 || get_byte (c, &byte) < 0)
+            return -1;
+        v |= (size_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    *val = v;
+    return 0;
+}
+
+/* Return a pointer to the next length-prefixed string, not terminated.
+ */
+static const char *get_string (struct cursor *c, size_t *lenp)
+{
+    const char *s;
+    size_t len;
+
+    if (get_varint (c, &len) < 0 || len > c->left)
+        return NULL;
+    s = (const char *)c->p;
+    c->p += len;
+    c->left -= len;
+    *lenp = len;
+    return s;
+}
+
+/* Return a NUL-terminated copy of the next string, rejecting
+ * strings with embedded NULs.
+ */
+static char *get_strdup (struct cursor *c)
+{
+    const char *s;
+    size_t len;
+    char *cpy;
+
+    if (!(s = get_string (c, &len)) || memchr (s, '\0', len))
+        return NULL;
+    if (!(cpy = malloc (len + 1)))
+        return NULL;
+    memcpy (cpy, s, len);
+    cpy[len] = '\0';
+    return cpy;
+}
+
+static json_t *decode_binary_obj (struct cursor *c, int depth)
+{
+    json_t *obj = NULL;
+    char *str = NULL;
+    size_t i, count, len;
+    const char *val;
+    uint8_t type;
+
+    if (depth > BINARY_MAXDEPTH || get_byte (c, &type) < 0)
+        goto error;
+    switch (type) {
+        case BINARY_VAL:
+            if (!(val = get_string (c, &len)) || len > INT_MAX
+                    || !(obj = treeobj_create_val (val, len)))
+                goto error;
+            break;
+        case BINARY_SYMLINK:
+            if (!(str = get_strdup (c))
+                    || !(obj = treeobj_create_symlink (str)))
+                goto error;
+            break;
+        case BINARY_VALREF:
+        case BINARY_DIRREF:
+            if (type == BINARY_VALREF)
+                obj = treeobj_create_valref (NULL);
+            else
+                obj = treeobj_create_dirref (NULL);
+            if (!obj || get_varint (c, &count) < 0 || count == 0)
+                goto error;
+            for (i = 0; i < count; i++) {
+                if (!(str = get_strdup (c))
+                        || treeobj_append_blobref (obj, str) < 0)
+                    goto error;
+                free (str);
+                str = NULL;
+            }
+            break;
+        case BINARY_DIR:
+        case BINARY_HDIR: {
+            json_t *data;
+            json_t *entry;
+
+            if (type == BINARY_DIR)
+                obj = treeobj_create_dir ();
+            else
+                obj = treeobj_create_hdir ();
+            if (!obj || !(data = treeobj_get_data (obj))
+                    || get_varint (c, &count) < 0)
+                goto error;
+            for (i = 0; i < count; i++) {
+                if (!(str = get_strdup (c))
+                        || !(entry = decode_binary_obj (c, depth + 1)))
+                    goto error;
+                if (type == BINARY_HDIR
+                        && (hdir_slot_index (str) < 0
+                            || !(treeobj_is_dir (entry)
+                                 || treeobj_is_dirref (entry)
+                                 || treeobj_is_hdir (entry)))) {
+                    json_decref (entry);
+                    goto error;
+                }
+                if (json_object_set_new (data, str, entry) < 0) {
+                    json_decref (entry);
+                    goto error;
+                }
+                free (str);
+                str = NULL;
+            }
+            break;
+        }
+        default:
+            goto error;
+    }
+    return obj;
+error:
+    free (str);
+    json_decref (obj);
+    return NULL;
+}
+
+static json_t *treeobj_decode_binary (const char *buf, size_t buflen)
+{
+    struct cursor c = { .p = (const uint8_t *)buf, .left = buflen };
+    uint8_t hdr[3];
+    json_t *obj;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (get_byte (&c, &hdr[i]) < 0)
+            goto error;
+    }
+    if (hdr[1] != BINARY_MAGIC1 || hdr[2] != BINARY_VERSION)
+        goto error;
+    if (!(obj = decode_binary_obj (&c, 0)))
+        goto error;
+    if (c.left > 0) {
+        json_decref (obj);
+        goto error;
+    }
+    return obj;
+error:
+    errno = EPROTO;
+    return NULL;
+}
+
+bool treeobj_is_binary (const void *buf, size_t buflen)
+{
+    return buf && buflen > 0 && *(const uint8_t *)buf == BINARY_MAGIC0;
+}
+
 json_t *treeobj_decodeb (const char *buf, size_t buflen)
 {
     json_t *obj = NULL;
+
+    if (treeobj_is_binary (buf, buflen))
+        return treeobj_decode_binary (buf, buflen);
     if (!(obj = json_loadb (buf, buflen, 0, NULL))
             || treeobj_validate (obj) < 0) {
         errno = EPROTO;
@@ -558,6 +1047,38 @@ char *treeobj_encode (const json_t *obj)
     return json_dumps (obj, JSON_COMPACT|JSON_SORT_KEYS);
 }
 
+void *treeobj_encodeb (const json_t *obj, int format, size_t *lenp)
+{
+    struct bbuf b = { .data = NULL, .len = 0, .size = 0 };
+    uint8_t hdr[3] = { BINARY_MAGIC0, BINARY_MAGIC1, BINARY_VERSION };
+    char *s;
+
+    if (!obj || !lenp || (format != TREEOBJ_FORMAT_JSON
+                          && format != TREEOBJ_FORMAT_BINARY)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (format == TREEOBJ_FORMAT_JSON) {
+        if (!(s = treeobj_encode (obj))) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        *lenp = strlen (s);
+        return s;
+    }
+    if (treeobj_validate (obj) < 0)
+        return NULL;
+    if (bbuf_put (&b, hdr, sizeof (hdr)) < 0
+            || encode_binary_obj (&b, obj) < 0) {
+        int saved_errno = errno;
+        free (b.data);
+        errno = saved_errno;
+        return NULL;
+    }
+    *lenp = b.len;
+    return b.data;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
@@ -27,6 +27,7 @@ json_t *treeobj_create_val (const void *data, int len);
 json_t *treeobj_create_valref (const char *blobref);
 json_t *treeobj_create_dir (void);
 json_t *treeobj_create_dirref (const char *blobref);
+json_t *treeobj_create_hdir (void);
 
 /* Validate treeobj, recursively.
  * Return 0 if valid, -1 with errno = EINVAL if invalid.
@@ -44,10 +45,12 @@ bool treeobj_is_val (const json_t *obj);
 bool treeobj_is_valref (const json_t *obj);
 bool treeobj_is_dir (const json_t *obj);
 bool treeobj_is_dirref (const json_t *obj);
+bool treeobj_is_hdir (const json_t *obj);
 
 /* get type-specific value.
  * For dirref/valref, this is an array of blobrefs.
  * For directory, this is dictionary of treeobjs
+ * For hdir, this is dictionary of slot name to treeobj
  * For symlink, this is a string.
  * For val this is string containing base64-encoded data.
  * Return JSON object on success, NULL on error with errno = EINVAL.
@@ -69,6 +72,7 @@ int treeobj_decode_val (const json_t *obj, void **data, int *len);
 /* get type-specific count.
  * For dirref/valref, this is the number of blobrefs.
  * For directory, this is number of entries
+ * For hdir, this is number of occupied slots
  * For symlink or val, this is 1.
  * Return count on success, -1 on error with errno = EINVAL.
  */
@@ -89,6 +93,33 @@ int treeobj_delete_entry (json_t *obj, const char *name);
  */
 const json_t *treeobj_peek_entry (const json_t *obj, const char *name);
 
+/* Sharded directories
+ * An hdir is one node of a hash array mapped trie that holds the entries
+ * of a large directory.  Each of its TREEOBJ_HDIR_FANOUT slots is empty
+ * or holds a dir, a dirref, or an hdir (as a dirref once stored).  The
+ * entry 'name' lives in the dir reached by following, at each level,
+ * the slot returned by treeobj_hdir_slot (name, level).
+ * Slot get/peek/insert/delete follow the directory entry functions above.
+ *
+ * hdir is not an RFC 11 type, and is only produced by a kvs module
+ * started with dir-shard-threshold=N.  It is encoded like a dir:
+ *
+ *   {"ver":1, "type":"hdir", "data":{"0":<obj>, ..., "f":<obj>}}
+ *
+ * where each key of "data" names an occupied slot with one lowercase
+ * hex digit.  The slot of 'name' at 'level' is bits [4*level, 4*level+3]
+ * of the 32-bit FNV-1a hash of 'name', so an hdir is at most
+ * TREEOBJ_HDIR_MAXLEVEL levels deep.
+ */
+#define TREEOBJ_HDIR_FANOUT     16
+#define TREEOBJ_HDIR_MAXLEVEL   8
+
+int treeobj_hdir_slot (const char *name, int level);
+json_t *treeobj_get_slot (json_t *obj, int index);
+const json_t *treeobj_peek_slot (const json_t *obj, int index);
+int treeobj_insert_slot (json_t *obj, int index, json_t *obj2);
+int treeobj_delete_slot (json_t *obj, int index);
+
 /* Shallow copy a treeobj
  * Note that this is not a shallow copy on the json object, but is a
  * shallow copy on the data within a tree object.  For example, for a
@@ -124,6 +155,31 @@ json_t *treeobj_decode (const char *buf);
 json_t *treeobj_decodeb (const char *buf, size_t buflen);
 char *treeobj_encode (const json_t *obj);
 
+/* Encode a treeobj for storage in 'format'.
+ * TREEOBJ_FORMAT_JSON is the RFC 11 JSON encoding produced by
+ * treeobj_encode().  TREEOBJ_FORMAT_BINARY is a compact encoding in which
+ * val data is stored as raw bytes rather than base64, and directory
+ * entries are stored sorted by name.  treeobj_decodeb() accepts either.
+ * The return value must be destroyed with free().  Its length is
+ * assigned to 'len'.  Returns NULL on failure with errno set.
+ *
+ * N.B. The binary format is a storage encoding only.  In memory, and in
+ * lookup responses, a treeobj is always the JSON form.  treeobj_decodeb()
+ * rebuilds that form from a binary object and base64 encodes val data
+ * again, so lookups still pay for jansson objects and base64 val data.
+ * It skips only the JSON text parse.  The format is chosen per kvs module
+ * instance, and nothing negotiates it with libkvs or the content store.
+ */
+enum {
+    TREEOBJ_FORMAT_JSON = 0,
+    TREEOBJ_FORMAT_BINARY = 1,
+};
+void *treeobj_encodeb (const json_t *obj, int format, size_t *len);
+
+/* Return true if 'buf' is a binary encoded treeobj.
+ */
+bool treeobj_is_binary (const void *buf, size_t buflen);
+
 #endif /* !_FLUX_KVS_TREEOBJ_H */
 
 /*
@@ -231,6 +231,73 @@ int blobref_validate_hashtype (const char *name)
     return 0;
 }
 
+int blobkey_fromstr (struct blobkey *key, const char *blobref)
+{
+    struct blobhash *bh;
+    int len;
+
+    if (!key || !blobref || !(bh = lookup_blobhash (blobref))) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset (key, 0, sizeof (*key));
+    if ((len = blobref_strtohash (blobref, key->digest,
+                                  sizeof (key->digest))) < 0)
+        return -1;
+    key->type = bh - blobtab;
+    key->len = len;
+    return 0;
+}
+
+int blobkey_tostr (const struct blobkey *key, char *blobref, int blobref_len)
+{
+    if (!key || key->type >= sizeof (blobtab) / sizeof (blobtab[0]) - 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    return hashtostr (&blobtab[key->type], key->digest, key->len,
+                      blobref, blobref_len);
+}
+
+int blobkey_hash (const char *hashtype, const void *data, int len,
+                  struct blobkey *key)
+{
+    struct blobhash *bh;
+
+    if (!key || !(bh = lookup_blobhash (hashtype))) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset (key, 0, sizeof (*key));
+    bh->hashfun (data, len, key->digest, bh->hashlen);
+    key->type = bh - blobtab;
+    key->len = bh->hashlen;
+    return 0;
+}
+
+int blobkey_match_hashtype (const struct blobkey *key, const char *hashtype)
+{
+    struct blobhash *bh;
+
+    if (!key || !hashtype || !(bh = lookup_blobhash (hashtype)))
+        return 0;
+    return (key->type == bh - blobtab);
+}
+
+size_t blobkey_hasher (const void *key)
+{
+    const struct blobkey *k = key;
+    size_t hash;
+
+    memcpy (&hash, k->digest, sizeof (hash));
+    return hash ^ k->type;
+}
+
+int blobkey_cmp (const void *key1, const void *key2)
+{
+    return memcmp (key1, key2, sizeof (struct blobkey));
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
@@ -15,6 +15,7 @@
 #define BLOBREF_MAX_DIGEST_SIZE     32
 
 #include <stdint.h>
+#include <stddef.h>
 
 /* Convert a blobref string to hash digest.
  * The hash algorithm is selected by the blobref prefix.
@@ -46,6 +47,46 @@ int blobref_validate (const char *blobref);
  */
 int blobref_validate_hashtype (const char *name);
 
+/* Binary form of a blobref:  hash type and raw digest.
+ * This is more compact than the string form and is cheaper to hash and
+ * compare, so it is suitable for use as a hash key for large caches.
+ * Unused digest bytes are zeroed so keys may be compared with memcmp().
+ */
+struct blobkey {
+    uint8_t type;
+    uint8_t len;
+    uint8_t digest[BLOBREF_MAX_DIGEST_SIZE];
+};
+
+/* Convert a blobref string to a blobkey.
+ * Returns 0 on success, -1 on error with errno set.
+ */
+int blobkey_fromstr (struct blobkey *key, const char *blobref);
+
+/* Convert a blobkey to null-terminated blobref string in 'blobref'.
+ * Returns 0 on success, -1 on error with errno set.
+ */
+int blobkey_tostr (const struct blobkey *key, char *blobref, int blobref_len);
+
+/* Compute hash over data and return the result in 'key'.
+ * The hash algorithm is selected by 'hashtype', e.g. "sha1".
+ * Returns 0 on success, -1 on error with errno set.
+ */
+int blobkey_hash (const char *hashtype, const void *data, int len,
+                  struct blobkey *key);
+
+/* Return true if 'key' was computed with hash algorithm 'hashtype'.
+ */
+int blobkey_match_hashtype (const struct blobkey *key, const char *hashtype);
+
+/* Hash and comparison functions for struct blobkey, compatible with
+ * czmq zhashx_set_key_hasher() and zhashx_set_key_comparator().
+ * Digests are already uniformly distributed, so the hasher just
+ * takes the leading bytes of the digest.
+ */
+size_t blobkey_hasher (const void *key);
+int blobkey_cmp (const void *key1, const void *key2);
+
 
 #endif /* _UTIL_BLOBREF_H */
 /*
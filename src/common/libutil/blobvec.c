@@ -0,0 +1,213 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+#include "blobvec.h"
+
+#define RECORD_HEADER_SIZE  8
+
+struct record {
+    int errnum;
+    int len;
+    size_t offset;      /* offset of data in buf */
+};
+
+struct blobvec {
+    uint8_t *buf;
+    size_t size;        /* allocated size of buf (encoder only) */
+    size_t used;
+    bool decoded;
+
+    struct record *recs;
+    int count;
+    int alloc;
+};
+
+void blobvec_destroy (blobvec_t *bv)
+{
+    if (bv) {
+        int saved_errno = errno;
+        if (!bv->decoded)
+            free (bv->buf);
+        free (bv->recs);
+        free (bv);
+        errno = saved_errno;
+    }
+}
+
+blobvec_t *blobvec_create (void)
+{
+    blobvec_t *bv;
+
+    if (!(bv = calloc (1, sizeof (*bv)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return bv;
+}
+
+static int add_record (blobvec_t *bv, int errnum, int len, size_t offset)
+{
+    if (bv->count == bv->alloc) {
+        int alloc = bv->alloc ? bv->alloc * 2 : 16;
+        struct record *recs;
+        if (!(recs = realloc (bv->recs, alloc * sizeof (recs[0])))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        bv->recs = recs;
+        bv->alloc = alloc;
+    }
+    bv->recs[bv->count].errnum = errnum;
+    bv->recs[bv->count].len = len;
+    bv->recs[bv->count].offset = offset;
+    bv->count++;
+    return 0;
+}
+
+static int grow_buf (blobvec_t *bv, size_t needed)
+{
+    size_t size = bv->size ? bv->size : 4096;
+    uint8_t *buf;
+
+    while (size < needed)
+        size *= 2;
+    if (size > bv->size) {
+        if (!(buf = realloc (bv->buf, size))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        bv->buf = buf;
+        bv->size = size;
+    }
+    return 0;
+}
+
+int blobvec_append (blobvec_t *bv, int errnum, const void *data, int len)
+{
+    uint32_t hdr[2];
+
+    if (!bv || bv->decoded || errnum < 0 || (errnum == 0 && len < 0)
+             || (errnum == 0 && len > 0 && !data)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (errnum != 0)
+        len = 0;
+    if (bv->used + RECORD_HEADER_SIZE + len > INT_MAX) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    if (grow_buf (bv, bv->used + RECORD_HEADER_SIZE + len) < 0)
+        return -1;
+    if (add_record (bv, errnum, len, bv->used + RECORD_HEADER_SIZE) < 0)
+        return -1;
+    hdr[0] = htonl (errnum);
+    hdr[1] = htonl (len);
+    memcpy (bv->buf + bv->used, hdr, RECORD_HEADER_SIZE);
+    bv->used += RECORD_HEADER_SIZE;
+    if (len > 0) {
+        memcpy (bv->buf + bv->used, data, len);
+        bv->used += len;
+    }
+    return 0;
+}
+
+int blobvec_encode (blobvec_t *bv, const void **buf, int *len)
+{
+    if (!bv || !buf || !len) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (bv->used > INT_MAX) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    *buf = bv->buf;
+    *len = bv->used;
+    return 0;
+}
+
+blobvec_t *blobvec_decode (const void *buf, int len)
+{
+    blobvec_t *bv;
+    uint32_t hdr[2];
+    size_t offset = 0;
+
+    if ((len > 0 && !buf) || len < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(bv = blobvec_create ()))
+        return NULL;
+    bv->decoded = true;
+    bv->buf = (uint8_t *)buf;
+    bv->used = len;
+    while (offset < len) {
+        int errnum, reclen;
+
+        if (len - offset < RECORD_HEADER_SIZE)
+            goto eproto;
+        memcpy (hdr, bv->buf + offset, RECORD_HEADER_SIZE);
+        errnum = ntohl (hdr[0]);
+        reclen = ntohl (hdr[1]);
+        offset += RECORD_HEADER_SIZE;
+        if (errnum < 0 || reclen < 0 || len - offset < reclen
+                       || (errnum != 0 && reclen != 0))
+            goto eproto;
+        if (add_record (bv, errnum, reclen, offset) < 0)
+            goto error;
+        offset += reclen;
+    }
+    return bv;
+eproto:
+    errno = EPROTO;
+error:
+    blobvec_destroy (bv);
+    return NULL;
+}
+
+int blobvec_count (blobvec_t *bv)
+{
+    return bv ? bv->count : 0;
+}
+
+int blobvec_get (blobvec_t *bv, int index,
+                 int *errnum, const void **data, int *len)
+{
+    struct record *rec;
+
+    if (!bv || index < 0 || index >= bv->count) {
+        errno = EINVAL;
+        return -1;
+    }
+    rec = &bv->recs[index];
+    if (errnum)
+        *errnum = rec->errnum;
+    if (data)
+        *data = rec->len > 0 ? bv->buf + rec->offset : NULL;
+    if (len)
+        *len = rec->len;
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,62 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_BLOBVEC_H
+#define _UTIL_BLOBVEC_H
+
+/* blobvec - vector of blobs packed into one message payload
+ *
+ * Each record is encoded as a 4 byte errnum and a 4 byte length,
+ * both in network byte order, followed by 'length' bytes of data.
+ * A record with nonzero errnum carries no data.
+ */
+
+typedef struct blobvec blobvec_t;
+
+/* Create an empty blobvec for encoding, or destroy a blobvec.
+ */
+blobvec_t *blobvec_create (void);
+void blobvec_destroy (blobvec_t *bv);
+
+/* Append a record.  'data' is copied.  If 'errnum' is nonzero,
+ * 'data' and 'len' are ignored.
+ * Returns 0 on success, -1 on failure with errno set (EOVERFLOW if the
+ * encoded blobvec would exceed INT_MAX bytes).
+ */
+int blobvec_append (blobvec_t *bv, int errnum, const void *data, int len);
+
+/* Access the encoded form of 'bv'.  Storage belongs to 'bv'.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int blobvec_encode (blobvec_t *bv, const void **buf, int *len);
+
+/* Parse an encoded blobvec.  The result refers to 'buf', which must
+ * remain valid for the lifetime of the blobvec.  No records may be
+ * appended to a decoded blobvec.
+ * Returns blobvec on success, NULL on failure with errno set (EPROTO
+ * if 'buf' is malformed).
+ */
+blobvec_t *blobvec_decode (const void *buf, int len);
+
+/* Return the number of records.
+ */
+int blobvec_count (blobvec_t *bv);
+
+/* Get record by index.  Any of 'errnum', 'data', 'len' may be NULL.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int blobvec_get (blobvec_t *bv, int index,
+                 int *errnum, const void **data, int *len);
+
+#endif /* !_UTIL_BLOBVEC_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
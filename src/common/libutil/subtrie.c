@@ -0,0 +1,290 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "subtrie.h"
+
+struct entry {
+    void *subscriber;
+    int refcount;
+    struct entry *next;
+};
+
+struct node {
+    char c;
+    struct node *child;     /* first child */
+    struct node *next;      /* next sibling */
+    struct entry *entries;  /* subscribers to the prefix ending here */
+};
+
+struct subtrie {
+    struct node root;       /* prefix "" */
+    int count;
+    void **matches;         /* scratch buffer for subtrie_match() */
+    int matches_size;
+};
+
+static void node_destroy (struct node *n)
+{
+    while (n->child) {
+        struct node *child = n->child;
+        n->child = child->next;
+        node_destroy (child);
+        free (child);
+    }
+    while (n->entries) {
+        struct entry *e = n->entries;
+        n->entries = e->next;
+        free (e);
+    }
+}
+
+void subtrie_destroy (subtrie_t *st)
+{
+    if (st) {
+        int saved_errno = errno;
+        node_destroy (&st->root);
+        free (st->matches);
+        free (st);
+        errno = saved_errno;
+    }
+}
+
+subtrie_t *subtrie_create (void)
+{
+    subtrie_t *st;
+
+    if (!(st = calloc (1, sizeof (*st))))
+        return NULL;
+    return st;
+}
+
+static struct node *node_child (struct node *n, char c, bool create)
+{
+    struct node *child;
+
+    for (child = n->child; child != NULL; child = child->next) {
+        if (child->c == c)
+            return child;
+    }
+    if (!create)
+        return NULL;
+    if (!(child = calloc (1, sizeof (*child))))
+        return NULL;
+    child->c = c;
+    child->next = n->child;
+    n->child = child;
+    return child;
+}
+
+int subtrie_subscribe (subtrie_t *st, const char *topic, void *subscriber)
+{
+    struct node *n;
+    struct entry *e;
+    const char *cp;
+
+    if (!st || !topic || !subscriber) {
+        errno = EINVAL;
+        return -1;
+    }
+    n = &st->root;
+    for (cp = topic; *cp != '\0'; cp++) {
+        if (!(n = node_child (n, *cp, true)))
+            return -1;
+    }
+    for (e = n->entries; e != NULL; e = e->next) {
+        if (e->subscriber == subscriber) {
+            e->refcount++;
+            return 0;
+        }
+    }
+    if (!(e = calloc (1, sizeof (*e))))
+        return -1;
+    e->subscriber = subscriber;
+    e->refcount = 1;
+    if (!n->entries)
+        st->count++;
+    e->next = n->entries;
+    n->entries = e;
+    return 0;
+}
+
+/* Remove child 'child' of 'n' if it no longer leads anywhere.
+ */
+static void node_prune (struct node *n, struct node *child)
+{
+    struct node **np;
+
+    if (child->child || child->entries)
+        return;
+    for (np = &n->child; *np != NULL; np = &(*np)->next) {
+        if (*np == child) {
+            *np = child->next;
+            free (child);
+            break;
+        }
+    }
+}
+
+/* Drop one reference (or all if 'all') on 'subscriber' in node 'n'.
+ * Returns true if an entry was found.
+ */
+static bool node_unsubscribe (subtrie_t *st, struct node *n,
+                              void *subscriber, bool all)
+{
+    struct entry **ep;
+
+    for (ep = &n->entries; *ep != NULL; ep = &(*ep)->next) {
+        struct entry *e = *ep;
+        if (e->subscriber == subscriber) {
+            if (all || --e->refcount == 0) {
+                *ep = e->next;
+                free (e);
+                if (!n->entries)
+                    st->count--;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool topic_unsubscribe (subtrie_t *st, struct node *n,
+                               const char *topic, void *subscriber)
+{
+    struct node *child;
+    bool found;
+
+    if (*topic == '\0')
+        return node_unsubscribe (st, n, subscriber, false);
+    if (!(child = node_child (n, *topic, false)))
+        return false;
+    found = topic_unsubscribe (st, child, topic + 1, subscriber);
+    node_prune (n, child);
+    return found;
+}
+
+int subtrie_unsubscribe (subtrie_t *st, const char *topic, void *subscriber)
+{
+    if (!st || !topic || !subscriber) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!topic_unsubscribe (st, &st->root, topic, subscriber)) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+static void node_unsubscribe_all (subtrie_t *st, struct node *n,
+                                  void *subscriber)
+{
+    struct node *child = n->child;
+
+    (void)node_unsubscribe (st, n, subscriber, true);
+    while (child) {
+        struct node *next = child->next;
+        node_unsubscribe_all (st, child, subscriber);
+        node_prune (n, child);
+        child = next;
+    }
+}
+
+void subtrie_unsubscribe_all (subtrie_t *st, void *subscriber)
+{
+    if (st && subscriber)
+        node_unsubscribe_all (st, &st->root, subscriber);
+}
+
+static int match_append (subtrie_t *st, struct node *n, int *count)
+{
+    struct entry *e;
+
+    for (e = n->entries; e != NULL; e = e->next) {
+        if (*count == st->matches_size) {
+            int new_size = st->matches_size ? st->matches_size * 2 : 16;
+            void **new_matches;
+
+            if (!(new_matches = realloc (st->matches,
+                                         new_size * sizeof (void *))))
+                return -1;
+            st->matches = new_matches;
+            st->matches_size = new_size;
+        }
+        st->matches[(*count)++] = e->subscriber;
+    }
+    return 0;
+}
+
+static int ptr_cmp (const void *a, const void *b)
+{
+    uintptr_t x = (uintptr_t)*(void **)a;
+    uintptr_t y = (uintptr_t)*(void **)b;
+
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+int subtrie_match (subtrie_t *st, const char *topic,
+                   subtrie_match_f fun, void *arg)
+{
+    struct node *n;
+    const char *cp;
+    int count = 0;
+    int nodes = 0;
+    int i;
+
+    if (!st || !topic || !fun) {
+        errno = EINVAL;
+        return -1;
+    }
+    n = &st->root;
+    cp = topic;
+    for (;;) {
+        if (n->entries) {
+            if (match_append (st, n, &count) < 0)
+                return -1;
+            nodes++;
+        }
+        if (*cp == '\0' || !(n = node_child (n, *cp++, false)))
+            break;
+    }
+    /* A subscriber is listed at most once per node, so duplicates
+     * are only possible when more than one prefix matched.
+     */
+    if (nodes > 1) {
+        int unique = 0;
+        qsort (st->matches, count, sizeof (void *), ptr_cmp);
+        for (i = 0; i < count; i++) {
+            if (unique == 0 || st->matches[unique - 1] != st->matches[i])
+                st->matches[unique++] = st->matches[i];
+        }
+        count = unique;
+    }
+    for (i = 0; i < count; i++)
+        fun (st->matches[i], arg);
+    return count;
+}
+
+int subtrie_count (subtrie_t *st)
+{
+    return st ? st->count : 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,62 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_SUBTRIE_H
+#define _UTIL_SUBTRIE_H
+
+/* Event subscription index.
+ *
+ * Subscriptions are topic prefixes: a subscriber to "foo." receives
+ * "foo.bar" and "foo.baz", and a subscriber to "" receives everything.
+ * Prefixes are stored in a character trie so that the subscribers of a
+ * topic are found in one walk down the topic string, rather than by
+ * comparing the topic against every subscription of every subscriber.
+ */
+
+typedef struct subtrie subtrie_t;
+
+typedef void (*subtrie_match_f)(void *subscriber, void *arg);
+
+subtrie_t *subtrie_create (void);
+void subtrie_destroy (subtrie_t *st);
+
+/* Subscribe 'subscriber' to 'topic' prefix.  Subscriptions are counted,
+ * so subscribing twice requires unsubscribing twice.
+ * Returns 0 on success, -1 on error with errno set.
+ */
+int subtrie_subscribe (subtrie_t *st, const char *topic, void *subscriber);
+
+/* Drop one subscription of 'subscriber' to 'topic' prefix.
+ * Returns 0 on success, -1 on error with errno set (ENOENT if
+ * 'subscriber' was not subscribed to 'topic').
+ */
+int subtrie_unsubscribe (subtrie_t *st, const char *topic, void *subscriber);
+
+/* Drop all subscriptions of 'subscriber'.
+ */
+void subtrie_unsubscribe_all (subtrie_t *st, void *subscriber);
+
+/* Call 'fun' once for each subscriber with a subscription that is a
+ * prefix of 'topic', even if it has several such subscriptions.
+ * 'fun' must not modify the index.
+ * Returns the number of subscribers, or -1 on error with errno set.
+ */
+int subtrie_match (subtrie_t *st, const char *topic,
+                   subtrie_match_f fun, void *arg);
+
+/* Return the number of distinct topic prefixes in the index.
+ */
+int subtrie_count (subtrie_t *st);
+
+#endif /* !_UTIL_SUBTRIE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -157,6 +157,45 @@ int main(int argc, char** argv)
     ok (blobref_validate_hashtype (NULL) == -1,
         "blobref_validate_hashtype NULL is invalid");
 
+    /* blobkey */
+    struct blobkey key, key2;
+
+    errno = 0;
+    ok (blobkey_fromstr (&key, badref[0]) < 0 && errno == EINVAL,
+        "blobkey_fromstr fails EINVAL with unknown hash prefix");
+    errno = 0;
+    ok (blobkey_fromstr (&key, badref[3]) < 0 && errno == EINVAL,
+        "blobkey_fromstr fails EINVAL with out of range blobref chars");
+    errno = 0;
+    ok (blobkey_hash ("nerf", data, sizeof (data), &key) < 0
+        && errno == EINVAL,
+        "blobkey_hash fails EINVAL with unknown hash name");
+    pp = &goodref[0];
+    while (*pp) {
+        ok (blobkey_fromstr (&key, *pp) == 0
+            && blobkey_tostr (&key, ref, sizeof (ref)) == 0
+            && strcmp (ref, *pp) == 0,
+            "blobkey round trip: %s", *pp);
+        pp++;
+    }
+    errno = 0;
+    ok (blobkey_tostr (&key, ref, 1) < 0 && errno == EINVAL,
+        "blobkey_tostr fails EINVAL with invalid ref length");
+
+    ok (blobkey_hash ("sha1", data, sizeof (data), &key) == 0
+        && blobref_hash ("sha1", data, sizeof (data), ref, sizeof (ref)) == 0
+        && blobkey_fromstr (&key2, ref) == 0,
+        "blobkey_hash sha1 works");
+    ok (blobkey_cmp (&key, &key2) == 0
+        && blobkey_hasher (&key) == blobkey_hasher (&key2),
+        "blobkey_hash and blobkey_fromstr keys compare equal");
+    ok (blobkey_match_hashtype (&key, "sha1")
+        && !blobkey_match_hashtype (&key, "sha256"),
+        "blobkey_match_hashtype works");
+    ok (blobkey_hash ("sha256", data, sizeof (data), &key2) == 0
+        && blobkey_cmp (&key, &key2) != 0,
+        "sha1 and sha256 keys of same data compare unequal");
+
     done_testing();
 }
 
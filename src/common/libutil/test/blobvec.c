@@ -0,0 +1,157 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/blobvec.h"
+
+void basic (void)
+{
+    blobvec_t *bv, *bv2;
+    const void *buf, *data;
+    int len, errnum, i;
+
+    ok ((bv = blobvec_create ()) != NULL,
+        "blobvec_create works");
+    ok (blobvec_count (bv) == 0,
+        "empty blobvec has zero records");
+    ok (blobvec_append (bv, 0, "foo", 4) == 0,
+        "blobvec_append foo works");
+    ok (blobvec_append (bv, 0, NULL, 0) == 0,
+        "blobvec_append empty blob works");
+    ok (blobvec_append (bv, ENOENT, NULL, 0) == 0,
+        "blobvec_append errnum works");
+    ok (blobvec_count (bv) == 3,
+        "blobvec has three records");
+    ok (blobvec_get (bv, 0, &errnum, &data, &len) == 0
+        && errnum == 0 && len == 4 && !strcmp (data, "foo"),
+        "blobvec_get works on encoder");
+
+    ok (blobvec_encode (bv, &buf, &len) == 0 && len == 8 * 3 + 4,
+        "blobvec_encode works");
+    ok ((bv2 = blobvec_decode (buf, len)) != NULL,
+        "blobvec_decode works");
+    ok (blobvec_count (bv2) == 3,
+        "decoded blobvec has three records");
+    ok (blobvec_get (bv2, 0, &errnum, &data, &len) == 0
+        && errnum == 0 && len == 4 && !strcmp (data, "foo"),
+        "record 0 is foo");
+    ok (blobvec_get (bv2, 1, &errnum, &data, &len) == 0
+        && errnum == 0 && len == 0 && data == NULL,
+        "record 1 is empty");
+    ok (blobvec_get (bv2, 2, &errnum, &data, &len) == 0
+        && errnum == ENOENT && len == 0,
+        "record 2 is ENOENT");
+    errno = 0;
+    ok (blobvec_get (bv2, 3, &errnum, &data, &len) < 0 && errno == EINVAL,
+        "blobvec_get index out of range fails with EINVAL");
+    errno = 0;
+    ok (blobvec_append (bv2, 0, "foo", 4) < 0 && errno == EINVAL,
+        "blobvec_append to decoded blobvec fails with EINVAL");
+    blobvec_destroy (bv2);
+
+    /* truncated buffers */
+    blobvec_encode (bv, &buf, &len);
+    for (i = 1; i < len; i++) {
+        if (i == 12 || i == 20)
+            continue; /* record boundaries */
+        errno = 0;
+        if (!(bv2 = blobvec_decode (buf, i)) && errno == EPROTO)
+            continue;
+        blobvec_destroy (bv2);
+        break;
+    }
+    ok (i == len,
+        "blobvec_decode fails with EPROTO on truncated buffers");
+    blobvec_destroy (bv);
+
+    ok ((bv = blobvec_decode (NULL, 0)) != NULL && blobvec_count (bv) == 0,
+        "blobvec_decode of empty buffer works");
+    blobvec_destroy (bv);
+}
+
+void big (void)
+{
+    blobvec_t *bv, *bv2;
+    const void *buf, *data;
+    char blob[1000];
+    int len, errnum, i;
+    int errors = 0;
+
+    bv = blobvec_create ();
+    for (i = 0; i < 1000; i++) {
+        memset (blob, i & 0xff, i);
+        if (blobvec_append (bv, 0, blob, i) < 0)
+            errors++;
+    }
+    ok (errors == 0,
+        "appended 1000 records of increasing size");
+    ok (blobvec_encode (bv, &buf, &len) == 0
+        && (bv2 = blobvec_decode (buf, len)) != NULL
+        && blobvec_count (bv2) == 1000,
+        "encoded and decoded 1000 records");
+    for (i = 0; i < 1000; i++) {
+        memset (blob, i & 0xff, i);
+        if (blobvec_get (bv2, i, &errnum, &data, &len) < 0
+                || errnum != 0 || len != i || (i > 0 && memcmp (data, blob, i)))
+            errors++;
+    }
+    ok (errors == 0,
+        "all records decoded correctly");
+    blobvec_destroy (bv2);
+    blobvec_destroy (bv);
+}
+
+void badargs (void)
+{
+    blobvec_t *bv;
+
+    if (!(bv = blobvec_create ()))
+        BAIL_OUT ("blobvec_create failed");
+    errno = 0;
+    ok (blobvec_append (NULL, 0, "foo", 4) < 0 && errno == EINVAL,
+        "blobvec_append bv=NULL fails with EINVAL");
+    errno = 0;
+    ok (blobvec_append (bv, 0, NULL, 4) < 0 && errno == EINVAL,
+        "blobvec_append data=NULL len=4 fails with EINVAL");
+    errno = 0;
+    ok (blobvec_append (bv, -1, NULL, 0) < 0 && errno == EINVAL,
+        "blobvec_append errnum=-1 fails with EINVAL");
+    errno = 0;
+    ok (blobvec_append (bv, 0, "foo", INT_MAX) < 0 && errno == EOVERFLOW,
+        "blobvec_append len=INT_MAX fails with EOVERFLOW");
+    errno = 0;
+    ok (blobvec_decode (NULL, 4) == NULL && errno == EINVAL,
+        "blobvec_decode buf=NULL len=4 fails with EINVAL");
+    errno = 0;
+    ok (blobvec_get (NULL, 0, NULL, NULL, NULL) < 0 && errno == EINVAL,
+        "blobvec_get bv=NULL fails with EINVAL");
+    ok (blobvec_count (NULL) == 0,
+        "blobvec_count bv=NULL returns 0");
+    blobvec_destroy (bv);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    basic ();
+    big ();
+    badargs ();
+
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
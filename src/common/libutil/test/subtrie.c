@@ -0,0 +1,181 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/subtrie.h"
+
+#define NSUBS 4
+
+static int hits[NSUBS];
+static int subs[NSUBS];
+
+static void match_cb (void *subscriber, void *arg)
+{
+    int *s = subscriber;
+    hits[s - subs]++;
+}
+
+static int match (subtrie_t *st, const char *topic)
+{
+    memset (hits, 0, sizeof (hits));
+    return subtrie_match (st, topic, match_cb, NULL);
+}
+
+void basic (void)
+{
+    subtrie_t *st;
+
+    ok ((st = subtrie_create ()) != NULL,
+        "subtrie_create works");
+    ok (match (st, "foo") == 0,
+        "empty index matches nothing");
+    ok (subtrie_subscribe (st, "foo.", &subs[0]) == 0
+        && subtrie_subscribe (st, "foo.bar", &subs[1]) == 0
+        && subtrie_subscribe (st, "baz", &subs[2]) == 0,
+        "subtrie_subscribe works");
+    ok (subtrie_count (st) == 3,
+        "subtrie_count is 3");
+    ok (match (st, "foo.bar") == 2 && hits[0] == 1 && hits[1] == 1,
+        "foo.bar matches foo. and foo.bar subscribers");
+    ok (match (st, "foo.barn") == 2 && hits[0] == 1 && hits[1] == 1,
+        "foo.barn matches foo. and foo.bar subscribers");
+    ok (match (st, "foo.ba") == 1 && hits[0] == 1,
+        "foo.ba matches only foo. subscriber");
+    ok (match (st, "foo") == 0,
+        "foo matches nothing");
+    ok (match (st, "bazooka") == 1 && hits[2] == 1,
+        "bazooka matches baz subscriber");
+    ok (match (st, "") == 0,
+        "empty topic matches nothing");
+
+    ok (subtrie_subscribe (st, "", &subs[3]) == 0,
+        "subtrie_subscribe to empty prefix works");
+    ok (match (st, "anything") == 1 && hits[3] == 1,
+        "empty prefix subscriber matches anything");
+    ok (match (st, "") == 1 && hits[3] == 1,
+        "empty prefix subscriber matches empty topic");
+
+    ok (subtrie_unsubscribe (st, "foo.bar", &subs[1]) == 0,
+        "subtrie_unsubscribe works");
+    ok (match (st, "foo.bar") == 2 && hits[0] == 1 && hits[3] == 1,
+        "foo.bar no longer matches unsubscribed subscriber");
+    errno = 0;
+    ok (subtrie_unsubscribe (st, "foo.bar", &subs[1]) < 0 && errno == ENOENT,
+        "subtrie_unsubscribe of unknown subscription fails with ENOENT");
+    errno = 0;
+    ok (subtrie_unsubscribe (st, "foo", &subs[0]) < 0 && errno == ENOENT,
+        "subtrie_unsubscribe of prefix of subscription fails with ENOENT");
+    ok (subtrie_count (st) == 3,
+        "subtrie_count is 3");
+    subtrie_destroy (st);
+}
+
+void refcount (void)
+{
+    subtrie_t *st;
+
+    if (!(st = subtrie_create ()))
+        BAIL_OUT ("subtrie_create failed");
+    ok (subtrie_subscribe (st, "a.b", &subs[0]) == 0
+        && subtrie_subscribe (st, "a.b", &subs[0]) == 0,
+        "subscribed twice to the same topic");
+    ok (subtrie_subscribe (st, "a.", &subs[0]) == 0
+        && subtrie_subscribe (st, "a", &subs[0]) == 0,
+        "subscribed to two more prefixes of the same topic");
+    ok (match (st, "a.b.c") == 1 && hits[0] == 1,
+        "subscriber with several matching prefixes matches once");
+    ok (subtrie_unsubscribe (st, "a.b", &subs[0]) == 0
+        && match (st, "a.b") == 1,
+        "subscription remains after one of two unsubscribes");
+    subtrie_unsubscribe_all (st, &subs[0]);
+    ok (match (st, "a.b") == 0 && subtrie_count (st) == 0,
+        "subtrie_unsubscribe_all removes all subscriptions");
+    errno = 0;
+    ok (subtrie_unsubscribe (st, "a.b", &subs[0]) < 0 && errno == ENOENT,
+        "subtrie_unsubscribe after unsubscribe_all fails with ENOENT");
+    subtrie_destroy (st);
+}
+
+void many (void)
+{
+    subtrie_t *st;
+    char topic[64];
+    int i;
+    bool subscribed = true;
+    bool matched = true;
+
+    if (!(st = subtrie_create ()))
+        BAIL_OUT ("subtrie_create failed");
+    for (i = 0; i < 1000; i++) {
+        snprintf (topic, sizeof (topic), "topic.%d", i);
+        if (subtrie_subscribe (st, topic, &subs[i % NSUBS]) < 0)
+            subscribed = false;
+    }
+    ok (subscribed && subtrie_count (st) == 1000,
+        "subscribed to 1000 topics");
+    /* "topic.1" is a prefix of topic.1, topic.10-19, topic.100-199 */
+    for (i = 0; i < 1000; i++) {
+        snprintf (topic, sizeof (topic), "topic.%d", i);
+        if (match (st, topic) < 1 || hits[i % NSUBS] != 1)
+            matched = false;
+    }
+    ok (matched,
+        "each topic matches its subscriber exactly once");
+    ok (match (st, "topic.123") == 3,
+        "topic.123 matches subscribers of topic.1, topic.12, topic.123");
+    subtrie_destroy (st);
+}
+
+void errors (void)
+{
+    subtrie_t *st;
+
+    if (!(st = subtrie_create ()))
+        BAIL_OUT ("subtrie_create failed");
+    errno = 0;
+    ok (subtrie_subscribe (NULL, "foo", &subs[0]) < 0 && errno == EINVAL,
+        "subtrie_subscribe st=NULL fails with EINVAL");
+    errno = 0;
+    ok (subtrie_subscribe (st, NULL, &subs[0]) < 0 && errno == EINVAL,
+        "subtrie_subscribe topic=NULL fails with EINVAL");
+    errno = 0;
+    ok (subtrie_subscribe (st, "foo", NULL) < 0 && errno == EINVAL,
+        "subtrie_subscribe subscriber=NULL fails with EINVAL");
+    errno = 0;
+    ok (subtrie_unsubscribe (st, NULL, &subs[0]) < 0 && errno == EINVAL,
+        "subtrie_unsubscribe topic=NULL fails with EINVAL");
+    errno = 0;
+    ok (subtrie_match (st, "foo", NULL, NULL) < 0 && errno == EINVAL,
+        "subtrie_match fun=NULL fails with EINVAL");
+    subtrie_destroy (st);
+    lives_ok ({subtrie_destroy (NULL);},
+        "subtrie_destroy NULL doesn't crash");
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    basic ();
+    refcount ();
+    many ();
+    errors ();
+
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,163 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <stdbool.h>
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/workpool.h"
+
+#define NTHREADS 4
+#define NITEMS 1000
+
+struct item {
+    int seq;
+    int result;
+    int worker;
+};
+
+static void work (void *arg, int worker, void *ctx)
+{
+    struct item *item = arg;
+
+    /* make later items finish before earlier ones now and then */
+    if (item->seq % 7 == 0)
+        usleep (100);
+    item->result = item->seq * 2;
+    item->worker = worker;
+}
+
+void basic (void)
+{
+    workpool_t *wp;
+    struct item items[NITEMS];
+    struct item *item;
+    int i, next;
+    bool in_order = true;
+    bool processed = true;
+    bool workers_ok = true;
+
+    ok ((wp = workpool_create (NTHREADS, work, NULL)) != NULL,
+        "workpool_create works");
+    ok (workpool_next (wp) == NULL,
+        "workpool_next returns NULL on empty pool");
+    for (i = 0; i < NITEMS; i++) {
+        items[i].seq = i;
+        if (workpool_submit (wp, &items[i]) < 0)
+            break;
+    }
+    ok (i == NITEMS,
+        "workpool_submit %d items works", NITEMS);
+    ok (workpool_count (wp) == NITEMS,
+        "workpool_count is %d", NITEMS);
+    workpool_wait (wp);
+    next = 0;
+    while ((item = workpool_next (wp))) {
+        if (item->seq != next)
+            in_order = false;
+        if (item->result != item->seq * 2)
+            processed = false;
+        if (item->worker < 0 || item->worker >= NTHREADS)
+            workers_ok = false;
+        next++;
+    }
+    ok (next == NITEMS,
+        "workpool_next returned all items after workpool_wait");
+    ok (in_order,
+        "items were returned in submission order");
+    ok (processed,
+        "items were processed");
+    ok (workers_ok,
+        "worker index is within range");
+    ok (workpool_count (wp) == 0,
+        "workpool_count is zero");
+    workpool_destroy (wp);
+}
+
+void pollfd (void)
+{
+    workpool_t *wp;
+    struct item items[NITEMS];
+    struct item *item;
+    struct pollfd pfd;
+    int i, next;
+    bool in_order = true;
+    bool polled = true;
+
+    ok ((wp = workpool_create (NTHREADS, work, NULL)) != NULL,
+        "workpool_create works");
+    ok ((pfd.fd = workpool_pollfd (wp)) >= 0,
+        "workpool_pollfd works");
+    pfd.events = POLLIN;
+    for (i = 0; i < NITEMS; i++) {
+        items[i].seq = i;
+        if (workpool_submit (wp, &items[i]) < 0)
+            break;
+    }
+    ok (i == NITEMS,
+        "workpool_submit %d items works", NITEMS);
+    next = 0;
+    while (next < NITEMS) {
+        pfd.revents = 0;
+        if (poll (&pfd, 1, 5000) != 1 || !(pfd.revents & POLLIN)) {
+            polled = false;
+            break;
+        }
+        workpool_clear_event (wp);
+        while ((item = workpool_next (wp))) {
+            if (item->seq != next)
+                in_order = false;
+            next++;
+        }
+    }
+    ok (polled,
+        "pollfd became readable until all items were returned");
+    ok (next == NITEMS && in_order,
+        "items were returned in submission order");
+    workpool_destroy (wp);
+}
+
+void errors (void)
+{
+    workpool_t *wp;
+
+    errno = 0;
+    ok (workpool_create (0, work, NULL) == NULL && errno == EINVAL,
+        "workpool_create nthreads=0 fails with EINVAL");
+    errno = 0;
+    ok (workpool_create (1, NULL, NULL) == NULL && errno == EINVAL,
+        "workpool_create fun=NULL fails with EINVAL");
+    if (!(wp = workpool_create (1, work, NULL)))
+        BAIL_OUT ("workpool_create failed");
+    errno = 0;
+    ok (workpool_submit (wp, NULL) < 0 && errno == EINVAL,
+        "workpool_submit item=NULL fails with EINVAL");
+    workpool_destroy (wp);
+    lives_ok ({workpool_destroy (NULL);},
+        "workpool_destroy NULL doesn't crash");
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    basic ();
+    pollfd ();
+    errors ();
+
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,248 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "workpool.h"
+
+struct job {
+    void *item;
+    bool done;
+    struct job *next;
+};
+
+struct worker {
+    workpool_t *wp;
+    int id;
+    pthread_t t;
+    bool started;
+};
+
+struct workpool {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        /* signaled when work is queued */
+    pthread_cond_t done_cond;   /* signaled when work completes */
+    bool shutdown;
+    struct job *head;           /* oldest job not yet returned */
+    struct job *tail;
+    struct job *todo;           /* oldest job not yet started */
+    int count;
+    int running;
+    struct worker *workers;
+    int nthreads;
+    workpool_work_f fun;
+    void *arg;
+    int pollfd;
+};
+
+static void *worker_thread (void *arg)
+{
+    struct worker *w = arg;
+    workpool_t *wp = w->wp;
+    struct job *job;
+    uint64_t one = 1;
+
+    pthread_mutex_lock (&wp->lock);
+    for (;;) {
+        while (!wp->shutdown && !wp->todo)
+            pthread_cond_wait (&wp->cond, &wp->lock);
+        if (!wp->todo)
+            break;
+        job = wp->todo;
+        wp->todo = job->next;
+        wp->running++;
+        pthread_mutex_unlock (&wp->lock);
+
+        wp->fun (job->item, w->id, wp->arg);
+
+        pthread_mutex_lock (&wp->lock);
+        job->done = true;
+        wp->running--;
+        pthread_cond_broadcast (&wp->done_cond);
+        if (wp->pollfd >= 0) {
+            /* eventfd write can only fail on counter overflow */
+            ssize_t n = write (wp->pollfd, &one, sizeof (one));
+            (void)n;
+        }
+    }
+    pthread_mutex_unlock (&wp->lock);
+    return NULL;
+}
+
+void workpool_destroy (workpool_t *wp)
+{
+    if (wp) {
+        int saved_errno = errno;
+        int i;
+
+        pthread_mutex_lock (&wp->lock);
+        wp->shutdown = true;
+        pthread_cond_broadcast (&wp->cond);
+        pthread_mutex_unlock (&wp->lock);
+        if (wp->workers) {
+            for (i = 0; i < wp->nthreads; i++) {
+                if (wp->workers[i].started)
+                    pthread_join (wp->workers[i].t, NULL);
+            }
+            free (wp->workers);
+        }
+        while (wp->head) {
+            struct job *job = wp->head;
+            wp->head = job->next;
+            free (job);
+        }
+        if (wp->pollfd >= 0)
+            close (wp->pollfd);
+        pthread_cond_destroy (&wp->done_cond);
+        pthread_cond_destroy (&wp->cond);
+        pthread_mutex_destroy (&wp->lock);
+        free (wp);
+        errno = saved_errno;
+    }
+}
+
+workpool_t *workpool_create (int nthreads, workpool_work_f fun, void *arg)
+{
+    workpool_t *wp;
+    int i, e;
+
+    if (nthreads < 1 || !fun) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(wp = calloc (1, sizeof (*wp)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    pthread_mutex_init (&wp->lock, NULL);
+    pthread_cond_init (&wp->cond, NULL);
+    pthread_cond_init (&wp->done_cond, NULL);
+    wp->pollfd = -1;
+    wp->fun = fun;
+    wp->arg = arg;
+    wp->nthreads = nthreads;
+    if (!(wp->workers = calloc (nthreads, sizeof (wp->workers[0])))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    for (i = 0; i < nthreads; i++) {
+        wp->workers[i].wp = wp;
+        wp->workers[i].id = i;
+        if ((e = pthread_create (&wp->workers[i].t, NULL, worker_thread,
+                                 &wp->workers[i]))) {
+            errno = e;
+            goto error;
+        }
+        wp->workers[i].started = true;
+    }
+    return wp;
+error:
+    workpool_destroy (wp);
+    return NULL;
+}
+
+int workpool_submit (workpool_t *wp, void *item)
+{
+    struct job *job;
+
+    if (!wp || !item) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(job = calloc (1, sizeof (*job)))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    job->item = item;
+    pthread_mutex_lock (&wp->lock);
+    if (wp->tail)
+        wp->tail->next = job;
+    else
+        wp->head = job;
+    wp->tail = job;
+    if (!wp->todo)
+        wp->todo = job;
+    wp->count++;
+    pthread_cond_signal (&wp->cond);
+    pthread_mutex_unlock (&wp->lock);
+    return 0;
+}
+
+void *workpool_next (workpool_t *wp)
+{
+    struct job *job = NULL;
+    void *item = NULL;
+
+    pthread_mutex_lock (&wp->lock);
+    if (wp->head && wp->head->done) {
+        job = wp->head;
+        wp->head = job->next;
+        if (!wp->head)
+            wp->tail = NULL;
+        wp->count--;
+    }
+    pthread_mutex_unlock (&wp->lock);
+    if (job) {
+        item = job->item;
+        free (job);
+    }
+    return item;
+}
+
+void workpool_wait (workpool_t *wp)
+{
+    pthread_mutex_lock (&wp->lock);
+    while (wp->todo || wp->running > 0)
+        pthread_cond_wait (&wp->done_cond, &wp->lock);
+    pthread_mutex_unlock (&wp->lock);
+}
+
+int workpool_count (workpool_t *wp)
+{
+    int count;
+
+    pthread_mutex_lock (&wp->lock);
+    count = wp->count;
+    pthread_mutex_unlock (&wp->lock);
+    return count;
+}
+
+int workpool_pollfd (workpool_t *wp)
+{
+    pthread_mutex_lock (&wp->lock);
+    if (wp->pollfd < 0)
+        wp->pollfd = eventfd (0, EFD_NONBLOCK);
+    pthread_mutex_unlock (&wp->lock);
+    return wp->pollfd;
+}
+
+void workpool_clear_event (workpool_t *wp)
+{
+    uint64_t val;
+
+    if (wp->pollfd >= 0) {
+        /* EAGAIN just means there were no events */
+        ssize_t n = read (wp->pollfd, &val, sizeof (val));
+        (void)n;
+    }
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,63 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_WORKPOOL_H
+#define _UTIL_WORKPOOL_H
+
+/* A fixed pool of worker threads that process submitted items and hand
+ * them back in the order they were submitted.
+ */
+
+typedef struct workpool workpool_t;
+
+/* Process 'item' in worker thread number 'worker' (0 to nthreads - 1).
+ * Runs concurrently with other workers, so it should touch only 'item'
+ * and per-worker state.
+ */
+typedef void (*workpool_work_f)(void *item, int worker, void *arg);
+
+/* Create/destroy pool with 'nthreads' worker threads.
+ * Destroy joins the threads; items not yet handed back are lost,
+ * so callers should use workpool_wait() first.
+ */
+workpool_t *workpool_create (int nthreads, workpool_work_f fun, void *arg);
+void workpool_destroy (workpool_t *wp);
+
+/* Queue 'item' for processing.
+ * Returns 0 on success, -1 on error with errno set.
+ */
+int workpool_submit (workpool_t *wp, void *item);
+
+/* Return the oldest submitted item if it has been processed.
+ * Returns NULL if no items are pending or the oldest is still in progress.
+ */
+void *workpool_next (workpool_t *wp);
+
+/* Block until all submitted items have been processed.
+ */
+void workpool_wait (workpool_t *wp);
+
+/* Number of items submitted but not yet returned by workpool_next().
+ */
+int workpool_count (workpool_t *wp);
+
+/* Obtain a file descriptor that becomes readable when items have been
+ * processed.  Call workpool_clear_event() before draining items with
+ * workpool_next() so a completion racing with the drain is not missed.
+ * Returns fd on success, -1 on error with errno set.
+ */
+int workpool_pollfd (workpool_t *wp);
+void workpool_clear_event (workpool_t *wp);
+
+#endif /* !_UTIL_WORKPOOL_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
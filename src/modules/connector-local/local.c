@@ -32,6 +32,7 @@
 #include "src/common/libutil/cleanup.h"
 #include "src/common/libutil/iterators.h"
 #include "src/common/libutil/fdutils.h"
+#include "src/common/libutil/subtrie.h"
 
 enum {
     DEBUG_AUTHFAIL_ONESHOT = 1, /* force auth to fail one time */
@@ -50,6 +51,7 @@ typedef struct {
     flux_reactor_t *reactor;
     uid_t instance_owner;
     zhash_t *subscriptions;
+    subtrie_t *subscribers;     /* client subscriptions, for event routing */
     zhash_t *services;
 } mod_local_ctx_t;
 
@@ -102,6 +104,7 @@ static void freectx (void *arg)
     if (ctx) {
         zlist_destroy (&ctx->clients);
         zhash_destroy (&ctx->subscriptions);
+        subtrie_destroy (ctx->subscribers);
         zhash_destroy (&ctx->services);
         free (ctx);
     }
@@ -127,6 +130,8 @@ static mod_local_ctx_t *getctx (flux_t *h)
             errno = ENOMEM;
             goto error;
         }
+        if (!(ctx->subscribers = subtrie_create ()))
+            goto error;
         if (!(ctx->services = zhash_new ())) {
             errno = ENOMEM;
             goto error;
@@ -437,6 +442,15 @@ done:
     return rc;
 }
 
+/* Drop client's entry in the event routing index, then the
+ * global subscription that backs it.
+ */
+static void client_sub_release (client_t *c, const char *topic)
+{
+    (void)subtrie_unsubscribe (c->ctx->subscribers, topic, c);
+    (void)global_unsubscribe (c->ctx, topic);
+}
+
 static int client_subscribe (client_t *c, const char *topic)
 {
     subscription_t *sub;
@@ -452,8 +466,17 @@ static int client_subscribe (client_t *c, const char *topic)
             subscription_destroy (sub);
             goto done;
         }
+        /* release only the global subscription if indexing fails */
         sub->unsubscribe = (unsubscribe_f) global_unsubscribe;
         sub->handle = c->ctx;
+        if (subtrie_subscribe (c->ctx->subscribers, topic, c) < 0) {
+            flux_log_error (c->ctx->h, "%s: subtrie_subscribe %s",
+                            __FUNCTION__, topic);
+            subscription_destroy (sub);
+            goto done;
+        }
+        sub->unsubscribe = (unsubscribe_f) client_sub_release;
+        sub->handle = c;
         zhash_update (c->subscriptions, topic, sub);
         zhash_freefn (c->subscriptions, topic, subscription_destroy);
         //flux_log (c->ctx->h, LOG_DEBUG, "%s: %s", __FUNCTION__, topic);
@@ -497,21 +520,6 @@ done:
     return rc;
 }
 
-static bool client_is_subscribed (client_t *c, const char *topic)
-{
-    subscription_t *sub;
-
-    if (zhash_lookup (c->subscriptions, topic))
-        return true;
-    sub = zhash_first (c->subscriptions);
-    while (sub) {
-        if (!strncmp (topic, sub->topic, strlen (sub->topic)))
-            return true;
-        sub = zhash_next (c->subscriptions);
-    }
-    return false;
-}
-
 static void local_service_destroy (struct local_service *ls)
 {
     if (ls == NULL)
@@ -1140,6 +1148,25 @@ done:
     flux_msg_destroy (cpy);
 }
 
+static void event_deliver_cb (void *subscriber, void *arg)
+{
+    client_t *c = subscriber;
+    const flux_msg_t *msg = arg;
+
+    if (!allowed_message (c, msg))
+        return;
+    if (client_send (c, msg) < 0) { /* FIXME handle errors */
+        int type = FLUX_MSGTYPE_ANY;
+        const char *topic = "unknown";
+        (void)flux_msg_get_type (msg, &type);
+        (void)flux_msg_get_topic (msg, &topic);
+        flux_log_error (c->ctx->h, "send %s %s to client %.*s",
+                        topic, flux_msg_typestr (type),
+                        5, zuuid_str (c->uuid));
+        errno = 0;
+    }
+}
+
 /* Received an event message from broker.
  * Find all subscribers and deliver.
  */
@@ -1147,30 +1174,17 @@ static void event_cb (flux_t *h, flux_msg_handler_t *mh,
                       const flux_msg_t *msg, void *arg)
 {
     mod_local_ctx_t *ctx = arg;
-    client_t *c;
     const char *topic;
-    int count = 0;
+    int count;
 
     if (flux_msg_get_topic (msg, &topic) < 0) {
         flux_log_error (h, "%s: dropped", __FUNCTION__);
         return;
     }
-    c = zlist_first (ctx->clients);
-    while (c) {
-        if (client_is_subscribed (c, topic) && allowed_message (c, msg)) {
-            if (client_send (c, msg) < 0) { /* FIXME handle errors */
-                int type = FLUX_MSGTYPE_ANY;
-                const char *topic = "unknown";
-                (void)flux_msg_get_type (msg, &type);
-                (void)flux_msg_get_topic (msg, &topic);
-                flux_log_error (h, "send %s %s to client %.*s",
-                                topic, flux_msg_typestr (type),
-                                5, zuuid_str (c->uuid));
-                errno = 0;
-            }
-            count++;
-        }
-        c = zlist_next (ctx->clients);
+    if ((count = subtrie_match (ctx->subscribers, topic,
+                                event_deliver_cb, (void *)msg)) < 0) {
+        flux_log_error (h, "%s: %s dropped", __FUNCTION__, topic);
+        return;
     }
     //flux_log (h, LOG_DEBUG, "%s: %s to %d clients", __FUNCTION__, topic, count);
 }
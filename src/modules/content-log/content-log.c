@@ -0,0 +1,1386 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* content-log.c - content addressable storage with append-only log back end
+ *
+ * Blobs are appended to a sequence of segment files, each record
+ * consisting of a header followed by the digest and the blob data:
+ *
+ *   magic (4) | digest length (4) | data length (4) | digest | data
+ *
+ * with integers in network byte order.  An in-memory index maps digest
+ * to segment and offset.  When the module is unloaded, the index is
+ * checkpointed to a file.  At startup, the checkpoint is used if it is
+ * consistent with the segments, otherwise the index is rebuilt by scanning
+ * the segments.  A partially written record at the end of the last segment
+ * (e.g. after a crash) is truncated.
+ *
+ * Stores are group committed:  records are accumulated in a write buffer
+ * and are written and synced to disk together, once per reactor loop
+ * iteration or when the buffer reaches 'commit-bytes', before store
+ * requests are responded to.
+ *
+ * Records that are not referenced by the index (duplicates or corrupt
+ * records found while scanning) are dead space.  Sealed segments whose
+ * dead space exceeds 'compact-threshold' percent are compacted in the
+ * background, a few records per timer tick, by copying live records
+ * to the active segment and then removing the old segment.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <arpa/inet.h>
+#include <czmq.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/blobref.h"
+#include "src/common/libutil/cleanup.h"
+#include "src/common/libutil/iterators.h"
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/read_all.h"
+
+#define RECORD_MAGIC        0x666c6f67  /* "flog" */
+#define RECORD_HEADER_SIZE  12
+#define CHECKPOINT_MAGIC    0x666c6978  /* "flix" */
+#define CHECKPOINT_VERSION  1
+#define COMPACT_BATCH       64  /* records copied per compaction step */
+
+static const uint32_t default_segment_size = 64*1024*1024;
+static const uint32_t default_commit_bytes = 4*1024*1024;
+static const uint32_t default_compact_threshold = 50; /* percent dead */
+static const double compact_interval = 1.; /* seconds between steps */
+
+struct segment {
+    uint32_t id;
+    int fd;
+    off_t size;                     /* bytes written to segment */
+    off_t live;                     /* bytes in records referenced by index */
+    bool nocompact;                 /* compaction failed, don't retry */
+};
+
+struct log_entry {
+    struct blobkey key;
+    uint32_t seg;                   /* segment id */
+    off_t offset;                   /* offset of record within segment */
+    uint32_t size;                  /* blob size */
+};
+
+struct store_request {
+    flux_msg_t *msg;
+    struct blobkey key;
+};
+
+typedef struct {
+    char *dir;
+    flux_t *h;
+    bool broker_shutdown;
+    const char *hashfun;
+    struct blobkey hashkey;         /* key template for configured hash */
+    uint32_t blob_size_limit;
+
+    uint32_t segment_size;
+    uint32_t commit_bytes;
+    uint32_t compact_threshold;
+    bool sync;
+
+    struct segment **segs;          /* indexed by segment id */
+    uint32_t nsegs;
+    struct segment *active;         /* segment being appended to */
+
+    zhashx_t *index;                /* blobkey => struct log_entry */
+
+    uint8_t *wbuf;                  /* records not yet written to active */
+    size_t wbuf_size;
+    size_t wbuf_used;
+    zlist_t *commit_entries;        /* index entries added since commit */
+    zlist_t *commit_requests;       /* store requests awaiting commit */
+
+    void *rbuf;
+    size_t rbuf_size;
+
+    struct segment *compact_seg;    /* segment being compacted, if any */
+    off_t compact_offset;
+    flux_watcher_t *compact_w;
+    flux_watcher_t *prep_w;
+    flux_watcher_t *check_w;
+    flux_watcher_t *idle_w;
+
+    /* stats */
+    int commit_count;
+    int commit_records;
+    int fsync_count;
+    int compact_count;
+    int64_t compact_bytes;
+} log_ctx_t;
+
+static int commit (log_ctx_t *ctx);
+
+static size_t record_size (const struct blobkey *key, uint32_t size)
+{
+    return RECORD_HEADER_SIZE + key->len + size;
+}
+
+static void store_request_destroy (struct store_request *sr)
+{
+    if (sr) {
+        int saved_errno = errno;
+        flux_msg_destroy (sr->msg);
+        free (sr);
+        errno = saved_errno;
+    }
+}
+
+static void segment_destroy (struct segment *seg)
+{
+    if (seg) {
+        int saved_errno = errno;
+        if (seg->fd >= 0)
+            (void)close (seg->fd);
+        free (seg);
+        errno = saved_errno;
+    }
+}
+
+static char *segment_path (log_ctx_t *ctx, uint32_t id)
+{
+    char *path;
+
+    if (asprintf (&path, "%s/seg.%08u", ctx->dir, (unsigned int)id) < 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return path;
+}
+
+/* Open segment 'id', creating it if 'create' is true, and add it to
+ * the segment table.
+ */
+static struct segment *segment_open (log_ctx_t *ctx, uint32_t id, bool create)
+{
+    struct segment *seg;
+    char *path = NULL;
+    struct stat sb;
+    int flags = O_RDWR | (create ? O_CREAT | O_EXCL : 0);
+
+    if (!(seg = calloc (1, sizeof (*seg)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    seg->id = id;
+    if (!(path = segment_path (ctx, id)))
+        goto error;
+    if ((seg->fd = open (path, flags, 0644)) < 0) {
+        flux_log_error (ctx->h, "open %s", path);
+        goto error;
+    }
+    if (fstat (seg->fd, &sb) < 0)
+        goto error;
+    seg->size = sb.st_size;
+    if (id >= ctx->nsegs) {
+        struct segment **segs;
+        if (!(segs = realloc (ctx->segs, (id + 1) * sizeof (segs[0])))) {
+            errno = ENOMEM;
+            goto error;
+        }
+        memset (&segs[ctx->nsegs], 0,
+                (id + 1 - ctx->nsegs) * sizeof (segs[0]));
+        ctx->segs = segs;
+        ctx->nsegs = id + 1;
+    }
+    assert (ctx->segs[id] == NULL);
+    ctx->segs[id] = seg;
+    free (path);
+    return seg;
+error:
+    free (path);
+    segment_destroy (seg);
+    return NULL;
+}
+
+/* Close and unlink segment, removing it from the segment table.
+ */
+static void segment_remove (log_ctx_t *ctx, struct segment *seg)
+{
+    char *path;
+
+    if ((path = segment_path (ctx, seg->id))) {
+        if (unlink (path) < 0)
+            flux_log_error (ctx->h, "unlink %s", path);
+        free (path);
+    }
+    ctx->segs[seg->id] = NULL;
+    segment_destroy (seg);
+}
+
+/* Seal the active segment and start a new one.
+ */
+static int segment_roll (log_ctx_t *ctx)
+{
+    struct segment *seg;
+
+    if (!(seg = segment_open (ctx, ctx->nsegs, true)))
+        return -1;
+    ctx->active = seg;
+    return 0;
+}
+
+static struct log_entry *index_lookup (log_ctx_t *ctx,
+                                       const struct blobkey *key)
+{
+    return zhashx_lookup (ctx->index, key);
+}
+
+static int index_insert (log_ctx_t *ctx, const struct blobkey *key,
+                         uint32_t seg, off_t offset, uint32_t size)
+{
+    struct log_entry *entry;
+
+    if (!(entry = calloc (1, sizeof (*entry)))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    entry->key = *key;
+    entry->seg = seg;
+    entry->offset = offset;
+    entry->size = size;
+    if (zhashx_insert (ctx->index, &entry->key, entry) < 0) {
+        free (entry);
+        errno = EEXIST;
+        return -1;
+    }
+    ctx->segs[seg]->live += record_size (key, size);
+    return 0;
+}
+
+static void index_remove (log_ctx_t *ctx, struct log_entry *entry)
+{
+    struct segment *seg = ctx->segs[entry->seg];
+
+    if (seg)
+        seg->live -= record_size (&entry->key, entry->size);
+    zhashx_delete (ctx->index, &entry->key);
+}
+
+static void log_entry_destructor (void **item)
+{
+    if (item) {
+        free (*item);
+        *item = NULL;
+    }
+}
+
+/* An entry is pending if its record is still in the write buffer.
+ */
+static bool entry_pending (log_ctx_t *ctx, struct log_entry *entry)
+{
+    return (entry->seg == ctx->active->id
+            && entry->offset >= ctx->active->size);
+}
+
+static int grow_buf (void **buf, size_t *bufsize, size_t size)
+{
+    size_t newsize = *bufsize ? *bufsize : 4096;
+    void *newbuf;
+
+    while (newsize < size)
+        newsize *= 2;
+    if (newsize > *bufsize) {
+        if (!(newbuf = realloc (*buf, newsize))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        *buf = newbuf;
+        *bufsize = newsize;
+    }
+    return 0;
+}
+
+/* Append a record to the write buffer, rolling to a new segment first
+ * if the record would not fit in the active one.  On success the
+ * segment id and offset of the new record are assigned.
+ */
+static int append_record (log_ctx_t *ctx, const struct blobkey *key,
+                          const void *data, uint32_t size,
+                          uint32_t *segp, off_t *offsetp)
+{
+    size_t reclen = record_size (key, size);
+    off_t end = ctx->active->size + ctx->wbuf_used;
+    uint32_t hdr[3];
+
+    if (end > 0 && end + reclen > ctx->segment_size) {
+        if (commit (ctx) < 0 || segment_roll (ctx) < 0)
+            return -1;
+        end = 0;
+    }
+    if (grow_buf ((void **)&ctx->wbuf, &ctx->wbuf_size,
+                  ctx->wbuf_used + reclen) < 0)
+        return -1;
+    hdr[0] = htonl (RECORD_MAGIC);
+    hdr[1] = htonl (key->len);
+    hdr[2] = htonl (size);
+    memcpy (ctx->wbuf + ctx->wbuf_used, hdr, RECORD_HEADER_SIZE);
+    memcpy (ctx->wbuf + ctx->wbuf_used + RECORD_HEADER_SIZE,
+            key->digest, key->len);
+    if (size > 0)
+        memcpy (ctx->wbuf + ctx->wbuf_used + RECORD_HEADER_SIZE + key->len,
+                data, size);
+    ctx->wbuf_used += reclen;
+    *segp = ctx->active->id;
+    *offsetp = end;
+    return 0;
+}
+
+/* Respond to store requests parked waiting for commit, with blobref
+ * on success, or errnum on failure.
+ */
+static void respond_store_requests (log_ctx_t *ctx, int errnum)
+{
+    struct store_request *sr;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+
+    while ((sr = zlist_pop (ctx->commit_requests))) {
+        int rc;
+        if (errnum == 0
+                && blobkey_tostr (&sr->key, blobref, sizeof (blobref)) == 0)
+            rc = flux_respond_raw (ctx->h, sr->msg, blobref,
+                                   strlen (blobref) + 1);
+        else
+            rc = flux_respond_error (ctx->h, sr->msg,
+                                     errnum ? errnum : errno, NULL);
+        if (rc < 0)
+            flux_log_error (ctx->h, "store: respond");
+        store_request_destroy (sr);
+    }
+}
+
+/* Write the write buffer to the active segment and sync it, then respond
+ * to parked store requests.  On failure, the segment is truncated back to
+ * its last committed size and the records added since the last commit
+ * are dropped from the index.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int commit (log_ctx_t *ctx)
+{
+    struct segment *seg = ctx->active;
+    struct log_entry *entry;
+    ssize_t n;
+    int saved_errno;
+
+    if (ctx->wbuf_used > 0) {
+        if ((n = pwrite (seg->fd, ctx->wbuf, ctx->wbuf_used, seg->size))
+                                                    != ctx->wbuf_used) {
+            if (n >= 0)
+                errno = ENOSPC;
+            flux_log_error (ctx->h, "commit: write segment %u", seg->id);
+            goto error;
+        }
+        if (ctx->sync) {
+            if (fdatasync (seg->fd) < 0) {
+                flux_log_error (ctx->h, "commit: fdatasync segment %u",
+                                seg->id);
+                goto error;
+            }
+            ctx->fsync_count++;
+        }
+        seg->size += ctx->wbuf_used;
+        ctx->wbuf_used = 0;
+        ctx->commit_count++;
+        ctx->commit_records += zlist_size (ctx->commit_entries);
+    }
+    zlist_purge (ctx->commit_entries);
+    respond_store_requests (ctx, 0);
+    return 0;
+error:
+    saved_errno = errno;
+    if (ftruncate (seg->fd, seg->size) < 0)
+        flux_log_error (ctx->h, "commit: truncate segment %u", seg->id);
+    while ((entry = zlist_pop (ctx->commit_entries))) {
+        if (entry_pending (ctx, entry))
+            index_remove (ctx, entry);
+    }
+    ctx->wbuf_used = 0;
+    respond_store_requests (ctx, saved_errno);
+    errno = saved_errno;
+    return -1;
+}
+
+/* Read blob data for entry into ctx->rbuf, committing first if the
+ * entry is still pending in the write buffer.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int read_entry (log_ctx_t *ctx, struct log_entry *entry,
+                       void **data)
+{
+    struct segment *seg;
+    off_t offset;
+    ssize_t n;
+
+    if (entry_pending (ctx, entry) && commit (ctx) < 0)
+        return -1;
+    if (!(seg = ctx->segs[entry->seg])) {
+        errno = EIO;
+        return -1;
+    }
+    if (grow_buf (&ctx->rbuf, &ctx->rbuf_size, entry->size) < 0)
+        return -1;
+    offset = entry->offset + RECORD_HEADER_SIZE + entry->key.len;
+    if ((n = pread (seg->fd, ctx->rbuf, entry->size, offset)) != entry->size) {
+        if (n >= 0)
+            errno = EIO;
+        flux_log_error (ctx->h, "read segment %u offset %ju",
+                        seg->id, (uintmax_t)offset);
+        return -1;
+    }
+    *data = ctx->rbuf;
+    return 0;
+}
+
+/* Reactor loop hooks for group commit.  If there are uncommitted records
+ * when the reactor is about to block, keep it from blocking so that
+ * the check callback runs and commits them after messages received in
+ * this loop iteration have been handled.
+ */
+static void commit_prep_cb (flux_reactor_t *r, flux_watcher_t *w,
+                            int revents, void *arg)
+{
+    log_ctx_t *ctx = arg;
+
+    if (ctx->wbuf_used > 0 || zlist_size (ctx->commit_requests) > 0)
+        flux_watcher_start (ctx->idle_w);
+}
+
+static void commit_check_cb (flux_reactor_t *r, flux_watcher_t *w,
+                             int revents, void *arg)
+{
+    log_ctx_t *ctx = arg;
+
+    flux_watcher_stop (ctx->idle_w);
+    if (ctx->wbuf_used > 0 || zlist_size (ctx->commit_requests) > 0)
+        (void)commit (ctx);
+}
+
+/* Scan segment, adding its records to the index.  Records whose digest
+ * does not match their data are skipped.  If a record is incomplete or
+ * its header is invalid, the rest of the segment cannot be parsed.
+ * The blob-size-limit is not applied here: it may have been larger
+ * when the records were stored, and only governs new stores.  In
+ * the last segment this is assumed to be the result of a partial write,
+ * and the segment is truncated there.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int scan_segment (log_ctx_t *ctx, struct segment *seg, bool last)
+{
+    off_t offset = 0;
+    int count = 0;
+
+    while (offset < seg->size) {
+        uint32_t hdr[3];
+        uint32_t digest_len, size;
+        struct blobkey key;
+        struct blobkey digest;
+        void *data;
+
+        if (seg->size - offset < RECORD_HEADER_SIZE
+                || pread (seg->fd, hdr, RECORD_HEADER_SIZE, offset)
+                                                    != RECORD_HEADER_SIZE)
+            goto bad_record;
+        digest_len = ntohl (hdr[1]);
+        size = ntohl (hdr[2]);
+        if (ntohl (hdr[0]) != RECORD_MAGIC
+                || digest_len == 0
+                || digest_len > BLOBREF_MAX_DIGEST_SIZE
+                || seg->size - offset - RECORD_HEADER_SIZE - digest_len
+                                                            < (off_t)size)
+            goto bad_record;
+        memset (&digest, 0, sizeof (digest));
+        if (pread (seg->fd, digest.digest, digest_len,
+                   offset + RECORD_HEADER_SIZE) != digest_len)
+            goto bad_record;
+        if (grow_buf (&ctx->rbuf, &ctx->rbuf_size, size) < 0)
+            return -1;
+        data = ctx->rbuf;
+        if (pread (seg->fd, data, size,
+                   offset + RECORD_HEADER_SIZE + digest_len) != size)
+            goto bad_record;
+        if (blobkey_hash (ctx->hashfun, data, size, &key) < 0)
+            return -1;
+        if (key.len != digest_len
+                        || memcmp (key.digest, digest.digest, key.len) != 0)
+            flux_log (ctx->h, LOG_ERR,
+                      "segment %u: skipping corrupt record at offset %ju",
+                      seg->id, (uintmax_t)offset);
+        else if (!index_lookup (ctx, &key)) {
+            if (index_insert (ctx, &key, seg->id, offset, size) < 0)
+                return -1;
+            count++;
+        }
+        offset += RECORD_HEADER_SIZE + digest_len + size;
+    }
+    flux_log (ctx->h, LOG_DEBUG, "segment %u: %d records", seg->id, count);
+    return 0;
+bad_record:
+    if (last) {
+        flux_log (ctx->h, LOG_ERR,
+                  "segment %u: truncating partial record at offset %ju",
+                  seg->id, (uintmax_t)offset);
+        if (ftruncate (seg->fd, offset) < 0) {
+            flux_log_error (ctx->h, "truncate segment %u", seg->id);
+            return -1;
+        }
+        seg->size = offset;
+    }
+    else
+        flux_log (ctx->h, LOG_ERR,
+                  "segment %u: ignoring invalid records from offset %ju",
+                  seg->id, (uintmax_t)offset);
+    return 0;
+}
+
+static int scan_segments (log_ctx_t *ctx)
+{
+    uint32_t id;
+
+    for (id = 0; id < ctx->nsegs; id++) {
+        if (ctx->segs[id]) {
+            if (scan_segment (ctx, ctx->segs[id], id == ctx->nsegs - 1) < 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/* Checkpoint file format, integers in network byte order:
+ *   magic (4) | version (4) | nsegs (4) | nentries (4)
+ *   nsegs * [ id (4) | size (8) ]
+ *   nentries * [ type (1) | len (1) | digest (len) | seg (4) | offset (8)
+ *                | size (4) ]
+ * The checkpoint is only valid if each listed segment exists with
+ * exactly the recorded size.
+ */
+
+static void put32 (uint8_t **p, uint32_t val)
+{
+    val = htonl (val);
+    memcpy (*p, &val, 4);
+    *p += 4;
+}
+
+static void put64 (uint8_t **p, uint64_t val)
+{
+    put32 (p, val >> 32);
+    put32 (p, val & 0xffffffff);
+}
+
+static int get32 (uint8_t **p, uint8_t *end, uint32_t *val)
+{
+    if (end - *p < 4)
+        return -1;
+    memcpy (val, *p, 4);
+    *val = ntohl (*val);
+    *p += 4;
+    return 0;
+}
+
+static int get64 (uint8_t **p, uint8_t *end, uint64_t *val)
+{
+    uint32_t hi, lo;
+
+    if (get32 (p, end, &hi) < 0 || get32 (p, end, &lo) < 0)
+        return -1;
+    *val = ((uint64_t)hi << 32) | lo;
+    return 0;
+}
+
+static char *checkpoint_path (log_ctx_t *ctx)
+{
+    char *path;
+
+    if (asprintf (&path, "%s/index", ctx->dir) < 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return path;
+}
+
+static int checkpoint_write (log_ctx_t *ctx)
+{
+    char *path = NULL;
+    char *tmp = NULL;
+    uint8_t *buf = NULL, *p;
+    size_t len;
+    uint32_t nsegs = 0;
+    struct log_entry *entry;
+    const struct blobkey *key;
+    uint32_t id;
+    int fd = -1;
+    int rc = -1;
+
+    for (id = 0; id < ctx->nsegs; id++) {
+        if (ctx->segs[id])
+            nsegs++;
+    }
+    len = 16 + nsegs * 12 + zhashx_size (ctx->index)
+                                        * (2 + BLOBREF_MAX_DIGEST_SIZE + 16);
+    if (!(buf = malloc (len))) {
+        errno = ENOMEM;
+        goto done;
+    }
+    p = buf;
+    put32 (&p, CHECKPOINT_MAGIC);
+    put32 (&p, CHECKPOINT_VERSION);
+    put32 (&p, nsegs);
+    put32 (&p, zhashx_size (ctx->index));
+    for (id = 0; id < ctx->nsegs; id++) {
+        if (ctx->segs[id]) {
+            put32 (&p, id);
+            put64 (&p, ctx->segs[id]->size);
+        }
+    }
+    FOREACH_ZHASHX (ctx->index, key, entry) {
+        *p++ = entry->key.type;
+        *p++ = entry->key.len;
+        memcpy (p, entry->key.digest, entry->key.len);
+        p += entry->key.len;
+        put32 (&p, entry->seg);
+        put64 (&p, entry->offset);
+        put32 (&p, entry->size);
+    }
+    if (!(path = checkpoint_path (ctx)))
+        goto done;
+    if (asprintf (&tmp, "%s.tmp", path) < 0) {
+        errno = ENOMEM;
+        goto done;
+    }
+    if ((fd = open (tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0
+            || write_all (fd, buf, p - buf) < 0
+            || fdatasync (fd) < 0
+            || close (fd) < 0) {
+        flux_log_error (ctx->h, "write %s", tmp);
+        if (fd >= 0)
+            (void)close (fd);
+        (void)unlink (tmp);
+        goto done;
+    }
+    if (rename (tmp, path) < 0) {
+        flux_log_error (ctx->h, "rename %s", tmp);
+        (void)unlink (tmp);
+        goto done;
+    }
+    rc = 0;
+done:
+    free (tmp);
+    free (path);
+    free (buf);
+    return rc;
+}
+
+/* Load index from checkpoint file, then remove the file, so that if
+ * the module terminates without writing a new checkpoint, the index
+ * is rebuilt from the segments next time.
+ * Returns 0 on success, -1 if checkpoint is missing or inconsistent.
+ */
+static int checkpoint_read (log_ctx_t *ctx)
+{
+    char *path;
+    void *buf = NULL;
+    uint8_t *p, *end;
+    ssize_t len;
+    uint32_t magic, version, nsegs, nentries, i;
+    int fd;
+    int rc = -1;
+
+    if (!(path = checkpoint_path (ctx)))
+        return -1;
+    if ((fd = open (path, O_RDONLY)) < 0)
+        goto done;
+    len = read_all (fd, &buf);
+    (void)close (fd);
+    (void)unlink (path);
+    if (len < 0)
+        goto done;
+    p = buf;
+    end = p + len;
+    if (get32 (&p, end, &magic) < 0 || magic != CHECKPOINT_MAGIC
+            || get32 (&p, end, &version) < 0
+            || version != CHECKPOINT_VERSION
+            || get32 (&p, end, &nsegs) < 0
+            || get32 (&p, end, &nentries) < 0)
+        goto invalid;
+    for (i = 0; i < nsegs; i++) {
+        uint32_t id;
+        uint64_t size;
+        if (get32 (&p, end, &id) < 0 || get64 (&p, end, &size) < 0)
+            goto invalid;
+        if (id >= ctx->nsegs || !ctx->segs[id] || ctx->segs[id]->size != size)
+            goto invalid;
+    }
+    for (i = 0; i < ctx->nsegs; i++) {
+        if (ctx->segs[i])
+            nsegs--;
+    }
+    if (nsegs != 0)
+        goto invalid;
+    for (i = 0; i < nentries; i++) {
+        struct blobkey key;
+        uint32_t seg, size;
+        uint64_t offset;
+
+        memset (&key, 0, sizeof (key));
+        if (end - p < 2)
+            goto invalid;
+        key.type = *p++;
+        key.len = *p++;
+        if (key.len > BLOBREF_MAX_DIGEST_SIZE || end - p < key.len)
+            goto invalid;
+        memcpy (key.digest, p, key.len);
+        p += key.len;
+        if (get32 (&p, end, &seg) < 0
+                || get64 (&p, end, &offset) < 0
+                || get32 (&p, end, &size) < 0)
+            goto invalid;
+        if (seg >= ctx->nsegs || !ctx->segs[seg]
+                || offset + record_size (&key, size) > ctx->segs[seg]->size
+                || index_insert (ctx, &key, seg, offset, size) < 0)
+            goto invalid;
+    }
+    flux_log (ctx->h, LOG_DEBUG, "index checkpoint: %u entries", nentries);
+    rc = 0;
+    goto done;
+invalid:
+    flux_log (ctx->h, LOG_ERR, "index checkpoint is invalid, rebuilding");
+    zhashx_purge (ctx->index);
+    for (i = 0; i < ctx->nsegs; i++) {
+        if (ctx->segs[i])
+            ctx->segs[i]->live = 0;
+    }
+done:
+    free (buf);
+    free (path);
+    return rc;
+}
+
+/* Open existing segments in ctx->dir and create the active segment
+ * if there are none.  The active segment is always the one with the
+ * highest id.
+ */
+static int open_segments (log_ctx_t *ctx)
+{
+    DIR *dir;
+    struct dirent *dent;
+    zlist_t *ids = NULL;
+    uint32_t *id;
+    int rc = -1;
+
+    if (!(dir = opendir (ctx->dir))) {
+        flux_log_error (ctx->h, "opendir %s", ctx->dir);
+        return -1;
+    }
+    if (!(ids = zlist_new ())) {
+        errno = ENOMEM;
+        goto done;
+    }
+    while ((dent = readdir (dir))) {
+        unsigned int n;
+        char c;
+        if (sscanf (dent->d_name, "seg.%u%c", &n, &c) != 1)
+            continue;
+        if (!(id = malloc (sizeof (*id)))) {
+            errno = ENOMEM;
+            goto done;
+        }
+        *id = n;
+        if (zlist_append (ids, id) < 0) {
+            free (id);
+            errno = ENOMEM;
+            goto done;
+        }
+        zlist_freefn (ids, id, free, true);
+    }
+    while ((id = zlist_pop (ids))) {
+        struct segment *seg = segment_open (ctx, *id, false);
+        free (id);
+        if (!seg)
+            goto done;
+    }
+    if (ctx->nsegs > 0)
+        ctx->active = ctx->segs[ctx->nsegs - 1];
+    else if (segment_roll (ctx) < 0)
+        goto done;
+    rc = 0;
+done:
+    zlist_destroy (&ids);
+    (void)closedir (dir);
+    return rc;
+}
+
+/* Background compaction
+ */
+
+static struct segment *compact_select (log_ctx_t *ctx)
+{
+    uint32_t id;
+
+    for (id = 0; id < ctx->nsegs; id++) {
+        struct segment *seg = ctx->segs[id];
+        if (seg && seg != ctx->active && seg->size > 0 && !seg->nocompact
+                && (seg->size - seg->live) * 100
+                                    >= seg->size * ctx->compact_threshold)
+            return seg;
+    }
+    return NULL;
+}
+
+/* Copy up to 'COMPACT_BATCH' live records from the segment being compacted
+ * to the active segment.  Index entries are updated only once the copies
+ * are committed.  Once all live records have been copied, remove the
+ * segment.
+ */
+static int compact_step (log_ctx_t *ctx)
+{
+    struct segment *seg;
+    struct {
+        struct log_entry *entry;
+        uint32_t seg;
+        off_t offset;
+    } moves[COMPACT_BATCH];
+    int count = 0;
+    int i;
+
+    if (!ctx->compact_seg) {
+        if (!(ctx->compact_seg = compact_select (ctx)))
+            return 0;
+        ctx->compact_offset = 0;
+        flux_log (ctx->h, LOG_DEBUG, "compact: segment %u (%ju/%ju live)",
+                  ctx->compact_seg->id, (uintmax_t)ctx->compact_seg->live,
+                  (uintmax_t)ctx->compact_seg->size);
+    }
+    seg = ctx->compact_seg;
+    while (ctx->compact_offset < seg->size && count < COMPACT_BATCH) {
+        uint32_t hdr[3];
+        uint32_t digest_len, size;
+        struct blobkey key = ctx->hashkey;
+        struct log_entry *entry;
+        off_t offset = ctx->compact_offset;
+
+        if (pread (seg->fd, hdr, RECORD_HEADER_SIZE, offset)
+                                                    != RECORD_HEADER_SIZE
+                || ntohl (hdr[0]) != RECORD_MAGIC
+                || (digest_len = ntohl (hdr[1])) != key.len) {
+            ctx->compact_offset = seg->size;
+            break;
+        }
+        size = ntohl (hdr[2]);
+        if (pread (seg->fd, key.digest, digest_len,
+                   offset + RECORD_HEADER_SIZE) != digest_len) {
+            ctx->compact_offset = seg->size;
+            break;
+        }
+        ctx->compact_offset += RECORD_HEADER_SIZE + digest_len + (off_t)size;
+        if ((entry = index_lookup (ctx, &key))
+                && entry->seg == seg->id && entry->offset == offset) {
+            void *data;
+
+            if (read_entry (ctx, entry, &data) < 0
+                    || append_record (ctx, &key, data, size,
+                                      &moves[count].seg,
+                                      &moves[count].offset) < 0)
+                return -1;
+            moves[count++].entry = entry;
+        }
+    }
+    if (commit (ctx) < 0)
+        return -1;
+    for (i = 0; i < count; i++) {
+        struct log_entry *entry = moves[i].entry;
+        size_t reclen = record_size (&entry->key, entry->size);
+
+        seg->live -= reclen;
+        entry->seg = moves[i].seg;
+        entry->offset = moves[i].offset;
+        ctx->segs[entry->seg]->live += reclen;
+        ctx->compact_bytes += reclen;
+    }
+    if (ctx->compact_offset >= seg->size) {
+        if (seg->live > 0) {
+            flux_log (ctx->h, LOG_ERR,
+                      "compact: segment %u: live records could not be read",
+                      seg->id);
+            seg->nocompact = true;
+        }
+        else {
+            flux_log (ctx->h, LOG_DEBUG, "compact: removing segment %u",
+                      seg->id);
+            segment_remove (ctx, seg);
+            ctx->compact_count++;
+        }
+        ctx->compact_seg = NULL;
+    }
+    return 0;
+}
+
+static void compact_timer_cb (flux_reactor_t *r, flux_watcher_t *w,
+                              int revents, void *arg)
+{
+    log_ctx_t *ctx = arg;
+
+    if (compact_step (ctx) < 0) {
+        flux_log_error (ctx->h, "compact");
+        ctx->compact_seg = NULL;
+    }
+}
+
+static void freectx (void *arg)
+{
+    log_ctx_t *ctx = arg;
+    if (ctx) {
+        int saved_errno = errno;
+        uint32_t id;
+        flux_watcher_destroy (ctx->prep_w);
+        flux_watcher_destroy (ctx->check_w);
+        flux_watcher_destroy (ctx->idle_w);
+        flux_watcher_destroy (ctx->compact_w);
+        if (ctx->commit_requests) {
+            struct store_request *sr;
+            while ((sr = zlist_pop (ctx->commit_requests)))
+                store_request_destroy (sr);
+            zlist_destroy (&ctx->commit_requests);
+        }
+        zlist_destroy (&ctx->commit_entries);
+        zhashx_destroy (&ctx->index);
+        for (id = 0; id < ctx->nsegs; id++)
+            segment_destroy (ctx->segs[id]);
+        free (ctx->segs);
+        free (ctx->wbuf);
+        free (ctx->rbuf);
+        free (ctx->dir);
+        free (ctx);
+        errno = saved_errno;
+    }
+}
+
+static log_ctx_t *getctx (flux_t *h)
+{
+    log_ctx_t *ctx = (log_ctx_t *)flux_aux_get (h, "flux::content-log");
+    flux_reactor_t *r = flux_get_reactor (h);
+    const char *dir;
+    const char *tmp;
+    char *path = NULL;
+    bool cleanup = false;
+
+    if (!ctx) {
+        if (!(ctx = calloc (1, sizeof (*ctx))))
+            goto error;
+        ctx->h = h;
+        ctx->segment_size = default_segment_size;
+        ctx->commit_bytes = default_commit_bytes;
+        ctx->compact_threshold = default_compact_threshold;
+        ctx->sync = true;
+        if (!(ctx->index = zhashx_new ()))
+            goto nomem;
+        zhashx_set_key_hasher (ctx->index, blobkey_hasher);
+        zhashx_set_key_comparator (ctx->index, blobkey_cmp);
+        zhashx_set_key_duplicator (ctx->index, NULL);
+        zhashx_set_key_destructor (ctx->index, NULL);
+        zhashx_set_destructor (ctx->index, log_entry_destructor);
+        if (!(ctx->commit_entries = zlist_new ())
+                            || !(ctx->commit_requests = zlist_new ()))
+            goto nomem;
+        if (!(ctx->hashfun = flux_attr_get (h, "content.hash"))) {
+            flux_log_error (h, "content.hash");
+            goto error;
+        }
+        if (blobkey_hash (ctx->hashfun, NULL, 0, &ctx->hashkey) < 0) {
+            flux_log_error (h, "content.hash %s", ctx->hashfun);
+            goto error;
+        }
+        if (!(tmp = flux_attr_get (h, "content.blob-size-limit"))) {
+            flux_log_error (h, "content.blob-size-limit");
+            goto error;
+        }
+        ctx->blob_size_limit = strtoul (tmp, NULL, 10);
+
+        if (!(dir = flux_attr_get (h, "persist-directory"))) {
+            if (!(dir = flux_attr_get (h, "broker.rundir"))) {
+                flux_log_error (h, "broker.rundir");
+                goto error;
+            }
+            cleanup = true;
+        }
+        if (asprintf (&path, "%s/content", dir) < 0)
+            goto nomem;
+        if (mkdir (path, 0755) < 0 && errno != EEXIST) {
+            flux_log_error (h, "mkdir %s", path);
+            goto error;
+        }
+        if (cleanup)
+            cleanup_push_string (cleanup_directory_recursive, path);
+        if (asprintf (&ctx->dir, "%s/log", path) < 0)
+            goto nomem;
+        if (mkdir (ctx->dir, 0755) < 0 && errno != EEXIST) {
+            flux_log_error (h, "mkdir %s", ctx->dir);
+            goto error;
+        }
+        if (!(ctx->prep_w = flux_prepare_watcher_create (r, commit_prep_cb,
+                                                         ctx))
+                || !(ctx->check_w = flux_check_watcher_create (r,
+                                                               commit_check_cb,
+                                                               ctx))
+                || !(ctx->idle_w = flux_idle_watcher_create (r, NULL, NULL))
+                || !(ctx->compact_w = flux_timer_watcher_create (r,
+                                                        compact_interval,
+                                                        compact_interval,
+                                                        compact_timer_cb,
+                                                        ctx)))
+            goto error;
+        if (flux_aux_set (h, "flux::content-log", ctx, freectx) < 0)
+            goto error;
+        free (path);
+    }
+    return ctx;
+nomem:
+    errno = ENOMEM;
+error:
+    free (path);
+    freectx (ctx);
+    return NULL;
+}
+
+/* Open segments and build the index, from checkpoint if possible.
+ */
+static int log_open (log_ctx_t *ctx)
+{
+    if (open_segments (ctx) < 0)
+        return -1;
+    if (checkpoint_read (ctx) < 0) {
+        if (scan_segments (ctx) < 0) {
+            flux_log_error (ctx->h, "scanning segments");
+            return -1;
+        }
+    }
+    flux_log (ctx->h, LOG_DEBUG, "%zu blobs in %u segments",
+              zhashx_size (ctx->index), ctx->nsegs);
+    return 0;
+}
+
+void load_cb (flux_t *h, flux_msg_handler_t *mh,
+              const flux_msg_t *msg, void *arg)
+{
+    log_ctx_t *ctx = arg;
+    const char *blobref = "-";
+    int blobref_size;
+    struct blobkey key;
+    struct log_entry *entry;
+    void *data = NULL;
+    int size = 0;
+    int rc = -1;
+
+    if (flux_request_decode_raw (msg, NULL, (const void **)&blobref,
+                                 &blobref_size) < 0) {
+        flux_log_error (h, "load: request decode failed");
+        goto done;
+    }
+    if (!blobref || blobref[blobref_size - 1] != '\0') {
+        errno = EPROTO;
+        flux_log_error (h, "load: malformed blobref");
+        goto done;
+    }
+    if (blobkey_fromstr (&key, blobref) < 0) {
+        errno = ENOENT;
+        flux_log_error (h, "load: unexpected foreign blobref");
+        goto done;
+    }
+    if (!(entry = index_lookup (ctx, &key))) {
+        errno = ENOENT;
+        goto done;
+    }
+    if (read_entry (ctx, entry, &data) < 0)
+        goto done;
+    size = entry->size;
+    rc = 0;
+done:
+    if (rc < 0) {
+        if (flux_respond_error (h, msg, errno, NULL) < 0)
+            flux_log_error (h, "load: flux_respond_error");
+    }
+    else {
+        if (flux_respond_raw (h, msg, data, size) < 0)
+            flux_log_error (h, "load: flux_respond_raw");
+    }
+}
+
+/* Append blob to the log, unless already present, and park the request
+ * until the next commit.  If the blob is already committed, respond
+ * immediately.
+ */
+void store_cb (flux_t *h, flux_msg_handler_t *mh,
+               const flux_msg_t *msg, void *arg)
+{
+    log_ctx_t *ctx = arg;
+    const void *data;
+    int size;
+    struct store_request *sr = NULL;
+    struct log_entry *entry;
+    uint32_t seg;
+    off_t offset;
+
+    if (flux_request_decode_raw (msg, NULL, &data, &size) < 0) {
+        flux_log_error (h, "store: request decode failed");
+        goto error;
+    }
+    if (size > ctx->blob_size_limit) {
+        errno = EFBIG;
+        goto error;
+    }
+    if (!(sr = calloc (1, sizeof (*sr)))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (blobkey_hash (ctx->hashfun, data, size, &sr->key) < 0)
+        goto error;
+    if ((entry = index_lookup (ctx, &sr->key))) {
+        if (!entry_pending (ctx, entry)) {
+            char blobref[BLOBREF_MAX_STRING_SIZE];
+
+            if (blobkey_tostr (&sr->key, blobref, sizeof (blobref)) < 0)
+                goto error;
+            if (flux_respond_raw (h, msg, blobref, strlen (blobref) + 1) < 0)
+                flux_log_error (h, "store: flux_respond_raw");
+            store_request_destroy (sr);
+            return;
+        }
+    }
+    else {
+        if (append_record (ctx, &sr->key, data, size, &seg, &offset) < 0
+                || index_insert (ctx, &sr->key, seg, offset, size) < 0)
+            goto error;
+        entry = index_lookup (ctx, &sr->key);
+        if (zlist_append (ctx->commit_entries, entry) < 0) {
+            index_remove (ctx, entry);
+            errno = ENOMEM;
+            goto error;
+        }
+    }
+    if (!(sr->msg = flux_msg_copy (msg, false)))
+        goto error;
+    if (zlist_append (ctx->commit_requests, sr) < 0) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (ctx->wbuf_used >= ctx->commit_bytes)
+        (void)commit (ctx);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "store: flux_respond_error");
+    store_request_destroy (sr);
+}
+
+void stats_cb (flux_t *h, flux_msg_handler_t *mh,
+               const flux_msg_t *msg, void *arg)
+{
+    log_ctx_t *ctx = arg;
+    int64_t size = 0;
+    int64_t live = 0;
+    int nsegs = 0;
+    uint32_t id;
+
+    for (id = 0; id < ctx->nsegs; id++) {
+        if (ctx->segs[id]) {
+            size += ctx->segs[id]->size;
+            live += ctx->segs[id]->live;
+            nsegs++;
+        }
+    }
+    if (flux_respond_pack (h, msg,
+                           "{ s:i s:i s:I s:I s:i s:i s:i s:i s:I }",
+                           "count", (int)zhashx_size (ctx->index),
+                           "segments", nsegs,
+                           "size", (json_int_t)size,
+                           "live", (json_int_t)live,
+                           "commits", ctx->commit_count,
+                           "commit-records", ctx->commit_records,
+                           "fsyncs", ctx->fsync_count,
+                           "compactions", ctx->compact_count,
+                           "compact-bytes", (json_int_t)ctx->compact_bytes) < 0)
+        flux_log_error (h, "stats: flux_respond_pack");
+}
+
+int register_backing_store (flux_t *h, bool value, const char *name)
+{
+    flux_future_t *f;
+    int saved_errno = 0;
+    int rc = -1;
+
+    if (!(f = flux_rpc_pack (h, "content.backing", FLUX_NODEID_ANY, 0,
+                             "{ s:b s:s }",
+                             "backing", value,
+                             "name", name)))
+        goto done;
+    if (flux_future_get (f, NULL) < 0)
+        goto done;
+    rc = 0;
+done:
+    saved_errno = errno;
+    flux_future_destroy (f);
+    errno = saved_errno;
+    return rc;
+}
+
+int register_content_backing_service (flux_t *h)
+{
+    int rc, saved_errno;
+    flux_future_t *f;
+    if (!(f = flux_service_register (h, "content-backing")))
+        return -1;
+    rc = flux_future_get (f, NULL);
+    saved_errno = errno;
+    flux_future_destroy (f);
+    errno = saved_errno;
+    return rc;
+}
+
+/* Intercept broker shutdown event.  If broker is shutting down,
+ * avoid transferring data back to the content cache at unload time.
+ */
+void broker_shutdown_cb (flux_t *h, flux_msg_handler_t *mh,
+                         const flux_msg_t *msg, void *arg)
+{
+    log_ctx_t *ctx = arg;
+    ctx->broker_shutdown = true;
+    flux_log (h, LOG_DEBUG, "broker shutdown in progress");
+}
+
+/* Manage shutdown of this module.
+ * Tell content cache to disable backing store,
+ * then write everything back to it before exiting.
+ * Finally, checkpoint the index.
+ */
+void shutdown_cb (flux_t *h, flux_msg_handler_t *mh,
+                  const flux_msg_t *msg, void *arg)
+{
+    log_ctx_t *ctx = arg;
+    struct log_entry *entry;
+    const struct blobkey *key;
+    flux_future_t *f;
+    int count = 0;
+
+    flux_log (h, LOG_DEBUG, "shutdown: begin");
+    if (commit (ctx) < 0)
+        flux_log_error (h, "shutdown: commit");
+    if (register_backing_store (h, false, "content-log") < 0) {
+        flux_log_error (h, "shutdown: unregistering backing store");
+        goto done;
+    }
+    if (ctx->broker_shutdown) {
+        flux_log (h, LOG_DEBUG, "shutdown: instance is terminating, don't reload to cache");
+        goto done;
+    }
+    FOREACH_ZHASHX (ctx->index, key, entry) {
+        void *data;
+        if (read_entry (ctx, entry, &data) < 0) {
+            flux_log_error (h, "shutdown: read");
+            continue;
+        }
+        if (!(f = flux_content_store (h, data, entry->size, 0))) {
+            flux_log_error (h, "shutdown: store");
+            continue;
+        }
+        if (flux_content_store_get (f, NULL) < 0) {
+            flux_log_error (h, "shutdown: store");
+            flux_future_destroy (f);
+            continue;
+        }
+        flux_future_destroy (f);
+        count++;
+    }
+    flux_log (h, LOG_DEBUG, "shutdown: %d entries returned to cache", count);
+done:
+    if (checkpoint_write (ctx) < 0)
+        flux_log_error (h, "shutdown: writing index checkpoint");
+    flux_reactor_stop (flux_get_reactor (h));
+}
+
+static const struct flux_msg_handler_spec htab[] = {
+    { FLUX_MSGTYPE_REQUEST, "content-backing.load",    load_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-backing.store",   store_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-log.stats.get",   stats_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-log.shutdown",    shutdown_cb, 0, },
+    { FLUX_MSGTYPE_EVENT,   "shutdown",                broker_shutdown_cb, 0 },
+    FLUX_MSGHANDLER_TABLE_END,
+};
+
+static void process_args (log_ctx_t *ctx, int ac, char **av)
+{
+    int i;
+
+    for (i = 0; i < ac; i++) {
+        if (strncmp (av[i], "segment-size=", 13) == 0)
+            ctx->segment_size = strtoul (av[i]+13, NULL, 10);
+        else if (strncmp (av[i], "commit-bytes=", 13) == 0)
+            ctx->commit_bytes = strtoul (av[i]+13, NULL, 10);
+        else if (strncmp (av[i], "compact-threshold=", 18) == 0)
+            ctx->compact_threshold = strtoul (av[i]+18, NULL, 10);
+        else if (strncmp (av[i], "sync=", 5) == 0)
+            ctx->sync = strtoul (av[i]+5, NULL, 10) != 0;
+        else
+            flux_log (ctx->h, LOG_ERR, "Unknown option `%s'", av[i]);
+    }
+}
+
+int mod_main (flux_t *h, int argc, char **argv)
+{
+    flux_msg_handler_t **handlers = NULL;
+    log_ctx_t *ctx = getctx (h);
+    if (!ctx)
+        goto done;
+    process_args (ctx, argc, argv);
+    if (log_open (ctx) < 0)
+        goto done;
+    flux_watcher_start (ctx->prep_w);
+    flux_watcher_start (ctx->check_w);
+    if (ctx->compact_threshold > 0 && ctx->compact_threshold <= 100)
+        flux_watcher_start (ctx->compact_w);
+    if (flux_event_subscribe (h, "shutdown") < 0) {
+        flux_log_error (h, "flux_event_subscribe");
+        goto done;
+    }
+    if (flux_msg_handler_addvec (h, htab, ctx, &handlers) < 0) {
+        flux_log_error (h, "flux_msg_handler_addvec");
+        goto done;
+    }
+    if (register_backing_store (h, true, "content-log") < 0) {
+        flux_log_error (h, "registering backing store");
+        goto done;
+    }
+    if (register_content_backing_service (h) < 0) {
+        flux_log_error (h, "service.add: content-backing");
+        goto done;
+    }
+    if (flux_reactor_run (flux_get_reactor (h), 0) < 0) {
+        flux_log_error (h, "flux_reactor_run");
+        goto done;
+    }
+done:
+    flux_msg_handler_delvec (handlers);
+    return 0;
+}
+
+MOD_NAME ("content-log");
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -16,40 +16,172 @@
 #include <sqlite3.h>
 #include <czmq.h>
 #include <lz4.h>
+#if HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+#include <jansson.h>
 #include <flux/core.h>
 
 #include "src/common/libutil/blobref.h"
 #include "src/common/libutil/cleanup.h"
 #include "src/common/libutil/log.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/workpool.h"
 
-const size_t lzo_buf_chunksize = 1024*1024;
-const size_t compression_threshold = 256; /* compress blobs >= this size */
+const size_t buf_chunksize = 1024*1024;
 
+/* The codec column records how each object was compressed.  Rows written
+ * before the column existed have a NULL codec, and are lz4 compressed
+ * if size (the uncompressed size) is not -1.  A size of -1 always means
+ * the object is stored uncompressed.
+ */
 const char *sql_create_table = "CREATE TABLE if not exists objects("
                                "  hash CHAR(20) PRIMARY KEY,"
                                "  size INT,"
-                               "  object BLOB"
+                               "  object BLOB,"
+                               "  codec INT"
                                ");";
-const char *sql_load = "SELECT object,size FROM objects"
+const char *sql_add_codec = "ALTER TABLE objects ADD COLUMN codec INT";
+const char *sql_load = "SELECT object,size,codec FROM objects"
                        "  WHERE hash = ?1 LIMIT 1";
-const char *sql_store = "INSERT INTO objects (hash,size,object) "
-                        "  values (?1, ?2, ?3)";
-const char *sql_dump = "SELECT object,size FROM objects";
+const char *sql_store = "INSERT INTO objects (hash,size,object,codec) "
+                        "  values (?1, ?2, ?3, ?4)";
+const char *sql_dump = "SELECT object,size,codec FROM objects";
+const char *sql_sample = "SELECT object,size,codec FROM objects"
+                         "  ORDER BY rowid DESC LIMIT ?1";
+
+/* zstd dictionaries are versioned by rowid.  Objects compressed with a
+ * dictionary are decompressed with the one whose id matches the id
+ * recorded in the zstd frame header.
+ */
+const char *sql_create_dict_table = "CREATE TABLE if not exists dictionaries("
+                                    "  version INTEGER PRIMARY KEY,"
+                                    "  id INT UNIQUE,"
+                                    "  dict BLOB"
+                                    ");";
+const char *sql_dict_load = "SELECT dict FROM dictionaries"
+                            "  WHERE id = ?1 LIMIT 1";
+const char *sql_dict_latest = "SELECT version,id,dict FROM dictionaries"
+                              "  ORDER BY version DESC LIMIT 1";
+const char *sql_dict_store = "INSERT INTO dictionaries (id,dict) "
+                             "  values (?1, ?2)";
+
+enum {
+    CODEC_NONE = 0,
+    CODEC_LZ4 = 1,
+    CODEC_ZSTD = 2,
+    CODEC_ZSTD_DICT = 3,
+};
+
+#if HAVE_ZSTD
+const int default_dict_samples = 1024;
+const int default_dict_size = 112640;
+const int dict_sample_size_limit = 65536;
+const int dict_min_samples = 16;
+#endif
+
+/* Stores are grouped into a transaction which is committed after
+ * batch_limit stores, or batch_timeout seconds after the first store.
+ * Responses are deferred until the transaction is committed.
+ */
+const int default_batch_limit = 256;
+const double default_batch_timeout = 0.001;
+
+/* A store request is hashed and compressed (prepared), then inserted
+ * into the current batch.  With workers=N, preparation runs in a pool of
+ * worker threads, and requests are inserted in the order they arrived.
+ */
+struct store_request {
+    flux_msg_t *msg;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+    uint8_t hash[BLOBREF_MAX_DIGEST_SIZE];
+    int hash_len;
+    const void *data;           /* object to insert */
+    int size;
+    int uncompressed_size;      /* -1 if not compressed */
+    int codec_id;
+    void *cbuf;                 /* compressed copy owned by request */
+    bool compress_tried;
+    double compress_time;       /* msec */
+    int errnum;
+};
 
-typedef struct {
+/* Buffer and compression context for one thread.
+ */
+struct codec_state {
+    void *buf;
+    size_t bufsize;
+#if HAVE_ZSTD
+    ZSTD_CCtx *zcctx;
+#endif
+};
+
+typedef struct sqlite_ctx sqlite_ctx_t;
+
+/* Compress 'size' bytes of 'data' into cs->buf, returning the
+ * compressed size, or -1 on failure.  Compression may run in a worker
+ * thread, so it must not use the flux handle.  Decompress 'size' bytes
+ * of 'data' into ctx->cs.buf, which must produce exactly
+ * 'uncompressed_size' bytes.
+ */
+struct codec {
+    const char *name;
+    int id;
+    int threshold;      /* by default, compress blobs >= this size */
+    int (*compress) (sqlite_ctx_t *ctx, struct codec_state *cs,
+                     const void *data, int size);
+    int (*decompress) (sqlite_ctx_t *ctx, const void *data, int size,
+                       int uncompressed_size);
+};
+
+struct sqlite_ctx {
     char *dbdir;
     char *dbfile;
     sqlite3 *db;
     sqlite3_stmt *load_stmt;
     sqlite3_stmt *store_stmt;
     sqlite3_stmt *dump_stmt;
+    sqlite3_stmt *sample_stmt;
+    sqlite3_stmt *dict_load_stmt;
+    sqlite3_stmt *dict_latest_stmt;
+    sqlite3_stmt *dict_store_stmt;
     flux_t *h;
     bool broker_shutdown;
     const char *hashfun;
     uint32_t blob_size_limit;
-    size_t lzo_bufsize;
-    void *lzo_buf;
-} sqlite_ctx_t;
+    struct codec_state cs;      /* for the reactor thread */
+    bool batch_open;
+    zlist_t *batch_requests;
+    flux_watcher_t *batch_w;
+    int batch_limit;
+    double batch_timeout;
+    int batch_count;
+    int batch_stores;
+    int batch_largest;
+    const struct codec *codec;
+    int compress_threshold;
+    int dict_version;
+    unsigned int dict_id;
+#if HAVE_ZSTD
+    int zstd_level;
+    ZSTD_DCtx *zdctx;
+    ZSTD_CDict *cdict;          /* current dictionary, if any */
+    zhash_t *ddicts;            /* dict id => ZSTD_DDict */
+    int dict_samples;
+    int dict_size;
+#endif
+    int compress_count;
+    int64_t compress_in;
+    int64_t compress_out;
+    double compress_time;       /* msec */
+    int decompress_count;
+    double decompress_time;     /* msec */
+    workpool_t *pool;
+    struct codec_state *wcs;    /* for each worker thread */
+    int workers;
+    flux_watcher_t *pool_w;
+};
 
 static void log_sqlite_error (sqlite_ctx_t *ctx, const char *fmt, ...)
 {
@@ -94,27 +226,664 @@ static void set_errno_from_sqlite_error (sqlite_ctx_t *ctx)
     }
 }
 
+static void store_request_destroy (struct store_request *req)
+{
+    if (req) {
+        int saved_errno = errno;
+        flux_msg_destroy (req->msg);
+        free (req->cbuf);
+        free (req);
+        errno = saved_errno;
+    }
+}
+
+/* If 'payload' is true, the request keeps its own copy of the object,
+ * so it can be prepared after the message handler returns.
+ */
+static struct store_request *store_request_create (const flux_msg_t *msg,
+                                                   bool payload)
+{
+    struct store_request *req;
+
+    if (!(req = calloc (1, sizeof (*req))))
+        return NULL;
+    if (!(req->msg = flux_msg_copy (msg, payload))) {
+        store_request_destroy (req);
+        return NULL;
+    }
+    if (payload && flux_request_decode_raw (req->msg, NULL, &req->data,
+                                            &req->size) < 0) {
+        store_request_destroy (req);
+        return NULL;
+    }
+    req->uncompressed_size = -1;
+    req->codec_id = CODEC_NONE;
+    return req;
+}
+
+static void codec_state_clear (struct codec_state *cs)
+{
+#if HAVE_ZSTD
+    ZSTD_freeCCtx (cs->zcctx);
+#endif
+    free (cs->buf);
+}
+
+static int codec_state_init (struct codec_state *cs)
+{
+    if (!(cs->buf = calloc (1, buf_chunksize)))
+        goto nomem;
+#if HAVE_ZSTD
+    if (!(cs->zcctx = ZSTD_createCCtx ()))
+        goto nomem;
+#endif
+    cs->bufsize = buf_chunksize;
+    return 0;
+nomem:
+    codec_state_clear (cs);
+    errno = ENOMEM;
+    return -1;
+}
+
 static void freectx (void *arg)
 {
     sqlite_ctx_t *ctx = arg;
     if (ctx) {
         int saved_errno = errno;
+        flux_watcher_destroy (ctx->pool_w);
+        if (ctx->pool) {
+            struct store_request *req;
+            workpool_wait (ctx->pool);
+            while ((req = workpool_next (ctx->pool)))
+                store_request_destroy (req);
+            workpool_destroy (ctx->pool);
+        }
+        if (ctx->wcs) {
+            int i;
+            for (i = 0; i < ctx->workers; i++)
+                codec_state_clear (&ctx->wcs[i]);
+            free (ctx->wcs);
+        }
+        if (ctx->batch_requests) {
+            struct store_request *req;
+            while ((req = zlist_pop (ctx->batch_requests)))
+                store_request_destroy (req);
+            zlist_destroy (&ctx->batch_requests);
+        }
+        flux_watcher_destroy (ctx->batch_w);
         if (ctx->store_stmt)
             sqlite3_finalize (ctx->store_stmt);
         if (ctx->load_stmt)
             sqlite3_finalize (ctx->load_stmt);
         if (ctx->dump_stmt)
             sqlite3_finalize (ctx->dump_stmt);
+        if (ctx->sample_stmt)
+            sqlite3_finalize (ctx->sample_stmt);
+        if (ctx->dict_load_stmt)
+            sqlite3_finalize (ctx->dict_load_stmt);
+        if (ctx->dict_latest_stmt)
+            sqlite3_finalize (ctx->dict_latest_stmt);
+        if (ctx->dict_store_stmt)
+            sqlite3_finalize (ctx->dict_store_stmt);
+#if HAVE_ZSTD
+        zhash_destroy (&ctx->ddicts);
+        ZSTD_freeCDict (ctx->cdict);
+        ZSTD_freeDCtx (ctx->zdctx);
+#endif
+        codec_state_clear (&ctx->cs);
         if (ctx->db)
             sqlite3_close (ctx->db);
         free (ctx->dbfile);
         free (ctx->dbdir);
-        free (ctx->lzo_buf);
         free (ctx);
         errno = saved_errno;
     }
 }
 
+int grow_buf (struct codec_state *cs, size_t size)
+{
+    size_t newsize = cs->bufsize;
+    void *newbuf;
+    while (newsize < size)
+        newsize += buf_chunksize;
+    if (!(newbuf = realloc (cs->buf, newsize))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    cs->bufsize = newsize;
+    cs->buf = newbuf;
+    return 0;
+}
+
+static int lz4_compress (sqlite_ctx_t *ctx, struct codec_state *cs,
+                         const void *data, int size)
+{
+    int out_len = LZ4_compressBound (size);
+    int r;
+
+    if (cs->bufsize < out_len && grow_buf (cs, out_len) < 0)
+        return -1;
+    if ((r = LZ4_compress_default (data, cs->buf, size, out_len)) == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return r;
+}
+
+static int lz4_decompress (sqlite_ctx_t *ctx, const void *data, int size,
+                           int uncompressed_size)
+{
+    int r;
+
+    if (ctx->cs.bufsize < uncompressed_size
+                        && grow_buf (&ctx->cs, uncompressed_size) < 0)
+        return -1;
+    r = LZ4_decompress_safe (data, ctx->cs.buf, size, uncompressed_size);
+    if (r < 0 || r != uncompressed_size) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+#if HAVE_ZSTD
+static int zstd_compress (sqlite_ctx_t *ctx, struct codec_state *cs,
+                          const void *data, int size)
+{
+    size_t out_len = ZSTD_compressBound (size);
+    size_t r;
+
+    if (cs->bufsize < out_len && grow_buf (cs, out_len) < 0)
+        return -1;
+    r = ZSTD_compressCCtx (cs->zcctx, cs->buf, out_len, data, size,
+                           ctx->zstd_level);
+    if (ZSTD_isError (r)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return r;
+}
+
+static int zstd_dict_compress (sqlite_ctx_t *ctx, struct codec_state *cs,
+                               const void *data, int size)
+{
+    size_t out_len = ZSTD_compressBound (size);
+    size_t r;
+
+    if (cs->bufsize < out_len && grow_buf (cs, out_len) < 0)
+        return -1;
+    r = ZSTD_compress_usingCDict (cs->zcctx, cs->buf, out_len, data, size,
+                                  ctx->cdict);
+    if (ZSTD_isError (r)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return r;
+}
+
+static void ddict_destroy (void *arg)
+{
+    (void)ZSTD_freeDDict (arg);
+}
+
+/* Look up the decompression dictionary with the specified id,
+ * loading it from the db if it isn't already cached.
+ */
+static ZSTD_DDict *ddict_lookup (sqlite_ctx_t *ctx, unsigned int id)
+{
+    char key[16];
+    ZSTD_DDict *ddict;
+    const void *dict;
+    int size;
+
+    snprintf (key, sizeof (key), "%u", id);
+    if ((ddict = zhash_lookup (ctx->ddicts, key)))
+        return ddict;
+    if (sqlite3_bind_int64 (ctx->dict_load_stmt, 1, id) != SQLITE_OK) {
+        log_sqlite_error (ctx, "load: binding dict id");
+        set_errno_from_sqlite_error (ctx);
+        goto done;
+    }
+    if (sqlite3_step (ctx->dict_load_stmt) != SQLITE_ROW) {
+        flux_log (ctx->h, LOG_ERR, "load: unknown dictionary %u", id);
+        errno = EINVAL;
+        goto done;
+    }
+    dict = sqlite3_column_blob (ctx->dict_load_stmt, 0);
+    size = sqlite3_column_bytes (ctx->dict_load_stmt, 0);
+    if (!(ddict = ZSTD_createDDict (dict, size))) {
+        errno = ENOMEM;
+        goto done;
+    }
+    zhash_update (ctx->ddicts, key, ddict);
+    zhash_freefn (ctx->ddicts, key, ddict_destroy);
+done:
+    (void )sqlite3_reset (ctx->dict_load_stmt);
+    return ddict;
+}
+
+static int zstd_decompress (sqlite_ctx_t *ctx, const void *data, int size,
+                            int uncompressed_size)
+{
+    unsigned int id = ZSTD_getDictID_fromFrame (data, size);
+    ZSTD_DDict *ddict = NULL;
+    size_t r;
+
+    if (ctx->cs.bufsize < uncompressed_size
+                        && grow_buf (&ctx->cs, uncompressed_size) < 0)
+        return -1;
+    if (id != 0 && !(ddict = ddict_lookup (ctx, id)))
+        return -1;
+    if (ddict)
+        r = ZSTD_decompress_usingDDict (ctx->zdctx, ctx->cs.buf,
+                                        uncompressed_size, data, size, ddict);
+    else
+        r = ZSTD_decompressDCtx (ctx->zdctx, ctx->cs.buf, uncompressed_size,
+                                 data, size);
+    if (ZSTD_isError (r) || r != uncompressed_size) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+#endif /* HAVE_ZSTD */
+
+static const struct codec codecs[] = {
+    { "none",       CODEC_NONE,         0,      NULL,   NULL },
+    { "lz4",        CODEC_LZ4,          256,    lz4_compress,
+                                                lz4_decompress },
+#if HAVE_ZSTD
+    { "zstd",       CODEC_ZSTD,         256,    zstd_compress,
+                                                zstd_decompress },
+    { "zstd-dict",  CODEC_ZSTD_DICT,    32,     zstd_dict_compress,
+                                                zstd_decompress },
+#endif
+};
+
+static const struct codec *codec_lookup (int id)
+{
+    int i;
+    for (i = 0; i < sizeof (codecs) / sizeof (codecs[0]); i++)
+        if (codecs[i].id == id)
+            return &codecs[i];
+    return NULL;
+}
+
+static const struct codec *codec_lookup_name (const char *name)
+{
+    int i;
+    for (i = 0; i < sizeof (codecs) / sizeof (codecs[0]); i++)
+        if (!strcmp (codecs[i].name, name))
+            return &codecs[i];
+    return NULL;
+}
+
+/* Compress the request's object with the configured codec, if it is
+ * large enough to be worth compressing.  If it shrinks, req->data and
+ * req->size are updated to refer to the compressed object in cs->buf,
+ * req->uncompressed_size is set to the original size, and req->codec_id
+ * identifies the codec.
+ */
+static int encode_object (sqlite_ctx_t *ctx, struct codec_state *cs,
+                          struct store_request *req)
+{
+    const struct codec *codec = ctx->codec;
+    struct timespec t0;
+    int r;
+
+#if HAVE_ZSTD
+    if (codec->id == CODEC_ZSTD_DICT && !ctx->cdict)
+        codec = codec_lookup (CODEC_ZSTD);
+#endif
+    if (!codec->compress || req->size < ctx->compress_threshold)
+        return 0;
+    monotime (&t0);
+    if ((r = codec->compress (ctx, cs, req->data, req->size)) < 0)
+        return -1;
+    req->compress_time = monotime_since (t0);
+    req->compress_tried = true;
+    if (r >= req->size)         /* not worth it */
+        return 0;
+    req->uncompressed_size = req->size;
+    req->codec_id = codec->id;
+    req->size = r;
+    req->data = cs->buf;
+    return 0;
+}
+
+/* Decode the object in the current row of 'stmt', a SELECT of
+ * (object, size, codec).  Compressed objects are decompressed into
+ * ctx->cs.buf.
+ */
+static int decode_object (sqlite_ctx_t *ctx, sqlite3_stmt *stmt,
+                          const void **datap, int *sizep)
+{
+    const void *data;
+    int size;
+    int uncompressed_size;
+    const struct codec *codec;
+    struct timespec t0;
+
+    size = sqlite3_column_bytes (stmt, 0);
+    if (sqlite3_column_type (stmt, 0) != SQLITE_BLOB && size > 0) {
+        flux_log (ctx->h, LOG_ERR, "selected value is not a blob");
+        errno = EINVAL;
+        return -1;
+    }
+    data = sqlite3_column_blob (stmt, 0);
+    if (sqlite3_column_type (stmt, 1) != SQLITE_INTEGER) {
+        flux_log (ctx->h, LOG_ERR, "selected value is not an integer");
+        errno = EINVAL;
+        return -1;
+    }
+    uncompressed_size = sqlite3_column_int (stmt, 1);
+    if (uncompressed_size != -1) {
+        if (sqlite3_column_type (stmt, 2) == SQLITE_NULL)
+            codec = codec_lookup (CODEC_LZ4);
+        else
+            codec = codec_lookup (sqlite3_column_int (stmt, 2));
+        if (!codec || !codec->decompress) {
+            flux_log (ctx->h, LOG_ERR, "unknown codec");
+            errno = EINVAL;
+            return -1;
+        }
+        monotime (&t0);
+        if (codec->decompress (ctx, data, size, uncompressed_size) < 0) {
+            flux_log (ctx->h, LOG_ERR, "%s: blob decompression failed",
+                      codec->name);
+            return -1;
+        }
+        ctx->decompress_time += monotime_since (t0);
+        ctx->decompress_count++;
+        data = ctx->cs.buf;
+        size = uncompressed_size;
+    }
+    *datap = data;
+    *sizep = size;
+    return 0;
+}
+
+#if HAVE_ZSTD
+/* Make (dict, size) the dictionary used to compress new objects.
+ */
+static int dict_set (sqlite_ctx_t *ctx, int version, unsigned int id,
+                     const void *dict, int size)
+{
+    ZSTD_CDict *cdict;
+
+    if (!(cdict = ZSTD_createCDict (dict, size, ctx->zstd_level))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    /* Workers may be compressing with the old dictionary.
+     */
+    if (ctx->pool)
+        workpool_wait (ctx->pool);
+    ZSTD_freeCDict (ctx->cdict);
+    ctx->cdict = cdict;
+    ctx->dict_id = id;
+    ctx->dict_version = version;
+    return 0;
+}
+
+static int batch_commit (sqlite_ctx_t *ctx);
+
+/* Train a dictionary from a sample of the most recently stored objects,
+ * record it as a new dictionary version in the db, and start using it.
+ */
+static int dict_train (sqlite_ctx_t *ctx)
+{
+    char *samples = NULL;
+    size_t samples_size = 0;
+    size_t *sizes = NULL;
+    int nsamples = 0;
+    size_t total = 0;
+    void *dict = NULL;
+    size_t dict_size;
+    unsigned int id;
+    int version;
+    int rc = -1;
+    int old_state;
+    //delay cancellation to ensure lock-correctness in sqlite
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+
+    if (batch_commit (ctx) < 0)
+        goto done;
+    if (ctx->dict_samples < dict_min_samples) {
+        errno = EINVAL;
+        goto done;
+    }
+    if (!(sizes = calloc (ctx->dict_samples, sizeof (sizes[0])))) {
+        errno = ENOMEM;
+        goto done;
+    }
+    if (sqlite3_bind_int (ctx->sample_stmt, 1,
+                          ctx->dict_samples) != SQLITE_OK) {
+        log_sqlite_error (ctx, "dict-train: binding limit");
+        set_errno_from_sqlite_error (ctx);
+        goto done;
+    }
+    while (sqlite3_step (ctx->sample_stmt) == SQLITE_ROW) {
+        const void *data;
+        int size;
+        if (decode_object (ctx, ctx->sample_stmt, &data, &size) < 0)
+            continue;
+        if (size == 0 || size > dict_sample_size_limit)
+            continue;
+        if (samples_size < total + size) {
+            size_t newsize = samples_size + buf_chunksize;
+            char *newbuf;
+            if (!(newbuf = realloc (samples, newsize))) {
+                errno = ENOMEM;
+                goto done;
+            }
+            samples = newbuf;
+            samples_size = newsize;
+        }
+        memcpy (samples + total, data, size);
+        sizes[nsamples++] = size;
+        total += size;
+    }
+    if (nsamples < dict_min_samples) {
+        errno = EAGAIN;
+        goto done;
+    }
+    if (!(dict = malloc (ctx->dict_size))) {
+        errno = ENOMEM;
+        goto done;
+    }
+    dict_size = ZDICT_trainFromBuffer (dict, ctx->dict_size,
+                                       samples, sizes, nsamples);
+    if (ZDICT_isError (dict_size)) {
+        flux_log (ctx->h, LOG_ERR, "dict-train: %s",
+                  ZDICT_getErrorName (dict_size));
+        errno = EINVAL;
+        goto done;
+    }
+    if ((id = ZDICT_getDictID (dict, dict_size)) == 0) {
+        errno = EINVAL;
+        goto done;
+    }
+    if (sqlite3_bind_int64 (ctx->dict_store_stmt, 1, id) != SQLITE_OK
+            || sqlite3_bind_blob (ctx->dict_store_stmt, 2, dict, dict_size,
+                                  SQLITE_STATIC) != SQLITE_OK) {
+        log_sqlite_error (ctx, "dict-train: binding dict");
+        set_errno_from_sqlite_error (ctx);
+        goto done;
+    }
+    if (sqlite3_step (ctx->dict_store_stmt) != SQLITE_DONE) {
+        log_sqlite_error (ctx, "dict-train: storing dict");
+        set_errno_from_sqlite_error (ctx);
+        goto done;
+    }
+    version = sqlite3_last_insert_rowid (ctx->db);
+    if (dict_set (ctx, version, id, dict, dict_size) < 0)
+        goto done;
+    flux_log (ctx->h, LOG_DEBUG,
+              "dict-train: version %d: %zu bytes from %d samples",
+              version, dict_size, nsamples);
+    rc = 0;
+done:
+    (void )sqlite3_reset (ctx->sample_stmt);
+    (void )sqlite3_reset (ctx->dict_store_stmt);
+    free (dict);
+    free (sizes);
+    free (samples);
+    pthread_setcancelstate(old_state, NULL);
+    return rc;
+}
+
+/* Load the most recent dictionary version, if any.
+ * If the zstd-dict codec is configured and there is no dictionary yet,
+ * try to train one from the objects already in the db.  Training is
+ * slow and runs on the reactor, so it is only attempted here, when the
+ * module starts, and on demand with content-sqlite.dict-train.  Until
+ * it succeeds, new objects are compressed with plain zstd.
+ */
+static int dict_open (sqlite_ctx_t *ctx)
+{
+    int rc = -1;
+    int old_state;
+    //delay cancellation to ensure lock-correctness in sqlite
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+
+    if (sqlite3_step (ctx->dict_latest_stmt) == SQLITE_ROW) {
+        if (dict_set (ctx,
+                      sqlite3_column_int (ctx->dict_latest_stmt, 0),
+                      sqlite3_column_int64 (ctx->dict_latest_stmt, 1),
+                      sqlite3_column_blob (ctx->dict_latest_stmt, 2),
+                      sqlite3_column_bytes (ctx->dict_latest_stmt, 2)) < 0) {
+            flux_log_error (ctx->h, "loading dictionary");
+            goto done;
+        }
+    }
+    (void )sqlite3_reset (ctx->dict_latest_stmt);
+    if (ctx->codec->id == CODEC_ZSTD_DICT && !ctx->cdict) {
+        if (dict_train (ctx) < 0)
+            flux_log (ctx->h, LOG_DEBUG, "no dictionary yet, using zstd");
+    }
+    rc = 0;
+done:
+    (void )sqlite3_reset (ctx->dict_latest_stmt);
+    pthread_setcancelstate(old_state, NULL);
+    return rc;
+}
+#endif /* HAVE_ZSTD */
+
+/* Respond to store requests in the current batch with blobref,
+ * or with an error if errnum is nonzero.
+ */
+static void batch_respond (sqlite_ctx_t *ctx, int errnum)
+{
+    struct store_request *req;
+
+    while ((req = zlist_pop (ctx->batch_requests))) {
+        if (errnum != 0) {
+            if (flux_respond_error (ctx->h, req->msg, errnum, NULL) < 0)
+                flux_log_error (ctx->h, "store: flux_respond_error");
+        }
+        else {
+            if (flux_respond_raw (ctx->h, req->msg, req->blobref,
+                                  strlen (req->blobref) + 1) < 0)
+                flux_log_error (ctx->h, "store: flux_respond_raw");
+        }
+        store_request_destroy (req);
+    }
+}
+
+static int batch_begin (sqlite_ctx_t *ctx)
+{
+    if (ctx->batch_open)
+        return 0;
+    if (sqlite3_exec (ctx->db, "BEGIN", NULL, NULL, NULL) != SQLITE_OK) {
+        log_sqlite_error (ctx, "store: begin transaction");
+        set_errno_from_sqlite_error (ctx);
+        return -1;
+    }
+    ctx->batch_open = true;
+    flux_timer_watcher_reset (ctx->batch_w, ctx->batch_timeout, 0.);
+    flux_watcher_start (ctx->batch_w);
+    return 0;
+}
+
+/* Abandon the current transaction, failing its store requests.
+ * The transaction may already have been rolled back by sqlite.
+ * Otherwise its rows are rolled back from the in-memory journal.
+ */
+static void batch_abort (sqlite_ctx_t *ctx, int errnum)
+{
+    flux_watcher_stop (ctx->batch_w);
+    if (!sqlite3_get_autocommit (ctx->db))
+        (void)sqlite3_exec (ctx->db, "ROLLBACK", NULL, NULL, NULL);
+    ctx->batch_open = false;
+    batch_respond (ctx, errnum);
+}
+
+/* Commit the current transaction, then respond to its store requests.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int batch_commit (sqlite_ctx_t *ctx)
+{
+    int count = zlist_size (ctx->batch_requests);
+    int old_state;
+    int rc = -1;
+    //delay cancellation to ensure lock-correctness in sqlite
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+
+    if (!ctx->batch_open) {
+        rc = 0;
+        goto done;
+    }
+    if (sqlite3_exec (ctx->db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+        log_sqlite_error (ctx, "store: commit transaction");
+        set_errno_from_sqlite_error (ctx);
+        batch_abort (ctx, errno);
+        goto done;
+    }
+    flux_watcher_stop (ctx->batch_w);
+    ctx->batch_open = false;
+    ctx->batch_count++;
+    ctx->batch_stores += count;
+    if (ctx->batch_largest < count)
+        ctx->batch_largest = count;
+    batch_respond (ctx, 0);
+    rc = 0;
+done:
+    pthread_setcancelstate(old_state, NULL);
+    return rc;
+}
+
+static void batch_timeout_cb (flux_reactor_t *r, flux_watcher_t *w,
+                              int revents, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+
+    (void)batch_commit (ctx);
+}
+
+static int table_info_cb (void *arg, int ncols, char **vals, char **names)
+{
+    bool *found = arg;
+    int i;
+
+    for (i = 0; i < ncols; i++) {
+        if (!strcmp (names[i], "name") && vals[i] && !strcmp (vals[i], "codec"))
+            *found = true;
+    }
+    return 0;
+}
+
+/* Databases created before codecs were recorded lack the codec column.
+ */
+static bool has_codec_column (sqlite_ctx_t *ctx)
+{
+    bool found = false;
+
+    (void)sqlite3_exec (ctx->db, "PRAGMA table_info(objects)",
+                        table_info_cb, &found, NULL);
+    return found;
+}
+
 static sqlite_ctx_t *getctx (flux_t *h)
 {
     sqlite_ctx_t *ctx = (sqlite_ctx_t *)flux_aux_get (h, "flux::content-sqlite");
@@ -125,10 +894,26 @@ static sqlite_ctx_t *getctx (flux_t *h)
     if (!ctx) {
         if (!(ctx = calloc (1, sizeof (*ctx))))
             goto error;
-        if (!(ctx->lzo_buf = calloc (1, lzo_buf_chunksize)))
+        if (codec_state_init (&ctx->cs) < 0)
             goto error;
-        ctx->lzo_bufsize = lzo_buf_chunksize;
         ctx->h = h;
+        if (!(ctx->batch_requests = zlist_new ()))
+            goto error;
+        ctx->batch_limit = default_batch_limit;
+        ctx->batch_timeout = default_batch_timeout;
+        ctx->codec = codec_lookup (CODEC_LZ4);
+        ctx->compress_threshold = -1;
+#if HAVE_ZSTD
+        ctx->zstd_level = ZSTD_CLEVEL_DEFAULT;
+        ctx->dict_samples = default_dict_samples;
+        ctx->dict_size = default_dict_size;
+        if (!(ctx->ddicts = zhash_new ()))
+            goto error;
+        if (!(ctx->zdctx = ZSTD_createDCtx ())) {
+            errno = ENOMEM;
+            goto error;
+        }
+#endif
         if (!(ctx->hashfun = flux_attr_get (h, "content.hash"))) {
             flux_log_error (h, "content.hash");
             goto error;
@@ -161,7 +946,11 @@ static sqlite_ctx_t *getctx (flux_t *h)
             flux_log_error (h, "sqlite3_open %s", ctx->dbfile);
             goto error;
         }
-        if (sqlite3_exec (ctx->db, "PRAGMA journal_mode=OFF",
+        /* Stores are batched in transactions that batch_abort() may roll
+         * back, which sqlite leaves undefined with journal_mode=OFF.
+         * An in-memory journal makes rollback work without disk I/O.
+         */
+        if (sqlite3_exec (ctx->db, "PRAGMA journal_mode=MEMORY",
                                             NULL, NULL, NULL) != SQLITE_OK
                 || sqlite3_exec (ctx->db, "PRAGMA synchronous=OFF",
                                             NULL, NULL, NULL) != SQLITE_OK
@@ -171,10 +960,18 @@ static sqlite_ctx_t *getctx (flux_t *h)
             goto error_sqlite;
         }
         if (sqlite3_exec (ctx->db, sql_create_table,
+                                            NULL, NULL, NULL) != SQLITE_OK
+                || sqlite3_exec (ctx->db, sql_create_dict_table,
                                             NULL, NULL, NULL) != SQLITE_OK) {
             log_sqlite_error (ctx, "creating table");
             goto error_sqlite;
         }
+        if (!has_codec_column (ctx)
+                && sqlite3_exec (ctx->db, sql_add_codec,
+                                            NULL, NULL, NULL) != SQLITE_OK) {
+            log_sqlite_error (ctx, "adding codec column");
+            goto error_sqlite;
+        }
         if (sqlite3_prepare_v2 (ctx->db, sql_load, -1, &ctx->load_stmt,
                                             NULL) != SQLITE_OK) {
             log_sqlite_error (ctx, "preparing load stmt");
@@ -190,6 +987,31 @@ static sqlite_ctx_t *getctx (flux_t *h)
             log_sqlite_error (ctx, "preparing dump stmt");
             goto error_sqlite;
         }
+        if (sqlite3_prepare_v2 (ctx->db, sql_sample, -1, &ctx->sample_stmt,
+                                            NULL) != SQLITE_OK) {
+            log_sqlite_error (ctx, "preparing sample stmt");
+            goto error_sqlite;
+        }
+        if (sqlite3_prepare_v2 (ctx->db, sql_dict_load, -1,
+                                &ctx->dict_load_stmt, NULL) != SQLITE_OK) {
+            log_sqlite_error (ctx, "preparing dict load stmt");
+            goto error_sqlite;
+        }
+        if (sqlite3_prepare_v2 (ctx->db, sql_dict_latest, -1,
+                                &ctx->dict_latest_stmt, NULL) != SQLITE_OK) {
+            log_sqlite_error (ctx, "preparing dict latest stmt");
+            goto error_sqlite;
+        }
+        if (sqlite3_prepare_v2 (ctx->db, sql_dict_store, -1,
+                                &ctx->dict_store_stmt, NULL) != SQLITE_OK) {
+            log_sqlite_error (ctx, "preparing dict store stmt");
+            goto error_sqlite;
+        }
+        if (!(ctx->batch_w = flux_timer_watcher_create (flux_get_reactor (h),
+                                                        0., 0.,
+                                                        batch_timeout_cb,
+                                                        ctx)))
+            goto error;
         if (flux_aux_set (h, "flux::content-sqlite", ctx, freectx) < 0)
             goto error;
     }
@@ -201,21 +1023,6 @@ error:
     return NULL;
 }
 
-int grow_lzo_buf (sqlite_ctx_t *ctx, size_t size)
-{
-    size_t newsize = ctx->lzo_bufsize;
-    void *newbuf;
-    while (newsize < size)
-        newsize += lzo_buf_chunksize;
-    if (!(newbuf = realloc (ctx->lzo_buf, newsize))) {
-        errno = ENOMEM;
-        return -1;
-    }
-    ctx->lzo_bufsize = newsize;
-    ctx->lzo_buf = newbuf;
-    return 0;
-}
-
 void load_cb (flux_t *h, flux_msg_handler_t *mh,
               const flux_msg_t *msg, void *arg)
 {
@@ -226,7 +1033,6 @@ void load_cb (flux_t *h, flux_msg_handler_t *mh,
     int hash_len;
     const void *data = NULL;
     int size = 0;
-    int uncompressed_size;
     int rc = -1;
     int old_state;
     //delay cancellation to ensure lock-correctness in sqlite
@@ -258,36 +1064,8 @@ void load_cb (flux_t *h, flux_msg_handler_t *mh,
         errno = ENOENT;
         goto done;
     }
-    size = sqlite3_column_bytes (ctx->load_stmt, 0);
-    if (sqlite3_column_type (ctx->load_stmt, 0) != SQLITE_BLOB && size > 0) {
-        flux_log (h, LOG_ERR, "load: selected value is not a blob");
-        errno = EINVAL;
+    if (decode_object (ctx, ctx->load_stmt, &data, &size) < 0)
         goto done;
-    }
-    data = sqlite3_column_blob (ctx->load_stmt, 0);
-    if (sqlite3_column_type (ctx->load_stmt, 1) != SQLITE_INTEGER) {
-        flux_log (h, LOG_ERR, "load: selected value is not an integer");
-        errno = EINVAL;
-        goto done;
-    }
-    uncompressed_size = sqlite3_column_int (ctx->load_stmt, 1);
-    if (uncompressed_size != -1) {
-        if (ctx->lzo_bufsize < uncompressed_size
-                                && grow_lzo_buf (ctx, uncompressed_size) < 0)
-            goto done;
-        int r = LZ4_decompress_safe (data, ctx->lzo_buf, size, uncompressed_size);
-        if (r < 0) {
-            errno = EINVAL;
-            goto done;
-        }
-        if (r != uncompressed_size) {
-            flux_log (h, LOG_ERR, "load: blob size mismatch");
-            errno = EINVAL;
-            goto done;
-        }
-        data = ctx->lzo_buf;
-        size = uncompressed_size;
-    }
     rc = 0;
 done:
     if (rc < 0) {
@@ -302,82 +1080,267 @@ done:
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_state);
 }
 
-void store_cb (flux_t *h, flux_msg_handler_t *mh,
-               const flux_msg_t *msg, void *arg)
+/* Hash and compress the request's object, recording any error in
+ * req->errnum.  This runs in a worker thread if the pool is enabled, so
+ * it must not use the flux handle or modify the module context.  If
+ * 'copy' is true, compressed data is copied out of cs->buf so the worker
+ * can reuse its buffer.
+ */
+static void store_prepare (sqlite_ctx_t *ctx, struct codec_state *cs,
+                           struct store_request *req, bool copy)
+{
+    if (blobref_hash (ctx->hashfun, (uint8_t *)req->data, req->size,
+                      req->blobref, sizeof (req->blobref)) < 0)
+        goto error;
+    if ((req->hash_len = blobref_strtohash (req->blobref, req->hash,
+                                            sizeof (req->hash))) < 0)
+        goto error;
+    if (encode_object (ctx, cs, req) < 0)
+        goto error;
+    if (copy && req->uncompressed_size != -1) {
+        if (!(req->cbuf = malloc (req->size))) {
+            errno = ENOMEM;
+            goto error;
+        }
+        memcpy (req->cbuf, req->data, req->size);
+        req->data = req->cbuf;
+    }
+    return;
+error:
+    req->errnum = errno;
+}
+
+/* Insert a prepared object into the current batch.  The response is
+ * sent when the batch is committed, or now if there is an error.
+ */
+static void store_insert (sqlite_ctx_t *ctx, struct store_request *req)
 {
-    sqlite_ctx_t *ctx = arg;
-    const void *data;
-    int size, hash_len;
-    uint8_t hash[BLOBREF_MAX_DIGEST_SIZE];
-    char blobref[BLOBREF_MAX_STRING_SIZE] = "-";
-    int uncompressed_size = -1;
     int rc = -1;
     int old_state;
     //delay cancellation to ensure lock-correctness in sqlite
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
 
-    if (flux_request_decode_raw (msg, NULL, &data, &size) < 0) {
-        flux_log_error (h, "store: request decode failed");
+    if (req->errnum != 0) {
+        errno = req->errnum;
         goto done;
     }
-    if (size > ctx->blob_size_limit) {
-        errno = EFBIG;
-        goto done;
+    if (req->compress_tried) {
+        int in = req->uncompressed_size != -1 ? req->uncompressed_size
+                                              : req->size;
+        ctx->compress_count++;
+        ctx->compress_time += req->compress_time;
+        ctx->compress_in += in;
+        ctx->compress_out += req->size;
     }
-    if (blobref_hash (ctx->hashfun, (uint8_t *)data, size, blobref,
-                      sizeof (blobref)) < 0)
+    if (batch_begin (ctx) < 0)
         goto done;
-    if ((hash_len = blobref_strtohash (blobref, hash, sizeof (hash))) < 0)
-        goto done;
-    if (size >= compression_threshold) {
-        int r;
-        int out_len = LZ4_compressBound(size);
-        if (ctx->lzo_bufsize < out_len && grow_lzo_buf (ctx, out_len) < 0)
-            goto done;
-        r = LZ4_compress_default (data, ctx->lzo_buf, size, out_len);
-        if (r == 0) {
-            errno = EINVAL;
-            goto done;
-        }
-        uncompressed_size = size;
-        size = r;
-        data = ctx->lzo_buf;
-    }
-    if (sqlite3_bind_text (ctx->store_stmt, 1, (char *)hash, hash_len,
-                           SQLITE_STATIC) != SQLITE_OK) {
+    if (sqlite3_bind_text (ctx->store_stmt, 1, (char *)req->hash,
+                           req->hash_len, SQLITE_STATIC) != SQLITE_OK) {
         log_sqlite_error (ctx, "store: binding key");
         set_errno_from_sqlite_error (ctx);
         goto done;
     }
-    if (sqlite3_bind_int (ctx->store_stmt, 2, uncompressed_size) != SQLITE_OK) {
+    if (sqlite3_bind_int (ctx->store_stmt, 2,
+                          req->uncompressed_size) != SQLITE_OK) {
         log_sqlite_error (ctx, "store: binding size");
         set_errno_from_sqlite_error (ctx);
         goto done;
     }
     if (sqlite3_bind_blob (ctx->store_stmt, 3,
-                           data, size, SQLITE_STATIC) != SQLITE_OK) {
+                           req->data, req->size, SQLITE_STATIC) != SQLITE_OK) {
         log_sqlite_error (ctx, "store: binding data");
         set_errno_from_sqlite_error (ctx);
         goto done;
     }
+    if (sqlite3_bind_int (ctx->store_stmt, 4, req->codec_id) != SQLITE_OK) {
+        log_sqlite_error (ctx, "store: binding codec");
+        set_errno_from_sqlite_error (ctx);
+        goto done;
+    }
     if (sqlite3_step (ctx->store_stmt) != SQLITE_DONE
                     && sqlite3_errcode (ctx->db) != SQLITE_CONSTRAINT) {
         log_sqlite_error (ctx, "store: executing stmt");
         set_errno_from_sqlite_error (ctx);
+        /* A failed statement may cause sqlite to roll back the
+         * whole transaction, taking earlier stores with it.
+         */
+        if (sqlite3_get_autocommit (ctx->db))
+            batch_abort (ctx, errno);
+        goto done;
+    }
+    if (zlist_append (ctx->batch_requests, req) < 0) {
+        errno = ENOMEM;
         goto done;
     }
     rc = 0;
 done:
+    (void) sqlite3_reset (ctx->store_stmt);
     if (rc < 0) {
-        if (flux_respond_error (h, msg, errno, NULL) < 0)
-            flux_log_error (h, "store: flux_respond_error");
+        if (flux_respond_error (ctx->h, req->msg, errno, NULL) < 0)
+            flux_log_error (ctx->h, "store: flux_respond_error");
+        store_request_destroy (req);
     }
-    else {
-        if (flux_respond_raw (h, msg, blobref, strlen (blobref) + 1) < 0)
-            flux_log_error (h, "store: flux_respond_raw");
+    pthread_setcancelstate(old_state, NULL);
+    if (zlist_size (ctx->batch_requests) >= ctx->batch_limit)
+        (void)batch_commit (ctx);
+}
+
+void store_cb (flux_t *h, flux_msg_handler_t *mh,
+               const flux_msg_t *msg, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+    const void *data;
+    int size;
+    struct store_request *req = NULL;
+
+    if (flux_request_decode_raw (msg, NULL, &data, &size) < 0) {
+        flux_log_error (h, "store: request decode failed");
+        goto error;
+    }
+    if (size > ctx->blob_size_limit) {
+        errno = EFBIG;
+        goto error;
+    }
+    if (ctx->pool) {
+        if (!(req = store_request_create (msg, true)))
+            goto error;
+        if (workpool_submit (ctx->pool, req) < 0)
+            goto error;
+        return;
+    }
+    if (!(req = store_request_create (msg, false)))
+        goto error;
+    req->data = data;
+    req->size = size;
+    store_prepare (ctx, &ctx->cs, req, false);
+    store_insert (ctx, req);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "store: flux_respond_error");
+    store_request_destroy (req);
+}
+
+static void store_work (void *item, int worker, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+
+    store_prepare (ctx, &ctx->wcs[worker], item, true);
+}
+
+/* Insert requests that the workers have finished, in arrival order.
+ */
+static void pool_drain (sqlite_ctx_t *ctx)
+{
+    struct store_request *req;
+
+    workpool_clear_event (ctx->pool);
+    while ((req = workpool_next (ctx->pool)))
+        store_insert (ctx, req);
+}
+
+static void pool_cb (flux_reactor_t *r, flux_watcher_t *w,
+                     int revents, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+
+    pool_drain (ctx);
+}
+
+/* Wait for the workers to finish all submitted requests, and insert them.
+ */
+static void pool_flush (sqlite_ctx_t *ctx)
+{
+    if (ctx->pool) {
+        workpool_wait (ctx->pool);
+        pool_drain (ctx);
     }
-    (void) sqlite3_reset (ctx->store_stmt);
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_state);
+}
+
+static int pool_start (sqlite_ctx_t *ctx)
+{
+    int i, fd;
+
+    if (ctx->workers <= 0)
+        return 0;
+    if (!(ctx->wcs = calloc (ctx->workers, sizeof (ctx->wcs[0]))))
+        return -1;
+    for (i = 0; i < ctx->workers; i++) {
+        if (codec_state_init (&ctx->wcs[i]) < 0)
+            return -1;
+    }
+    if (!(ctx->pool = workpool_create (ctx->workers, store_work, ctx)))
+        return -1;
+    if ((fd = workpool_pollfd (ctx->pool)) < 0)
+        return -1;
+    if (!(ctx->pool_w = flux_fd_watcher_create (flux_get_reactor (ctx->h),
+                                                fd, FLUX_POLLIN,
+                                                pool_cb, ctx)))
+        return -1;
+    flux_watcher_start (ctx->pool_w);
+    return 0;
+}
+
+void stats_cb (flux_t *h, flux_msg_handler_t *mh,
+               const flux_msg_t *msg, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+    double ratio = 1.;
+
+    if (ctx->compress_out > 0)
+        ratio = (double)ctx->compress_in / ctx->compress_out;
+    if (flux_respond_pack (h, msg,
+                           "{ s:i s:f s:i s:i s:i s:i"
+                           "  s:s s:i s:i s:i s:I s:I s:f s:f s:i s:f"
+                           "  s:i s:i }",
+                           "batch-limit", ctx->batch_limit,
+                           "batch-timeout", ctx->batch_timeout,
+                           "batch-count", ctx->batch_count,
+                           "batch-stores", ctx->batch_stores,
+                           "batch-largest", ctx->batch_largest,
+                           "batch-pending",
+                           (int)zlist_size (ctx->batch_requests),
+                           "codec", ctx->codec->name,
+                           "dict-version", ctx->dict_version,
+                           "compress-threshold", ctx->compress_threshold,
+                           "compress-count", ctx->compress_count,
+                           "compress-in", (json_int_t)ctx->compress_in,
+                           "compress-out", (json_int_t)ctx->compress_out,
+                           "compress-ratio", ratio,
+                           "compress-time", ctx->compress_time / 1000,
+                           "decompress-count", ctx->decompress_count,
+                           "decompress-time",
+                           ctx->decompress_time / 1000,
+                           "workers", ctx->workers,
+                           "workers-pending",
+                           ctx->pool ? workpool_count (ctx->pool) : 0) < 0)
+        flux_log_error (h, "stats: flux_respond_pack");
+}
+
+/* Train a new dictionary on demand.
+ */
+void dict_train_cb (flux_t *h, flux_msg_handler_t *mh,
+                    const flux_msg_t *msg, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+
+    if (flux_request_decode (msg, NULL, NULL) < 0)
+        goto error;
+#if HAVE_ZSTD
+    if (dict_train (ctx) < 0)
+        goto error;
+#else
+    errno = ENOSYS;
+    goto error;
+#endif
+    if (flux_respond_pack (h, msg, "{ s:i s:i }",
+                           "version", ctx->dict_version,
+                           "id", (int)ctx->dict_id) < 0)
+        flux_log_error (h, "dict-train: flux_respond_pack");
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "dict-train: flux_respond_error");
 }
 
 int register_backing_store (flux_t *h, bool value, const char *name)
@@ -438,6 +1401,9 @@ void shutdown_cb (flux_t *h, flux_msg_handler_t *mh,
     int old_state;
 
     flux_log (h, LOG_DEBUG, "shutdown: begin");
+    pool_flush (ctx);
+    if (batch_commit (ctx) < 0)
+        flux_log_error (h, "shutdown: committing stores");
     if (register_backing_store (h, false, "content-sqlite") < 0) {
         flux_log_error (h, "shutdown: unregistering backing store");
         goto done;
@@ -452,37 +1418,11 @@ void shutdown_cb (flux_t *h, flux_msg_handler_t *mh,
         const char *blobref;
         int blobref_size;
         const void *data = NULL;
-        int uncompressed_size;
-        int size = sqlite3_column_bytes (ctx->dump_stmt, 0);
-        if (sqlite3_column_type (ctx->dump_stmt, 0) != SQLITE_BLOB
-                                                            && size > 0) {
-            flux_log (h, LOG_ERR, "shutdown: encountered non-blob value");
+        int size;
+        if (decode_object (ctx, ctx->dump_stmt, &data, &size) < 0) {
+            flux_log (h, LOG_ERR, "shutdown: skipping undecodable object");
             continue;
         }
-        data = sqlite3_column_blob (ctx->dump_stmt, 0);
-        if (sqlite3_column_type (ctx->dump_stmt, 1) != SQLITE_INTEGER) {
-            flux_log (h, LOG_ERR, "shutdown: selected value is not an integer");
-            errno = EINVAL;
-            goto done;
-        }
-        uncompressed_size = sqlite3_column_int (ctx->dump_stmt, 1);
-        if (uncompressed_size != -1) {
-            if (ctx->lzo_bufsize < uncompressed_size
-                            && grow_lzo_buf (ctx, uncompressed_size) < 0)
-                goto done;
-            int r = LZ4_decompress_safe (data, ctx->lzo_buf, size, uncompressed_size);
-            if (r < 0) {
-                errno = EINVAL;
-                goto done;
-            }
-            if (r != uncompressed_size) {
-                flux_log (h, LOG_ERR, "shutdown: blob size mismatch");
-                errno = EINVAL;
-                goto done;
-            }
-            data = ctx->lzo_buf;
-            size = uncompressed_size;
-        }
         if (!(f = flux_rpc_raw (h, "content.store", data, size,
                                                         FLUX_NODEID_ANY, 0))) {
             flux_log_error (h, "shutdown: store");
@@ -511,17 +1451,83 @@ done:
 static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST, "content-backing.load",    load_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "content-backing.store",   store_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-sqlite.stats.get", stats_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-sqlite.dict-train", dict_train_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "content-sqlite.shutdown", shutdown_cb, 0, },
     { FLUX_MSGTYPE_EVENT,   "shutdown",                broker_shutdown_cb, 0 },
     FLUX_MSGHANDLER_TABLE_END,
 };
 
+/* An unknown codec fails the module load rather than silently falling
+ * back to lz4, since the operator asked for a specific on-disk format.
+ */
+static int process_args (sqlite_ctx_t *ctx, int ac, char **av)
+{
+    int i;
+
+    for (i = 0; i < ac; i++) {
+        if (strncmp (av[i], "batch-limit=", 12) == 0)
+            ctx->batch_limit = strtoul (av[i]+12, NULL, 10);
+        else if (strncmp (av[i], "batch-timeout=", 14) == 0)
+            ctx->batch_timeout = strtod (av[i]+14, NULL);
+        else if (strncmp (av[i], "codec=", 6) == 0) {
+            if (!(ctx->codec = codec_lookup_name (av[i]+6))) {
+#if !HAVE_ZSTD
+                if (strncmp (av[i]+6, "zstd", 4) == 0) {
+                    flux_log (ctx->h, LOG_ERR,
+                              "codec `%s' requires libzstd, which was not "
+                              "found at build time", av[i]+6);
+                    errno = EINVAL;
+                    return -1;
+                }
+#endif
+                flux_log (ctx->h, LOG_ERR, "Unknown codec `%s'", av[i]+6);
+                errno = EINVAL;
+                return -1;
+            }
+        }
+        else if (strncmp (av[i], "compress-threshold=", 19) == 0)
+            ctx->compress_threshold = strtoul (av[i]+19, NULL, 10);
+#if HAVE_ZSTD
+        else if (strncmp (av[i], "zstd-level=", 11) == 0)
+            ctx->zstd_level = strtol (av[i]+11, NULL, 10);
+        else if (strncmp (av[i], "dict-samples=", 13) == 0)
+            ctx->dict_samples = strtoul (av[i]+13, NULL, 10);
+        else if (strncmp (av[i], "dict-size=", 10) == 0)
+            ctx->dict_size = strtoul (av[i]+10, NULL, 10);
+#endif
+        else if (strncmp (av[i], "workers=", 8) == 0)
+            ctx->workers = strtoul (av[i]+8, NULL, 10);
+        else
+            flux_log (ctx->h, LOG_ERR, "Unknown option `%s'", av[i]);
+    }
+    if (ctx->compress_threshold < 0)
+        ctx->compress_threshold = ctx->codec->threshold;
+    if (ctx->batch_limit < 1)
+        ctx->batch_limit = 1;
+    if (ctx->batch_timeout < 0.)
+        ctx->batch_timeout = 0.;
+    return 0;
+}
+
 int mod_main (flux_t *h, int argc, char **argv)
 {
     flux_msg_handler_t **handlers = NULL;
     sqlite_ctx_t *ctx = getctx (h);
+    int rc = -1;
+
     if (!ctx)
         goto done;
+    if (process_args (ctx, argc, argv) < 0)
+        goto done;
+#if HAVE_ZSTD
+    if (dict_open (ctx) < 0)
+        goto done;
+#endif
+    if (pool_start (ctx) < 0) {
+        flux_log_error (h, "starting worker pool");
+        goto done;
+    }
     if (flux_event_subscribe (h, "shutdown") < 0) {
         flux_log_error (h, "flux_event_subscribe");
         goto done;
@@ -542,9 +1548,10 @@ int mod_main (flux_t *h, int argc, char **argv)
         flux_log_error (h, "flux_reactor_run");
         goto done;
     }
+    rc = 0;
 done:
     flux_msg_handler_delvec (handlers);
-    return 0;
+    return rc;
 }
 
 MOD_NAME ("content-sqlite");
@@ -20,6 +20,9 @@
 #endif
 
 #include "src/common/libutil/fluid.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/tstat.h"
+#include "src/common/libutil/workpool.h"
 #include "src/common/libjob/sign_none.h"
 
 #if HAVE_JOBSPEC
@@ -36,8 +39,8 @@
  * 5) make "job-manager.submit" request announcing new jobid
  *
  * For performance, the above actions are batched, so that if job requests
- * arrive within the 'batch_timeout' window, they are combined into one
- * KVS transaction and one job-manager request.
+ * arrive within the batch window, they are combined into one KVS transaction
+ * and one job-manager request.  Several batches may be in flight at once.
  *
  * The jobid is returned to the user in response to the job-ingest.submit RPC.
  * Responses are sent after the job has been successfully ingested.
@@ -52,6 +55,11 @@
  * independent and KVS commit scalability will ultimately limit the max
  * ingest rate for an instance.
  *
+ * Steps 1 and 2 may be spread over a pool of worker threads with the
+ * validate-workers=N module option.  Validated requests are handed back
+ * to the reactor in the order they were received, and everything from
+ * step 3 on runs on the reactor thread.
+ *
  * Security: any user with FLUX_ROLE_USER may submit jobs.  The jobspec
  * must be signed, but this module (running as the instance owner) doesn't
  * need to authenticate the signature.  It merely unwraps the contents,
@@ -61,13 +69,37 @@
  */
 
 
-/* The batch_timeout (seconds) is the maximum length of time
- * any given job request is delayed before initiating a KVS commit.
- * Too large, and individual job submit latency will suffer.
+/* The batch window adapts to load:
+ * - If no batch is in flight, a new batch is committed on the next
+ *   reactor loop iteration, so a lone submit is not delayed.
+ * - Otherwise the window is 'batch_timeout' (seconds) scaled by the
+ *   fraction of the commit pipeline in use, so it grows as the submit
+ *   rate approaches the rate at which batches can be committed.
+ * - A batch is closed early once it holds 'batch_max_jobs' jobs or
+ *   'batch_max_bytes' of signed jobspec, bounding the size of one
+ *   KVS transaction.
+ * - Up to 'batch_max_inflight' batches may be committing or announcing
+ *   at once.  Closed batches wait in the pending queue for a free slot,
+ *   and an open batch whose window expires while the pipeline is full
+ *   keeps accepting jobs until a slot frees up.
+ * Too large a batch_timeout, and individual job submit latency will suffer.
  * Too small, and KVS commit overhead will increase.
+ * All four are tunable with module options, e.g. batch-max-jobs=N.
  */
-const double batch_timeout = 0.01;
+static const double default_batch_timeout = 0.01;
+static const int default_batch_max_jobs = 1024;
+static const int default_batch_max_bytes = 4*1024*1024;
+static const int default_batch_max_inflight = 4;
 
+/* Summary statistics plus a log2 histogram: bucket 0 counts values < 1,
+ * bucket i counts values in [2^(i-1), 2^i), and the last bucket is open.
+ */
+#define HISTOGRAM_BUCKETS 16
+
+struct histogram {
+    tstat_t ts;
+    int bucket[HISTOGRAM_BUCKETS];
+};
 
 struct job_ingest_ctx {
     flux_t *h;
@@ -77,14 +109,34 @@ struct job_ingest_ctx {
     struct fluid_generator gen;
     flux_msg_handler_t **handlers;
 
-    struct batch *batch;
+    struct batch *batch;        // open batch, accepting new jobs
     flux_watcher_t *timer;
+    bool batch_expired;         // window expired while pipeline was full
+    zlist_t *pending;           // closed batches waiting for a free slot
+    int inflight;               // batches committing or announcing
+
+    double batch_timeout;
+    int batch_max_jobs;
+    int batch_max_bytes;
+    int batch_max_inflight;
+
+    int validate_workers;
+    workpool_t *pool;           // validates submit requests if workers > 0
+    flux_watcher_t *pool_w;
+#if HAVE_FLUX_SECURITY
+    flux_security_t **wsec;     // per-worker security contexts
+#endif
+
+    struct histogram batch_jobs;    // jobs per batch
+    struct histogram batch_kbytes;  // KiB of signed jobspec per batch
+    struct histogram latency;       // submit request to response (ms)
 };
 
 struct job {
     fluid_t id;
     char idstr[32];
     flux_msg_t *msg;    // orig. request message
+    struct timespec t_submit;
 };
 
 struct batch {
@@ -92,9 +144,54 @@ struct batch {
     flux_kvs_txn_t *txn;
     zlist_t *jobs;
     json_t *joblist;
+    int bytes;
 };
 
 static int make_key (char *buf, int bufsz, struct job *job, const char *name);
+static void batch_commit (struct batch *batch);
+
+static void histogram_push (struct histogram *hist, double x)
+{
+    int i = 0;
+
+    tstat_push (&hist->ts, x);
+    while (x >= 1. && i < HISTOGRAM_BUCKETS - 1) {
+        x /= 2;
+        i++;
+    }
+    hist->bucket[i]++;
+}
+
+static json_t *histogram_pack (struct histogram *hist)
+{
+    json_t *buckets;
+    json_t *o = NULL;
+    int i;
+
+    if (!(buckets = json_array ()))
+        goto nomem;
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        json_t *n = json_integer (hist->bucket[i]);
+        if (!n || json_array_append_new (buckets, n) < 0) {
+            json_decref (n);
+            goto nomem;
+        }
+    }
+    if (!(o = json_pack ("{s:i s:f s:f s:f s:f s:O}",
+                         "count", tstat_count (&hist->ts),
+                         "min", tstat_min (&hist->ts),
+                         "mean", tstat_mean (&hist->ts),
+                         "stddev", tstat_stddev (&hist->ts),
+                         "max", tstat_max (&hist->ts),
+                         "histogram", buckets)))
+        goto nomem;
+    json_decref (buckets);
+    return o;
+nomem:
+    json_decref (buckets);
+    errno = ENOMEM;
+    return NULL;
+}
 
 
 static void job_destroy (struct job *job)
@@ -125,6 +222,7 @@ static struct job *job_create (struct fluid_generator *gen,
         goto error_inval;
     if (!(job->msg = flux_msg_copy (msg, false)))
         goto error;
+    monotime (&job->t_submit);
     return job;
 error_inval:
     errno = EINVAL;
@@ -185,6 +283,7 @@ static void batch_respond_error (struct batch *batch,
     while (job) {
         if (flux_respond_error (h, job->msg, errnum, "%s", errstr) < 0)
             flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+        histogram_push (&batch->ctx->latency, monotime_since (job->t_submit));
         job = zlist_next (batch->jobs);
     }
 }
@@ -198,6 +297,7 @@ static void batch_respond_success (struct batch *batch)
     while (job) {
         if (flux_respond_pack (h, job->msg, "{s:I}", "id", job->id) < 0)
             flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+        histogram_push (&batch->ctx->latency, monotime_since (job->t_submit));
         job = zlist_next (batch->jobs);
     }
 }
@@ -243,6 +343,69 @@ error:
     return -1;
 }
 
+/* Return the batch window (seconds) for a newly opened batch.
+ */
+static double batch_window (struct job_ingest_ctx *ctx)
+{
+    if (ctx->inflight == 0)
+        return 0.;
+    return ctx->batch_timeout * ctx->inflight / ctx->batch_max_inflight;
+}
+
+/* Close the open batch to new jobs, then commit it, or queue it
+ * if the pipeline is full.
+ */
+static void batch_close (struct job_ingest_ctx *ctx)
+{
+    struct batch *batch = ctx->batch;
+
+    ctx->batch = NULL;
+    ctx->batch_expired = false;
+    flux_watcher_stop (ctx->timer);
+
+    if (zlist_size (batch->jobs) == 0) {
+        batch_destroy (batch);
+        return;
+    }
+    histogram_push (&ctx->batch_jobs, zlist_size (batch->jobs));
+    histogram_push (&ctx->batch_kbytes, batch->bytes / 1024.);
+    if (ctx->inflight < ctx->batch_max_inflight)
+        batch_commit (batch);
+    else if (zlist_append (ctx->pending, batch) < 0) {
+        batch_respond_error (batch, ENOMEM, "error queuing batch");
+        batch_destroy (batch);
+    }
+}
+
+/* Start as many queued batches as the pipeline has room for, then
+ * the open batch if its window has already expired.
+ */
+static void pipeline_advance (struct job_ingest_ctx *ctx)
+{
+    struct batch *batch;
+
+    while (ctx->inflight < ctx->batch_max_inflight) {
+        if ((batch = zlist_pop (ctx->pending)))
+            batch_commit (batch);
+        else if (ctx->batch && ctx->batch_expired)
+            batch_close (ctx);
+        else
+            break;
+    }
+}
+
+/* Batch has been fully processed, successfully or not.
+ * Free its pipeline slot for the next one.
+ */
+static void batch_finish (struct batch *batch)
+{
+    struct job_ingest_ctx *ctx = batch->ctx;
+
+    batch_destroy (batch);
+    ctx->inflight--;
+    pipeline_advance (ctx);
+}
+
 /* Get result of announcing job(s) to job manager,
  * and respond to submit request(s).
  */
@@ -260,8 +423,8 @@ static void batch_announce_continuation (flux_future_t *f, void *arg)
     else
         batch_respond_success (batch);
 
-    batch_destroy (batch);
     flux_future_destroy (f);
+    batch_finish (batch);
 }
 
 /* Announce job(s) to job manager.
@@ -283,20 +446,20 @@ error:
     batch_respond_error (batch, errno, "error sending job-manager.submit RPC");
     if (batch_cleanup (batch) < 0)
         flux_log_error (h, "%s: KVS cleanup failure", __FUNCTION__);
-    batch_destroy (batch);
     flux_future_destroy (f);
+    batch_finish (batch);
 }
 
 /* Get result of KVS commit.
  * If successful, announce job(s) to job-manager.
  */
-static void batch_flush_continuation (flux_future_t *f, void *arg)
+static void batch_commit_continuation (flux_future_t *f, void *arg)
 {
     struct batch *batch = arg;
 
     if (flux_future_get (f, NULL) < 0) {
         batch_respond_error (batch, errno, "KVS commit failed");
-        batch_destroy (batch);
+        batch_finish (batch);
     }
     else {
         batch_announce (batch);
@@ -304,26 +467,21 @@ static void batch_flush_continuation (flux_future_t *f, void *arg)
     flux_future_destroy (f);
 }
 
-/* batch timer - expires 'batch_timeout' seconds after batch was created.
- * Replace ctx->batch with a NULL, and pass 'batch' off to a chain of
- * continuations that commit its data to the KVS, respond to requestors,
- * and announce the new jobids.
+/* Take a pipeline slot and pass 'batch' off to a chain of continuations
+ * that commit its data to the KVS, respond to requestors, and announce
+ * the new jobids.
  */
-static void batch_flush (flux_reactor_t *r, flux_watcher_t *w,
-                         int revents, void *arg)
+static void batch_commit (struct batch *batch)
 {
-    struct job_ingest_ctx *ctx = arg;
-    struct batch *batch;
+    struct job_ingest_ctx *ctx = batch->ctx;
     flux_future_t *f;
 
-    batch = ctx->batch;
-    ctx->batch = NULL;
-
+    ctx->inflight++;
     if (!(f = flux_kvs_commit (ctx->h, 0, batch->txn))) {
         batch_respond_error (batch, errno, "flux_kvs_commit failed");
         goto error;
     }
-    if (flux_future_then (f, -1., batch_flush_continuation, batch) < 0) {
+    if (flux_future_then (f, -1., batch_commit_continuation, batch) < 0) {
         batch_respond_error (batch, errno, "flux_future_then (kvs) failed");
         flux_future_destroy (f);
         if (batch_cleanup (batch) < 0)
@@ -332,7 +490,21 @@ static void batch_flush (flux_reactor_t *r, flux_watcher_t *w,
     }
     return;
 error:
-    batch_destroy (batch);
+    batch_finish (batch);
+}
+
+/* batch timer - expires when the window of the open batch closes.
+ * If the pipeline is full, let the batch keep growing until a slot frees.
+ */
+static void batch_timer_cb (flux_reactor_t *r, flux_watcher_t *w,
+                            int revents, void *arg)
+{
+    struct job_ingest_ctx *ctx = arg;
+
+    if (ctx->inflight < ctx->batch_max_inflight)
+        batch_close (ctx);
+    else
+        ctx->batch_expired = true;
 }
 
 /* Format key within the KVS directory of 'job'.
@@ -408,6 +580,7 @@ static int batch_add_job (struct batch *batch, struct job *job,
         goto nomem;
     }
     free (event);
+    batch->bytes += strlen (J) + jobspecsz;
     return 0;
 nomem:
     errno = ENOMEM;
@@ -421,123 +594,310 @@ error:
     return -1;
 }
 
-/* Handle "job-ingest.submit" request to add a new job.
- * Unwrap the signed jobspec and compare claimed userid to authenticated
- * userid from request (they must match).  Signature does not need to be
- * verified here.  Add job to a batch of new jobs that will be committed
- * after a timer expires.
+/* A submit request being validated.  Validation may run in a worker
+ * thread, so it must touch only this struct and the flux_security_t
+ * context it is handed.
  */
-static void submit_cb (flux_t *h, flux_msg_handler_t *mh,
-                       const flux_msg_t *msg, void *arg)
-{
-    struct job_ingest_ctx *ctx = arg;
-    int flags;
-    struct job *job = NULL;
-    const char *J;
-    const char *jobspec;
-    char *jobspec_cpy = NULL;
-    const char *errmsg = NULL;
-    char errbuf[80];
-    int jobspecsz;
-    int rc;
+struct submit {
+    struct job_ingest_ctx *ctx;
+    struct job *job;
+    char *J;
     uint32_t userid;
     uint32_t rolemask;
     int priority;
-    int64_t userid_signer;
-    const char *mech_type;
+    char *jobspec;      // unwrapped jobspec, set by validation
+    int jobspecsz;
+    int errnum;         // set by validation on failure
+    char errbuf[80];
+};
 
-    if (flux_request_unpack (msg, NULL, "{s:s s:i s:i}",
-                             "J", &J,
-                             "priority", &priority,
-                             "flags", &flags) < 0)
-        goto error;
-    if (flags != 0) {
-        errno = EPROTO;
-        goto error;
+static void submit_destroy (struct submit *sub)
+{
+    if (sub) {
+        int saved_errno = errno;
+        job_destroy (sub->job);
+        free (sub->J);
+        free (sub->jobspec);
+        free (sub);
+        errno = saved_errno;
     }
-    if (flux_msg_get_userid (msg, &userid) < 0)
-        goto error;
-    if (flux_msg_get_rolemask (msg, &rolemask) < 0)
-        goto error;
-    if (priority < FLUX_JOB_PRIORITY_MIN || priority > FLUX_JOB_PRIORITY_MAX) {
-        snprintf (errbuf, sizeof (errbuf), "priority range is [%d:%d]",
-                  FLUX_JOB_PRIORITY_MIN, FLUX_JOB_PRIORITY_MAX);
-        errmsg = errbuf;
-        errno = EINVAL;
+}
+
+static struct submit *submit_create (struct job_ingest_ctx *ctx,
+                                     const flux_msg_t *msg, const char *J,
+                                     uint32_t userid, uint32_t rolemask,
+                                     int priority)
+{
+    struct submit *sub;
+
+    if (!(sub = calloc (1, sizeof (*sub))))
+        return NULL;
+    sub->ctx = ctx;
+    sub->userid = userid;
+    sub->rolemask = rolemask;
+    sub->priority = priority;
+    if (!(sub->job = job_create (&ctx->gen, msg)))
         goto error;
-    }
-    if (!(rolemask & FLUX_ROLE_OWNER) && priority > FLUX_JOB_PRIORITY_DEFAULT) {
-        snprintf (errbuf, sizeof (errbuf),
-                  "only the instance owner can submit with priority >%d",
-                  FLUX_JOB_PRIORITY_DEFAULT);
-        errmsg = errbuf;
-        errno = EINVAL;
+    if (!(sub->J = strdup (J)))
         goto error;
-    }
+    return sub;
+error:
+    submit_destroy (sub);
+    return NULL;
+}
+
+/* Unwrap the signed jobspec and compare claimed userid to authenticated
+ * userid from request (they must match).  Signature does not need to be
+ * verified here.  Then validate the jobspec.  'worker' selects the
+ * security context of a worker thread, or the module's if < 0.
+ * On failure, set sub->errnum and optionally sub->errbuf.
+ */
+static void submit_validate (struct submit *sub, int worker)
+{
+    const char *errmsg = NULL;
+    const char *mech_type;
+    int64_t userid_signer;
 #if HAVE_FLUX_SECURITY
-    if (flux_sign_unwrap_anymech (ctx->sec, J, (const void **)&jobspec,
-                                  &jobspecsz, &mech_type, &userid_signer,
+    struct job_ingest_ctx *ctx = sub->ctx;
+    flux_security_t *sec = worker < 0 ? ctx->sec : ctx->wsec[worker];
+    const void *payload;
+
+    if (flux_sign_unwrap_anymech (sec, sub->J, &payload, &sub->jobspecsz,
+                                  &mech_type, &userid_signer,
                                   FLUX_SIGN_NOVERIFY) < 0) {
-        errmsg = flux_security_last_error (ctx->sec);
+        errmsg = flux_security_last_error (sec);
         goto error;
     }
+    /* 'payload' is owned by 'sec' and overwritten by its next unwrap,
+     * which may happen before the reactor gets to this job.
+     */
+    if (!(sub->jobspec = malloc (sub->jobspecsz + 1)))
+        goto error;
+    memcpy (sub->jobspec, payload, sub->jobspecsz);
+    sub->jobspec[sub->jobspecsz] = '\0';
 #else
     uint32_t userid_signer_u32;
     /* Simplified unwrap only understands mech=none.
      * Unlike flux-security version, returned payload must be freed,
      * and returned userid is a uint32_t.
      */
-    if (sign_none_unwrap (J, (void **)&jobspec_cpy, &jobspecsz,
+    if (sign_none_unwrap (sub->J, (void **)&sub->jobspec, &sub->jobspecsz,
                           &userid_signer_u32) < 0) {
         errmsg = "could not unwrap jobspec";
         goto error;
     }
     mech_type = "none";
-    jobspec = jobspec_cpy;
     userid_signer = userid_signer_u32;
 #endif
     /* If the signature claims to be a user other than the submitting user,
      * do not allow that.
      */
-    if (userid_signer != userid) {
-        snprintf (errbuf, sizeof (errbuf),
+    if (userid_signer != sub->userid) {
+        snprintf (sub->errbuf, sizeof (sub->errbuf),
                   "signer=%lu != requestor=%lu",
-                  (unsigned long)userid_signer, (unsigned long)userid);
-        errmsg = errbuf;
+                  (unsigned long)userid_signer, (unsigned long)sub->userid);
         errno = EPERM;
         goto error;
     }
     /* If not the instance owner, a strong signature is required
      * to give the imp permission to launch processes as the user.
      */
-    if (!(rolemask & FLUX_ROLE_OWNER) && !strcmp (mech_type, "none")) {
-        snprintf (errbuf, sizeof (errbuf),
+    if (!(sub->rolemask & FLUX_ROLE_OWNER) && !strcmp (mech_type, "none")) {
+        snprintf (sub->errbuf, sizeof (sub->errbuf),
                   "only instance owner can use sign-type=none");
-        errmsg = errbuf;
         errno = EPERM;
         goto error;
     }
 #if HAVE_JOBSPEC
-    if (jobspec_validate (jobspec, jobspecsz, errbuf, sizeof (errbuf)) < 0) {
-        errmsg = errbuf;
+    if (jobspec_validate (sub->jobspec, sub->jobspecsz,
+                          sub->errbuf, sizeof (sub->errbuf)) < 0) {
         errno = EINVAL;
         goto error;
     }
 #endif
+    return;
+error:
+    sub->errnum = errno ? errno : EINVAL;
+    if (errmsg)
+        snprintf (sub->errbuf, sizeof (sub->errbuf), "%s", errmsg);
+}
+
+/* Add a validated job to the open batch of new jobs, which is committed
+ * when its window expires or it reaches a size limit, or respond to the
+ * requestor if validation failed.  Runs on the reactor thread, in the
+ * order submit requests were received.
+ */
+static void submit_ingest (struct submit *sub)
+{
+    struct job_ingest_ctx *ctx = sub->ctx;
+    flux_t *h = ctx->h;
+    int rc;
+
+    if (sub->errnum != 0) {
+        errno = sub->errnum;
+        goto error;
+    }
     if (!ctx->batch) {
         if (!(ctx->batch = batch_create (ctx)))
             goto error;
-        flux_timer_watcher_reset (ctx->timer, batch_timeout, 0.);
+        flux_timer_watcher_reset (ctx->timer, batch_window (ctx), 0.);
         flux_watcher_start (ctx->timer);
     }
-    if (!(job = job_create (&ctx->gen, msg)))
+    if (batch_add_job (ctx->batch, sub->job, sub->J, sub->userid,
+                       sub->priority, sub->jobspec, sub->jobspecsz) < 0)
         goto error;
-    if (batch_add_job (ctx->batch, job, J, userid, priority,
-                       jobspec, jobspecsz) < 0) {
-        job_destroy (job);
+    sub->job = NULL; // now owned by batch
+    if (zlist_size (ctx->batch->jobs) >= ctx->batch_max_jobs
+        || ctx->batch->bytes >= ctx->batch_max_bytes)
+        batch_close (ctx);
+    submit_destroy (sub);
+    return;
+error:
+    if (sub->errbuf[0] != '\0')
+        rc = flux_respond_error (h, sub->job->msg, errno, "%s", sub->errbuf);
+    else
+        rc = flux_respond_error (h, sub->job->msg, errno, NULL);
+    if (rc < 0)
+        flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+    submit_destroy (sub);
+}
+
+static void validate_work (void *item, int worker, void *arg)
+{
+    submit_validate (item, worker);
+}
+
+/* Validated requests join the next KVS batch in arrival order, so job
+ * IDs are still allocated in the order requests were received.
+ */
+static void validate_pool_cb (flux_reactor_t *r, flux_watcher_t *w,
+                              int revents, void *arg)
+{
+    struct job_ingest_ctx *ctx = arg;
+    struct submit *sub;
+
+    workpool_clear_event (ctx->pool);
+    while ((sub = workpool_next (ctx->pool)))
+        submit_ingest (sub);
+}
+
+static int validate_pool_start (struct job_ingest_ctx *ctx)
+{
+    int fd;
+
+    if (ctx->validate_workers <= 0)
+        return 0;
+#if HAVE_FLUX_SECURITY
+    int i;
+
+    if (!(ctx->wsec = calloc (ctx->validate_workers, sizeof (ctx->wsec[0]))))
+        return -1;
+    for (i = 0; i < ctx->validate_workers; i++) {
+        if (!(ctx->wsec[i] = flux_security_create (0)))
+            return -1;
+        if (flux_security_configure (ctx->wsec[i], NULL) < 0) {
+            flux_log (ctx->h, LOG_ERR, "flux_security_configure: %s",
+                      flux_security_last_error (ctx->wsec[i]));
+            return -1;
+        }
+    }
+#endif
+    if (!(ctx->pool = workpool_create (ctx->validate_workers,
+                                       validate_work, ctx)))
+        return -1;
+    if ((fd = workpool_pollfd (ctx->pool)) < 0)
+        return -1;
+    if (!(ctx->pool_w = flux_fd_watcher_create (flux_get_reactor (ctx->h),
+                                                fd, FLUX_POLLIN,
+                                                validate_pool_cb, ctx)))
+        return -1;
+    flux_watcher_start (ctx->pool_w);
+    return 0;
+}
+
+/* The module is unloading, so requests still held by the pool are
+ * dropped without a response rather than ingested.  The workers must
+ * be idle before the per-worker security contexts are destroyed.
+ */
+static void validate_pool_stop (struct job_ingest_ctx *ctx)
+{
+    struct submit *sub;
+
+    flux_watcher_destroy (ctx->pool_w);
+    ctx->pool_w = NULL;
+    if (ctx->pool) {
+        workpool_wait (ctx->pool);
+        while ((sub = workpool_next (ctx->pool)))
+            submit_destroy (sub);
+        workpool_destroy (ctx->pool);
+        ctx->pool = NULL;
+    }
+#if HAVE_FLUX_SECURITY
+    if (ctx->wsec) {
+        int i;
+        for (i = 0; i < ctx->validate_workers; i++)
+            flux_security_destroy (ctx->wsec[i]);
+        free (ctx->wsec);
+        ctx->wsec = NULL;
+    }
+#endif
+}
+
+/* Handle "job-ingest.submit" request to add a new job.
+ * Check the request, then validate it and add it to a batch, either
+ * directly or, with validate-workers=N, by way of the worker pool.
+ */
+static void submit_cb (flux_t *h, flux_msg_handler_t *mh,
+                       const flux_msg_t *msg, void *arg)
+{
+    struct job_ingest_ctx *ctx = arg;
+    int flags;
+    struct submit *sub = NULL;
+    const char *J;
+    const char *errmsg = NULL;
+    char errbuf[80];
+    int rc;
+    uint32_t userid;
+    uint32_t rolemask;
+    int priority;
+
+    if (flux_request_unpack (msg, NULL, "{s:s s:i s:i}",
+                             "J", &J,
+                             "priority", &priority,
+                             "flags", &flags) < 0)
+        goto error;
+    if (flags != 0) {
+        errno = EPROTO;
+        goto error;
+    }
+    if (flux_msg_get_userid (msg, &userid) < 0)
+        goto error;
+    if (flux_msg_get_rolemask (msg, &rolemask) < 0)
+        goto error;
+    if (priority < FLUX_JOB_PRIORITY_MIN || priority > FLUX_JOB_PRIORITY_MAX) {
+        snprintf (errbuf, sizeof (errbuf), "priority range is [%d:%d]",
+                  FLUX_JOB_PRIORITY_MIN, FLUX_JOB_PRIORITY_MAX);
+        errmsg = errbuf;
+        errno = EINVAL;
+        goto error;
+    }
+    if (!(rolemask & FLUX_ROLE_OWNER) && priority > FLUX_JOB_PRIORITY_DEFAULT) {
+        snprintf (errbuf, sizeof (errbuf),
+                  "only the instance owner can submit with priority >%d",
+                  FLUX_JOB_PRIORITY_DEFAULT);
+        errmsg = errbuf;
+        errno = EINVAL;
+        goto error;
+    }
+    if (!(sub = submit_create (ctx, msg, J, userid, rolemask, priority)))
         goto error;
+    if (ctx->pool) {
+        if (workpool_submit (ctx->pool, sub) < 0)
+            goto error;
+        return;
     }
-    free (jobspec_cpy);
+    submit_validate (sub, -1);
+    submit_ingest (sub);
     return;
 error:
     if (errmsg)
@@ -546,11 +906,99 @@ error:
         rc = flux_respond_error (h, msg, errno, NULL);
     if (rc < 0)
         flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
-    free (jobspec_cpy);
+    submit_destroy (sub);
+}
+
+/* Handle "job-ingest.stats.get" request.
+ */
+static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
+                          const flux_msg_t *msg, void *arg)
+{
+    struct job_ingest_ctx *ctx = arg;
+    json_t *jobs = NULL;
+    json_t *kbytes = NULL;
+    json_t *latency = NULL;
+
+    if (!(jobs = histogram_pack (&ctx->batch_jobs))
+        || !(kbytes = histogram_pack (&ctx->batch_kbytes))
+        || !(latency = histogram_pack (&ctx->latency)))
+        goto error;
+    if (flux_respond_pack (h, msg,
+                           "{s:i s:i s:i s:i s:f s:f s:i s:i s:i s:i"
+                           " s:O s:O s:O}",
+                           "#validating",
+                           ctx->pool ? workpool_count (ctx->pool) : 0,
+                           "#batches", tstat_count (&ctx->batch_jobs.ts),
+                           "#inflight", ctx->inflight,
+                           "#pending", (int)zlist_size (ctx->pending),
+                           "window (ms)", batch_window (ctx) * 1000,
+                           "batch-timeout (ms)", ctx->batch_timeout * 1000,
+                           "batch-max-jobs", ctx->batch_max_jobs,
+                           "batch-max-bytes", ctx->batch_max_bytes,
+                           "batch-max-inflight", ctx->batch_max_inflight,
+                           "validate-workers", ctx->validate_workers,
+                           "batch size (jobs)", jobs,
+                           "batch size (KiB)", kbytes,
+                           "latency (ms)", latency) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    json_decref (jobs);
+    json_decref (kbytes);
+    json_decref (latency);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+    json_decref (jobs);
+    json_decref (kbytes);
+    json_decref (latency);
+}
+
+/* Handle "job-ingest.stats.clear" request.
+ */
+static void stats_clear_cb (flux_t *h, flux_msg_handler_t *mh,
+                            const flux_msg_t *msg, void *arg)
+{
+    struct job_ingest_ctx *ctx = arg;
+
+    memset (&ctx->batch_jobs, 0, sizeof (ctx->batch_jobs));
+    memset (&ctx->batch_kbytes, 0, sizeof (ctx->batch_kbytes));
+    memset (&ctx->latency, 0, sizeof (ctx->latency));
+    if (flux_respond (h, msg, 0, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+}
+
+static void process_args (struct job_ingest_ctx *ctx, int ac, char **av)
+{
+    int i;
+
+    for (i = 0; i < ac; i++) {
+        if (strncmp (av[i], "batch-timeout=", 14) == 0)
+            ctx->batch_timeout = strtod (av[i]+14, NULL);
+        else if (strncmp (av[i], "batch-max-jobs=", 15) == 0)
+            ctx->batch_max_jobs = strtoul (av[i]+15, NULL, 10);
+        else if (strncmp (av[i], "batch-max-bytes=", 16) == 0)
+            ctx->batch_max_bytes = strtoul (av[i]+16, NULL, 10);
+        else if (strncmp (av[i], "batch-max-inflight=", 19) == 0)
+            ctx->batch_max_inflight = strtoul (av[i]+19, NULL, 10);
+        else if (strncmp (av[i], "validate-workers=", 17) == 0)
+            ctx->validate_workers = strtoul (av[i]+17, NULL, 10);
+        else
+            flux_log (ctx->h, LOG_ERR, "Unknown option `%s'", av[i]);
+    }
+    if (ctx->batch_timeout < 0.)
+        ctx->batch_timeout = 0.;
+    if (ctx->batch_max_jobs < 1)
+        ctx->batch_max_jobs = 1;
+    if (ctx->batch_max_bytes < 1)
+        ctx->batch_max_bytes = 1;
+    if (ctx->batch_max_inflight < 1)
+        ctx->batch_max_inflight = 1;
 }
 
 static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST,  "job-ingest.submit", submit_cb, FLUX_ROLE_USER },
+    { FLUX_MSGTYPE_REQUEST,  "job-ingest.stats.get", stats_get_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST,  "job-ingest.stats.clear", stats_clear_cb, 0 },
     FLUX_MSGHANDLER_TABLE_END,
 };
 
@@ -563,6 +1011,15 @@ int mod_main (flux_t *h, int argc, char **argv)
 
     memset (&ctx, 0, sizeof (ctx));
     ctx.h = h;
+    ctx.batch_timeout = default_batch_timeout;
+    ctx.batch_max_jobs = default_batch_max_jobs;
+    ctx.batch_max_bytes = default_batch_max_bytes;
+    ctx.batch_max_inflight = default_batch_max_inflight;
+    process_args (&ctx, argc, argv);
+    if (!(ctx.pending = zlist_new ())) {
+        flux_log_error (h, "zlist_new");
+        goto done;
+    }
 #if HAVE_FLUX_SECURITY
     if (!(ctx.sec = flux_security_create (0))) {
         flux_log_error (h, "flux_security_create");
@@ -579,7 +1036,7 @@ int mod_main (flux_t *h, int argc, char **argv)
         goto done;
     }
     if (!(ctx.timer = flux_timer_watcher_create (r, 0., 0.,
-                                                 batch_flush, &ctx))) {
+                                                 batch_timer_cb, &ctx))) {
         flux_log_error (h, "flux_timer_watcher_create");
         goto done;
     }
@@ -594,6 +1051,10 @@ int mod_main (flux_t *h, int argc, char **argv)
         flux_log (h, LOG_ERR, "fluid_init failed");
         errno = EINVAL;
     }
+    if (validate_pool_start (&ctx) < 0) {
+        flux_log_error (h, "error starting validate workers");
+        goto done;
+    }
     if (flux_reactor_run (r, 0) < 0) {
         flux_log_error (h, "flux_reactor_run");
         goto done;
@@ -601,7 +1062,15 @@ int mod_main (flux_t *h, int argc, char **argv)
     rc = 0;
 done:
     flux_msg_handler_delvec (ctx.handlers);
+    validate_pool_stop (&ctx);
     flux_watcher_destroy (ctx.timer);
+    if (ctx.pending) {
+        struct batch *batch;
+        while ((batch = zlist_pop (ctx.pending)))
+            batch_destroy (batch);
+        zlist_destroy (&ctx.pending);
+    }
+    batch_destroy (ctx.batch);
 #if HAVE_FLUX_SECURITY
     flux_security_destroy (ctx.sec);
 #endif
@@ -34,12 +34,17 @@ struct watcher {
     bool initial_rpc_received;  // flag is initial watch rpc received
     bool finished;              // flag indicates if watcher is finished
     int initial_rootseq;        // initial rootseq returned by initial rpc
+    int dispatchseq;            // rootseq of last setroot dispatch
     char *key;                  // lookup key
     int flags;                  // kvs_lookup flags
-    zlist_t *lookups;           // list of futures, in commit order
+    zlist_t *lookups;           // list of struct lookup, in commit order
 
     struct namespace *ns;       // back pointer for removal
     json_t *prev;               // previous watch value for KVS_WATCH_FULL
+                                //  or treeobj sent for KVS_WATCH_APPEND
+    flux_future_t *appendf;     // KVS_WATCH_APPEND load of new blobs
+    json_t *append_next;        // treeobj for appendf
+    int append_start;           // index of first blob loaded by appendf
 };
 
 /* Current KVS root.
@@ -63,6 +68,14 @@ struct namespace {
     int errnum;                 // if non-zero, error pending for all watchers
     struct watch_ctx *ctx;      // back-pointer to watch_ctx
     zlist_t *watchers;          // list of watchers of this namespace
+    zhash_t *keywatchers;       // hash of key => list of watchers of key
+    zlist_t *fullwatchers;      // list of FLUX_KVS_WATCH_FULL watchers
+    zhash_t *lookups;           // hash of in flight lookups, for sharing
+    int lookups_sent;           // lookup RPCs sent
+    int lookups_shared;         // lookups that joined one in flight
+    int commits;                // setroot events dispatched
+    json_int_t examined;        // watchers examined by setroot dispatch
+    json_int_t woken;           // watchers woken by setroot dispatch
     char *setroot_topic;        // topic string for setroot subscription
     bool setroot_subscribed;    // setroot subscription active
     char *created_topic;        // topic string for kvs.namespace-created
@@ -72,6 +85,17 @@ struct namespace {
     flux_future_t *getrootf;    // initial getroot future
 };
 
+/* A kvs.lookup-plus RPC, shared by all watchers of the same key
+ * with the same flags and credentials, at the same root.
+ */
+struct lookup {
+    flux_future_t *f;           // lookup future
+    zlist_t *watchers;          // watchers holding a reference
+    char *hashkey;              // key in ns->lookups, NULL if not shared
+    char *response;             // encoded response, created on demand
+    struct namespace *ns;       // back pointer for removal
+};
+
 /* Module state.
  */
 struct watch_ctx {
@@ -80,6 +104,39 @@ struct watch_ctx {
     zhash_t *namespaces;        // hash of monitored namespaces
 };
 
+/* Stop sharing lookup 'l', e.g. once its result is available.
+ */
+static void lookup_unhash (struct lookup *l)
+{
+    if (l->hashkey) {
+        zhash_delete (l->ns->lookups, l->hashkey);
+        free (l->hashkey);
+        l->hashkey = NULL;
+    }
+}
+
+static void lookup_destroy (struct lookup *l)
+{
+    if (l) {
+        int saved_errno = errno;
+        lookup_unhash (l);
+        flux_future_destroy (l->f);
+        zlist_destroy (&l->watchers);
+        free (l->response);
+        free (l);
+        errno = saved_errno;
+    }
+}
+
+/* Drop watcher's reference on lookup 'l', destroying it after the last.
+ */
+static void lookup_release (struct lookup *l, struct watcher *w)
+{
+    zlist_remove (l->watchers, w);
+    if (zlist_size (l->watchers) == 0)
+        lookup_destroy (l);
+}
+
 static void watcher_destroy (struct watcher *w)
 {
     if (w) {
@@ -87,12 +144,14 @@ static void watcher_destroy (struct watcher *w)
         flux_msg_destroy (w->request);
         free (w->key);
         if (w->lookups) {
-            flux_future_t *f;
-            while ((f = zlist_pop (w->lookups)))
-                flux_future_destroy (f);
+            struct lookup *l;
+            while ((l = zlist_pop (w->lookups)))
+                lookup_release (l, w);
             zlist_destroy (&w->lookups);
         }
         json_decref (w->prev);
+        flux_future_destroy (w->appendf);
+        json_decref (w->append_next);
         free (w);
         errno = saved_errno;
     }
@@ -163,6 +222,9 @@ static void namespace_destroy (struct namespace *ns)
                 watcher_destroy (w);
             zlist_destroy (&ns->watchers);
         }
+        zhash_destroy (&ns->keywatchers);
+        zlist_destroy (&ns->fullwatchers);
+        zhash_destroy (&ns->lookups);
         if (ns->setroot_subscribed)
             (void)flux_event_unsubscribe (ns->ctx->h, ns->setroot_topic);
         if (ns->created_subscribed)
@@ -187,6 +249,12 @@ static struct namespace *namespace_create (struct watch_ctx *ctx,
         return NULL;
     if (!(ns->watchers = zlist_new ()))
         goto error;
+    if (!(ns->keywatchers = zhash_new ()))
+        goto error;
+    if (!(ns->fullwatchers = zlist_new ()))
+        goto error;
+    if (!(ns->lookups = zhash_new ()))
+        goto error;
     if (!(ns->name = strdup (namespace)))
         goto error;
     if (asprintf (&ns->setroot_topic, "kvs.setroot-%s", namespace) < 0)
@@ -227,6 +295,55 @@ static int check_authorization (struct namespace *ns,
     return -1;
 }
 
+/* Add watcher to ns->watchers, and index it so that a setroot event
+ * need only examine the watchers of the keys changed by the commit.
+ * FLUX_KVS_WATCH_FULL watchers are kept on a separate list since they
+ * look up their key on every commit.
+ */
+static int watcher_add (struct namespace *ns, struct watcher *w)
+{
+    zlist_t *l;
+
+    if (zlist_append (ns->watchers, w) < 0)
+        goto nomem;
+    if ((w->flags & FLUX_KVS_WATCH_FULL)) {
+        if (zlist_append (ns->fullwatchers, w) < 0)
+            goto nomem_remove;
+        return 0;
+    }
+    if (!(l = zhash_lookup (ns->keywatchers, w->key))) {
+        if (!(l = zlist_new ()))
+            goto nomem_remove;
+        if (zhash_insert (ns->keywatchers, w->key, l) < 0) {
+            zlist_destroy (&l);
+            goto nomem_remove;
+        }
+        zhash_freefn (ns->keywatchers, w->key, (zhash_free_fn *)zlist_destroy);
+    }
+    if (zlist_append (l, w) < 0)
+        goto nomem_remove;
+    return 0;
+nomem_remove:
+    zlist_remove (ns->watchers, w);
+nomem:
+    errno = ENOMEM;
+    return -1;
+}
+
+static void watcher_remove (struct namespace *ns, struct watcher *w)
+{
+    zlist_t *l;
+
+    zlist_remove (ns->watchers, w);
+    if ((w->flags & FLUX_KVS_WATCH_FULL))
+        zlist_remove (ns->fullwatchers, w);
+    else if ((l = zhash_lookup (ns->keywatchers, w->key))) {
+        zlist_remove (l, w);
+        if (zlist_size (l) == 0)
+            zhash_delete (ns->keywatchers, w->key);
+    }
+}
+
 /* Helper for watcher_respond - is key a member of array?
  * N.B. array 'a' can be NULL
  */
@@ -246,8 +363,8 @@ static bool array_match (json_t *a, const char *key)
 static void watcher_cleanup (struct namespace *ns, struct watcher *w)
 {
     /* wait for all in flight lookups to complete before destroying watcher */
-    if (zlist_size (w->lookups) == 0) {
-        zlist_remove (ns->watchers, w);
+    if (zlist_size (w->lookups) == 0 && !w->appendf) {
+        watcher_remove (ns, w);
         watcher_destroy (w);
     }
     /* if ns->getrootf, destroy when getroot_continuation completes */
@@ -311,12 +428,30 @@ static int handle_compare_response (flux_t *h,
     return 0;
 }
 
+/* Response payload is the same for all watchers sharing lookup 'l',
+ * so encode it once.
+ */
 static int handle_normal_response (flux_t *h,
                                    struct watcher *w,
+                                   struct lookup *l,
                                    json_t *val)
 {
-    if (flux_respond_pack (h, w->request, "{ s:O }", "val", val) < 0) {
-        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    if (!l->response) {
+        json_t *o;
+
+        if (!(o = json_pack ("{ s:O }", "val", val))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        l->response = json_dumps (o, JSON_COMPACT);
+        json_decref (o);
+        if (!l->response) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    if (flux_respond (h, w->request, 0, l->response) < 0) {
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
         return -1;
     }
 
@@ -324,16 +459,208 @@ static int handle_normal_response (flux_t *h,
     return 0;
 }
 
-/* New value of key is available in future 'f' container.
- * Send response to watcher using raw payload from lookup response.
- * Return 0 on success, -1 on error (caller should destroy watcher).
+static void watcher_process_lookups (struct watcher *w);
+
+/* Send data appended to the key, and remember 'val' as the treeobj
+ * delivered so far.
+ */
+static int append_respond (flux_t *h,
+                           struct watcher *w,
+                           json_t *val,
+                           const void *data, int len)
+{
+    json_t *o;
+
+    if (!(o = treeobj_create_val (data, len)))
+        return -1;
+    if (flux_respond_pack (h, w->request, "{ s:o }", "val", o) < 0) {
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+        return -1;
+    }
+    json_decref (w->prev);
+    w->prev = json_incref (val);
+    w->responded = true;
+    return 0;
+}
+
+/* Return true if 'blobref' is the blobref of the data in val object 'val'.
+ */
+static bool blobref_match_val (const char *blobref, json_t *val)
+{
+    char hashtype[16];
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    const char *cp;
+    void *data = NULL;
+    int len;
+    bool match = false;
+
+    if (!(cp = strchr (blobref, '-')) || cp - blobref >= sizeof (hashtype))
+        return false;
+    memcpy (hashtype, blobref, cp - blobref);
+    hashtype[cp - blobref] = '\0';
+    if (treeobj_decode_val (val, &data, &len) == 0
+        && blobref_hash (hashtype, data, len, ref, sizeof (ref)) == 0
+        && !strcmp (ref, blobref))
+        match = true;
+    free (data);
+    return match;
+}
+
+/* The blobs needed for a KVS_WATCH_APPEND response have been loaded.
+ * Send them, then continue with any lookups that completed meanwhile.
+ */
+static void append_continuation (flux_future_t *f, void *arg)
+{
+    struct watcher *w = arg;
+    flux_t *h = flux_future_get_flux (f);
+    int count = treeobj_get_count (w->append_next) - w->append_start;
+    const void *buf;
+    int len;
+    char *data = NULL;
+    int total = 0;
+    int i;
+
+    if (w->finished)
+        goto done;
+    for (i = 0; i < count; i++) {
+        char *tmp;
+        if (flux_content_load_batch_get (f, i, &buf, &len) < 0)
+            goto error;
+        if (!(tmp = realloc (data, total + len + 1))) {
+            errno = ENOMEM;
+            goto error;
+        }
+        data = tmp;
+        memcpy (data + total, buf, len);
+        total += len;
+    }
+    if (append_respond (h, w, w->append_next, data, total) < 0)
+        goto error;
+    goto done;
+error:
+    if (!w->mute) {
+        if (flux_respond_error (h, w->request, errno, NULL) < 0)
+            flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+    }
+    w->finished = true;
+done:
+    free (data);
+    flux_future_destroy (f);
+    w->appendf = NULL;
+    json_decref (w->append_next);
+    w->append_next = NULL;
+    watcher_process_lookups (w);
+}
+
+/* KVS_WATCH_APPEND: 'val' is the treeobj of the key, looked up with
+ * FLUX_KVS_TREEOBJ.  Appends to a key add blobrefs to its valref, so the
+ * blobrefs already sent to the watcher are a prefix of the new ones, and
+ * only the blobs past them need to be loaded and sent.  A val object,
+ * e.g. a key that has only been put once, counts as one blob.
+ * If the key was overwritten rather than appended to, fail with EINVAL.
+ * The response may be sent asynchronously, once w->appendf is fulfilled.
+ */
+static int handle_append_response (flux_t *h,
+                                   struct watcher *w,
+                                   json_t *val)
+{
+    int start = 0;
+    int count;
+    const char **refs = NULL;
+    int i;
+
+    if (treeobj_is_dir (val)
+        || treeobj_is_dirref (val)
+        || treeobj_is_hdir (val)) {
+        errno = EISDIR;
+        return -1;
+    }
+    if (treeobj_is_val (val)) {
+        void *data;
+        int len;
+        void *prev_data = NULL;
+        int prev_len = 0;
+        int rc;
+
+        /* A val can only extend a previous val, if overwritten with
+         * longer data.
+         */
+        if (w->prev && (!treeobj_is_val (w->prev)
+                        || treeobj_decode_val (w->prev, &prev_data,
+                                               &prev_len) < 0))
+            goto error_inval;
+        if (treeobj_decode_val (val, &data, &len) < 0) {
+            free (prev_data);
+            return -1;
+        }
+        if (len < prev_len
+            || (prev_len > 0 && memcmp (data, prev_data, prev_len) != 0)) {
+            free (prev_data);
+            free (data);
+            goto error_inval;
+        }
+        if (w->prev && len == prev_len)
+            rc = 0;
+        else
+            rc = append_respond (h, w, val, (char *)data + prev_len,
+                                 len - prev_len);
+        free (prev_data);
+        free (data);
+        return rc;
+    }
+    if (!treeobj_is_valref (val))
+        goto error_inval;
+    count = treeobj_get_count (val);
+    if (w->prev) {
+        if (treeobj_is_val (w->prev)) {
+            if (!blobref_match_val (treeobj_get_blobref (val, 0), w->prev))
+                goto error_inval;
+            start = 1;
+        }
+        else {
+            /* Only the last blobref sent is compared, to keep this
+             * independent of the length of the value.
+             */
+            start = treeobj_get_count (w->prev);
+            if (count < start
+                || strcmp (treeobj_get_blobref (val, start - 1),
+                           treeobj_get_blobref (w->prev, start - 1)) != 0)
+                goto error_inval;
+        }
+    }
+    if (start == count)
+        return 0;
+    if (!(refs = calloc (count - start, sizeof (refs[0]))))
+        return -1;
+    for (i = start; i < count; i++)
+        refs[i - start] = treeobj_get_blobref (val, i);
+    if (!(w->appendf = flux_content_load_batch (h, refs, count - start, 0))
+        || flux_future_then (w->appendf, -1., append_continuation, w) < 0)
+        goto error;
+    w->append_next = json_incref (val);
+    w->append_start = start;
+    free (refs);
+    return 0;
+error_inval:
+    errno = EINVAL;
+error:
+    flux_future_destroy (w->appendf);
+    w->appendf = NULL;
+    free (refs);
+    return -1;
+}
+
+/* New value of key is available in lookup 'l' future container.
+ * Send response to watcher using payload from lookup response.
+ * On error, respond with error and mark watcher finished.
  *
  * Exception for FLUX_KVS_WATCH_FULL, must check if value is
  * different than old value.
  */
-static void handle_lookup_response (flux_future_t *f,
+static void handle_lookup_response (struct lookup *l,
                                     struct watcher *w)
 {
+    flux_future_t *f = l->f;
     flux_t *h = flux_future_get_flux (f);
     int errnum;
     int root_seq;
@@ -380,7 +707,12 @@ static void handle_lookup_response (flux_future_t *f,
             goto error;
         }
 
-        if (handle_initial_response (h, w, val, root_seq) < 0)
+        if ((w->flags & FLUX_KVS_WATCH_APPEND)) {
+            w->initial_rootseq = root_seq;
+            if (handle_append_response (h, w, val) < 0)
+                goto error;
+        }
+        else if (handle_initial_response (h, w, val, root_seq) < 0)
             goto error;
     }
     else {
@@ -404,13 +736,17 @@ static void handle_lookup_response (flux_future_t *f,
             return;
 
         if (!w->mute) {
-            if ((w->flags & FLUX_KVS_WATCH_FULL)
+            if ((w->flags & FLUX_KVS_WATCH_APPEND)) {
+                if (handle_append_response (h, w, val) < 0)
+                    goto error;
+            }
+            else if ((w->flags & FLUX_KVS_WATCH_FULL)
                 || (w->flags & FLUX_KVS_WATCH_UNIQ)) {
                 if (handle_compare_response (h, w, val) < 0)
                     goto error;
             }
             else {
-                if (handle_normal_response (h, w, val) < 0)
+                if (handle_normal_response (h, w, l, val) < 0)
                     goto error;
             }
         }
@@ -424,20 +760,23 @@ error:
     w->finished = true;
 }
 
-/* One lookup has completed.
- * Pop ready futures off w->lookups and send responses, until
- * the list is empty, or a non-ready future is encountered.
+/* Pop lookups with ready futures off w->lookups and send responses,
+ * until the list is empty, or a non-ready future is encountered.
+ * A KVS_WATCH_APPEND watcher also stops while it is loading blobs for
+ * a response, and resumes from append_continuation().
  */
-static void lookup_continuation (flux_future_t *f, void *arg)
+static void watcher_process_lookups (struct watcher *w)
 {
-    struct watcher *w = arg;
     struct namespace *ns = w->ns;
+    struct lookup *l;
 
-    while ((f = zlist_first (w->lookups)) && flux_future_is_ready (f)) {
-        f = zlist_pop (w->lookups);
+    while (!w->appendf
+           && (l = zlist_first (w->lookups))
+           && flux_future_is_ready (l->f)) {
+        l = zlist_pop (w->lookups);
         if (!w->finished)
-            handle_lookup_response (f, w);
-        flux_future_destroy (f);
+            handle_lookup_response (l, w);
+        lookup_release (l, w);
         /* if WAITCREATE and !WATCH, then we only care about sending
          * one response and being done.  We can use the responded flag
          * to indicate that condition.
@@ -451,6 +790,32 @@ static void lookup_continuation (flux_future_t *f, void *arg)
         watcher_cleanup (ns, w);
 }
 
+/* One lookup has completed.
+ * Process the lookups of each watcher sharing it.
+ * N.B. the last watcher to release 'l' destroys it, and any watcher may
+ * be destroyed while its lookups are processed, so a temporary duplicate
+ * of the watchers list must be iterated here.
+ */
+static void lookup_continuation (flux_future_t *f, void *arg)
+{
+    struct lookup *l = arg;
+    zlist_t *watchers;
+    struct watcher *w;
+
+    lookup_unhash (l);
+    if (!(watchers = zlist_dup (l->watchers))) {
+        flux_log_error (flux_future_get_flux (f), "%s: zlist_dup",
+                        __FUNCTION__);
+        return;
+    }
+    w = zlist_first (watchers);
+    while (w) {
+        watcher_process_lookups (w);
+        w = zlist_next (watchers);
+    }
+    zlist_destroy (&watchers);
+}
+
 /* Like flux_kvs_lookupat() except:
  * - targets kvs.lookup-plus, so root_ref & root_seq are available in
  *   response
@@ -468,15 +833,19 @@ static flux_future_t *lookupat (flux_t *h,
     flux_msg_t *msg;
     json_t *o = NULL;
     flux_future_t *f;
+    int flags = w->flags;
     int saved_errno;
 
+    /* KVS_WATCH_APPEND needs the valref, to load only new blobs */
+    if ((flags & FLUX_KVS_WATCH_APPEND))
+        flags |= FLUX_KVS_TREEOBJ;
     if (!(msg = flux_request_encode ("kvs.lookup-plus", NULL)))
         return NULL;
     if (!w->initial_rpc_sent) {
         if (flux_msg_pack (msg, "{s:s s:s s:i}",
                            "key", w->key,
                            "namespace", namespace,
-                           "flags", w->flags) < 0)
+                           "flags", flags) < 0)
             goto error;
     }
     else {
@@ -485,7 +854,7 @@ static flux_future_t *lookupat (flux_t *h,
         if (flux_msg_pack (msg, "{s:s s:s s:i s:i s:O}",
                            "key", w->key,
                            "namespace", namespace,
-                           "flags", w->flags,
+                           "flags", flags,
                            "rootseq", root_seq,
                            "rootdir", o) < 0)
             goto error;
@@ -521,28 +890,94 @@ error:
     return NULL;
 }
 
-static int process_lookup_response (struct namespace *ns, struct watcher *w)
+/* Send lookup for watcher 'w' at the current root.
+ * If 'hashkey' is non-NULL, make the lookup available for sharing
+ * under it until the response arrives.
+ */
+static struct lookup *lookup_create (struct namespace *ns,
+                                     struct watcher *w,
+                                     const char *hashkey)
 {
-    flux_future_t *f;
-    if (!(f = lookupat (ns->ctx->h,
-                        w,
-                        ns->commit->rootref,
-                        ns->commit->rootseq,
-                        ns->name))) {
+    struct lookup *l;
+
+    if (!(l = calloc (1, sizeof (*l))))
+        return NULL;
+    l->ns = ns;
+    if (!(l->watchers = zlist_new ()))
+        goto error_nomem;
+    if (!(l->f = lookupat (ns->ctx->h,
+                           w,
+                           ns->commit->rootref,
+                           ns->commit->rootseq,
+                           ns->name))) {
         flux_log_error (ns->ctx->h, "%s: lookupat", __FUNCTION__);
-        return -1;
+        goto error;
     }
-    if (zlist_append (w->lookups, f) < 0) {
-        flux_future_destroy (f);
-        errno = ENOMEM;
-        return -1;
+    if (flux_future_then (l->f, -1., lookup_continuation, l) < 0)
+        goto error;
+    if (hashkey) {
+        if (!(l->hashkey = strdup (hashkey)))
+            goto error_nomem;
+        if (zhash_insert (ns->lookups, l->hashkey, l) < 0) {
+            free (l->hashkey);
+            l->hashkey = NULL;
+            goto error_nomem;
+        }
     }
-    if (flux_future_then (f, -1., lookup_continuation, w) < 0) {
-        flux_future_destroy (f);
-        return -1;
+    ns->lookups_sent++;
+    return l;
+error_nomem:
+    errno = ENOMEM;
+error:
+    lookup_destroy (l);
+    return NULL;
+}
+
+/* Look up w->key at the current root.  Once a watcher has sent its
+ * initial lookup, its lookups differ from those of other watchers only by
+ * key, flags, and credentials, so a lookup already in flight for the same
+ * tuple at the same root is shared rather than sent again.  The root is
+ * identified by its blobref: rootseq restarts if the kvs module on rank 0
+ * is reloaded, so it alone cannot tell two roots apart.
+ */
+static int process_lookup_response (struct namespace *ns, struct watcher *w)
+{
+    struct lookup *l = NULL;
+    char *hashkey = NULL;
+
+    if (w->initial_rpc_sent) {
+        if (asprintf (&hashkey, "%s:%d:%d:%ju:%ju:%s",
+                      ns->commit->rootref,
+                      ns->commit->rootseq,
+                      w->flags,
+                      (uintmax_t)w->userid,
+                      (uintmax_t)w->rolemask,
+                      w->key) < 0) {
+            errno = ENOMEM;
+            return -1;
+        }
+        if ((l = zhash_lookup (ns->lookups, hashkey)))
+            ns->lookups_shared++;
+    }
+    if (!l && !(l = lookup_create (ns, w, hashkey)))
+        goto error;
+    if (zlist_append (l->watchers, w) < 0) {
+        if (zlist_size (l->watchers) == 0)
+            lookup_destroy (l);
+        goto error_nomem;
+    }
+    if (zlist_append (w->lookups, l) < 0) {
+        lookup_release (l, w);
+        goto error_nomem;
     }
     w->rootseq = ns->commit->rootseq;
+    free (hashkey);
     return 0;
+error_nomem:
+    errno = ENOMEM;
+error:
+    free (hashkey);
+    return -1;
 }
 
 /* Respond to watcher request, if appropriate.
@@ -608,6 +1043,8 @@ static void watcher_respond (struct namespace *ns, struct watcher *w)
     if (w->rootseq == -1
         || (w->flags & FLUX_KVS_WATCH_FULL)
         || array_match (ns->commit->keys, w->key)) {
+        if (w->rootseq != -1)
+            ns->woken++;
         if (process_lookup_response (ns, w) < 0)
             goto error_respond;
     }
@@ -644,6 +1081,54 @@ static void watcher_respond_ns (struct namespace *ns)
         flux_log_error (ns->ctx->h, "%s: zlist_dup", __FUNCTION__);
 }
 
+/* Respond to the watchers that may be affected by the current commit:
+ * those watching a key in ns->commit->keys, and FLUX_KVS_WATCH_FULL
+ * watchers.  This avoids visiting every watcher of the namespace on
+ * every setroot event.
+ * N.B. a key may appear more than once in the commit keys, so
+ * w->dispatchseq marks watchers already gathered for this commit.
+ */
+static void watcher_respond_keys (struct namespace *ns)
+{
+    zlist_t *l;
+    zlist_t *kl;
+    struct watcher *w;
+    size_t index;
+    json_t *value;
+    int rootseq = ns->commit->rootseq;
+
+    if (!(l = zlist_dup (ns->fullwatchers)))
+        goto nomem;
+    json_array_foreach (ns->commit->keys, index, value) {
+        const char *key = json_string_value (value);
+        if (!key || !(kl = zhash_lookup (ns->keywatchers, key)))
+            continue;
+        w = zlist_first (kl);
+        while (w) {
+            if (w->dispatchseq != rootseq) {
+                w->dispatchseq = rootseq;
+                if (zlist_append (l, w) < 0)
+                    goto nomem;
+            }
+            w = zlist_next (kl);
+        }
+    }
+    ns->examined += zlist_size (l);
+    /* N.B. watcher_respond() may destroy 'ns' with its last watcher */
+    w = zlist_first (l);
+    while (w) {
+        watcher_respond (ns, w);
+        w = zlist_next (l);
+    }
+    zlist_destroy (&l);
+    return;
+nomem:
+    flux_log_error (ns->ctx->h, "%s: out of memory", __FUNCTION__);
+    zlist_destroy (&l);
+    ns->examined += zlist_size (ns->watchers);
+    watcher_respond_ns (ns);
+}
+
 /* Cancel watcher 'w' if it matches (sender, matchtag).
  * matchtag=FLUX_MATCHTAG_NONE matches any matchtag.
  * If 'mute' is true, suppress response (e.g. for disconnect handling).
@@ -787,6 +1272,7 @@ static void setroot_cb (flux_t *h, flux_msg_handler_t *mh,
     int owner;
     json_t *keys;
     struct commit *commit;
+    bool started;
 
     if (flux_event_unpack (msg, NULL, "{s:s s:i s:s s:i s:o}",
                            "namespace", &namespace,
@@ -805,10 +1291,20 @@ static void setroot_cb (flux_t *h, flux_msg_handler_t *mh,
         ns->errnum = errno;
         goto done;
     }
+    started = ns->commit != NULL;
     commit_destroy (ns->commit);
     ns->commit = commit;
     if (ns->owner == FLUX_USERID_UNKNOWN)
         ns->owner = owner;
+    ns->commits++;
+    /* Before the first commit, watchers may still be waiting to send
+     * their initial lookup, so visit them all.
+     */
+    if (started) {
+        watcher_respond_keys (ns);
+        return;
+    }
+    ns->examined += zlist_size (ns->watchers);
 done:
     watcher_respond_ns (ns);
 }
@@ -923,9 +1419,8 @@ static void lookup_cb (flux_t *h, flux_msg_handler_t *mh,
     if (!(w = watcher_create (msg, key_suffix ? key_suffix : key, flags)))
         goto error;
     w->ns = ns;
-    if (zlist_append (ns->watchers, w) < 0) {
+    if (watcher_add (ns, w) < 0) {
         watcher_destroy (w);
-        errno = ENOMEM;
         goto error;
     }
     if (ns->commit)
@@ -1001,13 +1496,21 @@ static void stats_cb (flux_t *h, flux_msg_handler_t *mh,
         goto nomem;
     ns = zhash_first (ctx->namespaces);
     while (ns) {
-        json_t *o = json_pack ("{s:i s:i s:s s:i}",
+        json_t *o = json_pack ("{s:i s:i s:s s:i s:{s:i s:I s:I}"
+                               " s:{s:i s:i}}",
                                "owner", (int)ns->owner,
                                "rootseq", ns->commit ? ns->commit->rootseq
                                                      : -1,
                                "rootref", ns->commit ? ns->commit->rootref
                                                      : "(null)",
-                               "watchers", (int)zlist_size (ns->watchers));
+                               "watchers", (int)zlist_size (ns->watchers),
+                               "dispatch",
+                                 "commits", ns->commits,
+                                 "examined", ns->examined,
+                                 "woken", ns->woken,
+                               "lookups",
+                                 "sent", ns->lookups_sent,
+                                 "shared", ns->lookups_shared);
         if (!o)
             goto nomem;
         if (json_object_set_new (stats, ns->name, o) < 0) {
@@ -48,7 +48,7 @@ struct cache_entry {
                              * zero length data can be valid */
     bool dirty;
     int errnum;
-    char *blobref;
+    struct blobkey key;     /* hash type and digest */
 };
 
 struct cache {
@@ -69,9 +69,9 @@ struct cache_entry *cache_entry_create (const char *ref)
         return NULL;
     }
 
-    if (!(entry->blobref = strdup (ref))) {
+    if (blobkey_fromstr (&entry->key, ref) < 0) {
         cache_entry_destroy (entry);
-        errno = ENOMEM;
+        errno = EINVAL;
         return NULL;
     }
 
@@ -255,7 +255,6 @@ void cache_entry_destroy (void *arg)
             wait_queue_destroy (entry->waitlist_notdirty);
         if (entry->waitlist_valid)
             wait_queue_destroy (entry->waitlist_valid);
-        free (entry->blobref);
         free (entry);
     }
 }
@@ -289,7 +288,12 @@ int cache_entry_wait_valid (struct cache_entry *entry, wait_t *wait)
 struct cache_entry *cache_lookup (struct cache *cache, const char *ref,
                                   int current_epoch)
 {
-    struct cache_entry *entry = zhashx_lookup (cache->zhx, ref);
+    struct blobkey key;
+    struct cache_entry *entry;
+
+    if (blobkey_fromstr (&key, ref) < 0)
+        return NULL;
+    entry = zhashx_lookup (cache->zhx, &key);
     if (entry && current_epoch > entry->lastuse_epoch)
         entry->lastuse_epoch = current_epoch;
     return entry;
@@ -300,7 +304,7 @@ int cache_insert (struct cache *cache, struct cache_entry *entry)
     int rc;
 
     if (cache && entry) {
-        rc = zhashx_insert (cache->zhx, entry->blobref, entry);
+        rc = zhashx_insert (cache->zhx, &entry->key, entry);
         assert (rc == 0);
     }
     return 0;
@@ -308,15 +312,19 @@ int cache_insert (struct cache *cache, struct cache_entry *entry)
 
 int cache_remove_entry (struct cache *cache, const char *ref)
 {
-    struct cache_entry *entry = zhashx_lookup (cache->zhx, ref);
+    struct blobkey key;
+    struct cache_entry *entry;
 
+    if (blobkey_fromstr (&key, ref) < 0)
+        return 0;
+    entry = zhashx_lookup (cache->zhx, &key);
     if (entry
         && !entry->dirty
         && (!entry->waitlist_notdirty
             || !wait_queue_length (entry->waitlist_notdirty))
         && (!entry->waitlist_valid
             || !wait_queue_length (entry->waitlist_valid))) {
-        zhashx_delete (cache->zhx, ref);
+        zhashx_delete (cache->zhx, &key);
         return 1;
     }
     return 0;
@@ -339,7 +347,7 @@ static int cache_entry_age (struct cache_entry *entry, int current_epoch)
 int cache_expire_entries (struct cache *cache, int current_epoch, int thresh)
 {
     zlistx_t *keys;
-    char *ref;
+    struct blobkey *key;
     struct cache_entry *entry;
     int count = 0;
 
@@ -349,17 +357,17 @@ int cache_expire_entries (struct cache *cache, int current_epoch, int thresh)
         errno = ENOMEM;
         return -1;
     }
-    ref = zlistx_first (keys);
-    while (ref) {
-        if ((entry = zhashx_lookup (cache->zhx, ref))
+    key = zlistx_first (keys);
+    while (key) {
+        if ((entry = zhashx_lookup (cache->zhx, key))
             && !cache_entry_get_dirty (entry)
             && cache_entry_get_valid (entry)
             && (thresh == 0
                 || cache_entry_age (entry, current_epoch) > thresh)) {
-                zhashx_delete (cache->zhx, ref);
+                zhashx_delete (cache->zhx, key);
                 count++;
         }
-        ref = zlistx_next (keys);
+        key = zlistx_next (keys);
     }
     zlistx_destroy (&keys);
     return count;
@@ -369,7 +377,7 @@ int cache_get_stats (struct cache *cache, tstat_t *ts, int *sizep,
                      int *incompletep, int *dirtyp)
 {
     struct cache_entry *entry;
-    const char *key;
+    const struct blobkey *key;
     int size = 0;
     int incomplete = 0;
     int dirty = 0;
@@ -399,7 +407,7 @@ int cache_get_stats (struct cache *cache, tstat_t *ts, int *sizep,
 
 int cache_wait_destroy_msg (struct cache *cache, wait_test_msg_f cb, void *arg)
 {
-    const char *key;
+    const struct blobkey *key;
     struct cache_entry *entry;
     int n, count = 0;
     int rc = -1;
@@ -421,9 +429,14 @@ done:
     return rc;
 }
 
-const char *cache_entry_get_blobref (struct cache_entry *entry)
+int cache_entry_get_blobref (struct cache_entry *entry, char *blobref,
+                             int len)
 {
-    return entry ? entry->blobref : NULL;
+    if (!entry) {
+        errno = EINVAL;
+        return -1;
+    }
+    return blobkey_tostr (&entry->key, blobref, len);
 }
 
 static void cache_entry_destroy_wrapper (void **arg)
@@ -445,7 +458,9 @@ struct cache *cache_create (void)
         errno = ENOMEM;
         return NULL;
     }
-    /* do not duplicate hash keys, use blobrefs stored in cache entry */
+    /* do not duplicate hash keys, use digests stored in cache entry */
+    zhashx_set_key_hasher (cache->zhx, blobkey_hasher);
+    zhashx_set_key_comparator (cache->zhx, blobkey_cmp);
     zhashx_set_key_destructor (cache->zhx, NULL);
     zhashx_set_key_duplicator (cache->zhx, NULL);
     zhashx_set_destructor (cache->zhx, cache_entry_destroy_wrapper);
@@ -23,7 +23,8 @@ struct cache;
 /* Create/destroy cache entry.
  *
  * cache_entry_create() creates an empty cache entry.  Data can be set
- * in an entry via cache_entry_set_raw().
+ * in an entry via cache_entry_set_raw().  It fails with EINVAL if 'ref'
+ * is not a well formed blobref.
  */
 struct cache_entry *cache_entry_create (const char *ref);
 void cache_entry_destroy (void *arg);
@@ -99,8 +100,13 @@ int cache_entry_set_errnum_on_notdirty (struct cache_entry *entry, int errnum);
 int cache_entry_wait_notdirty (struct cache_entry *entry, wait_t *wait);
 int cache_entry_wait_valid (struct cache_entry *entry, wait_t *wait);
 
-/* Get the blobref of this entry */
-const char *cache_entry_get_blobref (struct cache_entry *entry);
+/* Get the blobref of this entry.  Entries are keyed internally by
+ * binary digest, so the blobref string is formatted into 'blobref',
+ * which should be at least BLOBREF_MAX_STRING_SIZE bytes.
+ * Returns -1 on error, 0 on success
+ */
+int cache_entry_get_blobref (struct cache_entry *entry, char *blobref,
+                             int len);
 
 /* Create/destroy the cache container and its contents.
  */
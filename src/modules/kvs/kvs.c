@@ -23,10 +23,12 @@
 #include <czmq.h>
 #include <flux/core.h>
 #include <jansson.h>
+#include <sodium.h>
 
 #include "src/common/libutil/blobref.h"
 #include "src/common/libutil/monotime.h"
 #include "src/common/libutil/tstat.h"
+#include "src/common/libutil/workpool.h"
 #include "src/common/libkvs/treeobj.h"
 #include "src/common/libkvs/kvs_txn_private.h"
 #include "src/common/libkvs/kvs_util_private.h"
@@ -58,6 +60,11 @@ typedef struct {
     struct cache *cache;    /* blobref => cache_entry */
     kvsroot_mgr_t *krm;
     int faults;                 /* for kvs.stats.get, etc. */
+    int primed;                 /* objects primed from setroot events */
+    int prefetches;             /* refs loaded speculatively by lookups */
+    int lookups;                /* lookups completed */
+    tstat_t lookup_stalls;      /* stalls per cold lookup */
+    tstat_t lookup_cold_ms;     /* latency of cold lookups */
     flux_t *h;
     uint32_t rank;
     int epoch;              /* tracks current heartbeat epoch */
@@ -65,8 +72,15 @@ typedef struct {
     flux_watcher_t *idle_w;
     flux_watcher_t *check_w;
     int transaction_merge;
+    int transaction_pipeline;   /* max transactions in flight per ns */
+    int commit_workers;         /* threads for commit store stage */
+    workpool_t **pools;         /* one single thread pool per worker */
+    flux_watcher_t **pools_w;
+    int dir_shard_threshold;
+    int setroot_blobs;          /* max bytes of encoded objects in setroot */
     bool events_init;            /* flag */
     const char *hash_name;
+    int treeobj_format;         /* encoding of stored dirs/treeobjs */
     unsigned int seq;           /* for commit transactions */
 } kvs_ctx_t;
 
@@ -77,6 +91,9 @@ struct kvs_cb_data {
     int errnum;
     bool ready;
     char *sender;
+    json_t *refs;               /* missing refs to load in one batch */
+    json_t *prefetch;           /* refs to load w/o waiting, may be NULL */
+    zlist_t *entries;           /* dirty entries to store in one batch */
 };
 
 static void transaction_prep_cb (flux_reactor_t *r, flux_watcher_t *w,
@@ -88,10 +105,23 @@ static void start_root_remove (kvs_ctx_t *ctx, const char *namespace);
 /*
  * kvs_ctx_t functions
  */
+
+/* Apply module options to the kvstxn manager of a new root.
+ */
+static void configure_kvstxn_mgr (kvs_ctx_t *ctx, kvstxn_mgr_t *ktm)
+{
+    kvstxn_mgr_set_treeobj_format (ktm, ctx->treeobj_format);
+    kvstxn_mgr_set_dir_shard_threshold (ktm, ctx->dir_shard_threshold);
+    kvstxn_mgr_set_pipeline_depth (ktm, ctx->transaction_pipeline);
+    kvstxn_mgr_set_unroll_offload (ktm, ctx->pools != NULL);
+}
+static void unroll_pool_stop (kvs_ctx_t *ctx);
+
 static void freectx (void *arg)
 {
     kvs_ctx_t *ctx = arg;
     if (ctx) {
+        unroll_pool_stop (ctx);
         cache_destroy (ctx->cache);
         kvsroot_mgr_destroy (ctx->krm);
         flux_watcher_destroy (ctx->prep_w);
@@ -155,6 +185,8 @@ static kvs_ctx_t *getctx (flux_t *h)
             flux_watcher_start (ctx->check_w);
         }
         ctx->transaction_merge = 1;
+        ctx->transaction_pipeline = KVSTXN_PIPELINE_DEPTH;
+        ctx->dir_shard_threshold = KVSTXN_DIR_SHARD_THRESHOLD;
         if (flux_aux_set (h, "kvssrv", ctx, freectx) < 0) {
             saved_errno = errno;
             goto error;
@@ -373,6 +405,7 @@ static void getroot_completion (flux_future_t *f, void *arg)
             flux_log_error (ctx->h, "%s: kvsroot_mgr_create_root", __FUNCTION__);
             goto error;
         }
+        configure_kvstxn_mgr (ctx, root->ktm);
 
         if (event_subscribe (ctx, namespace) < 0) {
             save_errno = errno;
@@ -558,137 +591,226 @@ static void content_load_cache_entry_error (kvs_ctx_t *ctx,
 static void content_load_completion (flux_future_t *f, void *arg)
 {
     kvs_ctx_t *ctx = arg;
-    const void *data;
-    int size;
-    const char *blobref;
-    struct cache_entry *entry;
+    json_t *refs = flux_future_aux_get (f, "refs");
+    size_t index;
+    json_t *o;
 
-    blobref = flux_future_aux_get (f, "ref");
+    json_array_foreach (refs, index, o) {
+        const char *blobref = json_string_value (o);
+        struct cache_entry *entry;
+        const void *data;
+        int size;
 
-    /* should be impossible for lookup to fail, cache entry created
-     * earlier, and cache_expire_entries() could not have removed it
-     * b/c it is not yet valid.  But check and log incase there is
-     * logic error dealng with error paths using cache_remove_entry().
-     */
-    if (!(entry = cache_lookup (ctx->cache, blobref, ctx->epoch))) {
-        flux_log (ctx->h, LOG_ERR, "%s: cache_lookup", __FUNCTION__);
-        goto done;
-    }
+        /* should be impossible for lookup to fail, cache entry created
+         * earlier, and cache_expire_entries() could not have removed it
+         * b/c it is not yet valid.  But check and log incase there is
+         * logic error dealng with error paths using cache_remove_entry().
+         */
+        if (!(entry = cache_lookup (ctx->cache, blobref, ctx->epoch))) {
+            flux_log (ctx->h, LOG_ERR, "%s: cache_lookup", __FUNCTION__);
+            continue;
+        }
 
-    if (flux_content_load_get (f, &data, &size) < 0) {
-        flux_log_error (ctx->h, "%s: flux_content_load_get", __FUNCTION__);
-        content_load_cache_entry_error (ctx, entry, errno, blobref);
-        goto done;
-    }
+        if (flux_content_load_batch_get (f, index, &data, &size) < 0) {
+            flux_log_error (ctx->h, "%s: flux_content_load_batch_get",
+                            __FUNCTION__);
+            content_load_cache_entry_error (ctx, entry, errno, blobref);
+            continue;
+        }
 
-    /* If cache_entry_set_raw() fails, it's a pretty terrible error
-     * case, where we've loaded an object from the content store, but
-     * can't put it in the cache.
-     */
-    if (cache_entry_set_raw (entry, data, size) < 0) {
-        flux_log_error (ctx->h, "%s: cache_entry_set_raw", __FUNCTION__);
-        content_load_cache_entry_error (ctx, entry, errno, blobref);
-        goto done;
+        /* If cache_entry_set_raw() fails, it's a pretty terrible error
+         * case, where we've loaded an object from the content store, but
+         * can't put it in the cache.
+         */
+        if (cache_entry_set_raw (entry, data, size) < 0) {
+            flux_log_error (ctx->h, "%s: cache_entry_set_raw", __FUNCTION__);
+            content_load_cache_entry_error (ctx, entry, errno, blobref);
+            continue;
+        }
     }
-
-done:
     flux_future_destroy (f);
 }
 
-/* Send content load request and setup contination to handle response.
+/* Send one content load request for all blobrefs in JSON array 'refs'
+ * and setup contination to handle response.
  */
-static int content_load_request_send (kvs_ctx_t *ctx, const char *ref)
+static int content_load_request_send (kvs_ctx_t *ctx, json_t *refs)
 {
     flux_future_t *f = NULL;
-    char *refcpy;
+    const char **refv;
+    size_t index;
+    json_t *o;
     int saved_errno;
 
-    if (!(f = flux_content_load (ctx->h, ref, 0))) {
-        flux_log_error (ctx->h, "%s: flux_content_load", __FUNCTION__);
+    if (!(refv = calloc (json_array_size (refs), sizeof (refv[0])))) {
+        errno = ENOMEM;
         goto error;
     }
-    if (!(refcpy = strdup (ref))) {
-        errno = ENOMEM;
+    json_array_foreach (refs, index, o)
+        refv[index] = json_string_value (o);
+    if (!(f = flux_content_load_batch (ctx->h, refv, json_array_size (refs),
+                                       0))) {
+        flux_log_error (ctx->h, "%s: flux_content_load_batch", __FUNCTION__);
         goto error;
     }
-    if (flux_future_aux_set (f, "ref", refcpy, free) < 0) {
+    if (flux_future_aux_set (f, "refs", json_incref (refs),
+                             (flux_free_f)json_decref) < 0) {
         flux_log_error (ctx->h, "%s: flux_future_aux_set", __FUNCTION__);
-        free (refcpy);
+        json_decref (refs);
         goto error;
     }
     if (flux_future_then (f, -1., content_load_completion, ctx) < 0) {
         flux_log_error (ctx->h, "%s: flux_future_then", __FUNCTION__);
         goto error;
     }
+    free (refv);
     return 0;
 error:
     saved_errno = errno;
     flux_future_destroy (f);
+    free (refv);
     errno = saved_errno;
     return -1;
 }
 
-/* Return 0 on success, -1 on error.  Set stall variable appropriately
+/* Load the refs collected in cbd->refs and arrange for cbd->wait to
+ * stall on each of them.  Refs in cbd->prefetch, if any, are loaded too
+ * but not waited on.  Refs not yet in cache are fetched with a single
+ * content load request.
+ * Return 0 on success, -1 on error with cbd->errnum set.
  */
-static int load (kvs_ctx_t *ctx, const char *ref, wait_t *wait, bool *stall)
+static int load (struct kvs_cb_data *cbd)
 {
-    struct cache_entry *entry = cache_lookup (ctx->cache, ref, ctx->epoch);
+    kvs_ctx_t *ctx = cbd->ctx;
+    json_t *missing;
+    size_t index;
+    json_t *o;
     int saved_errno, ret;
 
-    assert (wait != NULL);
+    assert (cbd->wait != NULL);
 
-    /* Create an incomplete hash entry if none found.
+    if (!(missing = json_array ())) {
+        errno = ENOMEM;
+        goto error;
+    }
+
+    /* Create an incomplete hash entry for each ref not found.
      */
-    if (!entry) {
+    json_array_foreach (cbd->refs, index, o) {
+        const char *ref = json_string_value (o);
+        struct cache_entry *entry;
+
+        if (cache_lookup (ctx->cache, ref, ctx->epoch))
+            continue;
         if (!(entry = cache_entry_create (ref))) {
             flux_log_error (ctx->h, "%s: cache_entry_create",
                             __FUNCTION__);
-            return -1;
+            goto error_remove;
         }
         if (cache_insert (ctx->cache, entry) < 0) {
             flux_log_error (ctx->h, "%s: cache_insert",
                             __FUNCTION__);
             cache_entry_destroy (entry);
-            return -1;
+            goto error_remove;
         }
-        if (content_load_request_send (ctx, ref) < 0) {
-            saved_errno = errno;
-            flux_log_error (ctx->h, "%s: content_load_request_send",
-                            __FUNCTION__);
+        if (json_array_append (missing, o) < 0) {
             /* cache entry just created, should always work */
             ret = cache_remove_entry (ctx->cache, ref);
             assert (ret == 1);
-            errno = saved_errno;
-            return -1;
+            errno = ENOMEM;
+            goto error_remove;
         }
-        ctx->faults++;
     }
+    if (cbd->prefetch) {
+        json_array_foreach (cbd->prefetch, index, o) {
+            const char *ref = json_string_value (o);
+            struct cache_entry *entry;
+
+            if (cache_lookup (ctx->cache, ref, ctx->epoch))
+                continue;
+            if (!(entry = cache_entry_create (ref))) {
+                flux_log_error (ctx->h, "%s: cache_entry_create",
+                                __FUNCTION__);
+                goto error_remove;
+            }
+            if (cache_insert (ctx->cache, entry) < 0) {
+                flux_log_error (ctx->h, "%s: cache_insert",
+                                __FUNCTION__);
+                cache_entry_destroy (entry);
+                goto error_remove;
+            }
+            if (json_array_append (missing, o) < 0) {
+                ret = cache_remove_entry (ctx->cache, ref);
+                assert (ret == 1);
+                errno = ENOMEM;
+                goto error_remove;
+            }
+            ctx->prefetches++;
+        }
+    }
+    if (json_array_size (missing) > 0) {
+        if (content_load_request_send (ctx, missing) < 0) {
+            flux_log_error (ctx->h, "%s: content_load_request_send",
+                            __FUNCTION__);
+            goto error_remove;
+        }
+        ctx->faults += json_array_size (missing);
+    }
+    json_decref (missing);
+
     /* If hash entry is incomplete (either created above or earlier),
      * arrange to stall caller.
      */
-    if (!cache_entry_get_valid (entry)) {
-        /* Potential future optimization, if this load() is called
-         * multiple times from the same kvstxn and on the same
-         * reference, we're effectively adding identical waiters onto
-         * this cache entry.  This is far better than sending multiple
-         * RPCs (the cache entry chck above protects against this),
+    json_array_foreach (cbd->refs, index, o) {
+        const char *ref = json_string_value (o);
+        struct cache_entry *entry;
+
+        if (!(entry = cache_lookup (ctx->cache, ref, ctx->epoch))) {
+            flux_log (ctx->h, LOG_ERR, "%s: cache_lookup", __FUNCTION__);
+            errno = ENOTRECOVERABLE;
+            goto error;
+        }
+        if (cache_entry_get_valid (entry))
+            continue;
+        /* Potential future optimization, if a ref is loaded multiple
+         * times from the same kvstxn, we're effectively adding identical
+         * waiters onto this cache entry.  This is far better than sending
+         * multiple RPCs (the cache entry chck above protects against this),
          * but could be improved later.  See Issue #1751.
          */
-        if (cache_entry_wait_valid (entry, wait) < 0) {
-            /* no cleanup in this path, if an rpc was sent, it will
-             * complete, but not call a waiter on this load.  Return
-             * error so caller can handle error appropriately.
+        if (cache_entry_wait_valid (entry, cbd->wait) < 0) {
+            /* no cleanup in this path, the rpc will complete, but not
+             * call a waiter on this load.  Return error so caller can
+             * handle error appropriately.
              */
             flux_log_error (ctx->h, "cache_entry_wait_valid");
-            return -1;
+            goto error;
         }
-        if (stall)
-            *stall = true;
-        return 0;
     }
+    return 0;
 
-    if (stall)
-        *stall = false;
+error_remove:
+    /* remove cache entries just created, no waiters are on them yet */
+    saved_errno = errno;
+    json_array_foreach (missing, index, o) {
+        ret = cache_remove_entry (ctx->cache, json_string_value (o));
+        assert (ret == 1);
+    }
+    json_decref (missing);
+    errno = saved_errno;
+error:
+    cbd->errnum = errno;
+    return -1;
+}
+
+/* Add ref to the set of refs to be loaded by load().
+ */
+static int load_ref_add (struct kvs_cb_data *cbd, const char *ref)
+{
+    if (json_array_append_new (cbd->refs, json_string (ref)) < 0) {
+        cbd->errnum = errno = ENOMEM;
+        return -1;
+    }
     return 0;
 }
 
@@ -696,62 +818,13 @@ static int load (kvs_ctx_t *ctx, const char *ref, wait_t *wait, bool *stall)
  * store/write
  */
 
-static void content_store_completion (flux_future_t *f, void *arg)
+static void content_store_cache_entry_error (kvs_ctx_t *ctx,
+                                             const char *ref,
+                                             int errnum)
 {
-    kvs_ctx_t *ctx = arg;
     struct cache_entry *entry;
-    const char *cache_blobref, *blobref;
     int ret;
 
-    cache_blobref = flux_future_aux_get (f, "cache_blobref");
-    assert (cache_blobref);
-
-    if (flux_content_store_get (f, &blobref) < 0) {
-        flux_log_error (ctx->h, "%s: flux_content_store_get", __FUNCTION__);
-        goto error;
-    }
-
-    /* Double check that content store stored in the same blobref
-     * location we calculated.
-     * N.B. perhaps this check is excessive and could be removed
-     */
-    if (strcmp (blobref, cache_blobref)) {
-        flux_log (ctx->h, LOG_ERR, "%s: inconsistent blobref returned",
-                  __FUNCTION__);
-        errno = EPROTO;
-        goto error;
-    }
-
-    //flux_log (ctx->h, LOG_DEBUG, "%s: %s", __FUNCTION__, ref);
-    /* should be impossible for lookup to fail, cache entry created
-     * earlier, and cache_expire_entries() could not have removed it
-     * b/c it was dirty.  But check and log incase there is logic
-     * error dealng with error paths using cache_remove_entry().
-     */
-    if (!(entry = cache_lookup (ctx->cache, blobref, ctx->epoch))) {
-        flux_log (ctx->h, LOG_ERR, "%s: cache_lookup", __FUNCTION__);
-        goto error;
-    }
-
-    /* This is a pretty terrible error case, where we've received
-     * verification that a dirty cache entry has been flushed to the
-     * content store, but we can't notify waiters that it has been
-     * flushed.  In addition, if we can't notify waiters by clearing
-     * the dirty bit, what are the odds the error handling below would
-     * work as well.
-     */
-    if (cache_entry_set_dirty (entry, false) < 0) {
-        flux_log_error (ctx->h, "%s: cache_entry_set_dirty",
-                        __FUNCTION__);
-        goto error;
-    }
-
-    flux_future_destroy (f);
-    return;
-
-error:
-    flux_future_destroy (f);
-
     /* failure on store, inform all waiters, must destroy entry
      * afterwards, as future loads/stores may believe content is ok.
      * cache_remove_entry() will not work if a waiter is still there.
@@ -760,7 +833,7 @@ error:
      */
 
     /* we can't do anything if this cache_lookup fails */
-    if (!(entry = cache_lookup (ctx->cache, cache_blobref, ctx->epoch))) {
+    if (!(entry = cache_lookup (ctx->cache, ref, ctx->epoch))) {
         flux_log (ctx->h, LOG_ERR, "%s: cache_lookup", __FUNCTION__);
         return;
     }
@@ -771,7 +844,7 @@ error:
      * dirty for entries without waiters.  So in this rare case, we
      * must call cache_entry_force_clear_dirty().  flushed.
      */
-    if (cache_entry_set_errnum_on_notdirty (entry, errno) < 0) {
+    if (cache_entry_set_errnum_on_notdirty (entry, errnum) < 0) {
         flux_log (ctx->h, LOG_ERR, "%s: cache_entry_set_errnum_on_notdirty",
                   __FUNCTION__);
         ret = cache_entry_force_clear_dirty (entry);
@@ -783,98 +856,273 @@ error:
     ret = cache_entry_force_clear_dirty (entry);
     assert (ret == 0);
 
-    if (cache_remove_entry (ctx->cache, cache_blobref) < 0)
+    if (cache_remove_entry (ctx->cache, ref) < 0)
         flux_log (ctx->h, LOG_ERR, "%s: cache_remove_entry", __FUNCTION__);
 }
 
-static int content_store_request_send (kvs_ctx_t *ctx, const char *blobref,
-                                       const void *data, int len)
+static void content_store_completion (flux_future_t *f, void *arg)
 {
-    flux_future_t *f;
+    kvs_ctx_t *ctx = arg;
+    json_t *cache_blobrefs = flux_future_aux_get (f, "cache_blobrefs");
+    size_t index;
+    json_t *o;
+
+    assert (cache_blobrefs);
+
+    json_array_foreach (cache_blobrefs, index, o) {
+        const char *cache_blobref = json_string_value (o);
+        struct cache_entry *entry;
+        const char *blobref;
+
+        if (flux_content_store_batch_get (f, index, &blobref) < 0) {
+            flux_log_error (ctx->h, "%s: flux_content_store_batch_get",
+                            __FUNCTION__);
+            content_store_cache_entry_error (ctx, cache_blobref, errno);
+            continue;
+        }
+
+        /* Double check that content store stored in the same blobref
+         * location we calculated.
+         * N.B. perhaps this check is excessive and could be removed
+         */
+        if (strcmp (blobref, cache_blobref)) {
+            flux_log (ctx->h, LOG_ERR, "%s: inconsistent blobref returned",
+                      __FUNCTION__);
+            content_store_cache_entry_error (ctx, cache_blobref, EPROTO);
+            continue;
+        }
+
+        /* should be impossible for lookup to fail, cache entry created
+         * earlier, and cache_expire_entries() could not have removed it
+         * b/c it was dirty.  But check and log incase there is logic
+         * error dealng with error paths using cache_remove_entry().
+         */
+        if (!(entry = cache_lookup (ctx->cache, cache_blobref, ctx->epoch))) {
+            flux_log (ctx->h, LOG_ERR, "%s: cache_lookup", __FUNCTION__);
+            continue;
+        }
+
+        /* This is a pretty terrible error case, where we've received
+         * verification that a dirty cache entry has been flushed to the
+         * content store, but we can't notify waiters that it has been
+         * flushed.  In addition, if we can't notify waiters by clearing
+         * the dirty bit, what are the odds the error handling below would
+         * work as well.
+         */
+        if (cache_entry_set_dirty (entry, false) < 0) {
+            flux_log_error (ctx->h, "%s: cache_entry_set_dirty",
+                            __FUNCTION__);
+            content_store_cache_entry_error (ctx, cache_blobref, errno);
+            continue;
+        }
+    }
+    flux_future_destroy (f);
+}
+
+/* Send one content store request for all entries in 'entries', with
+ * JSON array 'cache_blobrefs' holding the blobref of each entry.
+ */
+static int content_store_request_send (kvs_ctx_t *ctx, zlist_t *entries,
+                                       json_t *cache_blobrefs)
+{
+    flux_future_t *f = NULL;
+    struct cache_entry *entry;
+    const void **bufs;
+    int *lens;
+    int count = zlist_size (entries);
+    int i = 0;
     int saved_errno, rc = -1;
 
-    if (!(f = flux_content_store (ctx->h, data, len, 0)))
-        goto error;
-    if (flux_future_aux_set (f, "cache_blobref", (void *)blobref, NULL) < 0) {
-        saved_errno = errno;
-        flux_future_destroy (f);
-        errno = saved_errno;
+    bufs = calloc (count, sizeof (bufs[0]));
+    lens = calloc (count, sizeof (lens[0]));
+    if (!bufs || !lens) {
+        errno = ENOMEM;
         goto error;
     }
-    if (flux_future_then (f, -1., content_store_completion, ctx) < 0) {
-        saved_errno = errno;
-        flux_future_destroy (f);
-        errno = saved_errno;
+    entry = zlist_first (entries);
+    while (entry) {
+        if (cache_entry_get_raw (entry, &bufs[i], &lens[i]) < 0)
+            goto error;
+        i++;
+        entry = zlist_next (entries);
+    }
+    if (!(f = flux_content_store_batch (ctx->h, bufs, lens, count, 0)))
+        goto error;
+    if (flux_future_aux_set (f, "cache_blobrefs", json_incref (cache_blobrefs),
+                             (flux_free_f)json_decref) < 0) {
+        json_decref (cache_blobrefs);
         goto error;
     }
-
+    if (flux_future_then (f, -1., content_store_completion, ctx) < 0)
+        goto error;
+    f = NULL;
     rc = 0;
 error:
+    saved_errno = errno;
+    flux_future_destroy (f);
+    free (bufs);
+    free (lens);
+    errno = saved_errno;
     return rc;
 }
 
+/* Flush dirty cache entries collected in cbd->entries to the content
+ * cache asynchronously with a single store request, and push wait onto
+ * each cache object's wait queue.  Entries are popped off cbd->entries
+ * as waits are pushed.  On error, entries remaining on the list have
+ * not been waited on and must be cleaned up by the caller.
+ * Return 0 on success, -1 on error with cbd->errnum set.
+ */
+static int store (struct kvs_cb_data *cbd)
+{
+    kvs_ctx_t *ctx = cbd->ctx;
+    json_t *cache_blobrefs;
+    struct cache_entry *entry;
+
+    if (zlist_size (cbd->entries) == 0)
+        return 0;
+
+    if (!(cache_blobrefs = json_array ())) {
+        errno = ENOMEM;
+        goto error;
+    }
+    entry = zlist_first (cbd->entries);
+    while (entry) {
+        char blobref[BLOBREF_MAX_STRING_SIZE];
+
+        assert (cache_entry_get_dirty (entry));
+
+        if (cache_entry_get_blobref (entry, blobref, sizeof (blobref)) < 0) {
+            flux_log_error (ctx->h, "%s: cache_entry_get_blobref",
+                            __FUNCTION__);
+            goto error;
+        }
+        if (json_array_append_new (cache_blobrefs, json_string (blobref)) < 0) {
+            errno = ENOMEM;
+            goto error;
+        }
+        entry = zlist_next (cbd->entries);
+    }
+
+    if (content_store_request_send (ctx, cbd->entries, cache_blobrefs) < 0) {
+        flux_log_error (ctx->h, "%s: content_store_request_send",
+                        __FUNCTION__);
+        goto error;
+    }
+    json_decref (cache_blobrefs);
+    cache_blobrefs = NULL;
+
+    while ((entry = zlist_first (cbd->entries))) {
+        if (cache_entry_wait_notdirty (entry, cbd->wait) < 0) {
+            flux_log_error (ctx->h, "cache_entry_wait_notdirty");
+            goto error;
+        }
+        zlist_remove (cbd->entries, entry);
+    }
+    return 0;
+
+error:
+    cbd->errnum = errno;
+    json_decref (cache_blobrefs);
+    return -1;
+}
+
 static int kvstxn_load_cb (kvstxn_t *kt, const char *ref, void *data)
 {
     struct kvs_cb_data *cbd = data;
-    bool stall;
 
-    if (load (cbd->ctx, ref, cbd->wait, &stall) < 0) {
-        cbd->errnum = errno;
-        flux_log_error (cbd->ctx->h, "%s: load", __FUNCTION__);
+    if (load_ref_add (cbd, ref) < 0) {
+        flux_log_error (cbd->ctx->h, "%s: load_ref_add", __FUNCTION__);
         return -1;
     }
-    /* if not stalling, logic issue within code */
-    assert (stall);
     return 0;
 }
 
-/* Flush to content cache asynchronously and push wait onto cache
- * object's wait queue.
+/* Collect dirty cache entry, to be flushed to content cache by store().
  */
 static int kvstxn_cache_cb (kvstxn_t *kt, struct cache_entry *entry, void *data)
 {
     struct kvs_cb_data *cbd = data;
-    const char *blobref;
-    const void *storedata;
-    int storedatalen = 0;
 
     assert (cache_entry_get_dirty (entry));
 
-    if (cache_entry_get_raw (entry, &storedata, &storedatalen) < 0) {
-        flux_log_error (cbd->ctx->h, "%s: cache_entry_get_raw",
-                        __FUNCTION__);
+    if (zlist_append (cbd->entries, entry) < 0) {
+        cbd->errnum = errno = ENOMEM;
+        flux_log_error (cbd->ctx->h, "%s: zlist_append", __FUNCTION__);
         kvstxn_cleanup_dirty_cache_entry (kt, entry);
         return -1;
     }
+    return 0;
+}
 
-    /* must be true, otherwise we didn't insert entry in cache */
-    blobref = cache_entry_get_blobref (entry);
-    assert (blobref);
+/* Optimization: build an object mapping blobref to base64 content for
+ * the objects in 'refs' created by a commit, so followers can prime
+ * their caches with them rather than each faulting them in.  Objects
+ * are added in order, skipping any that would take the total over
+ * ctx->setroot_blobs bytes.  Each object is charged for what it adds to
+ * the event: its base64 text, its blobref key and the JSON punctuation.
+ * The root directory is sent separately.
+ */
+static json_t *setroot_blobs_create (kvs_ctx_t *ctx, struct kvsroot *root,
+                                     json_t *refs)
+{
+    json_t *blobs;
+    size_t index;
+    json_t *o;
+    size_t budget = ctx->setroot_blobs;
+    char *b64 = NULL;
+    size_t b64size = 0;
 
-    if (content_store_request_send (cbd->ctx,
-                                    blobref,
-                                    storedata,
-                                    storedatalen) < 0) {
-        cbd->errnum = errno;
-        flux_log_error (cbd->ctx->h, "%s: content_store_request_send",
-                        __FUNCTION__);
-        kvstxn_cleanup_dirty_cache_entry (kt, entry);
-        return -1;
-    }
-    if (cache_entry_wait_notdirty (entry, cbd->wait) < 0) {
-        cbd->errnum = errno;
-        flux_log_error (cbd->ctx->h, "cache_entry_wait_notdirty");
-        kvstxn_cleanup_dirty_cache_entry (kt, entry);
-        return -1;
+    if (!(blobs = json_object ()))
+        return NULL;
+    json_array_foreach (refs, index, o) {
+        const char *ref = json_string_value (o);
+        struct cache_entry *entry;
+        const void *data;
+        int len;
+        size_t need, cost;
+
+        if (!ref || (event_includes_rootdir && !strcmp (ref, root->ref)))
+            continue;
+        if (!(entry = cache_lookup (ctx->cache, ref, ctx->epoch))
+            || !cache_entry_get_valid (entry)
+            || cache_entry_get_raw (entry, &data, &len) < 0)
+            continue;
+        /* 'need' includes a NUL, which stands in for the separating
+         * comma.  Four quotes and a colon make up the other 5 bytes.
+         */
+        need = sodium_base64_encoded_len (len, sodium_base64_VARIANT_ORIGINAL);
+        cost = need + strlen (ref) + 5;
+        if (cost > budget)
+            continue;
+        if (need > b64size) {
+            char *tmp;
+            if (!(tmp = realloc (b64, need)))
+                goto error;
+            b64 = tmp;
+            b64size = need;
+        }
+        sodium_bin2base64 (b64, need, data, len,
+                           sodium_base64_VARIANT_ORIGINAL);
+        if (json_object_set_new (blobs, ref, json_string (b64)) < 0)
+            goto error;
+        budget -= cost;
     }
-    return 0;
+    free (b64);
+    return blobs;
+error:
+    free (b64);
+    json_decref (blobs);
+    errno = ENOMEM;
+    return NULL;
 }
 
 static int setroot_event_send (kvs_ctx_t *ctx, struct kvsroot *root,
-                               json_t *names, json_t *keys)
+                               json_t *names, json_t *keys, json_t *refs)
 {
     const json_t *root_dir = NULL;
     json_t *nullobj = NULL;
+    json_t *blobs = NULL;
     flux_msg_t *msg = NULL;
     char *setroot_topic = NULL;
     int saved_errno, rc = -1;
@@ -897,21 +1145,42 @@ static int setroot_event_send (kvs_ctx_t *ctx, struct kvsroot *root,
         root_dir = nullobj;
     }
 
+    /* Failure to include new objects is not fatal, they will be
+     * fetched on demand by followers.
+     */
+    if (ctx->setroot_blobs > 0 && refs) {
+        if (!(blobs = setroot_blobs_create (ctx, root, refs)))
+            flux_log_error (ctx->h, "%s: setroot_blobs_create", __FUNCTION__);
+    }
+
     if (asprintf (&setroot_topic, "kvs.setroot-%s", root->namespace) < 0) {
         saved_errno = ENOMEM;
         flux_log_error (ctx->h, "%s: asprintf", __FUNCTION__);
         goto done;
     }
 
-    if (!(msg = flux_event_pack (setroot_topic,
-                                 "{ s:s s:i s:s s:O s:O s:O s:i}",
-                                 "namespace", root->namespace,
-                                 "rootseq", root->seq,
-                                 "rootref", root->ref,
-                                 "names", names,
-                                 "rootdir", root_dir,
-                                 "keys", keys,
-                                 "owner", root->owner))) {
+    if (blobs && json_object_size (blobs) > 0)
+        msg = flux_event_pack (setroot_topic,
+                               "{ s:s s:i s:s s:O s:O s:O s:i s:O }",
+                               "namespace", root->namespace,
+                               "rootseq", root->seq,
+                               "rootref", root->ref,
+                               "names", names,
+                               "rootdir", root_dir,
+                               "keys", keys,
+                               "owner", root->owner,
+                               "blobs", blobs);
+    else
+        msg = flux_event_pack (setroot_topic,
+                               "{ s:s s:i s:s s:O s:O s:O s:i }",
+                               "namespace", root->namespace,
+                               "rootseq", root->seq,
+                               "rootref", root->ref,
+                               "names", names,
+                               "rootdir", root_dir,
+                               "keys", keys,
+                               "owner", root->owner);
+    if (!msg) {
         saved_errno = errno;
         flux_log_error (ctx->h, "%s: flux_event_pack", __FUNCTION__);
         goto done;
@@ -929,6 +1198,7 @@ done:
     free (setroot_topic);
     flux_msg_destroy (msg);
     json_decref (nullobj);
+    json_decref (blobs);
     if (rc < 0)
         errno = saved_errno;
     return rc;
@@ -990,6 +1260,19 @@ done:
     return rc;
 }
 
+/* A namespace is pinned to one commit worker, so that concurrent
+ * commits to different namespaces are spread over the workers.
+ */
+static workpool_t *unroll_pool_get (kvs_ctx_t *ctx, const char *namespace)
+{
+    unsigned int hash = 5381;
+    const char *cp;
+
+    for (cp = namespace; *cp != '\0'; cp++)
+        hash = hash * 33 + (unsigned char)*cp;
+    return ctx->pools[hash % ctx->commit_workers];
+}
+
 static void kvstxn_wait_error_cb (wait_t *w, int errnum, void *arg)
 {
     kvstxn_t *kt = arg;
@@ -1056,9 +1339,17 @@ static void kvstxn_apply (kvstxn_t *kt)
         cbd.ctx = ctx;
         cbd.wait = wait;
         cbd.errnum = 0;
+        cbd.prefetch = NULL;
+
+        if (!(cbd.refs = json_array ())) {
+            errnum = ENOMEM;
+            goto done;
+        }
 
-        if (kvstxn_iter_missing_refs (kt, kvstxn_load_cb, &cbd) < 0) {
+        if (kvstxn_iter_missing_refs (kt, kvstxn_load_cb, &cbd) < 0
+            || load (&cbd) < 0) {
             errnum = cbd.errnum;
+            json_decref (cbd.refs);
 
             /* rpcs already in flight, stall for them to complete */
             if (wait_get_usecount (wait) > 0) {
@@ -1068,6 +1359,7 @@ static void kvstxn_apply (kvstxn_t *kt)
 
             goto done;
         }
+        json_decref (cbd.refs);
 
         assert (wait_get_usecount (wait) > 0);
         goto stall;
@@ -1087,8 +1379,22 @@ static void kvstxn_apply (kvstxn_t *kt)
         cbd.wait = wait;
         cbd.errnum = 0;
 
-        if (kvstxn_iter_dirty_cache_entries (kt, kvstxn_cache_cb, &cbd) < 0) {
+        if (!(cbd.entries = zlist_new ())) {
+            errnum = ENOMEM;
+            goto done;
+        }
+
+        /* Dirty entries are collected, then flushed to the content
+         * cache in a single store request.
+         */
+        if (kvstxn_iter_dirty_cache_entries (kt, kvstxn_cache_cb, &cbd) < 0
+            || store (&cbd) < 0) {
+            struct cache_entry *entry;
+
             errnum = cbd.errnum;
+            while ((entry = zlist_pop (cbd.entries)))
+                kvstxn_cleanup_dirty_cache_entry (kt, entry);
+            zlist_destroy (&cbd.entries);
 
             /* rpcs already in flight, stall for them to complete */
             if (wait_get_usecount (wait) > 0) {
@@ -1098,10 +1404,28 @@ static void kvstxn_apply (kvstxn_t *kt)
 
             goto done;
         }
+        zlist_destroy (&cbd.entries);
 
         assert (wait_get_usecount (wait) > 0);
         goto stall;
     }
+    else if (ret == KVSTXN_PROCESS_UNROLL) {
+        /* Encode and hash the new objects on the namespace's worker
+         * thread.  unroll_pool_cb() replays the transaction after.
+         */
+        if (workpool_submit (unroll_pool_get (ctx, namespace), kt) < 0) {
+            errnum = errno;
+            goto done;
+        }
+        goto stall;
+    }
+    else if (ret == KVSTXN_PROCESS_WAIT_TURN) {
+        /* Started ahead of an earlier transaction, which must update
+         * the root first.  kvstxn_check_root_cb() will pick this one
+         * up again when it reaches the head of the ready queue.
+         */
+        goto stall;
+    }
     /* else ret == KVSTXN_PROCESS_FINISHED */
 
     /* This finalizes the transaction by replacing root->ref with
@@ -1119,7 +1443,8 @@ done:
                       count, opcount);
         }
         setroot (ctx, root, kvstxn_get_newroot_ref (kt), root->seq + 1);
-        setroot_event_send (ctx, root, names, kvstxn_get_keys (kt));
+        setroot_event_send (ctx, root, names, kvstxn_get_keys (kt),
+                            kvstxn_get_new_refs (kt));
     } else {
         fallback = kvstxn_fallback_mergeable (kt);
 
@@ -1145,6 +1470,74 @@ stall:
     return;
 }
 
+/*
+ * commit worker threads
+ */
+
+static void unroll_work (void *item, int worker, void *arg)
+{
+    kvstxn_unroll_work (item);
+}
+
+static void unroll_pool_cb (flux_reactor_t *r, flux_watcher_t *w,
+                            int revents, void *arg)
+{
+    workpool_t *pool = arg;
+    kvstxn_t *kt;
+
+    workpool_clear_event (pool);
+    while ((kt = workpool_next (pool)))
+        kvstxn_apply (kt);
+}
+
+static int unroll_pool_start (kvs_ctx_t *ctx)
+{
+    flux_reactor_t *r = flux_get_reactor (ctx->h);
+    int i, fd;
+
+    if (ctx->commit_workers <= 0)
+        return 0;
+    if (!(ctx->pools = calloc (ctx->commit_workers, sizeof (ctx->pools[0])))
+        || !(ctx->pools_w = calloc (ctx->commit_workers,
+                                    sizeof (ctx->pools_w[0]))))
+        return -1;
+    for (i = 0; i < ctx->commit_workers; i++) {
+        if (!(ctx->pools[i] = workpool_create (1, unroll_work, ctx)))
+            return -1;
+        if ((fd = workpool_pollfd (ctx->pools[i])) < 0)
+            return -1;
+        if (!(ctx->pools_w[i] = flux_fd_watcher_create (r, fd, FLUX_POLLIN,
+                                                        unroll_pool_cb,
+                                                        ctx->pools[i])))
+            return -1;
+        flux_watcher_start (ctx->pools_w[i]);
+    }
+    return 0;
+}
+
+/* Let the workers finish before the transactions they hold are
+ * destroyed.  Transactions are not replayed, the module is unloading.
+ */
+static void unroll_pool_stop (kvs_ctx_t *ctx)
+{
+    int i;
+
+    if (ctx->pools) {
+        for (i = 0; i < ctx->commit_workers; i++) {
+            if (ctx->pools_w)
+                flux_watcher_destroy (ctx->pools_w[i]);
+            if (ctx->pools[i]) {
+                workpool_wait (ctx->pools[i]);
+                workpool_destroy (ctx->pools[i]);
+            }
+        }
+        free (ctx->pools_w);
+        free (ctx->pools);
+        ctx->pools_w = NULL;
+        ctx->pools = NULL;
+    }
+}
+
 /*
  * pre/check event callbacks
  */
@@ -1181,20 +1574,26 @@ static int kvstxn_check_root_cb (struct kvsroot *root, void *arg)
     struct kvs_cb_data *cbd = arg;
     kvstxn_t *kt;
 
-    if ((kt = kvstxn_mgr_get_ready_transaction (root->ktm))) {
-        if (cbd->ctx->transaction_merge) {
-            /* if merge fails, set errnum in txn_t, let
-             * txn_apply() handle error handling.
-             */
-            if (kvstxn_mgr_merge_ready_transactions (root->ktm) < 0)
-                kvstxn_set_aux_errnum (kt, errno);
-            else {
-                /* grab new head ready commit, if above succeeds, this
-                 * must succeed */
-                kt = kvstxn_mgr_get_ready_transaction (root->ktm);
-                assert (kt);
-            }
-        }
+    /* Start every transaction that is ready.  Each call to
+     * kvstxn_apply() either completes the transaction, stalls it, or
+     * leaves it waiting for its turn, so none is returned twice.
+     */
+    while (kvstxn_mgr_transaction_ready (root->ktm)) {
+        int errnum = 0;
+
+        /* if merge fails, set errnum in txn_t, let
+         * txn_apply() handle error handling.
+         */
+        if (cbd->ctx->transaction_merge
+            && kvstxn_mgr_merge_ready_transactions (root->ktm) < 0)
+            errnum = errno;
+
+        /* merging only replaces an unblocked head, so if above
+         * succeeds, this must succeed */
+        kt = kvstxn_mgr_get_ready_transaction (root->ktm);
+        assert (kt);
+        if (errnum)
+            kvstxn_set_aux_errnum (kt, errnum);
 
         /* It does not matter if root has been marked for removal,
          * we want to process and clear all lingering ready
@@ -1339,18 +1738,65 @@ static void heartbeat_cb (flux_t *h, flux_msg_handler_t *mh,
 static int lookup_load_cb (lookup_t *lh, const char *ref, void *data)
 {
     struct kvs_cb_data *cbd = data;
-    bool stall;
 
-    if (load (cbd->ctx, ref, cbd->wait, &stall) < 0) {
-        cbd->errnum = errno;
-        flux_log_error (cbd->ctx->h, "%s: load", __FUNCTION__);
+    if (load_ref_add (cbd, ref) < 0) {
+        flux_log_error (cbd->ctx->h, "%s: load_ref_add", __FUNCTION__);
         return -1;
     }
-    /* if not stalling, logic issue within code */
-    assert (stall);
     return 0;
 }
 
+static int lookup_prefetch_cb (lookup_t *lh, const char *ref, void *data)
+{
+    struct kvs_cb_data *cbd = data;
+
+    if (json_array_append_new (cbd->prefetch, json_string (ref)) < 0) {
+        cbd->errnum = errno = ENOMEM;
+        flux_log_error (cbd->ctx->h, "%s: json_array_append_new",
+                        __FUNCTION__);
+        return -1;
+    }
+    return 0;
+}
+
+/* Load the missing refs of a stalled lookup.  Refs the lookup expects to
+ * need next are sent in the same content load request, so a cold path
+ * is fetched in as few round trips as possible.
+ * Return 0 on success, -1 on error with cbd->errnum set.
+ */
+static int lookup_load (struct kvs_cb_data *cbd, lookup_t *lh)
+{
+    int rc = -1;
+
+    if (!(cbd->prefetch = json_array ())) {
+        cbd->errnum = ENOMEM;
+        return -1;
+    }
+    if (lookup_iter_missing_refs (lh, lookup_load_cb, cbd) < 0
+        || lookup_iter_prefetch_refs (lh, lookup_prefetch_cb, cbd) < 0
+        || load (cbd) < 0)
+        goto done;
+    rc = 0;
+done:
+    json_decref (cbd->prefetch);
+    cbd->prefetch = NULL;
+    return rc;
+}
+
+/* Account for a lookup that has completed.  Lookups that stalled on
+ * missing refs or namespaces are "cold".
+ */
+static void lookup_stats_update (kvs_ctx_t *ctx, lookup_t *lh)
+{
+    int stalls = lookup_get_stall_count (lh);
+
+    ctx->lookups++;
+    if (stalls > 0) {
+        tstat_push (&ctx->lookup_stalls, stalls);
+        tstat_push (&ctx->lookup_cold_ms, lookup_get_elapsed (lh));
+    }
+}
+
 static void lookup_wait_error_cb (wait_t *w, int errnum, void *arg)
 {
     lookup_t *lh = arg;
@@ -1478,7 +1924,14 @@ static lookup_t *lookup_common (flux_t *h, flux_msg_handler_t *mh,
         cbd.wait = wait;
         cbd.errnum = 0;
 
-        if (lookup_iter_missing_refs (lh, lookup_load_cb, &cbd) < 0) {
+        if (!(cbd.refs = json_array ())) {
+            errno = ENOMEM;
+            goto done;
+        }
+
+        if (lookup_load (&cbd, lh) < 0) {
+            json_decref (cbd.refs);
+
             /* rpcs already in flight, stall for them to complete */
             if (wait_get_usecount (wait) > 0) {
                 lookup_set_aux_errnum (lh, cbd.errnum);
@@ -1488,12 +1941,14 @@ static lookup_t *lookup_common (flux_t *h, flux_msg_handler_t *mh,
             errno = cbd.errnum;
             goto done;
         }
+        json_decref (cbd.refs);
 
         assert (wait_get_usecount (wait) > 0);
         goto stall;
     }
     /* else lret == LOOKUP_PROCESS_FINISHED, fallthrough */
 
+    lookup_stats_update (ctx, lh);
     rc = 0;
 done:
     wait_destroy (wait);
@@ -1715,7 +2170,14 @@ static void watch_request_cb (flux_t *h, flux_msg_handler_t *mh,
         cbd.wait = wait;
         cbd.errnum = 0;
 
-        if (lookup_iter_missing_refs (lh, lookup_load_cb, &cbd) < 0) {
+        if (!(cbd.refs = json_array ())) {
+            errno = ENOMEM;
+            goto done;
+        }
+
+        if (lookup_load (&cbd, lh) < 0) {
+            json_decref (cbd.refs);
+
             /* rpcs already in flight, stall for them to complete */
             if (wait_get_usecount (wait) > 0) {
                 lookup_set_aux_errnum (lh, cbd.errnum);
@@ -1725,12 +2187,15 @@ static void watch_request_cb (flux_t *h, flux_msg_handler_t *mh,
             errno = cbd.errnum;
             goto done;
         }
+        json_decref (cbd.refs);
 
         assert (wait_get_usecount (wait) > 0);
         goto stall;
     }
     /* else lret == LOOKUP_PROCESS_FINISHED, fallthrough */
 
+    lookup_stats_update (ctx, lh);
+
     val = lookup_get_value (lh);
 
     /* if no value, create json null object for remainder of code */
@@ -2447,26 +2912,44 @@ static void error_event_cb (flux_t *h, flux_msg_handler_t *mh,
  * in the kvs.setroot event.  Prime the local cache with it.
  * If there are complications, just skip it.  Not critical.
  */
-static void prime_cache_with_rootdir (kvs_ctx_t *ctx, json_t *rootdir)
+static void prime_cache_with_rootdir (kvs_ctx_t *ctx, const char *rootref,
+                                      json_t *rootdir)
 {
     struct cache_entry *entry;
     char ref[BLOBREF_MAX_STRING_SIZE];
     void *data = NULL;
-    int len;
+    size_t len;
 
     if (treeobj_validate (rootdir) < 0 || !treeobj_is_dir (rootdir)) {
         flux_log (ctx->h, LOG_ERR, "%s: invalid rootdir", __FUNCTION__);
         goto done;
     }
-    if (!(data = treeobj_encode (rootdir))) {
-        flux_log_error (ctx->h, "%s: treeobj_encode", __FUNCTION__);
+    /* The root blob is cached under 'rootref', so it must be encoded as
+     * rank 0 stored it.  Try this rank's treeobj format, then the other.
+     */
+    if (!(data = treeobj_encodeb (rootdir, ctx->treeobj_format, &len))) {
+        flux_log_error (ctx->h, "%s: treeobj_encodeb", __FUNCTION__);
         goto done;
     }
-    len = strlen (data);
     if (blobref_hash (ctx->hash_name, data, len, ref, sizeof (ref)) < 0) {
         flux_log_error (ctx->h, "%s: blobref_hash", __FUNCTION__);
         goto done;
     }
+    if (strcmp (ref, rootref) != 0) {
+        int format = ctx->treeobj_format == TREEOBJ_FORMAT_JSON
+                     ? TREEOBJ_FORMAT_BINARY : TREEOBJ_FORMAT_JSON;
+        free (data);
+        if (!(data = treeobj_encodeb (rootdir, format, &len))) {
+            flux_log_error (ctx->h, "%s: treeobj_encodeb", __FUNCTION__);
+            goto done;
+        }
+        if (blobref_hash (ctx->hash_name, data, len, ref, sizeof (ref)) < 0) {
+            flux_log_error (ctx->h, "%s: blobref_hash", __FUNCTION__);
+            goto done;
+        }
+        if (strcmp (ref, rootref) != 0)
+            goto done; // not worth priming under a ref no one will ask for
+    }
     if ((entry = cache_lookup (ctx->cache, ref, ctx->epoch)))
         goto done; // already in cache, possibly dirty/invalid - we don't care
     if (!(entry = cache_entry_create (ref))) {
@@ -2487,6 +2970,68 @@ done:
     free (data);
 }
 
+/* Optimization: objects created by a commit are optionally included
+ * in the kvs.setroot event.  Prime the local cache with them, so the
+ * changed directories are not faulted in by every follower on first
+ * lookup.  Each object is checked against its blobref.  If there are
+ * complications, just skip it.  Not critical.
+ */
+static void prime_cache_with_blobs (kvs_ctx_t *ctx, json_t *blobs)
+{
+    const char *ref;
+    json_t *o;
+    void *data = NULL;
+    size_t size = 0;
+
+    json_object_foreach (blobs, ref, o) {
+        struct cache_entry *entry;
+        char hash[BLOBREF_MAX_STRING_SIZE];
+        const char *b64;
+        size_t b64len, len;
+
+        if (!(b64 = json_string_value (o)))
+            continue;
+        if ((entry = cache_lookup (ctx->cache, ref, ctx->epoch)))
+            continue; // already in cache, possibly dirty/invalid
+        b64len = strlen (b64);
+        if (b64len / 4 * 3 + 3 > size) {
+            void *tmp;
+            if (!(tmp = realloc (data, b64len / 4 * 3 + 3))) {
+                flux_log_error (ctx->h, "%s: realloc", __FUNCTION__);
+                break;
+            }
+            data = tmp;
+            size = b64len / 4 * 3 + 3;
+        }
+        if (sodium_base642bin (data, size, b64, b64len, NULL, &len, NULL,
+                               sodium_base64_VARIANT_ORIGINAL) < 0) {
+            flux_log (ctx->h, LOG_ERR, "%s: invalid base64", __FUNCTION__);
+            continue;
+        }
+        if (blobref_hash (ctx->hash_name, data, len, hash, sizeof (hash)) < 0
+            || strcmp (hash, ref) != 0) {
+            flux_log (ctx->h, LOG_ERR, "%s: blobref mismatch", __FUNCTION__);
+            continue;
+        }
+        if (!(entry = cache_entry_create (ref))) {
+            flux_log_error (ctx->h, "%s: cache_entry_create", __FUNCTION__);
+            continue;
+        }
+        if (cache_entry_set_raw (entry, data, len) < 0) {
+            flux_log_error (ctx->h, "%s: cache_entry_set_raw", __FUNCTION__);
+            cache_entry_destroy (entry);
+            continue;
+        }
+        if (cache_insert (ctx->cache, entry) < 0) {
+            flux_log_error (ctx->h, "%s: cache_insert", __FUNCTION__);
+            cache_entry_destroy (entry);
+            continue;
+        }
+        ctx->primed++;
+    }
+    free (data);
+}
+
 /* Alter the (rootref, rootseq) in response to a setroot event.
  */
 static void setroot_event_cb (flux_t *h, flux_msg_handler_t *mh,
@@ -2499,6 +3044,7 @@ static void setroot_event_cb (flux_t *h, flux_msg_handler_t *mh,
     const char *rootref;
     json_t *rootdir = NULL;
     json_t *names = NULL;
+    json_t *blobs = NULL;
     int errnum = 0;
 
     if (flux_event_unpack (msg, NULL, "{ s:s s:i s:s s:o s:o }",
@@ -2511,6 +3057,9 @@ static void setroot_event_cb (flux_t *h, flux_msg_handler_t *mh,
         return;
     }
 
+    /* blobs is optional */
+    (void)flux_event_unpack (msg, NULL, "{ s:o }", "blobs", &blobs);
+
     /* if root not initialized, nothing to do
      * - small chance we could receive setroot event on namespace that
      *   is being removed.  Would require events to be received out of
@@ -2539,7 +3088,12 @@ static void setroot_event_cb (flux_t *h, flux_msg_handler_t *mh,
      * demand from content cache if not in local cache.
      */
     if (!json_is_null (rootdir))
-        prime_cache_with_rootdir (ctx, rootdir);
+        prime_cache_with_rootdir (ctx, rootref, rootdir);
+
+    /* Don't decode blobs from a stale event that setroot() will ignore.
+     */
+    if (blobs && (rootseq == 0 || rootseq > root->seq))
+        prime_cache_with_blobs (ctx, blobs);
 
     setroot (ctx, root, rootref, rootseq);
 }
@@ -2597,12 +3151,77 @@ static void disconnect_request_cb (flux_t *h, flux_msg_handler_t *mh,
     free (sender);
 }
 
+static json_t *pipeline_stats_pack (struct kvstxn_mgr_stats *ps)
+{
+    json_t *o;
+
+    if (!(o = json_pack ("{ s:i s:f s:i s:{ s:i s:f } s:{ s:i s:f } }",
+                         "#commits", ps->commits,
+                         "commits/s", ps->elapsed > 0 ?
+                                      ps->commits / ps->elapsed : 0.,
+                         "#pipelined", ps->pipelined,
+                         "load stage",
+                           "#stalls", ps->load_stalls,
+                           "stall time (s)", ps->load_stall_time,
+                         "store stage",
+                           "#stalls", ps->store_stalls,
+                           "stall time (s)", ps->store_stall_time))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return o;
+}
+
+static json_t *tstat_pack (tstat_t *ts, double scale)
+{
+    json_t *o;
+
+    if (!(o = json_pack ("{ s:i s:f s:f s:f s:f }",
+                         "count", tstat_count (ts),
+                         "min", tstat_min (ts)*scale,
+                         "mean", tstat_mean (ts)*scale,
+                         "stddev", tstat_stddev (ts)*scale,
+                         "max", tstat_max (ts)*scale))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return o;
+}
+
+static json_t *lookup_stats_pack (kvs_ctx_t *ctx)
+{
+    json_t *stalls = NULL;
+    json_t *latency = NULL;
+    json_t *o = NULL;
+
+    if (!(stalls = tstat_pack (&ctx->lookup_stalls, 1.))
+        || !(latency = tstat_pack (&ctx->lookup_cold_ms, 1.)))
+        goto done;
+    if (!(o = json_pack ("{ s:i s:i s:i s:O s:O }",
+                         "#lookups", ctx->lookups,
+                         "#cold", tstat_count (&ctx->lookup_stalls),
+                         "#prefetched", ctx->prefetches,
+                         "stalls", stalls,
+                         "cold latency (ms)", latency)))
+        errno = ENOMEM;
+done:
+    json_decref (stalls);
+    json_decref (latency);
+    return o;
+}
+
 static int stats_get_root_cb (struct kvsroot *root, void *arg)
 {
     json_t *nsstats = arg;
+    struct kvstxn_mgr_stats ps;
+    json_t *pstats;
     json_t *s;
 
-    if (!(s = json_pack ("{ s:i s:i s:i s:i s:i }",
+    kvstxn_mgr_get_stats (root->ktm, &ps);
+    if (!(pstats = pipeline_stats_pack (&ps)))
+        return -1;
+
+    if (!(s = json_pack ("{ s:i s:i s:i s:i s:i s:o }",
                          "#watchers",
                          wait_queue_length (root->watchlist),
                          "#no-op stores",
@@ -2611,7 +3230,8 @@ static int stats_get_root_cb (struct kvsroot *root, void *arg)
                          treq_mgr_transactions_count (root->trm),
                          "#readytransactions",
                          kvstxn_mgr_ready_transaction_count (root->ktm),
-                         "store revision", root->seq))) {
+                         "store revision", root->seq,
+                         "pipeline", pstats))) {
         errno = ENOMEM;
         return -1;
     }
@@ -2627,6 +3247,7 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
     json_t *tstats = NULL;
     json_t *cstats = NULL;
     json_t *nsstats = NULL;
+    json_t *lstats = NULL;
     tstat_t ts = { .min = 0.0, .max = 0.0, .M = 0.0, .S = 0.0, .newM = 0.0,
                    .newS = 0.0, .n = 0 };
     int size = 0, incomplete = 0, dirty = 0;
@@ -2642,26 +3263,23 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
             goto done;
     }
 
-    if (!(tstats = json_pack ("{ s:i s:f s:f s:f s:f }",
-                              "count", tstat_count (&ts),
-                              "min", tstat_min (&ts)*scale,
-                              "mean", tstat_mean (&ts)*scale,
-                              "stddev", tstat_stddev (&ts)*scale,
-                              "max", tstat_max (&ts)*scale))) {
-        errno = ENOMEM;
+    if (!(tstats = tstat_pack (&ts, scale)))
         goto done;
-    }
 
-    if (!(cstats = json_pack ("{ s:f s:O s:i s:i s:i }",
+    if (!(cstats = json_pack ("{ s:f s:O s:i s:i s:i s:i }",
                               "obj size total (MiB)", (double)size/1048576,
                               "obj size (KiB)", tstats,
                               "#obj dirty", dirty,
                               "#obj incomplete", incomplete,
+                              "#obj primed", ctx->primed,
                               "#faults", ctx->faults))) {
         errno = ENOMEM;
         goto done;
     }
 
+    if (!(lstats = lookup_stats_pack (ctx)))
+        goto done;
+
     if (!(nsstats = json_object ())) {
         errno = ENOMEM;
         goto done;
@@ -2674,14 +3292,19 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
         }
     }
     else {
+        struct kvstxn_mgr_stats ps = { .commits = 0 };
+        json_t *pstats;
         json_t *s;
 
-        if (!(s = json_pack ("{ s:i s:i s:i s:i s:i }",
+        if (!(pstats = pipeline_stats_pack (&ps)))
+            goto done;
+        if (!(s = json_pack ("{ s:i s:i s:i s:i s:i s:o }",
                              "#watchers", 0,
                              "#no-op stores", 0,
                              "#transactions", 0,
                              "#readytransactions", 0,
-                             "store revision", 0))) {
+                             "store revision", 0,
+                             "pipeline", pstats))) {
             errno = ENOMEM;
             goto done;
         }
@@ -2690,8 +3313,9 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
     }
 
     if (flux_respond_pack (h, msg,
-                           "{ s:O s:O }",
+                           "{ s:O s:O s:O }",
                            "cache", cstats,
+                           "lookup", lstats,
                            "namespace", nsstats) < 0) {
         flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
         goto done;
@@ -2705,18 +3329,25 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
     }
     json_decref (tstats);
     json_decref (cstats);
+    json_decref (lstats);
     json_decref (nsstats);
 }
 
 static int stats_clear_root_cb (struct kvsroot *root, void *arg)
 {
     kvstxn_mgr_clear_noop_stores (root->ktm);
+    kvstxn_mgr_clear_stats (root->ktm);
     return 0;
 }
 
 static void stats_clear (kvs_ctx_t *ctx)
 {
     ctx->faults = 0;
+    ctx->primed = 0;
+    ctx->prefetches = 0;
+    ctx->lookups = 0;
+    memset (&ctx->lookup_stalls, 0, sizeof (ctx->lookup_stalls));
+    memset (&ctx->lookup_cold_ms, 0, sizeof (ctx->lookup_cold_ms));
 
     if (kvsroot_mgr_iter_roots (ctx->krm, stats_clear_root_cb, NULL) < 0)
         flux_log_error (ctx->h, "%s: kvsroot_mgr_iter_roots", __FUNCTION__);
@@ -2750,7 +3381,7 @@ static int namespace_create (kvs_ctx_t *ctx, const char *namespace,
     void *data = NULL;
     flux_msg_t *msg = NULL;
     char *topic = NULL;
-    int len;
+    size_t len;
     int rv = -1;
 
     /* If namespace already exists, return EEXIST.  Doesn't matter if
@@ -2769,17 +3400,17 @@ static int namespace_create (kvs_ctx_t *ctx, const char *namespace,
         flux_log_error (ctx->h, "%s: kvsroot_mgr_create_root", __FUNCTION__);
         return -1;
     }
+    configure_kvstxn_mgr (ctx, root->ktm);
 
     if (!(rootdir = treeobj_create_dir ())) {
         flux_log_error (ctx->h, "%s: treeobj_create_dir", __FUNCTION__);
         goto cleanup;
     }
 
-    if (!(data = treeobj_encode (rootdir))) {
-        flux_log_error (ctx->h, "%s: treeobj_encode", __FUNCTION__);
+    if (!(data = treeobj_encodeb (rootdir, ctx->treeobj_format, &len))) {
+        flux_log_error (ctx->h, "%s: treeobj_encodeb", __FUNCTION__);
         goto cleanup;
     }
-    len = strlen (data);
 
     if (blobref_hash (ctx->hash_name, data, len, ref, sizeof (ref)) < 0) {
         flux_log_error (ctx->h, "%s: blobref_hash", __FUNCTION__);
@@ -3110,6 +3741,18 @@ static void process_args (kvs_ctx_t *ctx, int ac, char **av)
     for (i = 0; i < ac; i++) {
         if (strncmp (av[i], "transaction-merge=", 13) == 0)
             ctx->transaction_merge = strtoul (av[i]+13, NULL, 10);
+        else if (strncmp (av[i], "commit-workers=", 15) == 0)
+            ctx->commit_workers = strtoul (av[i]+15, NULL, 10);
+        else if (strncmp (av[i], "transaction-pipeline=", 21) == 0)
+            ctx->transaction_pipeline = strtoul (av[i]+21, NULL, 10);
+        else if (strncmp (av[i], "dir-shard-threshold=", 20) == 0)
+            ctx->dir_shard_threshold = strtoul (av[i]+20, NULL, 10);
+        else if (strncmp (av[i], "setroot-blobs=", 14) == 0)
+            ctx->setroot_blobs = strtoul (av[i]+14, NULL, 10);
+        else if (strcmp (av[i], "treeobj-format=json") == 0)
+            ctx->treeobj_format = TREEOBJ_FORMAT_JSON;
+        else if (strcmp (av[i], "treeobj-format=binary") == 0)
+            ctx->treeobj_format = TREEOBJ_FORMAT_BINARY;
         else
             flux_log (ctx->h, LOG_ERR, "Unknown option `%s'", av[i]);
     }
@@ -3123,7 +3766,7 @@ static int store_initial_rootdir (kvs_ctx_t *ctx, char *ref, int ref_len)
     struct cache_entry *entry;
     int saved_errno, ret;
     void *data = NULL;
-    int len;
+    size_t len;
     flux_future_t *f = NULL;
     const char *newref;
     json_t *rootdir = NULL;
@@ -3132,9 +3775,8 @@ static int store_initial_rootdir (kvs_ctx_t *ctx, char *ref, int ref_len)
         flux_log_error (ctx->h, "%s: treeobj_create_dir", __FUNCTION__);
         goto error;
     }
-    if (!(data = treeobj_encode (rootdir)))
+    if (!(data = treeobj_encodeb (rootdir, ctx->treeobj_format, &len)))
         goto error;
-    len = strlen (data);
     if (blobref_hash (ctx->hash_name, data, len, ref, ref_len) < 0) {
         flux_log_error (ctx->h, "%s: blobref_hash", __FUNCTION__);
         goto error;
@@ -3200,6 +3842,11 @@ int mod_main (flux_t *h, int argc, char **argv)
     process_args (ctx, argc, argv);
     if (ctx->rank == 0) {
         struct kvsroot *root;
+
+        if (unroll_pool_start (ctx) < 0) {
+            flux_log_error (h, "error starting commit workers");
+            goto done;
+        }
         char rootref[BLOBREF_MAX_STRING_SIZE];
         uint32_t owner = geteuid ();
 
@@ -3223,6 +3870,7 @@ int mod_main (flux_t *h, int argc, char **argv)
                 flux_log_error (h, "kvsroot_mgr_create_root");
                 goto done;
             }
+            configure_kvstxn_mgr (ctx, root->ktm);
         }
 
         setroot (ctx, root, rootref, 0);
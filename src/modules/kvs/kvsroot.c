@@ -88,6 +88,7 @@ static void kvsroot_destroy (void *data)
             treq_mgr_destroy (root->trm);
         if (root->watchlist)
             wait_queue_destroy (root->watchlist);
+        zhash_destroy (&root->path_hints);
         free (data);
     }
 }
@@ -275,6 +276,41 @@ int kvsroot_check_user (kvsroot_mgr_t *krm, struct kvsroot *root,
     return -1;
 }
 
+int kvsroot_set_path_hint (struct kvsroot *root, const char *path,
+                           const char *ref)
+{
+    char *cpy;
+
+    if (!root || !path || !ref) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (root->path_hints
+        && zhash_size (root->path_hints) >= KVSROOT_PATH_HINTS_MAX
+        && !zhash_lookup (root->path_hints, path))
+        zhash_destroy (&root->path_hints);
+    if (!root->path_hints) {
+        if (!(root->path_hints = zhash_new ())) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    if (!(cpy = strdup (ref))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    zhash_update (root->path_hints, path, cpy);
+    zhash_freefn (root->path_hints, path, free);
+    return 0;
+}
+
+const char *kvsroot_get_path_hint (struct kvsroot *root, const char *path)
+{
+    if (!root || !root->path_hints || !path)
+        return NULL;
+    return zhash_lookup (root->path_hints, path);
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
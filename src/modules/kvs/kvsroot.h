@@ -12,6 +12,7 @@
 #define _FLUX_KVS_KVSROOT_H
 
 #include <stdbool.h>
+#include <czmq.h>
 #include <flux/core.h>
 
 #include "cache.h"
@@ -22,6 +23,10 @@
 
 typedef struct kvsroot_mgr kvsroot_mgr_t;
 
+/* Maximum number of path hints remembered per namespace.
+ */
+#define KVSROOT_PATH_HINTS_MAX 1024
+
 struct kvsroot {
     char *namespace;
     uint32_t owner;
@@ -33,6 +38,7 @@ struct kvsroot {
     int watchlist_lastrun_epoch;
     int flags;
     bool remove;
+    zhash_t *path_hints;        /* key path => dirref last seen there */
 };
 
 /* return -1 on error, 0 on success, 1 on success & to stop iterating */
@@ -75,6 +81,15 @@ void kvsroot_setroot (kvsroot_mgr_t *krm, struct kvsroot *root,
 int kvsroot_check_user (kvsroot_mgr_t *krm, struct kvsroot *root,
                         uint32_t rolemask, uint32_t userid);
 
+/* Remember 'ref' as the dirref last seen at key 'path' in this
+ * namespace, and recall it later.  Hints are used to prefetch the
+ * directories of a cold lookup path and may be stale.  When the
+ * hint table is full it is emptied.
+ */
+int kvsroot_set_path_hint (struct kvsroot *root, const char *path,
+                           const char *ref);
+const char *kvsroot_get_path_hint (struct kvsroot *root, const char *path);
+
 #endif /* !_FLUX_KVS_KVSROOT_H */
 
 /*
@@ -25,6 +25,7 @@
 
 #include "src/common/libutil/macros.h"
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/monotime.h"
 #include "src/common/libkvs/treeobj.h"
 #include "src/common/libkvs/kvs_txn_private.h"
 #include "src/common/libkvs/kvs_util_private.h"
@@ -39,7 +40,13 @@ struct kvstxn_mgr {
     struct cache *cache;
     const char *namespace;
     const char *hash_name;
+    int treeobj_format;         /* encoding of stored treeobjs */
+    int dir_shard_threshold;    /* shard dirs with more entries, 0=never */
     int noop_stores;            /* for kvs.stats.get, etc.*/
+    int pipeline_depth;         /* max transactions processed at once */
+    bool unroll_offload;        /* unroll via kvstxn_unroll_work() */
+    struct kvstxn_mgr_stats stats;
+    struct timespec stats_t0;
     zlist_t *ready;
     flux_t *h;
     void *aux;
@@ -54,9 +61,15 @@ struct kvstxn {
     json_t *names;
     int flags;
     json_t *rootcpy;   /* working copy of root dir */
+    char rootref[BLOBREF_MAX_STRING_SIZE];  /* root rootcpy was made from */
     char newroot[BLOBREF_MAX_STRING_SIZE];
+    kvstxn_process_t stall;
+    struct timespec stall_t0;
+    zlist_t *deferred_stores;   /* encoded by kvstxn_unroll_work() */
+    int unroll_errnum;
     zlist_t *missing_refs_list;
     zlist_t *dirty_cache_entries_list;
+    json_t *new_refs;           /* refs of entries passed to caller */
     int internal_flags;
     kvstxn_mgr_t *ktm;
     enum {
@@ -69,9 +82,40 @@ struct kvstxn {
     } state;
 };
 
+static json_t *keys_from_ops (json_t *ops);
+
+/* An object encoded and hashed off the reactor thread, waiting to be
+ * stored in the cache.
+ */
+struct deferred_store {
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    void *data;
+    size_t len;
+};
+
+static void deferred_store_destroy (struct deferred_store *ds)
+{
+    if (ds) {
+        free (ds->data);
+        free (ds);
+    }
+}
+
+static void deferred_stores_destroy (kvstxn_t *kt)
+{
+    struct deferred_store *ds;
+
+    if (kt->deferred_stores) {
+        while ((ds = zlist_pop (kt->deferred_stores)))
+            deferred_store_destroy (ds);
+        zlist_destroy (&kt->deferred_stores);
+    }
+}
+
 static void kvstxn_destroy (kvstxn_t *kt)
 {
     if (kt) {
+        deferred_stores_destroy (kt);
         json_decref (kt->ops);
         json_decref (kt->keys);
         json_decref (kt->names);
@@ -80,6 +124,7 @@ static void kvstxn_destroy (kvstxn_t *kt)
             zlist_destroy (&kt->missing_refs_list);
         if (kt->dirty_cache_entries_list)
             zlist_destroy (&kt->dirty_cache_entries_list);
+        json_decref (kt->new_refs);
         free (kt);
     }
 }
@@ -116,6 +161,12 @@ static kvstxn_t *kvstxn_create (kvstxn_mgr_t *ktm,
             goto error;
         }
     }
+    /* Keys are needed before processing to find conflicts between
+     * ready transactions.  Failure is not fatal here, the transaction
+     * then conflicts with everything and the error surfaces when the
+     * keys are regenerated in kvstxn_process().
+     */
+    kt->keys = keys_from_ops (kt->ops);
     kt->flags = flags;
     if (!(kt->missing_refs_list = zlist_new ())) {
         saved_errno = ENOMEM;
@@ -125,6 +176,10 @@ static kvstxn_t *kvstxn_create (kvstxn_mgr_t *ktm,
         saved_errno = ENOMEM;
         goto error;
     }
+    if (!(kt->new_refs = json_array ())) {
+        saved_errno = ENOMEM;
+        goto error;
+    }
     kt->ktm = ktm;
     kt->state = KVSTXN_STATE_INIT;
     return kt;
@@ -196,6 +251,13 @@ json_t *kvstxn_get_keys (kvstxn_t *kt)
     return NULL;
 }
 
+json_t *kvstxn_get_new_refs (kvstxn_t *kt)
+{
+    if (kt->state == KVSTXN_STATE_FINISHED)
+        return kt->new_refs;
+    return NULL;
+}
+
 /* On error we should cleanup anything on the dirty cache list
  * that has not yet been passed to the user.  Because this has not
  * been passed to the user, there should be no waiters and the
@@ -243,33 +305,28 @@ static void cleanup_dirty_cache_list (kvstxn_t *kt)
         kvstxn_cleanup_dirty_cache_entry (kt, entry);
 }
 
-/* Store object 'o' under key 'ref' in local cache.
- * Object reference is still owned by the caller.
- * 'is_raw' indicates this data is a json string w/ base64 value and
- * should be flushed to the content store as raw data after it is
- * decoded.  Otherwise, the json object should be a treeobj.
- * Returns -1 on error, 0 on success entry already there, 1 on success
- * entry needs to be flushed to content store
+/* Encode object 'o' as it is to be stored, and write its blobref into
+ * 'ref'.  The encoded data is returned in 'datap', to be freed by the
+ * caller.  See store_cache() for 'is_raw'.  Touches only 'kt' and 'o',
+ * so may be called off the reactor thread, and does not log.
+ * Returns 0 on success, -1 on error with errno set.
  */
-static int store_cache (kvstxn_t *kt, int current_epoch, json_t *o,
-                        bool is_raw, char *ref, int ref_len,
-                        struct cache_entry **entryp)
+static int store_encode (kvstxn_t *kt, json_t *o, bool is_raw,
+                         char *ref, int ref_len,
+                         char **datap, size_t *lenp)
 {
-    struct cache_entry *entry;
-    int saved_errno, rc;
     const char *xdata;
     char *data = NULL;
-    size_t xlen, len;
+    size_t xlen, len = 0;
+    int saved_errno;
 
     if (is_raw) {
         xdata = json_string_value (o);
         xlen = strlen (xdata);
         len = BASE64_DECODE_SIZE (xlen);
         if (len > 0) {
-            if (!(data = malloc (len))) {
-                flux_log_error (kt->ktm->h, "malloc");
+            if (!(data = malloc (len)))
                 goto error;
-            }
             if (sodium_base642bin ((unsigned char *)data, len, xdata, xlen,
                                    NULL, &len, NULL,
                                    sodium_base64_VARIANT_ORIGINAL) < 0) {
@@ -279,25 +336,42 @@ static int store_cache (kvstxn_t *kt, int current_epoch, json_t *o,
         }
     }
     else {
-        if (treeobj_validate (o) < 0 || !(data = treeobj_encode (o))) {
-            flux_log_error (kt->ktm->h, "%s: treeobj_encode", __FUNCTION__);
+        if (treeobj_validate (o) < 0
+            || !(data = treeobj_encodeb (o, kt->ktm->treeobj_format, &len)))
             goto error;
-        }
-        len = strlen (data);
     }
-    if (blobref_hash (kt->ktm->hash_name, data, len, ref, ref_len) < 0) {
-        flux_log_error (kt->ktm->h, "%s: blobref_hash", __FUNCTION__);
+    if (blobref_hash (kt->ktm->hash_name, data, len, ref, ref_len) < 0)
         goto error;
-    }
+    *datap = data;
+    *lenp = len;
+    return 0;
+error:
+    saved_errno = errno;
+    free (data);
+    errno = saved_errno;
+    return -1;
+}
+
+/* Store 'len' bytes of encoded 'data' under key 'ref' in local cache.
+ * Returns -1 on error, 0 on success entry already there, 1 on success
+ * entry needs to be flushed to content store
+ */
+static int store_cache_data (kvstxn_t *kt, int current_epoch,
+                             const char *ref, void *data, size_t len,
+                             struct cache_entry **entryp)
+{
+    struct cache_entry *entry;
+    int rc;
+
     if (!(entry = cache_lookup (kt->ktm->cache, ref, current_epoch))) {
         if (!(entry = cache_entry_create (ref))) {
             flux_log_error (kt->ktm->h, "%s: cache_entry_create", __FUNCTION__);
-            goto error;
+            return -1;
         }
         if (cache_insert (kt->ktm->cache, entry) < 0) {
             cache_entry_destroy (entry);
             flux_log_error (kt->ktm->h, "%s: cache_insert", __FUNCTION__);
-            goto error;
+            return -1;
         }
     }
     if (cache_entry_get_valid (entry)) {
@@ -309,28 +383,285 @@ static int store_cache (kvstxn_t *kt, int current_epoch, json_t *o,
             int ret;
             ret = cache_remove_entry (kt->ktm->cache, ref);
             assert (ret == 1);
-            goto error;
+            return -1;
         }
         if (cache_entry_set_dirty (entry, true) < 0) {
             flux_log_error (kt->ktm->h, "%s: cache_entry_set_dirty",__FUNCTION__);
             int ret;
             ret = cache_remove_entry (kt->ktm->cache, ref);
             assert (ret == 1);
-            goto error;
+            return -1;
         }
         rc = 1;
     }
     *entryp = entry;
-    free (data);
     return rc;
+}
 
- error:
+/* Store object 'o' under key 'ref' in local cache.
+ * Object reference is still owned by the caller.
+ * 'is_raw' indicates this data is a json string w/ base64 value and
+ * should be flushed to the content store as raw data after it is
+ * decoded.  Otherwise, the json object should be a treeobj.
+ * Returns -1 on error, 0 on success entry already there, 1 on success
+ * entry needs to be flushed to content store
+ *
+ * Within kvstxn_unroll_work(), the encoded object is only queued on
+ * kt->deferred_stores and 0 is returned.  The cache is updated later
+ * on the reactor thread by store_deferred().
+ */
+static int store_cache (kvstxn_t *kt, int current_epoch, json_t *o,
+                        bool is_raw, char *ref, int ref_len,
+                        struct cache_entry **entryp)
+{
+    char *data = NULL;
+    size_t len;
+    int saved_errno, rc;
+
+    if (store_encode (kt, o, is_raw, ref, ref_len, &data, &len) < 0) {
+        if (!kt->deferred_stores)
+            flux_log_error (kt->ktm->h, "%s: store_encode", __FUNCTION__);
+        return -1;
+    }
+    if (kt->deferred_stores) {
+        struct deferred_store *ds;
+
+        if (!(ds = calloc (1, sizeof (*ds))))
+            goto error;
+        snprintf (ds->ref, sizeof (ds->ref), "%s", ref);
+        ds->data = data;
+        ds->len = len;
+        if (zlist_append (kt->deferred_stores, ds) < 0) {
+            ds->data = NULL;
+            deferred_store_destroy (ds);
+            errno = ENOMEM;
+            goto error;
+        }
+        *entryp = NULL;
+        return 0;
+    }
+    if ((rc = store_cache_data (kt, current_epoch, ref,
+                                data, len, entryp)) < 0)
+        goto error;
+    free (data);
+    return rc;
+error:
     saved_errno = errno;
     free (data);
     errno = saved_errno;
     return -1;
 }
 
+/* Store objects queued by kvstxn_unroll_work() in the cache, in the
+ * order they were encoded, and queue them for flushing if needed.
+ */
+static int store_deferred (kvstxn_t *kt, int current_epoch)
+{
+    struct deferred_store *ds;
+    struct cache_entry *entry;
+    int ret;
+
+    while ((ds = zlist_pop (kt->deferred_stores))) {
+        ret = store_cache_data (kt, current_epoch, ds->ref,
+                                ds->data, ds->len, &entry);
+        deferred_store_destroy (ds);
+        if (ret < 0)
+            return -1;
+        if (ret) {
+            if (zlist_push (kt->dirty_cache_entries_list, entry) < 0) {
+                kvstxn_cleanup_dirty_cache_entry (kt, entry);
+                errno = ENOMEM;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Store directory object 'o' (dir or hdir) in the local cache and
+ * queue it for flushing if needed.  Its blobref is written into 'ref'.
+ */
+static int kvstxn_dir_to_cache (kvstxn_t *kt, int current_epoch,
+                                json_t *o, char *ref, int ref_len)
+{
+    struct cache_entry *entry;
+    int ret;
+
+    if ((ret = store_cache (kt, current_epoch, o,
+                            false, ref, ref_len, &entry)) < 0)
+        return -1;
+
+    if (ret) {
+        if (zlist_push (kt->dirty_cache_entries_list, entry) < 0) {
+            kvstxn_cleanup_dirty_cache_entry (kt, entry);
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Create an hdir at 'level' and distribute the entries of 'dir' over
+ * its slots.  Entries are shared with 'dir', not copied.
+ */
+static json_t *hdir_create_from_dir (json_t *dir, int level)
+{
+    json_t *hdir, *data, *entry, *shard;
+    const char *name;
+    int index, saved_errno;
+
+    if (!(data = treeobj_get_data (dir)))
+        return NULL;
+    if (!(hdir = treeobj_create_hdir ()))
+        return NULL;
+    json_object_foreach (data, name, entry) {
+        if ((index = treeobj_hdir_slot (name, level)) < 0)
+            goto error;
+        if (!(shard = treeobj_get_slot (hdir, index))) {
+            if (!(shard = treeobj_create_dir ()))
+                goto error;
+            if (treeobj_insert_slot (hdir, index, shard) < 0) {
+                json_decref (shard);
+                goto error;
+            }
+            json_decref (shard);
+        }
+        if (treeobj_insert_entry (shard, name, entry) < 0)
+            goto error;
+    }
+    return hdir;
+error:
+    saved_errno = errno;
+    json_decref (hdir);
+    errno = saved_errno;
+    return NULL;
+}
+
+static int kvstxn_unroll (kvstxn_t *kt, int current_epoch, json_t *dir);
+static int kvstxn_unroll_hdir (kvstxn_t *kt, int current_epoch,
+                               json_t *hdir, int level);
+
+/* Store the shard or child node in slot 'index' of sharded directory
+ * node 'hdir' at 'level', replacing it with a dirref.  A shard that has
+ * outgrown the threshold is split into a child node at the next level,
+ * and a slot that has become empty is dropped.
+ * Return 0 on success, -1 on error
+ */
+static int kvstxn_unroll_slot (kvstxn_t *kt, int current_epoch,
+                               json_t *hdir, int index, int level)
+{
+    int threshold = kt->ktm->dir_shard_threshold;
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    json_t *child, *split = NULL, *ktmp;
+    int saved_errno, rc = -1;
+
+    if (!(child = treeobj_get_slot (hdir, index)))
+        return -1;
+    if (treeobj_is_dir (child)
+        && threshold > 0
+        && treeobj_get_count (child) > threshold
+        && level + 1 < TREEOBJ_HDIR_MAXLEVEL) {
+        if (!(split = hdir_create_from_dir (child, level + 1)))
+            return -1;
+        child = split;
+    }
+    if (treeobj_is_hdir (child)) {
+        if (kvstxn_unroll_hdir (kt, current_epoch, child, level + 1) < 0)
+            goto done;
+    }
+    else if (kvstxn_unroll (kt, current_epoch, child) < 0)
+        goto done;
+    if (treeobj_get_count (child) == 0) {
+        if (treeobj_delete_slot (hdir, index) < 0)
+            goto done;
+    }
+    else {
+        if (kvstxn_dir_to_cache (kt, current_epoch, child,
+                                 ref, sizeof (ref)) < 0)
+            goto done;
+        if (!(ktmp = treeobj_create_dirref (ref)))
+            goto done;
+        if (treeobj_insert_slot (hdir, index, ktmp) < 0) {
+            json_decref (ktmp);
+            goto done;
+        }
+        json_decref (ktmp);
+    }
+    rc = 0;
+done:
+    saved_errno = errno;
+    json_decref (split);
+    errno = saved_errno;
+    return rc;
+}
+
+/* Store the modified shards and child nodes of sharded directory node
+ * 'hdir' at 'level'.  Unmodified slots are already dirrefs.
+ * Return 0 on success, -1 on error
+ */
+static int kvstxn_unroll_hdir (kvstxn_t *kt, int current_epoch,
+                               json_t *hdir, int level)
+{
+    const json_t *child;
+    int index;
+
+    for (index = 0; index < TREEOBJ_HDIR_FANOUT; index++) {
+        if (!(child = treeobj_peek_slot (hdir, index))) {
+            if (errno != ENOENT)
+                return -1;
+            continue;
+        }
+        if (treeobj_is_dirref (child))
+            continue;
+        if (kvstxn_unroll_slot (kt, current_epoch, hdir, index, level) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Unroll directory 'dir' (dir or hdir) and store it, writing its
+ * blobref into 'ref'.  A dir with more entries than the threshold is
+ * stored as a sharded directory, and a sharded directory that has
+ * become empty is stored as an empty dir.
+ * Return 0 on success, -1 on error
+ */
+static int kvstxn_unroll_subdir (kvstxn_t *kt, int current_epoch,
+                                 json_t *dir, char *ref, int ref_len)
+{
+    int threshold = kt->ktm->dir_shard_threshold;
+    json_t *tmp = NULL;
+    int saved_errno, rc = -1;
+
+    if (treeobj_is_dir (dir)
+        && threshold > 0
+        && treeobj_get_count (dir) > threshold) {
+        if (!(tmp = hdir_create_from_dir (dir, 0)))
+            return -1;
+        dir = tmp;
+    }
+    if (treeobj_is_hdir (dir)) {
+        if (kvstxn_unroll_hdir (kt, current_epoch, dir, 0) < 0)
+            goto done;
+        if (treeobj_get_count (dir) == 0) {
+            json_decref (tmp);
+            if (!(tmp = treeobj_create_dir ()))
+                goto done;
+            dir = tmp;
+        }
+    }
+    else if (kvstxn_unroll (kt, current_epoch, dir) < 0)
+        goto done;
+    if (kvstxn_dir_to_cache (kt, current_epoch, dir, ref, ref_len) < 0)
+        goto done;
+    rc = 0;
+done:
+    saved_errno = errno;
+    json_decref (tmp);
+    errno = saved_errno;
+    return rc;
+}
+
 /* Store DIRVAL objects, converting them to DIRREFs.
  * Store (large) FILEVAL objects, converting them to FILEREFs.
  * Return 0 on success, -1 on error
@@ -357,19 +688,10 @@ static int kvstxn_unroll (kvstxn_t *kt, int current_epoch, json_t *dir)
      */
     while (iter) {
         dir_entry = json_object_iter_value (iter);
-        if (treeobj_is_dir (dir_entry)) {
-            if (kvstxn_unroll (kt, current_epoch, dir_entry) < 0) /* depth first */
+        if (treeobj_is_dir (dir_entry) || treeobj_is_hdir (dir_entry)) {
+            if (kvstxn_unroll_subdir (kt, current_epoch, dir_entry,
+                                      ref, sizeof (ref)) < 0) /* depth first */
                 return -1;
-            if ((ret = store_cache (kt, current_epoch, dir_entry,
-                                    false, ref, sizeof (ref), &entry)) < 0)
-                return -1;
-            if (ret) {
-                if (zlist_push (kt->dirty_cache_entries_list, entry) < 0) {
-                    kvstxn_cleanup_dirty_cache_entry (kt, entry);
-                    errno = ENOMEM;
-                    return -1;
-                }
-            }
             if (!(ktmp = treeobj_create_dirref (ref)))
                 return -1;
             if (json_object_iter_set_new (dir, iter, ktmp) < 0) {
@@ -530,7 +852,8 @@ static int kvstxn_append (kvstxn_t *kt, int current_epoch, json_t *dirent,
         return -1;
     }
     else if (treeobj_is_dir (entry)
-             || treeobj_is_dirref (entry)) {
+             || treeobj_is_dirref (entry)
+             || treeobj_is_hdir (entry)) {
         errno = EISDIR;
         return -1;
     }
@@ -570,6 +893,80 @@ static int check_cross_namespace (kvstxn_t *kt,
     return 0;
 }
 
+/* Find the shard of sharded directory 'hdir' that holds 'name',
+ * replacing the nodes on the way with copies that may be modified.
+ * If 'create' is true, an empty shard is added if there is none.
+ * On success, *shardp is set to the shard, or to NULL if there is none
+ * or a missing reference was returned in *missing_ref (stall).
+ * Return 0 on success, -1 on error
+ */
+static int hdir_get_shard (kvstxn_t *kt, int current_epoch,
+                           json_t *hdir, const char *name, bool create,
+                           json_t **shardp, const char **missing_ref)
+{
+    json_t *node = hdir;
+    int level, index;
+
+    *shardp = NULL;
+    for (level = 0; level < TREEOBJ_HDIR_MAXLEVEL; level++) {
+        json_t *child;
+
+        if ((index = treeobj_hdir_slot (name, level)) < 0)
+            return -1;
+        if (!(child = treeobj_get_slot (node, index))) {
+            if (errno != ENOENT)
+                return -1;
+            if (!create)
+                return 0;
+            if (!(child = treeobj_create_dir ()))
+                return -1;
+            if (treeobj_insert_slot (node, index, child) < 0) {
+                json_decref (child);
+                return -1;
+            }
+            json_decref (child);
+        }
+        else if (treeobj_is_dirref (child)) {
+            struct cache_entry *entry;
+            const json_t *ktmp;
+            const char *ref;
+
+            if (treeobj_get_count (child) != 1
+                || !(ref = treeobj_get_blobref (child, 0))) {
+                errno = ENOTRECOVERABLE;
+                return -1;
+            }
+            if (!(entry = cache_lookup (kt->ktm->cache, ref, current_epoch))
+                || !cache_entry_get_valid (entry)) {
+                *missing_ref = ref;
+                return 0; /* stall */
+            }
+            if (!(ktmp = cache_entry_get_treeobj (entry))) {
+                errno = ENOTRECOVERABLE;
+                return -1;
+            }
+            /* do not corrupt store by modifying orig. */
+            if (!(child = treeobj_deep_copy (ktmp)))
+                return -1;
+            if (treeobj_insert_slot (node, index, child) < 0) {
+                json_decref (child);
+                errno = ENOTRECOVERABLE;
+                return -1;
+            }
+            json_decref (child);
+        }
+        if (treeobj_is_dir (child)) {
+            *shardp = child;
+            return 0;
+        }
+        if (!treeobj_is_hdir (child))
+            break;
+        node = child;
+    }
+    errno = ENOTRECOVERABLE;
+    return -1;
+}
+
 /* link (key, dirent) into directory 'dir'.
  */
 static int kvstxn_link_dirent (kvstxn_t *kt, int current_epoch,
@@ -610,6 +1007,20 @@ static int kvstxn_link_dirent (kvstxn_t *kt, int current_epoch,
     while ((next = strchr (name, '.'))) {
         *next++ = '\0';
 
+        if (treeobj_is_hdir (dir)) {
+            json_t *shard;
+
+            if (hdir_get_shard (kt, current_epoch, dir, name,
+                                !json_is_null (dirent),
+                                &shard, missing_ref) < 0) {
+                saved_errno = errno;
+                goto done;
+            }
+            if (!shard) /* stall, or key deletion - it doesn't exist */
+                goto success;
+            dir = shard;
+        }
+
         if (!treeobj_is_dir (dir)) {
             saved_errno = ENOTRECOVERABLE;
             goto done;
@@ -628,7 +1039,8 @@ static int kvstxn_link_dirent (kvstxn_t *kt, int current_epoch,
                 goto done;
             }
             json_decref (subdir);
-        } else if (treeobj_is_dir (dir_entry)) {
+        } else if (treeobj_is_dir (dir_entry)
+                   || treeobj_is_hdir (dir_entry)) {
             subdir = dir_entry;
         } else if (treeobj_is_dirref (dir_entry)) {
             struct cache_entry *entry;
@@ -739,6 +1151,19 @@ static int kvstxn_link_dirent (kvstxn_t *kt, int current_epoch,
     /* This is the final path component of the key.  Add/modify/delete
      * it in the directory.
      */
+    if (treeobj_is_hdir (dir)) {
+        json_t *shard;
+
+        if (hdir_get_shard (kt, current_epoch, dir, name,
+                            !json_is_null (dirent),
+                            &shard, missing_ref) < 0) {
+            saved_errno = errno;
+            goto done;
+        }
+        if (!shard) /* stall, or key deletion - it doesn't exist */
+            goto success;
+        dir = shard;
+    }
     if (!json_is_null (dirent)) {
         if (flags & FLUX_KVS_APPEND) {
             if (kvstxn_append (kt, current_epoch, dirent, dir, name) < 0) {
@@ -854,19 +1279,62 @@ error:
     return NULL;
 }
 
-kvstxn_process_t kvstxn_process (kvstxn_t *kt,
-                                 int current_epoch,
-                                 const char *rootdir_ref)
+/* The root may only be updated by the transaction at the head of the
+ * ready queue.
+ */
+static bool kvstxn_is_head (kvstxn_t *kt)
 {
-    /* Incase user calls kvstxn_process() again */
-    if (kt->errnum)
-        return KVSTXN_PROCESS_ERROR;
+    return zlist_first (kt->ktm->ready) == kt;
+}
 
-    if (!(kt->internal_flags & KVSTXN_PROCESSING)) {
-        kt->errnum = EINVAL;
-        return KVSTXN_PROCESS_ERROR;
+/* Discard any work done and return to the initial state, so that ops
+ * can be applied again to the current root.
+ */
+static void kvstxn_reset (kvstxn_t *kt)
+{
+    char *ref;
+
+    while ((ref = zlist_pop (kt->missing_refs_list)))
+        free (ref);
+    cleanup_dirty_cache_list (kt);
+    deferred_stores_destroy (kt);
+    json_array_clear (kt->new_refs);
+    json_decref (kt->rootcpy);
+    kt->rootcpy = NULL;
+    kt->rootref[0] = '\0';
+    kt->newroot[0] = '\0';
+    kt->errnum = 0;
+    kt->state = KVSTXN_STATE_INIT;
+}
+
+static void kvstxn_stall_begin (kvstxn_t *kt, kvstxn_process_t stall)
+{
+    if (stall == KVSTXN_PROCESS_LOAD_MISSING_REFS)
+        kt->ktm->stats.load_stalls++;
+    else
+        kt->ktm->stats.store_stalls++;
+    kt->stall = stall;
+    monotime (&kt->stall_t0);
+}
+
+static void kvstxn_stall_end (kvstxn_t *kt)
+{
+    if (kt->stall) {
+        double t = monotime_since (kt->stall_t0) * 1E-3;
+
+        if (kt->stall == KVSTXN_PROCESS_LOAD_MISSING_REFS)
+            kt->ktm->stats.load_stall_time += t;
+        else
+            kt->ktm->stats.store_stall_time += t;
+        kt->stall = 0;
     }
+}
 
+static kvstxn_process_t kvstxn_process_stages (kvstxn_t *kt,
+                                               int current_epoch,
+                                               const char *rootdir_ref)
+{
+ restart:
     switch (kt->state) {
     case KVSTXN_STATE_INIT:
     case KVSTXN_STATE_LOAD_ROOT:
@@ -903,6 +1371,7 @@ kvstxn_process_t kvstxn_process (kvstxn_t *kt,
             kt->errnum = errno;
             return KVSTXN_PROCESS_ERROR;
         }
+        snprintf (kt->rootref, sizeof (kt->rootref), "%s", rootdir_ref);
 
         kt->state = KVSTXN_STATE_APPLY_OPS;
         /* fallthrough */
@@ -966,6 +1435,25 @@ kvstxn_process_t kvstxn_process (kvstxn_t *kt,
         if (zlist_first (kt->missing_refs_list))
             goto stall_load;
 
+        /* Only the head of the ready queue goes on to store and update
+         * the root.  A transaction started ahead of its turn stops once
+         * the walk above has loaded everything it needs.  Its root copy
+         * will be stale by the time it reaches the head, so drop it, and
+         * apply the ops again, now without stalling, at the head.
+         */
+        if (!kvstxn_is_head (kt)) {
+            kvstxn_reset (kt);
+            kt->blocked = 0;
+            return KVSTXN_PROCESS_WAIT_TURN;
+        }
+        /* The transaction may have reached the head while stalled on a
+         * load, after the transaction ahead of it updated the root.
+         */
+        if (strcmp (kt->rootref, rootdir_ref) != 0) {
+            kvstxn_reset (kt);
+            goto restart;
+        }
+
         kt->state = KVSTXN_STATE_STORE;
         /* fallthrough */
     }
@@ -981,7 +1469,27 @@ kvstxn_process_t kvstxn_process (kvstxn_t *kt,
         struct cache_entry *entry;
         int sret;
 
-        if (kvstxn_unroll (kt, current_epoch, kt->rootcpy) < 0)
+        /* Encoding and hashing can be handed off to another thread,
+         * see kvstxn_unroll_work().  Afterwards only the cache has to
+         * be updated here.
+         */
+        if (kt->ktm->unroll_offload && !kt->deferred_stores) {
+            if (!(kt->deferred_stores = zlist_new ())) {
+                kt->errnum = ENOMEM;
+                return KVSTXN_PROCESS_ERROR;
+            }
+            kt->unroll_errnum = 0;
+            goto stall_unroll;
+        }
+
+        if (kt->deferred_stores) {
+            if (kt->unroll_errnum)
+                kt->errnum = kt->unroll_errnum;
+            else if (store_deferred (kt, current_epoch) < 0)
+                kt->errnum = errno;
+            deferred_stores_destroy (kt);
+        }
+        else if (kvstxn_unroll (kt, current_epoch, kt->rootcpy) < 0)
             kt->errnum = errno;
         else if ((sret = store_cache (kt,
                                       current_epoch,
@@ -1019,6 +1527,7 @@ kvstxn_process_t kvstxn_process (kvstxn_t *kt,
             goto stall_store;
 
         /* now generate keys for setroot */
+        json_decref (kt->keys);
         if (!(kt->keys = keys_from_ops (kt->ops))) {
             kt->errnum = ENOMEM;
             return KVSTXN_PROCESS_ERROR;
@@ -1038,11 +1547,69 @@ kvstxn_process_t kvstxn_process (kvstxn_t *kt,
 
  stall_load:
     kt->blocked = 1;
+    kvstxn_stall_begin (kt, KVSTXN_PROCESS_LOAD_MISSING_REFS);
     return KVSTXN_PROCESS_LOAD_MISSING_REFS;
 
  stall_store:
     kt->blocked = 1;
+    kvstxn_stall_begin (kt, KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES);
     return KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES;
+
+ stall_unroll:
+    kt->blocked = 1;
+    return KVSTXN_PROCESS_UNROLL;
+}
+
+void kvstxn_unroll_work (kvstxn_t *kt)
+{
+    struct cache_entry *entry;
+
+    if (kt->state != KVSTXN_STATE_STORE || !kt->deferred_stores) {
+        kt->unroll_errnum = EINVAL;
+        return;
+    }
+    if (kvstxn_unroll (kt, 0, kt->rootcpy) < 0
+        || store_cache (kt,
+                        0,
+                        kt->rootcpy,
+                        false,
+                        kt->newroot,
+                        sizeof (kt->newroot),
+                        &entry) < 0)
+        kt->unroll_errnum = errno;
+}
+
+kvstxn_process_t kvstxn_process (kvstxn_t *kt,
+                                 int current_epoch,
+                                 const char *rootdir_ref)
+{
+    kvstxn_process_t ret;
+
+    /* Incase user calls kvstxn_process() again */
+    if (kt->errnum)
+        return KVSTXN_PROCESS_ERROR;
+
+    if (!(kt->internal_flags & KVSTXN_PROCESSING)) {
+        kt->errnum = EINVAL;
+        return KVSTXN_PROCESS_ERROR;
+    }
+
+    kvstxn_stall_end (kt);
+
+    ret = kvstxn_process_stages (kt, current_epoch, rootdir_ref);
+
+    /* A transaction processed ahead of its turn may fail only because
+     * an earlier one has yet to update the root, e.g. when a key is
+     * reached through a symlink.  Retry once it is at the head.
+     */
+    if (ret == KVSTXN_PROCESS_ERROR
+        && kt->state <= KVSTXN_STATE_APPLY_OPS
+        && !kvstxn_is_head (kt)) {
+        kvstxn_reset (kt);
+        kt->blocked = 0;
+        return KVSTXN_PROCESS_WAIT_TURN;
+    }
+    return ret;
 }
 
 int kvstxn_iter_missing_refs (kvstxn_t *kt, kvstxn_ref_f cb, void *data)
@@ -1088,6 +1655,18 @@ int kvstxn_iter_dirty_cache_entries (kvstxn_t *kt,
     }
 
     while ((entry = zlist_pop (kt->dirty_cache_entries_list))) {
+        char ref[BLOBREF_MAX_STRING_SIZE];
+        json_t *o;
+
+        if (cache_entry_get_blobref (entry, ref, sizeof (ref)) < 0
+            || !(o = json_string (ref))
+            || json_array_append_new (kt->new_refs, o) < 0) {
+            /* entry was not passed to the caller, clean it up too */
+            kvstxn_cleanup_dirty_cache_entry (kt, entry);
+            saved_errno = ENOMEM;
+            rc = -1;
+            break;
+        }
         if (cb (kt, entry, data) < 0) {
             saved_errno = errno;
             rc = -1;
@@ -1124,6 +1703,9 @@ kvstxn_mgr_t *kvstxn_mgr_create (struct cache *cache,
     ktm->cache = cache;
     ktm->namespace = namespace;
     ktm->hash_name = hash_name;
+    ktm->dir_shard_threshold = KVSTXN_DIR_SHARD_THRESHOLD;
+    ktm->pipeline_depth = 1;
+    monotime (&ktm->stats_t0);
     if (!(ktm->ready = zlist_new ())) {
         saved_errno = ENOMEM;
         goto error;
@@ -1138,6 +1720,30 @@ kvstxn_mgr_t *kvstxn_mgr_create (struct cache *cache,
     return NULL;
 }
 
+void kvstxn_mgr_set_treeobj_format (kvstxn_mgr_t *ktm, int format)
+{
+    ktm->treeobj_format = format;
+}
+
+void kvstxn_mgr_set_dir_shard_threshold (kvstxn_mgr_t *ktm, int threshold)
+{
+    ktm->dir_shard_threshold = threshold;
+}
+
+void kvstxn_mgr_set_pipeline_depth (kvstxn_mgr_t *ktm, int depth)
+{
+    if (depth < 1)
+        depth = 1;
+    if (depth > KVSTXN_PIPELINE_DEPTH_MAX)
+        depth = KVSTXN_PIPELINE_DEPTH_MAX;
+    ktm->pipeline_depth = depth;
+}
+
+void kvstxn_mgr_set_unroll_offload (kvstxn_mgr_t *ktm, bool offload)
+{
+    ktm->unroll_offload = offload;
+}
+
 void kvstxn_mgr_destroy (kvstxn_mgr_t *ktm)
 {
     if (ktm) {
@@ -1175,19 +1781,87 @@ int kvstxn_mgr_add_transaction (kvstxn_mgr_t *ktm,
     return 0;
 }
 
-bool kvstxn_mgr_transaction_ready (kvstxn_mgr_t *ktm)
+/* Normalized keys overlap if they are equal or one is a directory
+ * containing the other.  The root directory "." contains everything.
+ */
+static bool key_overlap (const char *key1, const char *key2)
 {
-    kvstxn_t *kt;
+    size_t len1 = strlen (key1);
+    size_t len2 = strlen (key2);
+
+    if (!strcmp (key1, ".") || !strcmp (key2, "."))
+        return true;
+    if (len1 > len2)
+        return !strncmp (key1, key2, len2) && key1[len2] == '.';
+    if (len1 < len2)
+        return !strncmp (key1, key2, len1) && key2[len1] == '.';
+    return !strcmp (key1, key2);
+}
+
+static bool kvstxn_conflict (kvstxn_t *kt1, kvstxn_t *kt2)
+{
+    size_t i, j;
+    json_t *key1, *key2;
 
-    if ((kt = zlist_first (ktm->ready)) && !kt->blocked)
+    if (!kt1->keys || !kt2->keys)
         return true;
+    json_array_foreach (kt1->keys, i, key1) {
+        json_array_foreach (kt2->keys, j, key2) {
+            if (key_overlap (json_string_value (key1),
+                             json_string_value (key2)))
+                return true;
+        }
+    }
     return false;
 }
 
+/* Return the head of the ready queue if it is not blocked.  Otherwise
+ * look for a transaction that has not been started among the first
+ * 'pipeline_depth' transactions, whose keys do not overlap those of
+ * any transaction ahead of it.
+ */
+static kvstxn_t *kvstxn_mgr_next_ready (kvstxn_mgr_t *ktm)
+{
+    kvstxn_t *window[KVSTXN_PIPELINE_DEPTH_MAX];
+    kvstxn_t *kt;
+    int count = 0;
+    int i;
+
+    if (!(kt = zlist_first (ktm->ready)))
+        return NULL;
+    if (!kt->blocked)
+        return kt;
+    while (kt && count < ktm->pipeline_depth) {
+        /* merged components are represented by the merged kvstxn */
+        if (!(kt->internal_flags & KVSTXN_MERGE_COMPONENT)) {
+            if (kt->state == KVSTXN_STATE_INIT
+                && !(kt->internal_flags & KVSTXN_PROCESSING)) {
+                for (i = 0; i < count; i++) {
+                    if (kvstxn_conflict (window[i], kt))
+                        break;
+                }
+                if (i == count)
+                    return kt;
+            }
+            window[count++] = kt;
+        }
+        kt = zlist_next (ktm->ready);
+    }
+    return NULL;
+}
+
+bool kvstxn_mgr_transaction_ready (kvstxn_mgr_t *ktm)
+{
+    return kvstxn_mgr_next_ready (ktm) ? true : false;
+}
+
 kvstxn_t *kvstxn_mgr_get_ready_transaction (kvstxn_mgr_t *ktm)
 {
-    if (kvstxn_mgr_transaction_ready (ktm)) {
-        kvstxn_t *kt = zlist_first (ktm->ready);
+    kvstxn_t *kt;
+
+    if ((kt = kvstxn_mgr_next_ready (ktm))) {
+        if (!kvstxn_is_head (kt))
+            ktm->stats.pipelined++;
         kt->internal_flags |= KVSTXN_PROCESSING;
         return kt;
     }
@@ -1203,6 +1877,11 @@ void kvstxn_mgr_remove_transaction (kvstxn_mgr_t *ktm, kvstxn_t *kt,
         if (kt->internal_flags & KVSTXN_MERGED)
             kvstxn_is_merged = true;
 
+        if (kt->state == KVSTXN_STATE_FINISHED) {
+            int count = json_array_size (kt->names);
+            ktm->stats.commits += count > 0 ? count : 1;
+        }
+
         zlist_remove (ktm->ready, kt);
 
         if (kvstxn_is_merged) {
@@ -1231,6 +1910,18 @@ void kvstxn_mgr_clear_noop_stores (kvstxn_mgr_t *ktm)
     ktm->noop_stores = 0;
 }
 
+void kvstxn_mgr_get_stats (kvstxn_mgr_t *ktm, struct kvstxn_mgr_stats *stats)
+{
+    *stats = ktm->stats;
+    stats->elapsed = monotime_since (ktm->stats_t0) * 1E-3;
+}
+
+void kvstxn_mgr_clear_stats (kvstxn_mgr_t *ktm)
+{
+    memset (&ktm->stats, 0, sizeof (ktm->stats));
+    monotime (&ktm->stats_t0);
+}
+
 int kvstxn_mgr_ready_transaction_count (kvstxn_mgr_t *ktm)
 {
     return zlist_size (ktm->ready);
@@ -1266,7 +1957,12 @@ static int kvstxn_merge (kvstxn_t *dest, kvstxn_t *src)
             }
         }
     }
-    if ((len = json_array_size (src->keys))) {
+    if (!src->keys) {
+        /* see kvstxn_create(), merged kvstxn conflicts with everything */
+        json_decref (dest->keys);
+        dest->keys = NULL;
+    }
+    else if (dest->keys && (len = json_array_size (src->keys))) {
         for (i = 0; i < len; i++) {
             json_t *key;
             if ((key = json_array_get (src->keys, i))) {
@@ -1297,6 +1993,8 @@ static kvstxn_t *kvstxn_create_empty (kvstxn_mgr_t *ktm, int flags)
         goto error_enomem;
     if (!(ktnew->dirty_cache_entries_list = zlist_new ()))
         goto error_enomem;
+    if (!(ktnew->new_refs = json_array ()))
+        goto error_enomem;
     ktnew->flags = flags;
     ktnew->ktm = ktm;
     ktnew->state = KVSTXN_STATE_INIT;
@@ -1313,7 +2011,9 @@ error_enomem:
  * ready queue and appending their ops/names to the new transaction.
  * After merging, push the new kvstxn_t onto the head of the ready
  * queue.  Merging can occur if the top transaction hasn't started, or
- * is still building the rootcpy, e.g. stalled walking the namespace.
+ * is still building the rootcpy and is not stalled waiting on content.
+ * Transactions behind it that were started ahead of their turn (see
+ * kvstxn_mgr_next_ready()) are not merged.
  *
  * Break when an unmergeable transaction is discovered.  We do not
  * wish to merge non-adjacent transactions, as it can create
@@ -1337,6 +2037,7 @@ int kvstxn_mgr_merge_ready_transactions (kvstxn_mgr_t *ktm)
      * applied */
     first = zlist_first (ktm->ready);
     if (!first
+        || first->blocked
         || first->errnum != 0
         || first->aux_errnum != 0
         || first->state > KVSTXN_STATE_APPLY_OPS
@@ -1346,6 +2047,7 @@ int kvstxn_mgr_merge_ready_transactions (kvstxn_mgr_t *ktm)
 
     second = zlist_next (ktm->ready);
     if (!second
+        || second->state != KVSTXN_STATE_INIT
         || (second->flags & FLUX_KVS_NO_MERGE)
         || (first->flags != second->flags))
         return 0;
@@ -1358,6 +2060,11 @@ int kvstxn_mgr_merge_ready_transactions (kvstxn_mgr_t *ktm)
     do {
         int ret;
 
+        /* transactions already started ahead of the head cannot be
+         * merged */
+        if (nextkt != first && nextkt->state != KVSTXN_STATE_INIT)
+            break;
+
         if ((ret = kvstxn_merge (new, nextkt)) < 0) {
             kvstxn_destroy (new);
             return -1;
@@ -24,6 +24,8 @@ typedef enum {
     KVSTXN_PROCESS_LOAD_MISSING_REFS = 2,
     KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES = 3,
     KVSTXN_PROCESS_FINISHED = 4,
+    KVSTXN_PROCESS_WAIT_TURN = 5,
+    KVSTXN_PROCESS_UNROLL = 6,
 } kvstxn_process_t;
 
 /*
@@ -74,6 +76,13 @@ const char *kvstxn_get_newroot_ref (kvstxn_t *kt);
  * (i.e. kvstxn_process() returns KVSTXN_PROCESS_FINISHED) */
 json_t *kvstxn_get_keys (kvstxn_t *kt);
 
+/* Get the blobrefs of the objects created by the transaction, in the
+ * order their dirty cache entries were returned by
+ * kvstxn_iter_dirty_cache_entries().  Returns non-NULL only if process
+ * state complete (i.e. kvstxn_process() returns KVSTXN_PROCESS_FINISHED).
+ */
+json_t *kvstxn_get_new_refs (kvstxn_t *kt);
+
 /* Primary transaction processing function.
  *
  * Pass in a kvstxn_t that was obtained via
@@ -84,6 +93,18 @@ json_t *kvstxn_get_keys (kvstxn_t *kt);
  * KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES stall & process dirty cache
  * entries,
  * KVSTXN_PROCESS_FINISHED all done
+ * KVSTXN_PROCESS_WAIT_TURN stall until earlier transactions complete
+ * KVSTXN_PROCESS_UNROLL stall & call kvstxn_unroll_work()
+ *
+ * Transactions may be processed concurrently (see
+ * kvstxn_mgr_set_pipeline_depth()), but only to load missing content.
+ * A transaction behind the head of the ready queue returns
+ * KVSTXN_PROCESS_WAIT_TURN once its content is loaded, and is returned
+ * again by kvstxn_mgr_get_ready_transaction() when it reaches the head
+ * of the queue.  Its ops are then applied to the current root and
+ * stored, so each transaction is stored once.  An error ahead of its
+ * turn is not final either, as an earlier transaction may change the
+ * outcome: the transaction is reset and processed again at the head.
  *
  * on error, call kvstxn_get_errnum() to get error number
  *
@@ -92,6 +113,10 @@ json_t *kvstxn_get_keys (kvstxn_t *kt);
  * on stall & process dirty cache entries, call
  * kvstxn_iter_dirty_cache_entries() to process entries.
  *
+ * on stall & unroll, call kvstxn_unroll_work(), possibly in another
+ * thread, then kvstxn_process() again (see
+ * kvstxn_mgr_set_unroll_offload()).
+ *
  * on completion, call kvstxn_get_newroot_ref() to get reference to
  * new root to be stored.
  */
@@ -99,6 +124,14 @@ kvstxn_process_t kvstxn_process (kvstxn_t *kt,
                                  int current_epoch,
                                  const char *rootdir_ref);
 
+/* on stall & unroll, encode and hash the modified directories and
+ * values of the transaction.  This touches only 'kt' and read-only
+ * settings of its kvstxn_mgr_t, not the cache, so it may run in a
+ * worker thread as long as nothing else uses 'kt' meanwhile.  Errors
+ * are reported by the next kvstxn_process().
+ */
+void kvstxn_unroll_work (kvstxn_t *kt);
+
 /* on stall, iterate through all missing refs that the caller should
  * load into the cache
  *
@@ -135,6 +168,41 @@ kvstxn_mgr_t *kvstxn_mgr_create (struct cache *ktache,
 
 void kvstxn_mgr_destroy (kvstxn_mgr_t *ktm);
 
+/* Select how directory objects are encoded when stored, one of
+ * TREEOBJ_FORMAT_JSON (the default) or TREEOBJ_FORMAT_BINARY.
+ */
+void kvstxn_mgr_set_treeobj_format (kvstxn_mgr_t *ktm, int format);
+
+/* Directories with more than 'threshold' entries are stored as sharded
+ * directories (hdir objects), so that changing an entry rewrites only
+ * the shard that holds it and the nodes above it.  Shards are split at
+ * the same threshold.  A threshold of 0 (the default) disables sharding
+ * of plain dirs.  hdir is an extension to RFC 11 (see treeobj.h) that
+ * other readers of the content store may not understand, so sharding
+ * must be enabled explicitly.
+ */
+#define KVSTXN_DIR_SHARD_THRESHOLD 0
+void kvstxn_mgr_set_dir_shard_threshold (kvstxn_mgr_t *ktm, int threshold);
+
+/* Allow up to 'depth' ready transactions to be processed at once.
+ * A transaction behind the head of the ready queue may start only if
+ * its keys (and their parent directories) do not overlap the keys of
+ * any transaction ahead of it, so that it can load the content it needs
+ * while the head is stalled.  It is not applied or stored until it
+ * reaches the head.  A depth of 1 (the default) processes transactions
+ * one at a time.
+ */
+#define KVSTXN_PIPELINE_DEPTH 1
+#define KVSTXN_PIPELINE_DEPTH_MAX 64
+void kvstxn_mgr_set_pipeline_depth (kvstxn_mgr_t *ktm, int depth);
+
+/* If 'offload' is true, kvstxn_process() returns KVSTXN_PROCESS_UNROLL
+ * when the transaction is ready to be stored, so that the caller can
+ * run the CPU bound part of the store stage, kvstxn_unroll_work(), off
+ * the reactor thread.  Default is false.
+ */
+void kvstxn_mgr_set_unroll_offload (kvstxn_mgr_t *ktm, bool offload);
+
 /* kvstxn_mgr_add_transaction() will internally create a kvstxn_t and
  * store it in the queue of ready to process transactions.
  *
@@ -147,7 +215,9 @@ int kvstxn_mgr_add_transaction (kvstxn_mgr_t *ktm,
                                 int flags);
 
 /* returns true if there is a transaction ready for processing and is
- * not blocked, false if not.
+ * not blocked, false if not.  The transaction is the head of the
+ * ready queue, or one that may run ahead of it (see
+ * kvstxn_mgr_set_pipeline_depth()).
  */
 bool kvstxn_mgr_transaction_ready (kvstxn_mgr_t *ktm);
 
@@ -178,6 +248,23 @@ void kvstxn_mgr_remove_transaction (kvstxn_mgr_t *ktm, kvstxn_t *kt,
 int kvstxn_mgr_get_noop_stores (kvstxn_mgr_t *ktm);
 void kvstxn_mgr_clear_noop_stores (kvstxn_mgr_t *ktm);
 
+/* Commit pipeline statistics, for kvs.stats.get.  Stall times are in
+ * seconds, summed over all transactions.  'elapsed' is the time in
+ * seconds since the manager was created or the stats last cleared.
+ */
+struct kvstxn_mgr_stats {
+    int commits;                /* transactions that updated the root */
+    int pipelined;              /* started ahead of the queue head */
+    int load_stalls;
+    double load_stall_time;
+    int store_stalls;
+    double store_stall_time;
+    double elapsed;
+};
+
+void kvstxn_mgr_get_stats (kvstxn_mgr_t *ktm, struct kvstxn_mgr_stats *stats);
+void kvstxn_mgr_clear_stats (kvstxn_mgr_t *ktm);
+
 /* return count of ready transactions */
 int kvstxn_mgr_ready_transaction_count (kvstxn_mgr_t *ktm);
 
@@ -23,6 +23,7 @@
 #include <jansson.h>
 
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/monotime.h"
 #include "src/common/libkvs/treeobj.h"
 #include "src/common/libkvs/kvs_util_private.h"
 
@@ -75,6 +76,8 @@ struct lookup {
      */
     const json_t *valref_missing_refs;
     const char *missing_ref;
+    json_t *hdir_missing_refs;  /* shards missing from a sharded readdir */
+    json_t *prefetch_refs;      /* hinted dirrefs further down the path */
 
     /* for namespace callback */
 
@@ -83,6 +86,9 @@ struct lookup {
     int errnum;                 /* errnum if error */
     int aux_errnum;
 
+    int stalls;                 /* number of times lookup() stalled */
+    struct timespec t0;         /* time of lookup_create() */
+
     /* API internal */
     zlist_t *levels;
     const json_t *wdirent;       /* result after walk() */
@@ -359,6 +365,214 @@ cleanup:
     return ret;
 }
 
+/* Find the shard of sharded directory 'hdir' that would hold 'name'.
+ * On LOOKUP_PROCESS_FINISHED, *shardp is set to the shard, or to NULL if
+ * there is none (i.e. 'name' does not exist).
+ */
+static lookup_process_t hdir_find_shard (lookup_t *lh,
+                                         const json_t *hdir,
+                                         const char *name,
+                                         const json_t **shardp)
+{
+    const json_t *node = hdir;
+    int level, index;
+
+    for (level = 0; level < TREEOBJ_HDIR_MAXLEVEL; level++) {
+        const json_t *child;
+
+        if ((index = treeobj_hdir_slot (name, level)) < 0) {
+            lh->errnum = errno;
+            return LOOKUP_PROCESS_ERROR;
+        }
+        if (!(child = treeobj_peek_slot (node, index))) {
+            if (errno != ENOENT) {
+                lh->errnum = errno;
+                return LOOKUP_PROCESS_ERROR;
+            }
+            (*shardp) = NULL;
+            return LOOKUP_PROCESS_FINISHED;
+        }
+        if (treeobj_is_dirref (child)) {
+            struct cache_entry *entry;
+            const char *refstr;
+
+            if (treeobj_get_count (child) != 1
+                || !(refstr = treeobj_get_blobref (child, 0))) {
+                lh->errnum = ENOTRECOVERABLE;
+                return LOOKUP_PROCESS_ERROR;
+            }
+            if (!(entry = cache_lookup (lh->cache, refstr, lh->current_epoch))
+                || !cache_entry_get_valid (entry)) {
+                lh->missing_ref = refstr;
+                return LOOKUP_PROCESS_LOAD_MISSING_REFS;
+            }
+            if (!(child = cache_entry_get_treeobj (entry))) {
+                flux_log (lh->h, LOG_ERR, "hdir slot points to non-treeobj");
+                lh->errnum = ENOTRECOVERABLE;
+                return LOOKUP_PROCESS_ERROR;
+            }
+        }
+        if (treeobj_is_dir (child)) {
+            (*shardp) = child;
+            return LOOKUP_PROCESS_FINISHED;
+        }
+        if (!treeobj_is_hdir (child))
+            break;
+        node = child;
+    }
+    lh->errnum = ENOTRECOVERABLE;
+    return LOOKUP_PROCESS_ERROR;
+}
+
+/* Copy the entries of sharded directory node 'hdir' into 'dir'.
+ * Shards that are not in the cache are added to lh->hdir_missing_refs,
+ * and the merge must be repeated once they have been loaded.
+ * Return 0 on success, -1 on error with lh->errnum set.
+ */
+static int hdir_merge (lookup_t *lh, const json_t *hdir, json_t *dir)
+{
+    const json_t *child;
+    const json_t *data;
+    const json_t *o;
+    const char *key;
+    int index;
+
+    for (index = 0; index < TREEOBJ_HDIR_FANOUT; index++) {
+        if (!(child = treeobj_peek_slot (hdir, index)))
+            continue;
+        if (treeobj_is_dirref (child)) {
+            struct cache_entry *entry;
+            const char *refstr;
+
+            if (treeobj_get_count (child) != 1
+                || !(refstr = treeobj_get_blobref (child, 0))) {
+                lh->errnum = ENOTRECOVERABLE;
+                return -1;
+            }
+            if (!(entry = cache_lookup (lh->cache, refstr, lh->current_epoch))
+                || !cache_entry_get_valid (entry)) {
+                json_t *s;
+
+                if (!(s = json_string (refstr))
+                    || json_array_append_new (lh->hdir_missing_refs, s) < 0) {
+                    json_decref (s);
+                    lh->errnum = ENOMEM;
+                    return -1;
+                }
+                continue;
+            }
+            if (!(child = cache_entry_get_treeobj (entry))) {
+                flux_log (lh->h, LOG_ERR, "hdir slot points to non-treeobj");
+                lh->errnum = ENOTRECOVERABLE;
+                return -1;
+            }
+        }
+        if (treeobj_is_hdir (child)) {
+            if (hdir_merge (lh, child, dir) < 0)
+                return -1;
+        }
+        else if (treeobj_is_dir (child)) {
+            /* N.B. it should be safe to cast away const on 'data' as
+             * long as 'o' is not modified.
+             */
+            data = treeobj_get_data ((json_t *)child);
+            json_object_foreach ((json_t *)data, key, o) {
+                json_t *cpy;
+
+                if (!(cpy = treeobj_deep_copy (o))
+                    || treeobj_insert_entry (dir, key, cpy) < 0) {
+                    json_decref (cpy);
+                    lh->errnum = errno;
+                    return -1;
+                }
+                json_decref (cpy);
+            }
+        }
+        else {
+            lh->errnum = ENOTRECOVERABLE;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Return the length of the key path from the start of the top level
+ * walk through 'pathcomp', e.g. 3 ("a.b") for pathcomp "b" of "a.b.c".
+ */
+static size_t walk_prefix_len (walk_level_t *wl, const char *pathcomp)
+{
+    assert (wl->depth == 0);
+    return (pathcomp - wl->path_copy) + strlen (pathcomp);
+}
+
+/* Remember 'dirent', found at the first 'len' characters of the lookup
+ * path, so a later cold lookup through the same directory can prefetch
+ * it.  Hints are best effort, errors are ignored.
+ */
+static void walk_hint_set (lookup_t *lh, size_t len, const json_t *dirent)
+{
+    struct kvsroot *root;
+    const char *ref;
+    const char *hint;
+    char *prefix;
+
+    if (!treeobj_is_dirref (dirent)
+        || treeobj_get_count (dirent) != 1
+        || !(ref = treeobj_get_blobref (dirent, 0)))
+        return;
+    if (!(root = kvsroot_mgr_lookup_root_safe (lh->krm, lh->namespace)))
+        return;
+    if (!(prefix = strndup (lh->path, len)))
+        return;
+    hint = kvsroot_get_path_hint (root, prefix);
+    if (!hint || strcmp (hint, ref) != 0)
+        (void)kvsroot_set_path_hint (root, prefix, ref);
+    free (prefix);
+}
+
+/* The top level walk stalled on the directory holding 'pathcomp'.
+ * Rather than discovering the remaining directories of the path one
+ * round trip at a time, add the dirrefs last seen at 'pathcomp' and the
+ * path components after it to lh->prefetch_refs, so they are loaded
+ * alongside the missing ref.  Errors are ignored.
+ */
+static void walk_prefetch (lookup_t *lh, walk_level_t *wl,
+                           const char *pathcomp)
+{
+    struct kvsroot *root;
+    char *comp;
+
+    if (wl->depth > 0)
+        return;
+    if (!(root = kvsroot_mgr_lookup_root_safe (lh->krm, lh->namespace))
+        || !root->path_hints)
+        return;
+    comp = zlist_first (wl->pathcomps);
+    while (comp && comp != pathcomp)
+        comp = zlist_next (wl->pathcomps);
+    while (comp) {
+        struct cache_entry *entry;
+        const char *hint;
+        char *prefix;
+        json_t *s;
+
+        if (!(prefix = strndup (lh->path, walk_prefix_len (wl, comp))))
+            return;
+        hint = kvsroot_get_path_hint (root, prefix);
+        free (prefix);
+        if (hint
+            && (!(entry = cache_lookup (lh->cache, hint, lh->current_epoch))
+                || !cache_entry_get_valid (entry))) {
+            if (!(s = json_string (hint))
+                || json_array_append_new (lh->prefetch_refs, s) < 0) {
+                json_decref (s);
+                return;
+            }
+        }
+        comp = zlist_next (wl->pathcomps);
+    }
+}
+
 /* Get dirent of the requested path starting at the given root.
  *
  * Return true on success or error, error code is returned in ep and
@@ -406,6 +620,13 @@ static lookup_process_t walk (lookup_t *lh)
             if (!(entry = cache_lookup (lh->cache, refstr, lh->current_epoch))
                 || !cache_entry_get_valid (entry)) {
                 lh->missing_ref = refstr;
+                if (wl->depth == 0 && pathcomp != wl->path_copy) {
+                    /* the missing dir is at the path component before
+                     * 'pathcomp' */
+                    walk_hint_set (lh, (pathcomp - wl->path_copy) - 1,
+                                   wl->dirent);
+                }
+                walk_prefetch (lh, wl, pathcomp);
                 return LOOKUP_PROCESS_LOAD_MISSING_REFS;
             }
             if (!(dir = cache_entry_get_treeobj (entry))) {
@@ -419,7 +640,19 @@ static lookup_process_t walk (lookup_t *lh)
                     lh->errnum = ENOTRECOVERABLE;
                 goto error;
             }
-            if (!treeobj_is_dir (dir)) {
+            if (treeobj_is_hdir (dir)
+                && !(wl->depth == 0 && wl->dirent == wl->root_dirent)) {
+                lookup_process_t hret;
+
+                hret = hdir_find_shard (lh, dir, pathcomp, &dir);
+                if (hret == LOOKUP_PROCESS_ERROR)
+                    goto error;
+                else if (hret == LOOKUP_PROCESS_LOAD_MISSING_REFS)
+                    return LOOKUP_PROCESS_LOAD_MISSING_REFS;
+                if (!dir) /* entry does not exist, let caller decide */
+                    goto done;
+            }
+            else if (!treeobj_is_dir (dir)) {
                 /* dirref pointed to non-dir error, special case when
                  * root_dirent is bad, is EINVAL from user.
                  */
@@ -482,8 +715,14 @@ static lookup_process_t walk (lookup_t *lh)
                 continue;
             }
         }
-        else
+        else {
             wl->dirent = dirent_tmp;
+            /* Only lookups that have stalled record hints, so lookups
+             * served entirely from the cache pay nothing.
+             */
+            if (wl->depth == 0 && lh->stalls > 0)
+                walk_hint_set (lh, walk_prefix_len (wl, pathcomp), dirent_tmp);
+        }
 
         if (last_pathcomp (wl->pathcomps, pathcomp)
             && wl->depth) {
@@ -614,6 +853,18 @@ lookup_t *lookup_create (struct cache *cache,
         goto cleanup;
     }
 
+    if (!(lh->hdir_missing_refs = json_array ())) {
+        saved_errno = ENOMEM;
+        goto cleanup;
+    }
+
+    if (!(lh->prefetch_refs = json_array ())) {
+        saved_errno = ENOMEM;
+        goto cleanup;
+    }
+
+    monotime (&lh->t0);
+
     lh->wdirent = NULL;
     lh->state = LOOKUP_STATE_INIT;
 
@@ -636,6 +887,8 @@ void lookup_destroy (lookup_t *lh)
         json_decref (lh->val);
         free (lh->missing_namespace);
         zlist_destroy (&lh->levels);
+        json_decref (lh->hdir_missing_refs);
+        json_decref (lh->prefetch_refs);
         free (lh);
     }
 }
@@ -713,6 +966,15 @@ int lookup_iter_missing_refs (lookup_t *lh, lookup_ref_f cb, void *data)
                 }
             }
         }
+        else if (json_array_size (lh->hdir_missing_refs) > 0) {
+            size_t index;
+            json_t *o;
+
+            json_array_foreach (lh->hdir_missing_refs, index, o) {
+                if (cb (lh, json_string_value (o), data) < 0)
+                    return -1;
+            }
+        }
         else {
             if (cb (lh, lh->missing_ref, data) < 0)
                 return -1;
@@ -723,6 +985,25 @@ int lookup_iter_missing_refs (lookup_t *lh, lookup_ref_f cb, void *data)
     return -1;
 }
 
+int lookup_iter_prefetch_refs (lookup_t *lh, lookup_ref_f cb, void *data)
+{
+    if (lh
+        && (lh->state == LOOKUP_STATE_CHECK_ROOT
+            || lh->state == LOOKUP_STATE_WALK
+            || lh->state == LOOKUP_STATE_VALUE)) {
+        size_t index;
+        json_t *o;
+
+        json_array_foreach (lh->prefetch_refs, index, o) {
+            if (cb (lh, json_string_value (o), data) < 0)
+                return -1;
+        }
+        return 0;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
 const char *lookup_missing_namespace (lookup_t *lh)
 {
    if (lh
@@ -762,6 +1043,20 @@ int lookup_get_root_seq (lookup_t *lh)
     return -1;
 }
 
+int lookup_get_stall_count (lookup_t *lh)
+{
+    if (lh)
+        return lh->stalls;
+    return -1;
+}
+
+double lookup_get_elapsed (lookup_t *lh)
+{
+    if (lh)
+        return monotime_since (lh->t0);
+    return -1.;
+}
+
 int lookup_set_current_epoch (lookup_t *lh, int epoch)
 {
     if (lh) {
@@ -942,7 +1237,7 @@ done:
     return rc;
 }
 
-lookup_process_t lookup (lookup_t *lh)
+static lookup_process_t lookup_stages (lookup_t *lh)
 {
     const json_t *valtmp = NULL;
     const char *reftmp;
@@ -962,6 +1257,9 @@ lookup_process_t lookup (lookup_t *lh)
         && lh->state != LOOKUP_STATE_FINISHED)
         is_replay = true;
 
+    json_array_clear (lh->hdir_missing_refs);
+    json_array_clear (lh->prefetch_refs);
+
     switch (lh->state) {
         case LOOKUP_STATE_INIT:
             lh->state = LOOKUP_STATE_CHECK_NAMESPACE;
@@ -1134,12 +1432,30 @@ lookup_process_t lookup (lookup_t *lh)
                     lh->errnum = ENOTRECOVERABLE;
                     goto error;
                 }
-                if (!treeobj_is_dir (valtmp)) {
+                if (treeobj_is_hdir (valtmp)) {
+                    /* sharded directory, return its entries as one dir */
+                    json_t *dir;
+
+                    if (!(dir = treeobj_create_dir ())) {
+                        lh->errnum = errno;
+                        goto error;
+                    }
+                    if (hdir_merge (lh, valtmp, dir) < 0) {
+                        json_decref (dir);
+                        goto error;
+                    }
+                    if (json_array_size (lh->hdir_missing_refs) > 0) {
+                        json_decref (dir);
+                        return LOOKUP_PROCESS_LOAD_MISSING_REFS;
+                    }
+                    lh->val = dir;
+                }
+                else if (!treeobj_is_dir (valtmp)) {
                     /* dirref points to not dir */
                     lh->errnum = ENOTRECOVERABLE;
                     goto error;
                 }
-                if (!(lh->val = treeobj_deep_copy (valtmp))) {
+                else if (!(lh->val = treeobj_deep_copy (valtmp))) {
                     lh->errnum = errno;
                     goto error;
                 }
@@ -1246,6 +1562,16 @@ error:
     return LOOKUP_PROCESS_ERROR;
 }
 
+lookup_process_t lookup (lookup_t *lh)
+{
+    lookup_process_t ret;
+
+    if ((ret = lookup_stages (lh)) == LOOKUP_PROCESS_LOAD_MISSING_REFS
+        || ret == LOOKUP_PROCESS_LOAD_MISSING_NAMESPACE)
+        lh->stalls++;
+    return ret;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
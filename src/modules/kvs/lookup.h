@@ -77,6 +77,17 @@ json_t *lookup_get_value (lookup_t *lh);
  */
 int lookup_iter_missing_refs (lookup_t *lh, lookup_ref_f cb, void *data);
 
+/* On lookup stall b/c of missing reference(s), get references that
+ * are likely to be needed once the missing references are loaded
+ * (e.g. directories further down the lookup path, as last seen in this
+ * namespace).  These may be stale, so they should be loaded into the
+ * KVS cache along with the missing references, but the lookup should
+ * not wait on them.
+ *
+ * return -1 in callback to break iteration
+ */
+int lookup_iter_prefetch_refs (lookup_t *lh, lookup_ref_f cb, void *data);
+
 /* On lookup stall b/c of missing namespace, get missing namespace
  * returned by this function.
  *
@@ -106,6 +117,12 @@ const char *lookup_get_namespace (lookup_t *lh);
 const char *lookup_get_root_ref (lookup_t *lh);
 int lookup_get_root_seq (lookup_t *lh);
 
+/* Get the number of times lookup() has stalled on this handle, and
+ * the time in milliseconds since the handle was created.
+ */
+int lookup_get_stall_count (lookup_t *lh);
+double lookup_get_elapsed (lookup_t *lh);
+
 /* Set a new current epoch.  Convenience on RPC replays and epoch may
  * be new */
 int lookup_set_current_epoch (lookup_t *lh, int epoch);
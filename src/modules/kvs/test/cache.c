@@ -16,10 +16,20 @@
 
 #include "src/common/libkvs/treeobj.h"
 #include "src/common/libutil/tstat.h"
+#include "src/common/libutil/blobref.h"
 #include "src/common/libtap/tap.h"
 #include "src/modules/kvs/waitqueue.h"
 #include "src/modules/kvs/cache.h"
 
+/* cache entries are keyed by digest, so refs must be well formed */
+#define REF_A       "sha1-fac99bb4a6a2ffdf25afe424c41a77b2d945b0cc"
+#define REF_REMOVE  "sha1-f05aee2fc248c8816364b1a3e62a3f5faf923d5c"
+#define REF_XXX1    "sha1-3b683b265617ecc696007afb3752f482f779a63d"
+#define REF_YYY1    "sha1-70e5c896ec03341e04ee5ea9bed6d444c88ee477"
+#define REF_XXX2    "sha1-6bb488c2db37149d5c80455a911922f3af6a6d31"
+#define REF_YYY2    "sha1-cf5ca5e0d48c2618bc453e3cf3eab1b29a7b0aa9"
+#define REF_ABCD    "sha1-81fe8bfe87576c3ecb22426f8e57847382917acf"
+
 static int cache_entry_set_treeobj (struct cache_entry *entry, const json_t *o)
 {
     char *s = NULL;
@@ -110,7 +120,7 @@ void cache_entry_basic_tests (void)
         && errno == EINVAL,
         "cache_entry_set_treeobj fails with EINVAL with bad input");
 
-    ok ((e = cache_entry_create ("a-reference")) != NULL,
+    ok ((e = cache_entry_create (REF_A)) != NULL,
         "cache_entry_create success");
 
     o = json_string ("yabadabadoo");
@@ -166,7 +176,7 @@ void cache_entry_raw_tests (void)
     data = strdup ("abcd");
     data2 = strdup ("abcd");
 
-    ok ((e = cache_entry_create ("a-reference")) != NULL,
+    ok ((e = cache_entry_create (REF_A)) != NULL,
         "cache_entry_create works");
     ok (cache_entry_get_valid (e) == false,
         "cache entry initially non-valid");
@@ -224,7 +234,7 @@ void cache_entry_raw_tests (void)
 
     data = strdup ("abcd");
 
-    ok ((e = cache_entry_create ("a-reference")) != NULL,
+    ok ((e = cache_entry_create (REF_A)) != NULL,
         "cache_entry_create works");
     ok (cache_entry_set_raw (e, NULL, 0) == 0,
         "cache_entry_set_raw success");
@@ -268,7 +278,7 @@ void cache_entry_raw_and_treeobj_tests (void)
 
     data = strdup ("foo");
 
-    ok ((e = cache_entry_create ("a-reference")) != NULL,
+    ok ((e = cache_entry_create (REF_A)) != NULL,
         "cache_entry_create works");
     ok (cache_entry_set_raw (e, data, strlen (data) + 1) == 0,
         "cache_entry_set_raw success");
@@ -279,7 +289,7 @@ void cache_entry_raw_and_treeobj_tests (void)
 
     /* test cache entry filled with zero length raw data */
 
-    ok ((e = cache_entry_create ("a-reference")) != NULL,
+    ok ((e = cache_entry_create (REF_A)) != NULL,
         "cache_entry_create works");
     ok (cache_entry_set_raw (e, NULL, 0) == 0,
         "cache_entry_set_raw success");
@@ -294,7 +304,7 @@ void cache_entry_raw_and_treeobj_tests (void)
     o1 = treeobj_create_val ("foo", 3);
     data = treeobj_encode (o1);
 
-    ok ((e = cache_entry_create ("a-reference")) != NULL,
+    ok ((e = cache_entry_create (REF_A)) != NULL,
         "cache_entry_create works");
     ok (cache_entry_set_raw (e, data, strlen (data)) == 0,
         "cache_entry_set_raw success");
@@ -314,7 +324,7 @@ void cache_entry_raw_and_treeobj_tests (void)
     o1 = treeobj_create_val ("abcd", 3);
     data = treeobj_encode (o1);
 
-    ok ((e = cache_entry_create ("a-reference")) != NULL,
+    ok ((e = cache_entry_create (REF_A)) != NULL,
         "cache_entry_create works");
     ok (cache_entry_set_treeobj (e, o1) == 0,
         "cache_entry_set_treeobj success");
@@ -345,7 +355,7 @@ void waiter_tests (void)
     count = 0;
     ok ((w = wait_create (wait_cb, &count)) != NULL,
         "wait_create works");
-    ok ((e = cache_entry_create ("a-reference")) != NULL,
+    ok ((e = cache_entry_create (REF_A)) != NULL,
         "cache_entry_create created empty object");
     ok (cache_entry_get_valid (e) == false,
         "cache entry invalid, adding waiter");
@@ -435,7 +445,7 @@ void waiter_tests (void)
     count = 0;
     ok ((w = wait_create (wait_cb, &count)) != NULL,
         "wait_create works");
-    ok ((e = cache_entry_create ("a-reference")) != NULL,
+    ok ((e = cache_entry_create (REF_A)) != NULL,
         "cache_entry_create created empty object");
     ok (cache_entry_get_valid (e) == false,
         "cache entry invalid, adding waiter");
@@ -456,18 +466,24 @@ void cache_blobref_tests (void)
 {
     struct cache *cache;
     struct cache_entry *e;
-    const char *ref;
+    char ref[BLOBREF_MAX_STRING_SIZE];
 
     ok ((cache = cache_create ()) != NULL,
         "cache_create works");
-    ok ((e = cache_entry_create ("abcd")) != NULL,
+    ok (cache_entry_create ("abcd") == NULL && errno == EINVAL,
+        "cache_entry_create fails with EINVAL on malformed ref");
+    ok ((e = cache_entry_create (REF_ABCD)) != NULL,
         "cache_entry_create works");
     ok (cache_insert (cache, e) == 0,
         "cache_insert works");
-    ok ((ref = cache_entry_get_blobref (e)) != NULL,
+    ok (cache_entry_get_blobref (e, ref, sizeof (ref)) == 0,
         "cache_entry_get_blobref success");
-    ok (!strcmp (ref, "abcd"),
+    ok (!strcmp (ref, REF_ABCD),
         "cache_entry_get_blobref returned correct ref");
+    ok (cache_entry_get_blobref (e, ref, 1) < 0 && errno == EINVAL,
+        "cache_entry_get_blobref fails with EINVAL on short buffer");
+    ok (cache_lookup (cache, "abcd", 0) == NULL,
+        "cache_lookup of malformed ref fails");
 
     cache_destroy (cache);
 }
@@ -483,33 +499,33 @@ void cache_remove_entry_tests (void)
     ok ((cache = cache_create ()) != NULL,
         "cache_create works");
 
-    ok ((e = cache_entry_create ("remove-ref")) != NULL,
+    ok ((e = cache_entry_create (REF_REMOVE)) != NULL,
         "cache_entry_create works");
     ok (cache_insert (cache, e) == 0,
         "cache_insert works");
-    ok (cache_lookup (cache, "remove-ref", 0) != NULL,
+    ok (cache_lookup (cache, REF_REMOVE, 0) != NULL,
         "cache_lookup verify entry exists");
     ok (cache_remove_entry (cache, "blalalala") == 0,
         "cache_remove_entry failed on bad reference");
-    ok (cache_remove_entry (cache, "remove-ref") == 1,
+    ok (cache_remove_entry (cache, REF_REMOVE) == 1,
         "cache_remove_entry removed cache entry w/o object");
-    ok (cache_lookup (cache, "remove-ref", 0) == NULL,
+    ok (cache_lookup (cache, REF_REMOVE, 0) == NULL,
         "cache_lookup verify entry gone");
 
     count = 0;
     ok ((w = wait_create (wait_cb, &count)) != NULL,
         "wait_create works");
-    ok ((e = cache_entry_create ("remove-ref")) != NULL,
+    ok ((e = cache_entry_create (REF_REMOVE)) != NULL,
         "cache_entry_create created empty object");
     ok (cache_insert (cache, e) == 0,
         "cache_insert works");
-    ok (cache_lookup (cache, "remove-ref", 0) != NULL,
+    ok (cache_lookup (cache, REF_REMOVE, 0) != NULL,
         "cache_lookup verify entry exists");
     ok (cache_entry_get_valid (e) == false,
         "cache entry invalid, adding waiter");
     ok (cache_entry_wait_valid (e, w) == 0,
         "cache_entry_wait_valid success");
-    ok (cache_remove_entry (cache, "remove-ref") == 0,
+    ok (cache_remove_entry (cache, REF_REMOVE) == 0,
         "cache_remove_entry failed on valid waiter");
     o = treeobj_create_val ("foobar", 6);
     ok (cache_entry_set_treeobj (e, o) == 0,
@@ -519,15 +535,15 @@ void cache_remove_entry_tests (void)
         "cache entry set valid with one waiter");
     ok (count == 1,
         "waiter callback ran");
-    ok (cache_remove_entry (cache, "remove-ref") == 1,
+    ok (cache_remove_entry (cache, REF_REMOVE) == 1,
         "cache_remove_entry removed cache entry after valid waiter gone");
-    ok (cache_lookup (cache, "remove-ref", 0) == NULL,
+    ok (cache_lookup (cache, REF_REMOVE, 0) == NULL,
         "cache_lookup verify entry gone");
 
     count = 0;
     ok ((w = wait_create (wait_cb, &count)) != NULL,
         "wait_create works");
-    ok ((e = cache_entry_create ("remove-ref")) != NULL,
+    ok ((e = cache_entry_create (REF_REMOVE)) != NULL,
         "cache_entry_create works");
     o = treeobj_create_val ("foobar", 6);
     ok (cache_entry_set_treeobj (e, o) == 0,
@@ -535,23 +551,23 @@ void cache_remove_entry_tests (void)
     json_decref (o);
     ok (cache_insert (cache, e) == 0,
         "cache_insert works");
-    ok (cache_lookup (cache, "remove-ref", 0) != NULL,
+    ok (cache_lookup (cache, REF_REMOVE, 0) != NULL,
         "cache_lookup verify entry exists");
     ok (cache_entry_set_dirty (e, true) == 0,
         "cache_entry_set_dirty success");
-    ok (cache_remove_entry (cache, "remove-ref") == 0,
+    ok (cache_remove_entry (cache, REF_REMOVE) == 0,
         "cache_remove_entry not removed b/c dirty");
     ok (cache_entry_wait_notdirty (e, w) == 0,
         "cache_entry_wait_notdirty success");
-    ok (cache_remove_entry (cache, "remove-ref") == 0,
+    ok (cache_remove_entry (cache, REF_REMOVE) == 0,
         "cache_remove_entry failed on notdirty waiter");
     ok (cache_entry_set_dirty (e, false) == 0,
         "cache_entry_set_dirty success");
     ok (count == 1,
         "waiter callback ran");
-    ok (cache_remove_entry (cache, "remove-ref") == 1,
+    ok (cache_remove_entry (cache, REF_REMOVE) == 1,
         "cache_remove_entry removed cache entry after notdirty waiter gone");
-    ok (cache_lookup (cache, "remove-ref", 0) == NULL,
+    ok (cache_lookup (cache, REF_REMOVE, 0) == NULL,
         "cache_lookup verify entry gone");
 
     cache_destroy (cache);
@@ -575,15 +591,15 @@ void cache_expiration_tests (void)
         "cache contains 0 entries");
 
     /* first test w/ entry w/o treeobj object */
-    ok ((e1 = cache_entry_create ("xxx1")) != NULL,
+    ok ((e1 = cache_entry_create (REF_XXX1)) != NULL,
         "cache_entry_create works");
     ok (cache_insert (cache, e1) == 0,
         "cache_insert works");
     ok (cache_count_entries (cache) == 1,
         "cache contains 1 entry after insert");
-    ok (cache_lookup (cache, "yyy1", 0) == NULL,
+    ok (cache_lookup (cache, REF_YYY1, 0) == NULL,
         "cache_lookup of wrong hash fails");
-    ok ((e2 = cache_lookup (cache, "xxx1", 42)) != NULL,
+    ok ((e2 = cache_lookup (cache, REF_XXX1, 42)) != NULL,
         "cache_lookup of correct hash works (last use=42)");
     ok (cache_entry_get_treeobj (e2) == NULL,
         "no treeobj object found");
@@ -607,7 +623,7 @@ void cache_expiration_tests (void)
 
     /* second test w/ entry with treeobj object */
     o1 = treeobj_create_val ("foo", 3);
-    ok ((e3 = cache_entry_create ("xxx2")) != NULL,
+    ok ((e3 = cache_entry_create (REF_XXX2)) != NULL,
         "cache_entry_create works");
     ok (cache_entry_set_treeobj (e3, o1) == 0,
         "cache_entry_set_treeobj success");
@@ -616,9 +632,9 @@ void cache_expiration_tests (void)
         "cache_insert works");
     ok (cache_count_entries (cache) == 2,
         "cache contains 2 entries after insert");
-    ok (cache_lookup (cache, "yyy2", 0) == NULL,
+    ok (cache_lookup (cache, REF_YYY2, 0) == NULL,
         "cache_lookup of wrong hash fails");
-    ok ((e4 = cache_lookup (cache, "xxx2", 42)) != NULL,
+    ok ((e4 = cache_lookup (cache, REF_XXX2, 42)) != NULL,
         "cache_lookup of correct hash works (last use=42)");
     ok ((otmp = cache_entry_get_treeobj (e4)) != NULL,
         "cache_entry_get_treeobj found entry");
@@ -251,6 +251,55 @@ void basic_kvstxn_mgr_tests (void)
     cache_destroy (cache);
 }
 
+void path_hint_tests (void)
+{
+    kvsroot_mgr_t *krm;
+    struct cache *cache;
+    struct kvsroot *root;
+    char path[64];
+    int i;
+
+    cache = cache_create ();
+
+    ok ((krm = kvsroot_mgr_create (NULL, &global)) != NULL,
+        "kvsroot_mgr_create works");
+
+    ok ((root = kvsroot_mgr_create_root (krm,
+                                         cache,
+                                         "sha1",
+                                         KVS_PRIMARY_NAMESPACE,
+                                         geteuid (),
+                                         0)) != NULL,
+         "kvsroot_mgr_create_root works");
+
+    ok (kvsroot_get_path_hint (root, "a.b") == NULL,
+        "kvsroot_get_path_hint returns NULL with no hints");
+    ok (kvsroot_set_path_hint (root, "a.b", "sha1-1") == 0,
+        "kvsroot_set_path_hint works");
+    ok (kvsroot_get_path_hint (root, "a.b") != NULL
+        && !strcmp (kvsroot_get_path_hint (root, "a.b"), "sha1-1"),
+        "kvsroot_get_path_hint returns hint");
+    ok (kvsroot_set_path_hint (root, "a.b", "sha1-2") == 0
+        && !strcmp (kvsroot_get_path_hint (root, "a.b"), "sha1-2"),
+        "kvsroot_set_path_hint replaces hint");
+
+    for (i = 0; i < KVSROOT_PATH_HINTS_MAX; i++) {
+        snprintf (path, sizeof (path), "dir.%d", i);
+        if (kvsroot_set_path_hint (root, path, "sha1-3") < 0)
+            break;
+    }
+    ok (i == KVSROOT_PATH_HINTS_MAX,
+        "kvsroot_set_path_hint works beyond KVSROOT_PATH_HINTS_MAX");
+    ok (kvsroot_get_path_hint (root, "a.b") == NULL,
+        "hints are dropped once the table is full");
+
+    ok (kvsroot_set_path_hint (NULL, "a", "sha1-1") < 0 && errno == EINVAL,
+        "kvsroot_set_path_hint fails with EINVAL on bad input");
+
+    kvsroot_mgr_destroy (krm);
+    cache_destroy (cache);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -258,6 +307,7 @@ int main (int argc, char *argv[])
     basic_api_tests ();
     basic_iter_tests ();
     basic_kvstxn_mgr_tests ();
+    path_hint_tests ();
 
     done_testing ();
     return (0);
@@ -2729,6 +2729,176 @@ void kvstxn_process_giant_dir (void)
     json_decref (root);
 }
 
+/* Helper for kvstxn_process_shard_dir(): process a ready transaction
+ * through to completion and return the new root ref.
+ */
+const char *process_to_newroot (kvstxn_mgr_t *ktm, const char *root_ref,
+                                int *dirty)
+{
+    kvstxn_t *kt;
+    const char *newroot;
+
+    *dirty = 0;
+    ok ((kt = kvstxn_mgr_get_ready_transaction (ktm)) != NULL,
+        "kvstxn_mgr_get_ready_transaction returns ready kvstxn");
+    ok (kvstxn_process (kt, 1, root_ref) == KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES,
+        "kvstxn_process returns KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES");
+    ok (kvstxn_iter_dirty_cache_entries (kt, cache_count_dirty_cb, dirty) == 0,
+        "kvstxn_iter_dirty_cache_entries works for dirty cache entries");
+    ok (kvstxn_process (kt, 1, root_ref) == KVSTXN_PROCESS_FINISHED,
+        "kvstxn_process returns KVSTXN_PROCESS_FINISHED");
+    ok ((newroot = kvstxn_get_newroot_ref (kt)) != NULL,
+        "kvstxn_get_newroot_ref returns != NULL when processing complete");
+    kvstxn_mgr_remove_transaction (ktm, kt, false);
+    return newroot;
+}
+
+/* Helper for kvstxn_process_shard_dir(): return the object that
+ * entry 'name' of the root directory 'root_ref' refers to.
+ */
+const json_t *get_root_subdir (struct cache *cache, const char *root_ref,
+                               const char *name)
+{
+    struct cache_entry *entry;
+    const json_t *root, *dirref;
+    const char *ref;
+
+    if (!(entry = cache_lookup (cache, root_ref, 1))
+        || !(root = cache_entry_get_treeobj (entry))
+        || !(dirref = treeobj_peek_entry (root, name))
+        || !treeobj_is_dirref (dirref)
+        || !(ref = treeobj_get_blobref (dirref, 0))
+        || !(entry = cache_lookup (cache, ref, 1)))
+        return NULL;
+    return cache_entry_get_treeobj (entry);
+}
+
+void kvstxn_process_shard_dir (void)
+{
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    kvstxn_mgr_t *ktm;
+    json_t *ops;
+    char rootref[BLOBREF_MAX_STRING_SIZE];
+    char newroot[BLOBREF_MAX_STRING_SIZE];
+    char key[64];
+    const json_t *subdir;
+    lookup_t *lh;
+    json_t *o;
+    int dirty;
+    int i;
+
+    cache = create_cache_with_empty_rootdir (rootref, sizeof (rootref));
+
+    ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+        "kvsroot_mgr_create works");
+
+    setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, ref_dummy);
+
+    ok ((ktm = kvstxn_mgr_create (cache,
+                                  KVS_PRIMARY_NAMESPACE,
+                                  "sha1",
+                                  NULL,
+                                  &test_global)) != NULL,
+        "kvstxn_mgr_create works");
+
+    kvstxn_mgr_set_dir_shard_threshold (ktm, 4);
+
+    /* 64 entries is well past the threshold of 4, so "dir" is stored
+     * sharded, with shards split at least once.
+     */
+    ops = json_array ();
+    for (i = 0; i < 64; i++) {
+        snprintf (key, sizeof (key), "dir.key%d", i);
+        ops_append (ops, key, key, 0);
+    }
+    ok (kvstxn_mgr_add_transaction (ktm, "transaction1", ops, 0) == 0,
+        "kvstxn_mgr_add_transaction works");
+    json_decref (ops);
+
+    strcpy (newroot, process_to_newroot (ktm, rootref, &dirty));
+
+    ok ((subdir = get_root_subdir (cache, newroot, "dir")) != NULL
+        && treeobj_is_hdir (subdir),
+        "dir was stored as hdir");
+
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot,
+                  "dir.key0", "dir.key0");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot,
+                  "dir.key63", "dir.key63");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot,
+                  "dir.nokey", NULL);
+
+    /* Change one entry and delete another, only a few blobs should be
+     * written.
+     */
+    ops = json_array ();
+    ops_append (ops, "dir.key7", "foo", 0);
+    ops_append (ops, "dir.key8", NULL, 0);
+    ok (kvstxn_mgr_add_transaction (ktm, "transaction2", ops, 0) == 0,
+        "kvstxn_mgr_add_transaction works");
+    json_decref (ops);
+
+    strcpy (rootref, newroot);
+    strcpy (newroot, process_to_newroot (ktm, rootref, &dirty));
+
+    ok (dirty < 2 * TREEOBJ_HDIR_MAXLEVEL,
+        "update of sharded dir wrote %d blobs", dirty);
+
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot,
+                  "dir.key7", "foo");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot,
+                  "dir.key8", NULL);
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot,
+                  "dir.key9", "dir.key9");
+
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             newroot,
+                             0,
+                             "dir",
+                             FLUX_ROLE_OWNER,
+                             0,
+                             FLUX_KVS_READDIR,
+                             NULL)) != NULL,
+        "lookup_create on sharded dir");
+    ok (lookup (lh) == LOOKUP_PROCESS_FINISHED,
+        "lookup found result");
+    ok ((o = lookup_get_value (lh)) != NULL
+        && treeobj_is_dir (o)
+        && treeobj_get_count (o) == 63
+        && treeobj_peek_entry (o, "key7") != NULL
+        && treeobj_peek_entry (o, "key8") == NULL,
+        "readdir of sharded dir returns all entries as one dir");
+    json_decref (o);
+    lookup_destroy (lh);
+
+    /* Deleting every entry leaves an empty (plain) dir.
+     */
+    ops = json_array ();
+    for (i = 0; i < 64; i++) {
+        snprintf (key, sizeof (key), "dir.key%d", i);
+        ops_append (ops, key, NULL, 0);
+    }
+    ok (kvstxn_mgr_add_transaction (ktm, "transaction3", ops, 0) == 0,
+        "kvstxn_mgr_add_transaction works");
+    json_decref (ops);
+
+    strcpy (rootref, newroot);
+    strcpy (newroot, process_to_newroot (ktm, rootref, &dirty));
+
+    ok ((subdir = get_root_subdir (cache, newroot, "dir")) != NULL
+        && treeobj_is_dir (subdir)
+        && treeobj_get_count (subdir) == 0,
+        "emptied sharded dir was stored as empty dir");
+
+    kvstxn_mgr_destroy (ktm);
+    kvsroot_mgr_destroy (krm);
+    cache_destroy (cache);
+}
+
 void kvstxn_process_append (void)
 {
     struct cache *cache;
@@ -3120,6 +3290,263 @@ void kvstxn_process_fallback_merge (void)
     cache_destroy (cache);
 }
 
+void kvstxn_process_pipeline (void)
+{
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    kvstxn_mgr_t *ktm;
+    kvstxn_t *kt1, *kt2, *kt3;
+    json_t *root;
+    json_t *dir;
+    char root_ref[BLOBREF_MAX_STRING_SIZE];
+    char dir_ref[BLOBREF_MAX_STRING_SIZE];
+    char newroot[BLOBREF_MAX_STRING_SIZE];
+    struct kvstxn_mgr_stats stats;
+    int count = 0;
+
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+    ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+        "kvsroot_mgr_create works");
+
+    /* This root is
+     *
+     * root_ref
+     * "dir" : dirref to dir_ref
+     *
+     * dir_ref
+     * "val" : val w/ "42"
+     *
+     * dir_ref is not in the cache, so a transaction under "dir" stalls.
+     */
+
+    dir = treeobj_create_dir ();
+    _treeobj_insert_entry_val (dir, "val", "42", 2);
+
+    ok (treeobj_hash ("sha1", dir, dir_ref, sizeof (dir_ref)) == 0,
+        "treeobj_hash worked");
+
+    root = treeobj_create_dir ();
+    _treeobj_insert_entry_dirref (root, "dir", dir_ref);
+
+    ok (treeobj_hash ("sha1", root, root_ref, sizeof (root_ref)) == 0,
+        "treeobj_hash worked");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (root_ref, root));
+
+    setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, root_ref);
+
+    ok ((ktm = kvstxn_mgr_create (cache,
+                                  KVS_PRIMARY_NAMESPACE,
+                                  "sha1",
+                                  NULL,
+                                  &test_global)) != NULL,
+        "kvstxn_mgr_create works");
+
+    kvstxn_mgr_set_pipeline_depth (ktm, 8);
+
+    create_ready_kvstxn (ktm, "transaction1", "dir.a", "1", 0, 0);
+    create_ready_kvstxn (ktm, "transaction2", "b", "2", 0, 0);
+    create_ready_kvstxn (ktm, "transaction3", "dir.a", "3", 0, 0);
+
+    ok ((kt1 = kvstxn_mgr_get_ready_transaction (ktm)) != NULL,
+        "kvstxn_mgr_get_ready_transaction returns head transaction");
+
+    ok (kvstxn_process (kt1, 1, root_ref) == KVSTXN_PROCESS_LOAD_MISSING_REFS,
+        "kvstxn_process on head returns KVSTXN_PROCESS_LOAD_MISSING_REFS");
+
+    ok (kvstxn_iter_missing_refs (kt1, missingref_count_cb, &count) == 0
+        && count == 1,
+        "kvstxn_iter_missing_refs returns the missing dir");
+
+    ok ((kt2 = kvstxn_mgr_get_ready_transaction (ktm)) != NULL
+        && kt2 != kt1,
+        "non-conflicting transaction is ready while head is stalled");
+
+    ok (kvstxn_process (kt2, 1, root_ref) == KVSTXN_PROCESS_WAIT_TURN,
+        "kvstxn_process returns KVSTXN_PROCESS_WAIT_TURN ahead of head");
+
+    ok (kvstxn_get_newroot_ref (kt2) == NULL,
+        "transaction waiting for its turn has not stored a new root");
+
+    errno = 0;
+    ok (kvstxn_iter_dirty_cache_entries (kt2, cache_noop_cb, NULL) < 0
+        && errno == EINVAL,
+        "transaction waiting for its turn has no dirty cache entries");
+
+    ok (kvstxn_mgr_get_ready_transaction (ktm) == NULL,
+        "transaction conflicting with stalled head is not ready");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (dir_ref, dir));
+
+    ok (kvstxn_process (kt1, 1, root_ref) == KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES,
+        "kvstxn_process returns KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES");
+
+    ok (kvstxn_iter_dirty_cache_entries (kt1, cache_noop_cb, NULL) == 0,
+        "kvstxn_iter_dirty_cache_entries works for dirty cache entries");
+
+    ok (kvstxn_process (kt1, 1, root_ref) == KVSTXN_PROCESS_FINISHED,
+        "kvstxn_process on head returns KVSTXN_PROCESS_FINISHED");
+
+    strcpy (newroot, kvstxn_get_newroot_ref (kt1));
+
+    kvstxn_mgr_remove_transaction (ktm, kt1, false);
+
+    ok (kvstxn_mgr_get_ready_transaction (ktm) == kt2,
+        "waiting transaction is ready once at the head");
+
+    /* kt2 is applied to the root kt1 left, and stored only now */
+    ok (kvstxn_process (kt2, 1, newroot) == KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES,
+        "kvstxn_process returns KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES");
+
+    ok (kvstxn_iter_dirty_cache_entries (kt2, cache_noop_cb, NULL) == 0,
+        "kvstxn_iter_dirty_cache_entries works for dirty cache entries");
+
+    ok (kvstxn_process (kt2, 1, newroot) == KVSTXN_PROCESS_FINISHED,
+        "kvstxn_process returns KVSTXN_PROCESS_FINISHED");
+
+    strcpy (newroot, kvstxn_get_newroot_ref (kt2));
+
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.a", "1");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "b", "2");
+
+    kvstxn_mgr_remove_transaction (ktm, kt2, false);
+
+    ok ((kt3 = kvstxn_mgr_get_ready_transaction (ktm)) != NULL,
+        "conflicting transaction is ready once at the head");
+
+    ok (kvstxn_process (kt3, 1, newroot) == KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES,
+        "kvstxn_process returns KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES");
+
+    ok (kvstxn_iter_dirty_cache_entries (kt3, cache_noop_cb, NULL) == 0,
+        "kvstxn_iter_dirty_cache_entries works for dirty cache entries");
+
+    ok (kvstxn_process (kt3, 1, newroot) == KVSTXN_PROCESS_FINISHED,
+        "kvstxn_process returns KVSTXN_PROCESS_FINISHED");
+
+    strcpy (newroot, kvstxn_get_newroot_ref (kt3));
+
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.a", "3");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "b", "2");
+
+    kvstxn_mgr_remove_transaction (ktm, kt3, false);
+
+    kvstxn_mgr_get_stats (ktm, &stats);
+    ok (stats.commits == 3
+        && stats.pipelined == 1
+        && stats.load_stalls == 1,
+        "kvstxn_mgr_get_stats returns expected counts");
+
+    kvstxn_mgr_clear_stats (ktm);
+    kvstxn_mgr_get_stats (ktm, &stats);
+    ok (stats.commits == 0 && stats.load_stall_time == 0.,
+        "kvstxn_mgr_clear_stats works");
+
+    kvstxn_mgr_destroy (ktm);
+    kvsroot_mgr_destroy (krm);
+    cache_destroy (cache);
+    json_decref (dir);
+    json_decref (root);
+}
+
+void kvstxn_process_unroll_offload (void)
+{
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    kvstxn_mgr_t *ktm;
+    kvstxn_t *kt;
+    char rootref[BLOBREF_MAX_STRING_SIZE];
+    char newroot[BLOBREF_MAX_STRING_SIZE];
+    char bigstr[BLOBREF_MAX_STRING_SIZE * 2];
+    int count = 0;
+    int offload;
+    json_t *refs;
+    size_t index;
+    json_t *o;
+    bool found;
+
+    memset (bigstr, 'a', sizeof (bigstr) - 1);
+    bigstr[sizeof (bigstr) - 1] = '\0';
+
+    /* Process the same transaction without and with offload, the new
+     * roots must match.
+     */
+    for (offload = 0; offload < 2; offload++) {
+        cache = create_cache_with_empty_rootdir (rootref, sizeof (rootref));
+
+        ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+            "kvsroot_mgr_create works");
+
+        setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, rootref);
+
+        ok ((ktm = kvstxn_mgr_create (cache,
+                                      KVS_PRIMARY_NAMESPACE,
+                                      "sha1",
+                                      NULL,
+                                      &test_global)) != NULL,
+            "kvstxn_mgr_create works");
+
+        kvstxn_mgr_set_unroll_offload (ktm, offload ? true : false);
+
+        create_ready_kvstxn (ktm, "transaction1", "dir.big", bigstr, 0, 0);
+
+        ok ((kt = kvstxn_mgr_get_ready_transaction (ktm)) != NULL,
+            "kvstxn_mgr_get_ready_transaction returns ready kvstxn");
+
+        if (offload) {
+            ok (kvstxn_process (kt, 1, rootref) == KVSTXN_PROCESS_UNROLL,
+                "kvstxn_process returns KVSTXN_PROCESS_UNROLL with offload");
+
+            ok (kvstxn_mgr_transaction_ready (ktm) == false,
+                "transaction is blocked while unrolling");
+
+            ok (cache_count_entries (cache) == 1,
+                "cache is not modified before unroll completes");
+
+            kvstxn_unroll_work (kt);
+        }
+
+        ok (kvstxn_process (kt, 1, rootref) == KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES,
+            "kvstxn_process returns KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES");
+
+        count = 0;
+        ok (kvstxn_iter_dirty_cache_entries (kt, cache_count_dirty_cb,
+                                             &count) == 0,
+            "kvstxn_iter_dirty_cache_entries works for dirty cache entries");
+
+        /* root, dir, and large value */
+        ok (count == 3,
+            "correct number of cache entries were dirty");
+
+        ok (kvstxn_process (kt, 1, rootref) == KVSTXN_PROCESS_FINISHED,
+            "kvstxn_process returns KVSTXN_PROCESS_FINISHED");
+
+        verify_value (cache, krm, KVS_PRIMARY_NAMESPACE,
+                      kvstxn_get_newroot_ref (kt), "dir.big", bigstr);
+
+        ok ((refs = kvstxn_get_new_refs (kt)) != NULL
+            && json_array_size (refs) == 3,
+            "kvstxn_get_new_refs returns refs of dirty cache entries");
+        found = false;
+        json_array_foreach (refs, index, o) {
+            if (!strcmp (json_string_value (o), kvstxn_get_newroot_ref (kt)))
+                found = true;
+        }
+        ok (found == true,
+            "kvstxn_get_new_refs includes new root");
+
+        if (offload)
+            ok (strcmp (newroot, kvstxn_get_newroot_ref (kt)) == 0,
+                "offloaded unroll produces the same root");
+        else
+            strcpy (newroot, kvstxn_get_newroot_ref (kt));
+
+        kvstxn_mgr_destroy (ktm);
+        kvsroot_mgr_destroy (krm);
+        cache_destroy (cache);
+    }
+}
+
 void kvstxn_namespace_prefix (void)
 {
     struct cache *cache;
@@ -3431,9 +3858,12 @@ int main (int argc, char *argv[])
     kvstxn_process_bad_dirrefs ();
     kvstxn_process_big_fileval ();
     kvstxn_process_giant_dir ();
+    kvstxn_process_shard_dir ();
     kvstxn_process_append ();
     kvstxn_process_append_errors ();
     kvstxn_process_fallback_merge ();
+    kvstxn_process_pipeline ();
+    kvstxn_process_unroll_offload ();
     kvstxn_namespace_prefix ();
     kvstxn_namespace_prefix_symlink ();
 
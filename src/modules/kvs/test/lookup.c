@@ -3544,6 +3544,296 @@ void lookup_stall_namespace_prefix_in_symlink (void) {
     json_decref (rootB);
 }
 
+/* lookup stall tests on sharded directory */
+void lookup_stall_hdir (void) {
+    json_t *root;
+    json_t *hdir;
+    json_t *shard_a;
+    json_t *shard_b;
+    json_t *dirref;
+    json_t *test;
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    lookup_t *lh;
+    char shard_a_ref[BLOBREF_MAX_STRING_SIZE];
+    char shard_b_ref[BLOBREF_MAX_STRING_SIZE];
+    char hdir_ref[BLOBREF_MAX_STRING_SIZE];
+    char root_ref[BLOBREF_MAX_STRING_SIZE];
+    int slot_a = treeobj_hdir_slot ("a", 0);
+    int slot_b = treeobj_hdir_slot ("b", 0);
+
+    ok (slot_a >= 0 && slot_b >= 0 && slot_a != slot_b,
+        "keys a and b hash to different hdir slots");
+
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+    ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+        "kvsroot_mgr_create works");
+
+    /* This cache is
+     *
+     * shard_a_ref
+     * "a" : val to "foo"
+     *
+     * shard_b_ref
+     * "b" : val to "bar"
+     *
+     * hdir_ref (hdir)
+     * slot_a : dirref to shard_a_ref
+     * slot_b : dirref to shard_b_ref
+     *
+     * root_ref
+     * "dir" : dirref to hdir_ref
+     *
+     */
+
+    shard_a = treeobj_create_dir ();
+    _treeobj_insert_entry_val (shard_a, "a", "foo", 3);
+    treeobj_hash ("sha1", shard_a, shard_a_ref, sizeof (shard_a_ref));
+
+    shard_b = treeobj_create_dir ();
+    _treeobj_insert_entry_val (shard_b, "b", "bar", 3);
+    treeobj_hash ("sha1", shard_b, shard_b_ref, sizeof (shard_b_ref));
+
+    hdir = treeobj_create_hdir ();
+    dirref = treeobj_create_dirref (shard_a_ref);
+    treeobj_insert_slot (hdir, slot_a, dirref);
+    json_decref (dirref);
+    dirref = treeobj_create_dirref (shard_b_ref);
+    treeobj_insert_slot (hdir, slot_b, dirref);
+    json_decref (dirref);
+    treeobj_hash ("sha1", hdir, hdir_ref, sizeof (hdir_ref));
+
+    root = treeobj_create_dir ();
+    _treeobj_insert_entry_dirref (root, "dir", hdir_ref);
+    treeobj_hash ("sha1", root, root_ref, sizeof (root_ref));
+
+    setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, root_ref, 0);
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (root_ref, root));
+    (void)cache_insert (cache, create_cache_entry_treeobj (hdir_ref, hdir));
+
+    /* readdir dir, should stall on both shards */
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "dir",
+                             FLUX_ROLE_OWNER,
+                             0,
+                             FLUX_KVS_READDIR,
+                             NULL)) != NULL,
+        "lookup_create stalltest dir");
+    check_stall (lh, EAGAIN, 2, NULL, "dir stall #1");
+
+    /* lookup dir.a, should stall on shard_a only */
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "dir.a",
+                             FLUX_ROLE_OWNER,
+                             0,
+                             0,
+                             NULL)) != NULL,
+        "lookup_create stalltest dir.a");
+    check_stall (lh, EAGAIN, 1, shard_a_ref, "dir.a stall #1");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (shard_a_ref, shard_a));
+
+    test = treeobj_create_val ("foo", 3);
+    check_value (lh, test, "dir.a #1");
+    json_decref (test);
+
+    /* readdir dir, should stall on shard_b only */
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "dir",
+                             FLUX_ROLE_OWNER,
+                             0,
+                             FLUX_KVS_READDIR,
+                             NULL)) != NULL,
+        "lookup_create stalltest dir");
+    check_stall (lh, EAGAIN, 1, shard_b_ref, "dir stall #2");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (shard_b_ref, shard_b));
+
+    /* readdir returns entries of all shards as one dir */
+    test = treeobj_create_dir ();
+    _treeobj_insert_entry_val (test, "a", "foo", 3);
+    _treeobj_insert_entry_val (test, "b", "bar", 3);
+    check_value (lh, test, "dir #1");
+    json_decref (test);
+
+    cache_destroy (cache);
+    kvsroot_mgr_destroy (krm);
+    json_decref (shard_a);
+    json_decref (shard_b);
+    json_decref (hdir);
+    json_decref (root);
+}
+
+/* cold lookups record path hints, and later cold lookups prefetch them */
+void lookup_prefetch (void) {
+    json_t *root;
+    json_t *dir_a;
+    json_t *dir_b;
+    json_t *test;
+    json_t *val;
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    struct kvsroot *kroot;
+    lookup_t *lh;
+    struct lookup_ref_data ld;
+    char dir_a_ref[BLOBREF_MAX_STRING_SIZE];
+    char dir_b_ref[BLOBREF_MAX_STRING_SIZE];
+    char root_ref[BLOBREF_MAX_STRING_SIZE];
+
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+    ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+        "kvsroot_mgr_create works");
+
+    /* This cache is
+     *
+     * dir_b_ref
+     * "c" : val to "foo"
+     *
+     * dir_a_ref
+     * "b" : dirref to dir_b_ref
+     *
+     * root_ref
+     * "a" : dirref to dir_a_ref
+     */
+
+    dir_b = treeobj_create_dir ();
+    _treeobj_insert_entry_val (dir_b, "c", "foo", 3);
+    treeobj_hash ("sha1", dir_b, dir_b_ref, sizeof (dir_b_ref));
+
+    dir_a = treeobj_create_dir ();
+    _treeobj_insert_entry_dirref (dir_a, "b", dir_b_ref);
+    treeobj_hash ("sha1", dir_a, dir_a_ref, sizeof (dir_a_ref));
+
+    root = treeobj_create_dir ();
+    _treeobj_insert_entry_dirref (root, "a", dir_a_ref);
+    treeobj_hash ("sha1", root, root_ref, sizeof (root_ref));
+
+    setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, root_ref, 0);
+    ok ((kroot = kvsroot_mgr_lookup_root (krm, KVS_PRIMARY_NAMESPACE)) != NULL,
+        "kvsroot_mgr_lookup_root works");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (root_ref, root));
+
+    /* first cold lookup stalls one directory at a time */
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "a.b.c",
+                             FLUX_ROLE_OWNER,
+                             0,
+                             0,
+                             NULL)) != NULL,
+        "lookup_create a.b.c");
+    ok (lookup (lh) == LOOKUP_PROCESS_LOAD_MISSING_REFS,
+        "lookup a.b.c stalls on dir a");
+    memset (&ld, 0, sizeof (ld));
+    ok (lookup_iter_prefetch_refs (lh, lookup_ref, &ld) == 0
+        && ld.count == 0,
+        "no prefetch refs without hints");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (dir_a_ref, dir_a));
+
+    ok (lookup (lh) == LOOKUP_PROCESS_LOAD_MISSING_REFS,
+        "lookup a.b.c stalls on dir a.b");
+    memset (&ld, 0, sizeof (ld));
+    ok (lookup_iter_missing_refs (lh, lookup_ref, &ld) == 0
+        && ld.count == 1 && !strcmp (ld.ref, dir_b_ref),
+        "missing ref is dir a.b");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (dir_b_ref, dir_b));
+
+    ok (lookup (lh) == LOOKUP_PROCESS_FINISHED,
+        "lookup a.b.c finishes");
+    ok (lookup_get_stall_count (lh) == 2,
+        "lookup_get_stall_count returns 2");
+    ok (lookup_get_elapsed (lh) >= 0.,
+        "lookup_get_elapsed works");
+    test = treeobj_create_val ("foo", 3);
+    val = lookup_get_value (lh);
+    ok (json_equal (test, val) == true,
+        "lookup a.b.c returns correct value");
+    json_decref (test);
+    json_decref (val);
+    lookup_destroy (lh);
+
+    ok (kvsroot_get_path_hint (kroot, "a") != NULL
+        && !strcmp (kvsroot_get_path_hint (kroot, "a"), dir_a_ref),
+        "cold lookup recorded hint for a");
+    ok (kvsroot_get_path_hint (kroot, "a.b") != NULL
+        && !strcmp (kvsroot_get_path_hint (kroot, "a.b"), dir_b_ref),
+        "cold lookup recorded hint for a.b");
+
+    /* directories expire from the cache, a second cold lookup prefetches
+     * a.b while a is loaded */
+    cache_destroy (cache);
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+    (void)cache_insert (cache, create_cache_entry_treeobj (root_ref, root));
+
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "a.b.c",
+                             FLUX_ROLE_OWNER,
+                             0,
+                             0,
+                             NULL)) != NULL,
+        "lookup_create a.b.c");
+    ok (lookup (lh) == LOOKUP_PROCESS_LOAD_MISSING_REFS,
+        "lookup a.b.c stalls on dir a");
+    memset (&ld, 0, sizeof (ld));
+    ok (lookup_iter_missing_refs (lh, lookup_ref, &ld) == 0
+        && ld.count == 1 && !strcmp (ld.ref, dir_a_ref),
+        "missing ref is dir a");
+    memset (&ld, 0, sizeof (ld));
+    ok (lookup_iter_prefetch_refs (lh, lookup_ref, &ld) == 0
+        && ld.count == 1 && !strcmp (ld.ref, dir_b_ref),
+        "prefetch ref is dir a.b");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (dir_a_ref, dir_a));
+    (void)cache_insert (cache, create_cache_entry_treeobj (dir_b_ref, dir_b));
+
+    ok (lookup (lh) == LOOKUP_PROCESS_FINISHED,
+        "lookup a.b.c finishes after a single stall");
+    ok (lookup_get_stall_count (lh) == 1,
+        "lookup_get_stall_count returns 1");
+    lookup_destroy (lh);
+
+    ok (lookup_iter_prefetch_refs (NULL, lookup_ref, NULL) < 0
+        && errno == EINVAL,
+        "lookup_iter_prefetch_refs fails with EINVAL on NULL handle");
+
+    cache_destroy (cache);
+    kvsroot_mgr_destroy (krm);
+    json_decref (dir_a);
+    json_decref (dir_b);
+    json_decref (root);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -3565,6 +3855,8 @@ int main (int argc, char *argv[])
     lookup_stall_namespace ();
     lookup_stall_ref_root ();
     lookup_stall_ref ();
+    lookup_stall_hdir ();
+    lookup_prefetch ();
     lookup_stall_namespace_removed ();
     lookup_stall_namespace_prefix_in_symlink ();
     done_testing ();
@@ -0,0 +1,120 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* batch - exercise content load-batch and store-batch requests
+ *
+ * Usage: batch [--bypass-cache] store FILE...
+ *        batch [--bypass-cache] load BLOBREF...
+ *
+ * store sends the contents of all FILEs in one store-batch request
+ * and prints one blobref per line, in order.  load sends all BLOBREFs
+ * in one load-batch request and writes the blobs to stdout, in order.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/read_all.h"
+
+static void usage (void)
+{
+    fprintf (stderr,
+             "Usage: batch [--bypass-cache] store FILE...\n"
+             "       batch [--bypass-cache] load BLOBREF...\n");
+    exit (1);
+}
+
+static void batch_store (flux_t *h, int flags, int count, char **files)
+{
+    void **bufs = xzmalloc (sizeof (bufs[0]) * count);
+    int *lens = xzmalloc (sizeof (lens[0]) * count);
+    flux_future_t *f;
+    const char *blobref;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        int fd;
+        if ((fd = open (files[i], O_RDONLY)) < 0)
+            log_err_exit ("%s", files[i]);
+        if ((lens[i] = read_all (fd, &bufs[i])) < 0)
+            log_err_exit ("%s", files[i]);
+        close (fd);
+    }
+    if (!(f = flux_content_store_batch (h, (const void **)bufs, lens,
+                                        count, flags)))
+        log_err_exit ("flux_content_store_batch");
+    for (i = 0; i < count; i++) {
+        if (flux_content_store_batch_get (f, i, &blobref) < 0)
+            log_err_exit ("flux_content_store_batch_get %s", files[i]);
+        printf ("%s\n", blobref);
+    }
+    flux_future_destroy (f);
+    for (i = 0; i < count; i++)
+        free (bufs[i]);
+    free (bufs);
+    free (lens);
+}
+
+static void batch_load (flux_t *h, int flags, int count, char **refs)
+{
+    flux_future_t *f;
+    const void *buf;
+    int len;
+    int i;
+
+    if (!(f = flux_content_load_batch (h, (const char **)refs, count, flags)))
+        log_err_exit ("flux_content_load_batch");
+    for (i = 0; i < count; i++) {
+        if (flux_content_load_batch_get (f, i, &buf, &len) < 0)
+            log_err_exit ("flux_content_load_batch_get %s", refs[i]);
+        if (write_all (STDOUT_FILENO, buf, len) < 0)
+            log_err_exit ("write");
+    }
+    flux_future_destroy (f);
+}
+
+int main (int argc, char *argv[])
+{
+    flux_t *h;
+    int flags = 0;
+    int i = 1;
+
+    log_init ("batch");
+    if (i < argc && !strcmp (argv[i], "--bypass-cache")) {
+        flags |= CONTENT_FLAG_CACHE_BYPASS;
+        i++;
+    }
+    if (argc - i < 2)
+        usage ();
+    if (!(h = flux_open (NULL, 0)))
+        log_err_exit ("flux_open");
+    if (!strcmp (argv[i], "store"))
+        batch_store (h, flags, argc - i - 1, argv + i + 1);
+    else if (!strcmp (argv[i], "load"))
+        batch_load (h, flags, argc - i - 1, argv + i + 1);
+    else
+        usage ();
+    flux_close (h);
+    log_fini ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,117 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* dispatchbench - measure message handler dispatch rate
+ *
+ * Usage: dispatchbench [nhandlers] [nmsgs]
+ *
+ * Registers 'nhandlers' request handlers with exact topics, plus one
+ * prefix glob handler per ten exact handlers and a catch-all, then sends
+ * 'nmsgs' requests round robin over the topics on a loop:// handle and
+ * reports how long dispatch took.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/xzmalloc.h"
+
+static int received;
+static int expected;
+
+static void request_cb (flux_t *h, flux_msg_handler_t *mh,
+                        const flux_msg_t *msg, void *arg)
+{
+    if (++received == expected)
+        flux_reactor_stop (flux_get_reactor (h));
+}
+
+static flux_msg_handler_t *handler_create (flux_t *h, const char *glob)
+{
+    struct flux_match match = FLUX_MATCH_REQUEST;
+    flux_msg_handler_t *mh;
+
+    match.topic_glob = (char *)glob;
+    if (!(mh = flux_msg_handler_create (h, match, request_cb, NULL)))
+        log_err_exit ("flux_msg_handler_create");
+    flux_msg_handler_start (mh);
+    return mh;
+}
+
+int main (int argc, char *argv[])
+{
+    flux_t *h;
+    int nhandlers = argc > 1 ? strtol (argv[1], NULL, 10) : 100;
+    int nmsgs = argc > 2 ? strtol (argv[2], NULL, 10) : 100000;
+    int nprefix;
+    flux_msg_handler_t **handlers;
+    char topic[64];
+    struct timespec t0;
+    double elapsed;
+    int i, n;
+
+    log_init ("dispatchbench");
+    if (nhandlers < 1 || nmsgs < 1)
+        log_msg_exit ("Usage: dispatchbench [nhandlers] [nmsgs]");
+    if (!(h = flux_open ("loop://", 0)))
+        log_err_exit ("flux_open");
+
+    nprefix = nhandlers / 10;
+    handlers = xzmalloc (sizeof (handlers[0]) * (nhandlers + nprefix + 1));
+    n = 0;
+    handlers[n++] = handler_create (h, NULL);
+    for (i = 0; i < nprefix; i++) {
+        snprintf (topic, sizeof (topic), "svc%d.*", i);
+        handlers[n++] = handler_create (h, topic);
+    }
+    for (i = 0; i < nhandlers; i++) {
+        snprintf (topic, sizeof (topic), "svc%d.method%d", i % 10, i);
+        handlers[n++] = handler_create (h, topic);
+    }
+
+    expected = nmsgs;
+    monotime (&t0);
+    for (i = 0; i < nmsgs; i++) {
+        flux_msg_t *msg;
+
+        snprintf (topic, sizeof (topic), "svc%d.method%d",
+                  i % 10, i % nhandlers);
+        if (!(msg = flux_request_encode (topic, NULL)))
+            log_err_exit ("flux_request_encode");
+        if (flux_send (h, msg, 0) < 0)
+            log_err_exit ("flux_send");
+        flux_msg_destroy (msg);
+    }
+    if (flux_reactor_run (flux_get_reactor (h), 0) < 0)
+        log_err_exit ("flux_reactor_run");
+    elapsed = monotime_since (t0) / 1000;
+    if (received != nmsgs)
+        log_msg_exit ("received %d of %d messages", received, nmsgs);
+
+    printf ("%d handlers: %d requests in %.3fs (%.0f msgs/s)\n",
+            n, nmsgs, elapsed, elapsed > 0 ? nmsgs / elapsed : 0);
+
+    for (i = 0; i < n; i++)
+        flux_msg_handler_destroy (handlers[i]);
+    free (handlers);
+    flux_close (h);
+    log_fini ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -98,4 +98,9 @@ test_expect_success 'request: unloaded req module on rank 0' '
 	flux module remove --rank=0 req
 '
 
+test_expect_success 'request: dispatch microbenchmark runs' '
+	${FLUX_BUILD_DIR}/t/request/dispatchbench 1000 10000 >dispatchbench.out &&
+	grep "10000 requests" dispatchbench.out
+'
+
 test_done
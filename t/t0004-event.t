@@ -53,6 +53,25 @@ test_expect_success 'publish private event with raw payload (loopback)' '
 	run_timeout 5 flux event pub -p -l -r foo.bar foo
 '
 
+test_expect_success 'publish batch of events with raw payload (loopback)' '
+	run_timeout 5 flux event pub -c 10 -l -r foo.bar foo
+'
+
+test_expect_success 'publish batch of events with JSON payload (loopback)' '
+	run_timeout 5 flux event pub -c 10 -l foo.bar {}
+'
+
+test_expect_success 'publish batch assigns consecutive sequence numbers' '
+	flux event pub -c 5 foo.bar >batch.out &&
+	first=$(sed -e "s/^seq=\([0-9]*\)-.*/\1/" batch.out) &&
+	last=$(sed -e "s/^seq=[0-9]*-//" batch.out) &&
+	test $((last - first)) -eq 4
+'
+
+test_expect_success 'publish batch with invalid count fails' '
+	test_must_fail flux event pub -c 0 foo.bar
+'
+
 test_expect_success 'publish event with no payload (synchronous)' '
 	run_timeout 5 flux event pub -s foo.bar
 '
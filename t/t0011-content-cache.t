@@ -148,6 +148,39 @@ test_expect_success 'rank 0 cache is all valid' '
 	test $VALID -eq $TOTAL
 '
 
+# Rank 1 cache holds clean copies of blobs loaded from upstream,
+# which are purged from the lru list once targets are exceeded
+test_expect_success 'purge clean entries on rank 1' '
+	flux exec -n -r 1 flux content load `cat 1m.0.hash` >/dev/null &&
+	flux exec -n -r 1 flux setattr content.purge-old-entry 0 &&
+	flux exec -n -r 1 flux setattr content.purge-target-entries 0 &&
+	flux exec -n -r 1 flux setattr content.purge-target-size 0 &&
+	i=0 &&
+	while test $(flux module stats -r 1 --type int --parse purge-count \
+				content) -eq 0 && test $i -lt 60; do
+		sleep 0.5; i=$((i+1))
+	done &&
+	test $(flux module stats -r 1 --type int --parse valid content) -eq 0
+'
+
+# With only the size target exceeded, large entries are purged and
+# entries smaller than purge-large-entry are left alone
+test_expect_success 'purge by size takes only large entries on rank 1' '
+	echo small >small.blob &&
+	SMALL=$(flux content store <small.blob) &&
+	flux exec -n -r 1 flux setattr content.purge-target-entries 1048576 &&
+	flux exec -n -r 1 flux content load $SMALL >small.out &&
+	test_cmp small.blob small.out &&
+	flux exec -n -r 1 flux content load `cat 1m.0.hash` >/dev/null &&
+	i=0 &&
+	while test $(flux module stats -r 1 --type int --parse valid \
+				content) -ne 1 && test $i -lt 60; do
+		sleep 0.5; i=$((i+1))
+	done &&
+	test $(flux module stats -r 1 --type int --parse valid content) -eq 1 &&
+	test $(flux module stats -r 1 --type int --parse size content) -lt 256
+'
+
 # Write 8192 blobs, allowing 1024 requests to be outstanding
 test_expect_success 'store 8K blobs from rank 0 using async RPC' '
 	flux content spam 8192 1024
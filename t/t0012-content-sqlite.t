@@ -7,6 +7,12 @@ test_description='Test content-sqlite service'
 if test "$TEST_LONG" = "t"; then
     test_set_prereq LONGTEST
 fi
+if grep -q "^#define HAVE_ZSTD 1" ${FLUX_BUILD_DIR}/config/config.h; then
+    test_set_prereq ZSTD
+    WORKER_CODEC=zstd
+else
+    WORKER_CODEC=lz4
+fi
 
 # Size the session to one more than the number of cores, minimum of 4
 SIZE=$(test_size_large)
@@ -14,6 +20,7 @@ test_under_flux ${SIZE} minimal
 echo "# $0: flux session size will be ${SIZE}"
 
 BLOBREF=${FLUX_BUILD_DIR}/t/kvs/blobref
+BATCH=${FLUX_BUILD_DIR}/t/content/batch
 
 MAXBLOB=`flux getattr content.blob-size-limit`
 HASHFUN=`flux getattr content.hash`
@@ -108,6 +115,47 @@ test_expect_success 'load and verify 1m blob on all ranks' '
         test_cmp 1m.0.all.expect 1m.0.all.output
 '
 
+# Store and load several blobs per request
+# Load misses go through the cache to the backing store
+
+test_expect_success 'store blobs with one store-batch request' '
+        for i in 1 2 3; do
+                dd if=/dev/urandom count=1 bs=$((i*1024)) \
+                        >batch.$i.store 2>/dev/null || return 1
+        done &&
+        ${BATCH} store batch.1.store batch.2.store batch.3.store >batch.hash &&
+        for i in 1 2 3; do
+                $BLOBREF $HASHFUN <batch.$i.store || return 1
+        done >batch.hash.expect &&
+        test_cmp batch.hash.expect batch.hash
+'
+
+test_expect_success 'load-batch on rank 0 reads blobs from backing store' '
+        run_timeout 10 flux content flush &&
+        flux content dropcache &&
+        cat batch.1.store batch.2.store batch.3.store >batch.expect &&
+        ${BATCH} load $(cat batch.hash) >batch.out &&
+        test_cmp batch.expect batch.out
+'
+
+test_expect_success 'load-batch on rank 1 reads blobs from backing store' '
+        flux content dropcache &&
+        flux exec -n -r 1 ${BATCH} load $(cat batch.hash) >batch.out.1 &&
+        test_cmp batch.expect batch.out.1
+'
+
+test_expect_success 'load-batch of unknown blob fails' '
+        UNKNOWN=$(echo unknown | $BLOBREF $HASHFUN) &&
+        test_must_fail ${BATCH} load $(head -1 batch.hash) ${UNKNOWN}
+'
+
+test_expect_success 'batch requests cannot bypass the cache' '
+        test_must_fail ${BATCH} --bypass-cache load $(cat batch.hash) \
+                2>bypass.err &&
+        grep -q "Invalid argument" bypass.err &&
+        test_must_fail ${BATCH} --bypass-cache store batch.1.store
+'
+
 # Flush any pending stores and drop cache
 # Unload persistence module
 # Verify content is not lost
@@ -118,6 +166,15 @@ test_expect_success 'flush rank 0 cache' '
 	test $NDIRTY -eq 0
 '
 
+test_expect_success 'content-sqlite grouped stores into batches' '
+	BATCHES=`flux module stats --type int --parse batch-count content-sqlite` &&
+	STORES=`flux module stats --type int --parse batch-stores content-sqlite` &&
+	PENDING=`flux module stats --type int --parse batch-pending content-sqlite` &&
+	test $BATCHES -gt 0 &&
+	test $BATCHES -le $STORES &&
+	test $PENDING -eq 0
+'
+
 test_expect_success 'drop rank 0 cache' '
         flux content dropcache &&
 	ECOUNT=`flux module stats --type int --parse count content` &&
@@ -203,6 +260,118 @@ test_expect_success 'exercise batching of asynchronous flush to backing store' '
 	test $OLD_COUNT -le $NEW_COUNT
 '
 
+test_expect_success 'reload content-sqlite module with batch-limit=1' '
+	flux module remove --rank 0 content-sqlite &&
+	flux module load --rank 0 content-sqlite batch-limit=1 batch-timeout=1
+'
+
+test_expect_success 'stores are committed one at a time' '
+	store_junk nobatch 10 &&
+	run_timeout 10 flux content flush &&
+	LARGEST=`flux module stats --type int --parse batch-largest content-sqlite` &&
+	test $LARGEST -eq 1
+'
+
+test_expect_success 'store treeobj-like blobs' '
+	for i in `seq 1 200`; do \
+	    echo "{\"data\":[\"sha1-$i\"],\"type\":\"dirref\",\"ver\":1}" \
+	        | flux content store >/dev/null || return 1; \
+	done &&
+	run_timeout 10 flux content flush
+'
+
+test_expect_success !ZSTD 'content-sqlite refuses zstd codecs without libzstd' '
+	flux module remove --rank 0 content-sqlite &&
+	test_must_fail flux module load --rank 0 content-sqlite codec=zstd &&
+	test_must_fail flux module load --rank 0 content-sqlite codec=zstd-dict &&
+	flux module load --rank 0 content-sqlite
+'
+
+test_expect_success 'content-sqlite refuses an unknown codec' '
+	flux module remove --rank 0 content-sqlite &&
+	test_must_fail flux module load --rank 0 content-sqlite codec=nope &&
+	flux module load --rank 0 content-sqlite
+'
+
+test_expect_success ZSTD 'reload content-sqlite module with zstd-dict codec' '
+	flux module remove --rank 0 content-sqlite &&
+	flux module load --rank 0 content-sqlite codec=zstd-dict \
+		dict-samples=256 dict-size=4096 compress-threshold=16
+'
+
+test_expect_success ZSTD 'dictionary was trained from existing objects' '
+	VERSION=`flux module stats --type int --parse dict-version content-sqlite` &&
+	test $VERSION -ge 1
+'
+
+test_expect_success ZSTD 'store and load blob compressed with dictionary' '
+	echo "{\"data\":[\"sha1-dict\"],\"type\":\"dirref\",\"ver\":1}" \
+		>dict.store &&
+	flux content store --bypass-cache <dict.store >dict.hash &&
+	flux content load --bypass-cache `cat dict.hash` >dict.load &&
+	test_cmp dict.store dict.load &&
+	COUNT=`flux module stats --type int --parse compress-count content-sqlite` &&
+	test $COUNT -ge 1
+'
+
+test_expect_success ZSTD 'dictionary is retrained only on request' '
+	OLD=`flux module stats --type int --parse dict-version content-sqlite` &&
+	store_junk retrain 300 &&
+	run_timeout 10 flux content flush &&
+	NEW=`flux module stats --type int --parse dict-version content-sqlite` &&
+	test $NEW -eq $OLD &&
+	flux python -c "import flux; flux.Flux().rpc_send(\"content-sqlite.dict-train\")" &&
+	NEW=`flux module stats --type int --parse dict-version content-sqlite` &&
+	test $NEW -gt $OLD
+'
+
+test_expect_success 'blobs stored with lz4 are still readable' '
+	flux content load --bypass-cache `cat 4k.0.hash` >4k.0.load4 &&
+	test_cmp 4k.0.store 4k.0.load4
+'
+
+test_expect_success ZSTD 'reload content-sqlite module with zstd codec' '
+	flux module remove --rank 0 content-sqlite &&
+	flux module load --rank 0 content-sqlite codec=zstd
+'
+
+test_expect_success ZSTD 'store and load blob compressed with zstd' '
+	seq 1 2000 >seq.store &&
+	flux content store --bypass-cache <seq.store >seq.hash &&
+	flux content load --bypass-cache `cat seq.hash` >seq.load &&
+	test_cmp seq.store seq.load
+'
+
+test_expect_success ZSTD 'blobs stored with dictionary are still readable' '
+	flux content load --bypass-cache `cat dict.hash` >dict.load2 &&
+	test_cmp dict.store dict.load2
+'
+
+test_expect_success 'reload content-sqlite module with worker threads' '
+	flux module remove --rank 0 content-sqlite &&
+	flux module load --rank 0 content-sqlite workers=4 codec=$WORKER_CODEC &&
+	WORKERS=`flux module stats --type int --parse workers content-sqlite` &&
+	test $WORKERS -eq 4
+'
+
+test_expect_success 'store blobs through worker threads' '
+	store_junk workers 100 &&
+	for i in `seq 1 8`; do \
+	    seq $i 4000 | flux content store --bypass-cache >seq.$i.hash || return 1; \
+	done &&
+	run_timeout 10 flux content flush
+'
+
+test_expect_success 'blobs stored through worker threads are readable' '
+	for i in `seq 1 8`; do \
+	    seq $i 4000 >seq.$i.expect &&
+	    flux content load --bypass-cache `cat seq.$i.hash` >seq.$i.load &&
+	    test_cmp seq.$i.expect seq.$i.load || return 1; \
+	done &&
+	PENDING=`flux module stats --type int --parse workers-pending content-sqlite` &&
+	test $PENDING -eq 0
+'
+
 test_expect_success 'remove content-sqlite module on rank 0' '
 	flux module remove --rank 0 content-sqlite
 '
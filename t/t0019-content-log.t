@@ -0,0 +1,196 @@
+#!/bin/sh
+
+test_description='Test content-log service'
+
+. `dirname $0`/sharness.sh
+
+# Size the session to one more than the number of cores, minimum of 4
+SIZE=$(test_size_large)
+test_under_flux ${SIZE} minimal
+echo "# $0: flux session size will be ${SIZE}"
+
+BLOBREF=${FLUX_BUILD_DIR}/t/kvs/blobref
+
+HASHFUN=`flux getattr content.hash`
+LOGDIR=`flux getattr broker.rundir`/content/log
+
+store_junk() {
+    local name=$1
+    local n=$2
+    for i in `seq 1 $n`; do \
+        echo "$name:$i" | flux content store >/dev/null || return 1
+    done
+}
+
+test_expect_success 'load content-log module on rank 0' '
+	flux module load --rank 0 content-log
+'
+
+test_expect_success 'store 100 blobs on rank 0' '
+	store_junk test 100 &&
+        TOTAL=`flux module stats --type int --parse count content` &&
+        test $TOTAL -ge 100
+'
+
+test_expect_success 'flush rank 0 cache to content-log' '
+        run_timeout 10 flux content flush &&
+	NDIRTY=`flux module stats --type int --parse dirty content` &&
+	test $NDIRTY -eq 0 &&
+	COUNT=`flux module stats --type int --parse count content-log` &&
+	test $COUNT -ge 100
+'
+
+test_expect_success 'stores were group committed' '
+	COMMITS=`flux module stats --type int --parse commits content-log` &&
+	RECORDS=`flux module stats --type int --parse commit-records content-log` &&
+	test $COMMITS -gt 0 &&
+	test $COMMITS -le $RECORDS
+'
+
+test_expect_success 'store blobs bypassing cache' '
+	cat /dev/null >0.0.store &&
+        flux content store --bypass-cache <0.0.store >0.0.hash &&
+        dd if=/dev/urandom count=1 bs=64 >64.0.store 2>/dev/null &&
+        flux content store --bypass-cache <64.0.store >64.0.hash &&
+        dd if=/dev/urandom count=1 bs=4096 >4k.0.store 2>/dev/null &&
+        flux content store --bypass-cache <4k.0.store >4k.0.hash &&
+        dd if=/dev/urandom count=256 bs=4096 >1m.0.store 2>/dev/null &&
+        flux content store --bypass-cache <1m.0.store >1m.0.hash
+'
+
+test_expect_success 'load 0b blob bypassing cache' '
+        HASHSTR=`cat 0.0.hash` &&
+        flux content load --bypass-cache ${HASHSTR} >0.0.load &&
+        test_cmp 0.0.store 0.0.load
+'
+
+test_expect_success 'load 1m blob bypassing cache' '
+        HASHSTR=`cat 1m.0.hash` &&
+        flux content load --bypass-cache ${HASHSTR} >1m.0.load &&
+        test_cmp 1m.0.store 1m.0.load
+'
+
+test_expect_success 'load unknown blob bypassing cache fails' '
+        HASHSTR=`echo unknown | $BLOBREF $HASHFUN` &&
+        test_must_fail flux content load --bypass-cache ${HASHSTR}
+'
+
+test_expect_success 'load and verify 4k blob on all ranks' '
+        HASHSTR=`cat 4k.0.hash` &&
+        flux exec -n echo ${HASHSTR} >4k.0.all.expect &&
+        flux exec -n sh -c "flux content load ${HASHSTR} | $BLOBREF $HASHFUN" \
+                                                >4k.0.all.output &&
+        test_cmp 4k.0.all.expect 4k.0.all.output
+'
+
+test_expect_success 'drop rank 0 cache' '
+        flux content dropcache &&
+	ECOUNT=`flux module stats --type int --parse count content` &&
+	test $ECOUNT -eq 0
+'
+
+test_expect_success 'unload content-log module writes index checkpoint' '
+	flux module remove --rank 0 content-log &&
+	test -f ${LOGDIR}/index
+'
+
+test_expect_success 'check that content returned dirty' '
+	NDIRTY=`flux module stats --type int --parse dirty content` &&
+	ECOUNT=`flux module stats --type int --parse count content` &&
+	test $NDIRTY -eq $ECOUNT
+'
+
+test_expect_success 'reload content-log module from index checkpoint' '
+	flux module load --rank 0 content-log &&
+	test ! -f ${LOGDIR}/index &&
+	HASHSTR=`cat 1m.0.hash` &&
+        flux content load --bypass-cache ${HASHSTR} >1m.0.load2 &&
+        test_cmp 1m.0.store 1m.0.load2
+'
+
+test_expect_success 'reload content-log module, rebuilding index from log' '
+	flux module remove --rank 0 content-log &&
+	rm -f ${LOGDIR}/index &&
+	flux module load --rank 0 content-log &&
+	COUNT=`flux module stats --type int --parse count content-log` &&
+	test $COUNT -ge 104 &&
+	HASHSTR=`cat 64.0.hash` &&
+        flux content load --bypass-cache ${HASHSTR} >64.0.load2 &&
+        test_cmp 64.0.store 64.0.load2
+'
+
+test_expect_success 'partial record at end of log is truncated' '
+	flux module remove --rank 0 content-log &&
+	rm -f ${LOGDIR}/index &&
+	LAST=`ls ${LOGDIR}/seg.* | tail -1` &&
+	printf "junk" >>${LAST} &&
+	flux module load --rank 0 content-log &&
+	HASHSTR=`cat 4k.0.hash` &&
+        flux content load --bypass-cache ${HASHSTR} >4k.0.load2 &&
+        test_cmp 4k.0.store 4k.0.load2
+'
+
+test_expect_success 'small segments are rolled' '
+	flux module remove --rank 0 content-log &&
+	flux module load --rank 0 content-log segment-size=4096 &&
+	store_junk roll 200 &&
+        run_timeout 10 flux content flush &&
+	SEGS=`flux module stats --type int --parse segments content-log` &&
+	test $SEGS -gt 1
+'
+
+test_expect_success 'segments with dead records are compacted' '
+	flux module remove --rank 0 content-log &&
+	rm -f ${LOGDIR}/index &&
+	ls ${LOGDIR}/seg.* >segs.list &&
+	test $(wc -l <segs.list) -ge 3 &&
+	A=$(tail -3 segs.list | head -1) &&
+	B=$(tail -2 segs.list | head -1) &&
+	cat ${A} ${B} >segs.tmp &&
+	mv segs.tmp ${B} &&
+	flux module load --rank 0 content-log compact-threshold=10 &&
+	for i in $(seq 1 60); do
+		COMPACTIONS=$(flux module stats --type int \
+			--parse compactions content-log) &&
+		test ${COMPACTIONS} -ge 1 && break
+		sleep 0.5
+	done &&
+	test ${COMPACTIONS} -ge 1 &&
+	test ! -f ${B}
+'
+
+test_expect_success 'blobs are intact after compaction' '
+	for i in $(seq 1 200); do
+		HASHSTR=$(echo "roll:$i" | $BLOBREF $HASHFUN) &&
+		echo "roll:$i" >roll.expect &&
+		flux content load --bypass-cache ${HASHSTR} >roll.out &&
+		test_cmp roll.expect roll.out || return 1
+	done
+'
+
+test_expect_success 'remove content-log module on rank 0' '
+	flux module remove --rank 0 content-log
+'
+
+# A reduced blob-size-limit only applies to new stores
+
+test_expect_success 'records above a reduced blob-size-limit survive restart' '
+	PDIR=$(pwd)/persist.limit &&
+	mkdir -p ${PDIR} &&
+	flux start -o,--shutdown-grace=0.1 \
+		-o,--setattr=persist-directory=${PDIR} \
+		"flux module load content-log &&
+		 flux content store --bypass-cache <4k.0.store >4k.limit.hash &&
+		 flux module remove content-log" &&
+	HASHSTR=$(cat 4k.limit.hash) &&
+	flux start -o,--shutdown-grace=0.1 \
+		-o,--setattr=persist-directory=${PDIR} \
+		-o,--setattr=content.blob-size-limit=1024 \
+		"flux module load content-log &&
+		 flux content load --bypass-cache ${HASHSTR} >4k.limit.load &&
+		 ! flux content store --bypass-cache <4k.0.store &&
+		 flux module remove content-log" &&
+	test_cmp 4k.0.store 4k.limit.load
+'
+
+test_done
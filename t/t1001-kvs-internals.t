@@ -395,4 +395,52 @@ test_expect_success 'kvs: test invalid fence arguments on rank 1' '
         grep "flux_future_get: Invalid argument" invalid_output
 '
 
+#
+# sharded directories
+#
+
+test_expect_success 'kvs: large directory is not sharded by default' '
+        for i in $(seq 1 100); do echo $DIR.noshard.key$i=$i; done >noshard.in &&
+        flux kvs put $(cat noshard.in) &&
+        BLOBREF=`flux kvs get --treeobj $DIR.noshard | grep -P "sha1-[A-Za-z0-9]+" -o` &&
+        flux content load $BLOBREF | grep -q "\"type\":\"dir\""
+'
+
+#
+# lookup stats
+#
+
+test_expect_success 'kvs: lookup stats count lookups' '
+        flux module stats -c kvs &&
+        flux kvs put $DIR.lookupstats.a.b.c=1 &&
+        test $(flux kvs get $DIR.lookupstats.a.b.c) = 1 &&
+        test $(flux module stats --parse "lookup.#lookups" kvs) -ge 1 &&
+        flux module stats --parse "lookup.cold latency (ms).count" kvs &&
+        flux module stats --parse "lookup.#prefetched" kvs
+'
+
+# The first cold lookup of a deep key on rank 1 stalls on each directory
+# in its path and records them as hints.  After the cache is dropped, a
+# second cold lookup prefetches the hinted directories when it first
+# stalls, so it stalls fewer times.
+test_expect_success 'kvs: cold lookups prefetch hinted path directories' '
+        flux kvs put $DIR.prefetch.a.b.c.d.e.f=1 &&
+        VERS=$(flux kvs version) &&
+        flux exec -n -r 1 sh -c "flux kvs wait ${VERS}" &&
+        flux exec -n -r 1 flux kvs dropcache &&
+        flux exec -n -r 1 flux module stats -c kvs &&
+        test $(flux exec -n -r 1 flux kvs get $DIR.prefetch.a.b.c.d.e.f) = 1 &&
+        STALLS1=$(flux exec -n -r 1 flux module stats --type int \
+                  --parse "lookup.stalls.max" kvs) &&
+        flux exec -n -r 1 flux kvs dropcache &&
+        flux exec -n -r 1 flux module stats -c kvs &&
+        test $(flux exec -n -r 1 flux kvs get $DIR.prefetch.a.b.c.d.e.f) = 1 &&
+        STALLS2=$(flux exec -n -r 1 flux module stats --type int \
+                  --parse "lookup.stalls.max" kvs) &&
+        PREFETCHED=$(flux exec -n -r 1 flux module stats \
+                     --parse "lookup.#prefetched" kvs) &&
+        test $PREFETCHED -gt 0 &&
+        test $STALLS2 -lt $STALLS1
+'
+
 test_done
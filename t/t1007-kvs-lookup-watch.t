@@ -492,4 +492,110 @@ test_expect_success 'flux kvs get --watch allows owner access to guest ns' '
 	flux kvs namespace-remove testns4
 '
 
+wait_watcherscount() {
+        ns=$1
+        count=$2
+        i=0
+        while [ "$(flux module stats --parse namespaces.${ns}.watchers kvs-watch 2> /dev/null)" != "${count}" ] \
+              && [ $i -lt ${KVS_WAIT_ITERS} ]
+        do
+                sleep 0.1
+                i=$((i + 1))
+        done
+        return $(loophandlereturn $i)
+}
+
+test_expect_success NO_CHAIN_LINT 'setroot wakes only watchers of changed keys' '
+	flux kvs namespace-create testns6 &&
+	flux kvs --namespace=testns6 put a=1 b=1 c=1 &&
+	flux kvs --namespace=testns6 get --watch --count=2 a >dispatch_a.out &
+	pida=$! &&
+	flux kvs --namespace=testns6 get --watch --count=2 b >dispatch_b.out &
+	pidb=$! &&
+	flux kvs --namespace=testns6 get --watch --count=2 c >dispatch_c.out &
+	pidc=$! &&
+	wait_watcherscount testns6 3 &&
+	flux kvs --namespace=testns6 put a=2 &&
+	wait $pida &&
+	examined=$(flux module stats \
+		--parse namespaces.testns6.dispatch.examined kvs-watch) &&
+	woken=$(flux module stats \
+		--parse namespaces.testns6.dispatch.woken kvs-watch) &&
+	test $examined -eq 1 &&
+	test $woken -eq 1 &&
+	flux kvs --namespace=testns6 put b=2 c=2 &&
+	wait $pidb &&
+	wait $pidc &&
+	flux kvs namespace-remove testns6
+'
+
+test_expect_success NO_CHAIN_LINT 'watchers of the same key share lookups' '
+	flux kvs namespace-create testns7 &&
+	flux kvs --namespace=testns7 put a=1 z=1 &&
+	flux kvs --namespace=testns7 get --watch --count=2 a >share1.out &
+	pid1=$! &&
+	flux kvs --namespace=testns7 get --watch --count=2 a >share2.out &
+	pid2=$! &&
+	flux kvs --namespace=testns7 get --watch --count=2 a >share3.out &
+	pid3=$! &&
+	flux kvs --namespace=testns7 get --watch --count=2 z >share4.out &
+	pid4=$! &&
+	wait_watcherscount testns7 4 &&
+	flux kvs --namespace=testns7 put a=2 &&
+	wait $pid1 && wait $pid2 && wait $pid3 &&
+	printf "1\n2\n" >share.exp &&
+	test_cmp share.exp share1.out &&
+	test_cmp share.exp share2.out &&
+	test_cmp share.exp share3.out &&
+	shared=$(flux module stats \
+		--parse namespaces.testns7.lookups.shared kvs-watch) &&
+	test $shared -eq 2 &&
+	flux kvs --namespace=testns7 put z=2 &&
+	wait $pid4 &&
+	flux kvs namespace-remove testns7
+'
+
+test_expect_success NO_CHAIN_LINT 'flux kvs get --watch --append returns appended data' '
+	flux kvs put --append test.append=foo &&
+	flux kvs get --watch --append --count=4 test.append >append1.out &
+	pid=$! &&
+	wait_watcherscount_nonzero primary &&
+	flux kvs put --append test.append=bar &&
+	flux kvs put --append test.append=baz &&
+	flux kvs put --append test.append=meep &&
+	wait $pid &&
+	printf "foo\nbar\nbaz\nmeep\n" >append1.exp &&
+	test_cmp append1.exp append1.out
+'
+
+test_expect_success NO_CHAIN_LINT 'flux kvs get --watch --append fails on overwrite' '
+	flux kvs put --append test.append2=foo &&
+	flux kvs put --append test.append2=bar &&
+	flux kvs get --watch --append --count=2 test.append2 >append2.out &
+	pid=$! &&
+	wait_watcherscount_nonzero primary &&
+	flux kvs put test.append2=xyz &&
+	! wait $pid
+'
+
+test_expect_success NO_CHAIN_LINT 'flux kvs get --watch --append works with --waitcreate' '
+	flux kvs get --watch --waitcreate --append --count=2 test.append3 \
+		>append3.out &
+	pid=$! &&
+	wait_watcherscount_nonzero primary &&
+	flux kvs put --append test.append3=foo &&
+	flux kvs put --append test.append3=bar &&
+	wait $pid &&
+	printf "foo\nbar\n" >append3.exp &&
+	test_cmp append3.exp append3.out
+'
+
+test_expect_success 'flux kvs get --append fails without --watch' '
+	test_must_fail flux kvs get --append test.append
+'
+
+test_expect_success 'flux kvs get --watch --append --full fails' '
+	test_must_fail flux kvs get --watch --append --full test.append
+'
+
 test_done
@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+
+test_description='Test kvs with treeobj-format=binary
+
+Run a flux session in which the kvs module on every rank stores
+directories in the compact binary treeobj format.
+'
+
+. `dirname $0`/sharness.sh
+
+export FLUX_TEST_KVS_OPTIONS="treeobj-format=binary"
+
+SIZE=4
+test_under_flux ${SIZE} kvs
+
+DIR=test.a.b
+
+test_expect_success 'kvs: root directory is stored in binary format' '
+        flux kvs put $DIR.a.b.c=42 $DIR.a.b.d=hello &&
+        BLOBREF=$(flux kvs getroot --blobref) &&
+        flux content load $BLOBREF | head -c 1 | od -An -tx1 >magic.out &&
+        grep -q fe magic.out
+'
+
+test_expect_success 'kvs: values in binary format directories can be read' '
+        test $(flux kvs get $DIR.a.b.c) = 42 &&
+        test $(flux kvs get $DIR.a.b.d) = hello &&
+        flux kvs dir -R $DIR | grep -q "$DIR.a.b.d"
+'
+
+test_expect_success 'kvs: binary format directories can be read on rank 1' '
+        VERS=$(flux kvs version) &&
+        flux exec -n -r 1 sh -c "flux kvs wait ${VERS} && \
+                                 flux kvs get $DIR.a.b.c" >rank1.out &&
+        test $(cat rank1.out) = 42
+'
+
+test_expect_success 'kvs: binary format directories can be updated' '
+        flux kvs put $DIR.a.b.c=43 &&
+        flux kvs unlink $DIR.a.b.d &&
+        test $(flux kvs get $DIR.a.b.c) = 43 &&
+        test_must_fail flux kvs get $DIR.a.b.d
+'
+
+test_done
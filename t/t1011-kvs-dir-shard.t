@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+
+test_description='Test kvs with sharded directories
+
+Run a flux session in which the kvs module on every rank stores
+directories with more than 8 entries as sharded hdir objects.
+'
+
+. `dirname $0`/sharness.sh
+
+export FLUX_TEST_KVS_OPTIONS="dir-shard-threshold=8"
+
+SIZE=4
+test_under_flux ${SIZE} kvs
+
+DIR=test.a.b
+
+test_expect_success 'kvs: large directory is stored sharded' '
+        for i in $(seq 1 100); do echo $DIR.shard.key$i=$i; done >shard.in &&
+        flux kvs put $(cat shard.in) &&
+        flux kvs get --treeobj $DIR.shard | grep -q dirref &&
+        BLOBREF=`flux kvs get --treeobj $DIR.shard | grep -P "sha1-[A-Za-z0-9]+" -o` &&
+        flux content load $BLOBREF | grep -q "\"type\":\"hdir\""
+'
+
+test_expect_success 'kvs: values in sharded directory can be read' '
+        test $(flux kvs get $DIR.shard.key1) = 1 &&
+        test $(flux kvs get $DIR.shard.key100) = 100 &&
+        test_must_fail flux kvs get $DIR.shard.key101
+'
+
+test_expect_success 'kvs: values in sharded directory can be read on rank 1' '
+        VERS=$(flux kvs version) &&
+        flux exec -n -r 1 sh -c "flux kvs wait ${VERS} && \
+                                 flux kvs get $DIR.shard.key42" >rank1.out &&
+        test $(cat rank1.out) = 42
+'
+
+test_expect_success 'kvs: sharded directory can be listed' '
+        flux kvs dir $DIR.shard >shard.out &&
+        test $(wc -l <shard.out) -eq 100 &&
+        grep -q "^$DIR.shard.key42 = 42" shard.out
+'
+
+test_expect_success 'kvs: entries in sharded directory can be updated' '
+        flux kvs put $DIR.shard.key1=foo &&
+        flux kvs unlink $DIR.shard.key2 &&
+        test $(flux kvs get $DIR.shard.key1) = foo &&
+        test_must_fail flux kvs get $DIR.shard.key2 &&
+        test $(flux kvs dir $DIR.shard | wc -l) -eq 99
+'
+
+test_expect_success 'kvs: subdirectory in sharded directory works' '
+        flux kvs put $DIR.shard.subdir.a=1 &&
+        test $(flux kvs get $DIR.shard.subdir.a) = 1 &&
+        flux kvs dir -R $DIR.shard | grep -q "^$DIR.shard.subdir.a = 1"
+'
+
+test_done
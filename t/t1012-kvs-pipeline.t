@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+
+test_description='Test kvs with a transaction pipeline
+
+Run a flux session in which the kvs module on every rank may process up
+to 4 non-conflicting transactions at once.
+'
+
+. `dirname $0`/sharness.sh
+
+export FLUX_TEST_KVS_OPTIONS="transaction-pipeline=4"
+
+SIZE=4
+test_under_flux ${SIZE} kvs
+
+DIR=test.a.b
+
+test_expect_success 'kvs: concurrent unmerged commits all succeed' '
+        flux module stats -c kvs &&
+        ${FLUX_BUILD_DIR}/t/kvs/commit --nomerge 1 4 50 $DIR.pipeline &&
+        test $(flux kvs get $DIR.pipeline.0.0.49) = 42 &&
+        test $(flux kvs get $DIR.pipeline.0.3.49) = 42
+'
+
+test_expect_success 'kvs: concurrent unmerged commits from rank 1 succeed' '
+        flux exec -n -r 1 ${FLUX_BUILD_DIR}/t/kvs/commit --nomerge \
+                1 4 50 $DIR.pipeline1 &&
+        test $(flux kvs get $DIR.pipeline1.0.0.49) = 42 &&
+        test $(flux kvs get $DIR.pipeline1.0.3.49) = 42
+'
+
+test_expect_success 'kvs: pipeline stats count commits' '
+        COMMITS=$(flux module stats --parse "namespace.primary.pipeline.#commits" kvs) &&
+        test $COMMITS -ge 400 &&
+        flux module stats --parse "namespace.primary.pipeline.load stage.#stalls" kvs &&
+        flux module stats -c kvs &&
+        test $(flux module stats --parse "namespace.primary.pipeline.#commits" kvs) -eq 0
+'
+
+test_done
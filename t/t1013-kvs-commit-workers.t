@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+
+test_description='Test kvs with commit worker threads
+
+Run a flux session in which the kvs module on every rank encodes and
+hashes new objects in 2 worker threads.
+'
+
+. `dirname $0`/sharness.sh
+
+export FLUX_TEST_KVS_OPTIONS="commit-workers=2"
+
+SIZE=4
+test_under_flux ${SIZE} kvs
+
+DIR=test.a.b
+
+test_expect_success 'kvs: commits with large values succeed with workers' '
+        LARGE=$(printf "%0100d" 0) &&
+        flux kvs put $DIR.workers.a=$LARGE $DIR.workers.b.c=1 &&
+        test $(flux kvs get $DIR.workers.a) = $LARGE &&
+        test $(flux kvs get $DIR.workers.b.c) = 1
+'
+
+test_expect_success 'kvs: commits in several namespaces succeed with workers' '
+        for ns in workers1 workers2 workers3; do
+                flux kvs namespace-create $ns &&
+                flux kvs --namespace=$ns put $DIR.x=$ns || return 1
+        done &&
+        for ns in workers1 workers2 workers3; do
+                test $(flux kvs --namespace=$ns get $DIR.x) = $ns || return 1
+        done &&
+        for ns in workers1 workers2 workers3; do
+                flux kvs namespace-remove $ns || return 1
+        done
+'
+
+test_expect_success 'kvs: concurrent commits succeed with workers' '
+        ${FLUX_BUILD_DIR}/t/kvs/commit 1 4 50 $DIR.workers.commit &&
+        test $(flux kvs get $DIR.workers.commit.0.3.49) = 42
+'
+
+test_expect_success 'kvs: values committed with workers can be read on rank 1' '
+        VERS=$(flux kvs version) &&
+        flux exec -n -r 1 sh -c "flux kvs wait ${VERS} && \
+                                 flux kvs get $DIR.workers.b.c" >rank1.out &&
+        test $(cat rank1.out) = 1
+'
+
+test_done
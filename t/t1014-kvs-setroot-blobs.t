@@ -0,0 +1,39 @@
+#!/bin/sh
+#
+
+test_description='Test kvs with objects carried in setroot events
+
+Run a flux session in which the kvs module on every rank includes up
+to 64K of new objects in each kvs.setroot event, and followers prime
+their cache with them.
+'
+
+. `dirname $0`/sharness.sh
+
+export FLUX_TEST_KVS_OPTIONS="setroot-blobs=65536"
+
+SIZE=4
+test_under_flux ${SIZE} kvs
+
+DIR=test.a.b
+
+test_expect_success 'kvs: values committed on rank 0 can be read on rank 1' '
+        flux kvs put $DIR.primed.a.b.c=1 &&
+        VERS=$(flux kvs version) &&
+        flux exec -n -r 1 sh -c "flux kvs wait ${VERS} && \
+                                 flux kvs get $DIR.primed.a.b.c" >rank1.out &&
+        test $(cat rank1.out) = 1
+'
+
+test_expect_success 'kvs: followers prime their cache from setroot events' '
+        flux exec -n -r 1 flux module stats -c kvs &&
+        flux kvs put $DIR.primed.a.b.d=2 &&
+        VERS=$(flux kvs version) &&
+        flux exec -n -r 1 sh -c "flux kvs wait ${VERS}" &&
+        PRIMED=$(flux exec -n -r 1 flux module stats \
+                 --parse "cache.#obj primed" kvs) &&
+        test $PRIMED -ge 3 &&
+        test $(flux exec -n -r 1 flux kvs get $DIR.primed.a.b.d) = 2
+'
+
+test_done
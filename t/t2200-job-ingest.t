@@ -149,6 +149,18 @@ test_expect_success HAVE_FLUX_SECURITY 'job-ingest: non-owner mech=none fails' '
 	grep -q "only instance owner" badrole.out
 '
 
+test_expect_success 'job-ingest: stats report batches and latency' '
+	test $(flux module stats --parse "#batches" job-ingest) -gt 0 &&
+	test $(flux module stats --parse "latency (ms).count" job-ingest) \
+		-ge 200 &&
+	flux module stats --parse "batch size (jobs).histogram" job-ingest
+'
+
+test_expect_success 'job-ingest: stats can be cleared' '
+	flux module stats --clear job-ingest &&
+	test $(flux module stats --parse "#batches" job-ingest) -eq 0
+'
+
 test_expect_success 'job-ingest: remove modules' '
 	flux module remove -r 0 job-manager &&
 	flux module remove -r all job-ingest
@@ -0,0 +1,47 @@
+#!/bin/sh
+
+test_description='Test flux job ingest service with capped batches
+
+Run job-ingest with batches of at most 2 jobs and only one batch
+in flight at a time.
+'
+
+. $(dirname $0)/sharness.sh
+
+if flux job submitbench --help 2>&1 | grep -q sign-type; then
+    SUBMITBENCH_OPT_NONE="--sign-type=none"
+fi
+
+test_under_flux 4 kvs
+
+flux setattr log-stderr-level 1
+
+JOBSPEC=${SHARNESS_TEST_SRCDIR}/jobspec
+SUBMITBENCH="flux job submitbench $SUBMITBENCH_OPT_NONE"
+
+test_expect_success 'job-ingest: load job-ingest with batch-max-jobs=2' '
+	flux module load -r all job-ingest \
+		batch-max-jobs=2 batch-max-inflight=1 &&
+	test $(flux module stats --parse batch-max-jobs job-ingest) -eq 2
+'
+
+test_expect_success 'job-ingest: load job-manager-dummy module' '
+	flux module load -r 0 \
+		${FLUX_BUILD_DIR}/t/ingest/.libs/job-manager-dummy.so
+'
+
+test_expect_success 'job-ingest: batches are capped at batch-max-jobs' '
+	${SUBMITBENCH} -r 100 ${JOBSPEC}/valid/basic.yaml &&
+	test $(flux module stats --parse "latency (ms).count" job-ingest) \
+		-eq 100 &&
+	test $(flux module stats --type int \
+		--parse "batch size (jobs).max" job-ingest) -le 2 &&
+	test $(flux module stats --parse "#batches" job-ingest) -ge 50
+'
+
+test_expect_success 'job-ingest: remove modules' '
+	flux module remove -r 0 job-manager &&
+	flux module remove -r all job-ingest
+'
+
+test_done
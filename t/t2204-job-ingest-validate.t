@@ -0,0 +1,82 @@
+#!/bin/sh
+
+test_description='Test flux job ingest service with validate workers
+
+Run job-ingest with submit requests validated in 4 worker threads.
+'
+
+. $(dirname $0)/sharness.sh
+
+if test -x ${FLUX_BUILD_DIR}/src/cmd/flux-jobspec-validate; then
+    test_set_prereq ENABLE_JOBSPEC
+fi
+if flux job submitbench --help 2>&1 | grep -q sign-type; then
+    test_set_prereq HAVE_FLUX_SECURITY
+    SUBMITBENCH_OPT_NONE="--sign-type=none"
+fi
+
+test_under_flux 4 kvs
+
+flux setattr log-stderr-level 1
+
+JOBSPEC=${SHARNESS_TEST_SRCDIR}/jobspec
+SUBMITBENCH="flux job submitbench $SUBMITBENCH_OPT_NONE"
+
+test_valid ()
+{
+    local rc=0
+    for job in $*; do
+        ${SUBMITBENCH} ${job} || rc=1
+    done
+    return ${rc}
+}
+
+test_invalid ()
+{
+    local rc=0
+    for job in $*; do
+        ${SUBMITBENCH} ${job} && rc=1
+    done
+    return ${rc}
+}
+
+test_expect_success 'job-ingest: load job-ingest with validate-workers=4' '
+	flux module load -r all job-ingest validate-workers=4 &&
+	test $(flux module stats --parse validate-workers job-ingest) -eq 4
+'
+
+test_expect_success 'job-ingest: load job-manager-dummy module' '
+	flux module load -r 0 \
+		${FLUX_BUILD_DIR}/t/ingest/.libs/job-manager-dummy.so
+'
+
+test_expect_success 'job-ingest: submit job 100 times with validate workers' '
+	${SUBMITBENCH} -r 100 ${JOBSPEC}/valid/use_case_2.6.yaml >ids.out &&
+	test $(sort -u ids.out | wc -l) -eq 100
+'
+
+test_expect_success 'job-ingest: valid jobspecs accepted with validate workers' '
+	test_valid ${JOBSPEC}/valid/*
+'
+
+test_expect_success ENABLE_JOBSPEC 'job-ingest: invalid jobs rejected with validate workers' '
+	test_invalid ${JOBSPEC}/invalid/*
+'
+
+test_expect_success 'job-ingest: priority checked with validate workers' '
+	! FLUX_HANDLE_ROLEMASK=0x2 \
+	    ${SUBMITBENCH} --priority=17 ${JOBSPEC}/valid/basic.yaml
+'
+
+test_expect_success HAVE_FLUX_SECURITY 'job-ingest: submit user != signed user fails with validate workers' '
+	! FLUX_HANDLE_USERID=9999 ${SUBMITBENCH} \
+	     ${JOBSPEC}/valid/basic.yaml 2>baduser.out &&
+	grep -q "signer=$(id -u) != requestor=9999" baduser.out
+'
+
+test_expect_success 'job-ingest: remove modules' '
+	flux module remove -r 0 job-manager &&
+	flux module remove -r all job-ingest
+'
+
+test_done